@@ -11,6 +11,7 @@
 #define Z80_HPP
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
 #include "z80_types.h"
@@ -73,75 +74,95 @@ inline const FlagTables& getFlagTables() {
 
 #include "z80_bus_interface.h"
 
+#ifdef WITH_OPCODE_HISTOGRAM
+#    include "z80_histogram.h"
+#endif
+
+#ifdef WITH_HANDLER_PROFILING
+#    include "z80_handler_profile.h"
+#endif
+
 #define REG_B   regBC.byte8.hi
 #define REG_C   regBC.byte8.lo
-#define REG_BC  regBC.word
+#define REG_BC  Z80_WORD(regBC)
 #define REG_Bx  regBCx.byte8.hi
 #define REG_Cx  regBCx.byte8.lo
-#define REG_BCx regBCx.word
+#define REG_BCx Z80_WORD(regBCx)
 
 #define REG_D   regDE.byte8.hi
 #define REG_E   regDE.byte8.lo
-#define REG_DE  regDE.word
+#define REG_DE  Z80_WORD(regDE)
 #define REG_Dx  regDEx.byte8.hi
 #define REG_Ex  regDEx.byte8.lo
-#define REG_DEx regDEx.word
+#define REG_DEx Z80_WORD(regDEx)
 
 #define REG_H   regHL.byte8.hi
 #define REG_L   regHL.byte8.lo
-#define REG_HL  regHL.word
+#define REG_HL  Z80_WORD(regHL)
 #define REG_Hx  regHLx.byte8.hi
 #define REG_Lx  regHLx.byte8.lo
-#define REG_HLx regHLx.word
+#define REG_HLx Z80_WORD(regHLx)
 
 #define REG_IXh regIX.byte8.hi
 #define REG_IXl regIX.byte8.lo
-#define REG_IX  regIX.word
+#define REG_IX  Z80_WORD(regIX)
 
 #define REG_IYh regIY.byte8.hi
 #define REG_IYl regIY.byte8.lo
-#define REG_IY  regIY.word
+#define REG_IY  Z80_WORD(regIY)
 
 #define REG_Ax  regAFx.byte8.hi
 #define REG_Fx  regAFx.byte8.lo
-#define REG_AFx regAFx.word
+#define REG_AFx Z80_WORD(regAFx)
 
 #define REG_PCh regPC.byte8.hi
 #define REG_PCl regPC.byte8.lo
-#define REG_PC  regPC.word
+#define REG_PC  Z80_WORD(regPC)
 
 #define REG_S  regSP.byte8.hi
 #define REG_P  regSP.byte8.lo
-#define REG_SP regSP.word
+#define REG_SP Z80_WORD(regSP)
 
 #define REG_W  memptr.byte8.hi
 #define REG_Z  memptr.byte8.lo
-#define REG_WZ memptr.word
+#define REG_WZ Z80_WORD(memptr)
+
+// Notifica al bus los cambios de flujo: CALL, RST, RET, interrupciones
+#ifdef WITH_FLOW_EVENTS
+#    define Z80_FLOW_EVENT(kind, from, to) m_busInterface->flowEvent(kind, from, to, REG_SP)
+#else
+#    define Z80_FLOW_EVENT(kind, from, to)
+#endif
 
-template <typename TBusInterface> class Z80 {
+// Anota la entrada del decodificador a la que se carga el tiempo de la instrucción
+#ifdef WITH_HANDLER_PROFILING
+#    define Z80_HANDLER_SELECT(table, opcode)                                                                          \
+        if (m_handlerProfile != nullptr) {                                                                             \
+            m_handlerProfile->select(table, opcode);                                                                   \
+        }
+#else
+#    define Z80_HANDLER_SELECT(table, opcode)
+#endif
+
+template <typename TBusInterface> class alignas(64) Z80 {
   public:
+    // A copy would share the bus with the original; move or rebind() instead
     Z80(const Z80&) = delete;
     Z80& operator=(const Z80&) = delete;
-    Z80(Z80&&) = delete;
-    Z80& operator=(Z80&&) = delete;
+    Z80(Z80&&) noexcept = default;
+    Z80& operator=(Z80&&) noexcept = default;
 
     // Modos de interrupción
     enum class IntMode : uint8_t { IM0, IM1, IM2 };
 
+    // Bytes per instance, one cache line; a handler profiling build, slow anyway, may take two
+#ifdef WITH_HANDLER_PROFILING
+    static constexpr size_t kSizeBudget = 128;
+#else
+    static constexpr size_t kSizeBudget = 64;
+#endif
+
   private:
-    TBusInterface& m_busInterface;
-    // Código de instrucción a ejecutar
-    // Poner esta variable como local produce peor rendimiento
-    // ZEXALL test: (local) 1:54 vs 1:47 (visitante)
-    uint8_t m_opCode{};
-    // Se está ejecutando una instrucción prefijada con DD, ED o FD
-    // Los valores permitidos son [0x00, 0xDD, 0xED, 0xFD]
-    // El prefijo 0xCB queda al margen porque, detrás de 0xCB, siempre
-    // viene un código de instrucción válido, tanto si delante va un
-    // 0xDD o 0xFD como si no.
-    uint8_t prefixOpcode = {0x00};
-    // Subsistema de notificaciones
-    bool execDone{false};
     // Posiciones de los flags
     const static uint8_t CARRY_MASK = 0x01;
     const static uint8_t ADDSUB_MASK = 0x02;
@@ -158,58 +179,31 @@ template <typename TBusInterface> class Z80 {
     const static uint8_t FLAG_SZHN_MASK = FLAG_SZ_MASK | HALFCARRY_MASK | ADDSUB_MASK;
     const static uint8_t FLAG_SZP_MASK = FLAG_SZ_MASK | PARITY_MASK;
     const static uint8_t FLAG_SZHP_MASK = FLAG_SZP_MASK | HALFCARRY_MASK;
-    // Acumulador y resto de registros de 8 bits
-    uint8_t regA{};
-    // Flags sIGN, zERO, 5, hALFCARRY, 3, pARITY y ADDSUB (n)
-    uint8_t sz5h3pnFlags{};
-    // El flag Carry es el único que se trata aparte
-    bool carryFlag{};
-    // Registros principales y alternativos
-    RegisterPair regBC{}, regBCx{}, regDE{}, regDEx{}, regHL{}, regHLx{};
-    /* Flags para indicar la modificación del registro F en la instrucción actual
-     * y en la anterior.
-     * Son necesarios para emular el comportamiento de los bits 3 y 5 del
-     * registro F con las instrucciones CCF/SCF.
-     *
-     * http://www.worldofspectrum.org/forums/showthread.php?t=41834
-     * http://www.worldofspectrum.org/forums/showthread.php?t=41704
-     *
-     * Thanks to Patrik Rak for his tests and investigations.
+
+    /* Member layout: the class is aligned to a cache line and everything that
+     * execute() touches on every instruction comes first, so that the hot
+     * state of a CPU is a single 64-byte line. The alternate registers and
+     * the rarely used pins follow; they still fit in the same line today,
+     * but nothing on the fast path depends on that. kSizeBudget is checked
+     * in the constructors so that a new member cannot silently push a CPU
+     * over one line, which matters when thousands of them live in a pool.
      */
-    bool flagQ{}, lastFlagQ{};
 
-    // Acumulador alternativo y flags -- 8 bits
-    RegisterPair regAFx{};
+    // --- Hot: read or written by (almost) every instruction ---
 
+    // Pointer rather than reference so that CPUs can be moved, pooled and rebound
+    TBusInterface* m_busInterface{nullptr};
     // Registros de propósito específico
     // *PC -- Program Counter -- 16 bits*
     RegisterPair regPC{};
+    // *SP -- Stack Pointer -- 16 bits*
+    RegisterPair regSP{};
+    // Registros principales
+    RegisterPair regBC{}, regDE{}, regHL{};
     // *IX -- Registro de índice -- 16 bits*
     RegisterPair regIX{};
     // *IY -- Registro de índice -- 16 bits*
     RegisterPair regIY{};
-    // *SP -- Stack Pointer -- 16 bits*
-    RegisterPair regSP{};
-    // *I -- Vector de interrupción -- 8 bits*
-    uint8_t regI{};
-    // *R -- Refresco de memoria -- 7 bits*
-    uint8_t regR{};
-    // *R7 -- Refresco de memoria -- 1 bit* (bit superior de R)
-    bool regRbit7{};
-    // Flip-flops de interrupción
-    bool ffIFF1 = false;
-    bool ffIFF2 = false;
-    // EI solo habilita las interrupciones DESPUES de ejecutar la
-    // siguiente instrucción (excepto si la siguiente instrucción es un EI...)
-    bool pendingEI = false;
-    // Estado de la línea NMI
-    bool activeNMI = false;
-    // Modo de interrupción
-    IntMode modeINT = IntMode::IM0;
-    // halted == true cuando la CPU está ejecutando un HALT (28/03/2010)
-    bool halted = false;
-    // pinReset == true, se ha producido un reset a través de la patilla
-    bool pinReset = false;
     /*
      * Registro interno que usa la CPU de la siguiente forma
      *
@@ -230,589 +224,695 @@ template <typename TBusInterface> class Z80 {
      *                registro en TODAS las otras instrucciones.
      *                Shit yourself, little parrot.
      */
-
     RegisterPair memptr{};
+    // Acumulador
+    uint8_t regA{};
+    // Flags sIGN, zERO, 5, hALFCARRY, 3, pARITY y ADDSUB (n)
+    uint8_t sz5h3pnFlags{};
+    // El flag Carry es el único que se trata aparte
+    bool carryFlag{};
+    /* Flags para indicar la modificación del registro F en la instrucción actual
+     * y en la anterior.
+     * Son necesarios para emular el comportamiento de los bits 3 y 5 del
+     * registro F con las instrucciones CCF/SCF.
+     *
+     * http://www.worldofspectrum.org/forums/showthread.php?t=41834
+     * http://www.worldofspectrum.org/forums/showthread.php?t=41704
+     *
+     * Thanks to Patrik Rak for his tests and investigations.
+     */
+    bool flagQ{}, lastFlagQ{};
+    // Código de instrucción a ejecutar
+    // Poner esta variable como local produce peor rendimiento
+    // ZEXALL test: (local) 1:54 vs 1:47 (visitante)
+    uint8_t m_opCode{};
+    // Se está ejecutando una instrucción prefijada con DD, ED o FD
+    // Los valores permitidos son [0x00, 0xDD, 0xED, 0xFD]
+    // El prefijo 0xCB queda al margen porque, detrás de 0xCB, siempre
+    // viene un código de instrucción válido, tanto si delante va un
+    // 0xDD o 0xFD como si no.
+    uint8_t prefixOpcode = {0x00};
+    // *R -- Refresco de memoria -- 7 bits*
+    uint8_t regR{};
+    // *R7 -- Refresco de memoria -- 1 bit* (bit superior de R)
+    bool regRbit7{};
+    // halted == true cuando la CPU está ejecutando un HALT (28/03/2010)
+    bool halted = false;
+    // Flip-flop de interrupción, consultado tras cada instrucción
+    bool ffIFF1 = false;
+    // EI solo habilita las interrupciones DESPUES de ejecutar la
+    // siguiente instrucción (excepto si la siguiente instrucción es un EI...)
+    bool pendingEI = false;
+    // Estado de la línea NMI
+    bool activeNMI = false;
+
+    // --- Cold: exchanges, interrupt setup, pins and notifications ---
+
+    // Registros alternativos
+    RegisterPair regBCx{}, regDEx{}, regHLx{};
+    // Acumulador alternativo y flags -- 8 bits
+    RegisterPair regAFx{};
+    // *I -- Vector de interrupción -- 8 bits*
+    uint8_t regI{};
+    // Solo se consulta con RETN y LD A,I / LD A,R
+    bool ffIFF2 = false;
+    // Modo de interrupción
+    IntMode modeINT = IntMode::IM0;
+    // pinReset == true, se ha producido un reset a través de la patilla
+    bool pinReset = false;
+    // Subsistema de notificaciones
+    bool execDone{false};
+// Un true en una dirección indica que se debe notificar que se va a
+// ejecutar la instrucción que está en esa direción.
+#ifdef WITH_BREAKPOINT_SUPPORT
+    bool breakpointEnabled{false};
+#endif // Z80_HPP
+#ifdef WITH_OPCODE_HISTOGRAM
+    // Contadores de ejecución por código de operación, nullptr == no se cuenta
+    Z80OpcodeHistogram* m_histogram{nullptr};
+#endif
+#ifdef WITH_HANDLER_PROFILING
+    // Tiempo de host por código de operación, nullptr == no se mide
+    Z80HandlerProfile* m_handlerProfile{nullptr};
+#endif
+
     // I and R registers
-    [[nodiscard]] inline RegisterPair getPairIR() const;
+    [[nodiscard]] Z80_CONSTEXPR inline RegisterPair getPairIR() const;
 
     /* Algunos flags se precalculan para un tratamiento más rápido
      * Concretamente, SIGN, ZERO, los bits 3, 5, PARITY y ADDSUB:
-     * sz53n_addTable tiene el ADDSUB flag a 0 y paridad sin calcular
-     * sz53pn_addTable tiene el ADDSUB flag a 0 y paridad calculada
-     * sz53n_subTable tiene el ADDSUB flag a 1 y paridad sin calcular
-     * sz53pn_subTable tiene el ADDSUB flag a 1 y paridad calculada
+     * kFlagTables.sz53n_add tiene el ADDSUB flag a 0 y paridad sin calcular
+     * kFlagTables.sz53pn_add tiene el ADDSUB flag a 0 y paridad calculada
+     * kFlagTables.sz53n_sub tiene el ADDSUB flag a 1 y paridad sin calcular
+     * kFlagTables.sz53pn_sub tiene el ADDSUB flag a 1 y paridad calculada
      * El resto de bits están a 0 en las cuatro tablas lo que es
      * importante para muchas operaciones que ponen ciertos flags a 0 por real
      * decreto. Si lo ponen a 1 por el mismo método basta con hacer un OR con
      * la máscara correspondiente.
+     * Las tablas se usan directamente, sin referencias en cada instancia.
      */
-    const std::array<uint8_t, 256>& sz53n_addTable;
-    const std::array<uint8_t, 256>& sz53pn_addTable;
-    const std::array<uint8_t, 256>& sz53n_subTable;
-    const std::array<uint8_t, 256>& sz53pn_subTable;
 
-// Un true en una dirección indica que se debe notificar que se va a
-// ejecutar la instrucción que está en esa direción.
-#ifdef WITH_BREAKPOINT_SUPPORT
-    bool breakpointEnabled{false};
-#endif // Z80_HPP
-    void copyToRegister(uint8_t opCode, uint8_t value);
-    void adjustINxROUTxRFlags();
+    Z80_CONSTEXPR void copyToRegister(uint8_t opCode, uint8_t value);
+    Z80_CONSTEXPR void adjustINxROUTxRFlags();
 
   public:
     // Constructor de la clase
-    explicit Z80(TBusInterface& ops);
-    ~Z80();
+    Z80_CONSTEXPR explicit Z80(TBusInterface& ops);
+    // CPU sin bus asociado, hay que llamar a rebind() antes de execute()
+    // Unbound CPU, call rebind() before execute()
+    Z80_CONSTEXPR Z80();
+    Z80_CONSTEXPR ~Z80();
+
+    // Conecta la CPU a otro bus sin tocar su estado
+    // Attach the CPU to another bus, keeping its state
+    Z80_CONSTEXPR void rebind(TBusInterface& ops) {
+        m_busInterface = &ops;
+    }
+
+    [[nodiscard]] Z80_CONSTEXPR TBusInterface* getBus() const {
+        return m_busInterface;
+    }
 
     // Acceso a registros de 8 bits
     // Access to 8-bit registers
-    [[nodiscard]] uint8_t getRegA() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegA() const {
         return regA;
     }
 
-    void setRegA(uint8_t value) {
+    Z80_CONSTEXPR void setRegA(uint8_t value) {
         regA = value;
     }
 
-    [[nodiscard]] uint8_t getRegB() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegB() const {
         return REG_B;
     }
 
-    void setRegB(uint8_t value) {
+    Z80_CONSTEXPR void setRegB(uint8_t value) {
         REG_B = value;
     }
 
-    [[nodiscard]] uint8_t getRegC() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegC() const {
         return REG_C;
     }
 
-    void setRegC(uint8_t value) {
+    Z80_CONSTEXPR void setRegC(uint8_t value) {
         REG_C = value;
     }
 
-    [[nodiscard]] uint8_t getRegD() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegD() const {
         return REG_D;
     }
 
-    void setRegD(uint8_t value) {
+    Z80_CONSTEXPR void setRegD(uint8_t value) {
         REG_D = value;
     }
 
-    [[nodiscard]] uint8_t getRegE() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegE() const {
         return REG_E;
     }
 
-    void setRegE(uint8_t value) {
+    Z80_CONSTEXPR void setRegE(uint8_t value) {
         REG_E = value;
     }
 
-    [[nodiscard]] uint8_t getRegH() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegH() const {
         return REG_H;
     }
 
-    void setRegH(uint8_t value) {
+    Z80_CONSTEXPR void setRegH(uint8_t value) {
         REG_H = value;
     }
 
-    [[nodiscard]] uint8_t getRegL() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegL() const {
         return REG_L;
     }
 
-    void setRegL(uint8_t value) {
+    Z80_CONSTEXPR void setRegL(uint8_t value) {
         REG_L = value;
     }
 
     // Acceso a registros alternativos de 8 bits
     // Access to alternate 8-bit registers
-    [[nodiscard]] uint8_t getRegAx() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegAx() const {
         return REG_Ax;
     }
 
-    void setRegAx(uint8_t value) {
+    Z80_CONSTEXPR void setRegAx(uint8_t value) {
         REG_Ax = value;
     }
 
-    [[nodiscard]] uint8_t getRegFx() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegFx() const {
         return REG_Fx;
     }
 
-    void setRegFx(uint8_t value) {
+    Z80_CONSTEXPR void setRegFx(uint8_t value) {
         REG_Fx = value;
     }
 
-    [[nodiscard]] uint8_t getRegBx() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegBx() const {
         return REG_Bx;
     }
 
-    void setRegBx(uint8_t value) {
+    Z80_CONSTEXPR void setRegBx(uint8_t value) {
         REG_Bx = value;
     }
 
-    [[nodiscard]] uint8_t getRegCx() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegCx() const {
         return REG_Cx;
     }
 
-    void setRegCx(uint8_t value) {
+    Z80_CONSTEXPR void setRegCx(uint8_t value) {
         REG_Cx = value;
     }
 
-    [[nodiscard]] uint8_t getRegDx() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegDx() const {
         return REG_Dx;
     }
 
-    void setRegDx(uint8_t value) {
+    Z80_CONSTEXPR void setRegDx(uint8_t value) {
         REG_Dx = value;
     }
 
-    [[nodiscard]] uint8_t getRegEx() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegEx() const {
         return REG_Ex;
     }
 
-    void setRegEx(uint8_t value) {
+    Z80_CONSTEXPR void setRegEx(uint8_t value) {
         REG_Ex = value;
     }
 
-    [[nodiscard]] uint8_t getRegHx() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegHx() const {
         return REG_Hx;
     }
 
-    void setRegHx(uint8_t value) {
+    Z80_CONSTEXPR void setRegHx(uint8_t value) {
         REG_Hx = value;
     }
 
-    [[nodiscard]] uint8_t getRegLx() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegLx() const {
         return REG_Lx;
     }
 
-    void setRegLx(uint8_t value) {
+    Z80_CONSTEXPR void setRegLx(uint8_t value) {
         REG_Lx = value;
     }
 
     // Acceso a registros de 16 bits
     // Access to registers pairs
-    [[nodiscard]] uint16_t getRegAF() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getRegAF() const {
         return (regA << 8) | (carryFlag ? sz5h3pnFlags | CARRY_MASK : sz5h3pnFlags);
     }
 
-    void setRegAF(uint16_t word) {
+    Z80_CONSTEXPR void setRegAF(uint16_t word) {
         regA = word >> 8;
         sz5h3pnFlags = word & 0xfe;
         carryFlag = (word & CARRY_MASK) != 0;
     }
 
-    [[nodiscard]] uint16_t getRegAFx() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getRegAFx() const {
         return REG_AFx;
     }
 
-    void setRegAFx(uint16_t word) {
+    Z80_CONSTEXPR void setRegAFx(uint16_t word) {
         REG_AFx = word;
     }
 
-    [[nodiscard]] uint16_t getRegBC() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getRegBC() const {
         return REG_BC;
     }
 
-    void setRegBC(uint16_t word) {
+    Z80_CONSTEXPR void setRegBC(uint16_t word) {
         REG_BC = word;
     }
 
-    [[nodiscard]] uint16_t getRegBCx() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getRegBCx() const {
         return REG_BCx;
     }
 
-    void setRegBCx(uint16_t word) {
+    Z80_CONSTEXPR void setRegBCx(uint16_t word) {
         REG_BCx = word;
     }
 
-    [[nodiscard]] uint16_t getRegDE() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getRegDE() const {
         return REG_DE;
     }
 
-    void setRegDE(uint16_t word) {
+    Z80_CONSTEXPR void setRegDE(uint16_t word) {
         REG_DE = word;
     }
 
-    [[nodiscard]] uint16_t getRegDEx() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getRegDEx() const {
         return REG_DEx;
     }
 
-    void setRegDEx(uint16_t word) {
+    Z80_CONSTEXPR void setRegDEx(uint16_t word) {
         REG_DEx = word;
     }
 
-    [[nodiscard]] uint16_t getRegHL() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getRegHL() const {
         return REG_HL;
     }
 
-    void setRegHL(uint16_t word) {
+    Z80_CONSTEXPR void setRegHL(uint16_t word) {
         REG_HL = word;
     }
 
-    [[nodiscard]] uint16_t getRegHLx() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getRegHLx() const {
         return REG_HLx;
     }
 
-    void setRegHLx(uint16_t word) {
+    Z80_CONSTEXPR void setRegHLx(uint16_t word) {
         REG_HLx = word;
     }
 
     // Acceso a registros de propósito específico
     // Access to special purpose registers
-    [[nodiscard]] uint16_t getRegPC() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getRegPC() const {
         return REG_PC;
     }
 
-    void setRegPC(uint16_t address) {
+    Z80_CONSTEXPR void setRegPC(uint16_t address) {
         REG_PC = address;
     }
 
-    [[nodiscard]] uint16_t getRegSP() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getRegSP() const {
         return REG_SP;
     }
 
-    void setRegSP(uint16_t word) {
+    Z80_CONSTEXPR void setRegSP(uint16_t word) {
         REG_SP = word;
     }
 
-    [[nodiscard]] uint16_t getRegIX() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getRegIX() const {
         return REG_IX;
     }
 
-    void setRegIX(uint16_t word) {
+    Z80_CONSTEXPR void setRegIX(uint16_t word) {
         REG_IX = word;
     }
 
-    [[nodiscard]] uint16_t getRegIY() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getRegIY() const {
         return REG_IY;
     }
 
-    void setRegIY(uint16_t word) {
+    Z80_CONSTEXPR void setRegIY(uint16_t word) {
         REG_IY = word;
     }
 
-    [[nodiscard]] uint8_t getRegI() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegI() const {
         return regI;
     }
 
-    void setRegI(uint8_t value) {
+    Z80_CONSTEXPR void setRegI(uint8_t value) {
         regI = value;
     }
 
-    [[nodiscard]] uint8_t getRegR() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getRegR() const {
         return regRbit7 ? regR | SIGN_MASK : regR & 0x7f;
     }
 
-    void setRegR(uint8_t value) {
+    Z80_CONSTEXPR void setRegR(uint8_t value) {
         regR = value & 0x7f;
         regRbit7 = (value > 0x7f);
     }
 
     // Acceso al registro oculto MEMPTR
     // Hidden register MEMPTR (known as WZ at Zilog doc?)
-    [[nodiscard]] uint16_t getMemPtr() const {
+    [[nodiscard]] Z80_CONSTEXPR uint16_t getMemPtr() const {
         return REG_WZ;
     }
 
-    void setMemPtr(uint16_t word) {
+    Z80_CONSTEXPR void setMemPtr(uint16_t word) {
         REG_WZ = word;
     }
 
     // Acceso a los flags uno a uno
     // Access to single flags from F register
-    [[nodiscard]] bool isCarryFlag() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isCarryFlag() const {
         return carryFlag;
     }
 
-    void setCarryFlag(bool state) {
+    Z80_CONSTEXPR void setCarryFlag(bool state) {
         carryFlag = state;
     }
 
-    [[nodiscard]] bool isAddSubFlag() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isAddSubFlag() const {
         return (sz5h3pnFlags & ADDSUB_MASK) != 0;
     }
 
-    void setAddSubFlag(bool state);
+    Z80_CONSTEXPR void setAddSubFlag(bool state);
 
-    [[nodiscard]] bool isParOverFlag() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isParOverFlag() const {
         return (sz5h3pnFlags & PARITY_MASK) != 0;
     }
 
-    void setParOverFlag(bool state);
+    Z80_CONSTEXPR void setParOverFlag(bool state);
 
     /* Undocumented flag */
-    [[nodiscard]] bool isBit3Flag() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isBit3Flag() const {
         return (sz5h3pnFlags & BIT3_MASK) != 0;
     }
 
-    void setBit3Flag(bool state);
+    Z80_CONSTEXPR void setBit3Flag(bool state);
 
-    [[nodiscard]] bool isHalfCarryFlag() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isHalfCarryFlag() const {
         return (sz5h3pnFlags & HALFCARRY_MASK) != 0;
     }
 
-    void setHalfCarryFlag(bool state);
+    Z80_CONSTEXPR void setHalfCarryFlag(bool state);
 
     /* Undocumented flag */
-    [[nodiscard]] bool isBit5Flag() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isBit5Flag() const {
         return (sz5h3pnFlags & BIT5_MASK) != 0;
     }
 
-    void setBit5Flag(bool state);
+    Z80_CONSTEXPR void setBit5Flag(bool state);
 
-    [[nodiscard]] bool isZeroFlag() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isZeroFlag() const {
         return (sz5h3pnFlags & ZERO_MASK) != 0;
     }
 
-    void setZeroFlag(bool state);
+    Z80_CONSTEXPR void setZeroFlag(bool state);
 
-    [[nodiscard]] bool isSignFlag() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isSignFlag() const {
         return sz5h3pnFlags >= SIGN_MASK;
     }
 
-    void setSignFlag(bool state);
+    Z80_CONSTEXPR void setSignFlag(bool state);
 
     // Acceso a los flags F
     // Access to F register
-    [[nodiscard]] uint8_t getFlags() const {
+    [[nodiscard]] Z80_CONSTEXPR uint8_t getFlags() const {
         return carryFlag ? sz5h3pnFlags | CARRY_MASK : sz5h3pnFlags;
     }
 
-    void setFlags(uint8_t regF) {
+    Z80_CONSTEXPR void setFlags(uint8_t regF) {
         sz5h3pnFlags = regF & 0xfe;
         carryFlag = (regF & CARRY_MASK) != 0;
     }
 
     // Acceso a los flip-flops de interrupción
     // Interrupt flip-flops
-    [[nodiscard]] bool isIFF1() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isIFF1() const {
         return ffIFF1;
     }
 
-    void setIFF1(bool state) {
+    Z80_CONSTEXPR void setIFF1(bool state) {
         ffIFF1 = state;
     }
 
-    [[nodiscard]] bool isIFF2() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isIFF2() const {
         return ffIFF2;
     }
 
-    void setIFF2(bool state) {
+    Z80_CONSTEXPR void setIFF2(bool state) {
         ffIFF2 = state;
     }
 
-    [[nodiscard]] bool isNMI() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isNMI() const {
         return activeNMI;
     }
 
-    void setNMI(bool nmi) {
+    Z80_CONSTEXPR void setNMI(bool nmi) {
         activeNMI = nmi;
     }
 
     // /NMI is negative level triggered.
-    void triggerNMI() {
+    Z80_CONSTEXPR void triggerNMI() {
         activeNMI = true;
     }
 
     // Acceso al modo de interrupción
     //  Maskable interrupt mode
-    [[nodiscard]] IntMode getIM() const {
+    [[nodiscard]] Z80_CONSTEXPR IntMode getIM() const {
         return modeINT;
     }
 
-    void setIM(IntMode mode) {
+    Z80_CONSTEXPR void setIM(IntMode mode) {
         modeINT = mode;
     }
 
-    [[nodiscard]] bool isHalted() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isHalted() const {
         return halted;
     }
 
-    void setHalted(bool state) {
+    Z80_CONSTEXPR void setHalted(bool state) {
         halted = state;
     }
 
     // Reset requested by /RESET signal (not power-on)
-    void setPinReset() {
+    Z80_CONSTEXPR void setPinReset() {
         pinReset = true;
     }
 
-    [[nodiscard]] bool isPendingEI() const {
+    [[nodiscard]] Z80_CONSTEXPR bool isPendingEI() const {
         return pendingEI;
     }
 
-    void setPendingEI(bool state) {
+    Z80_CONSTEXPR void setPendingEI(bool state) {
         pendingEI = state;
     }
 
+    // Estado completo de la CPU, registros ocultos incluidos
+    // Full CPU state, hidden registers included
+    [[nodiscard]] Z80_CONSTEXPR Z80State getState() const;
+
+    Z80_CONSTEXPR void setState(const Z80State& state);
+
     // Reset
-    void reset();
+    Z80_CONSTEXPR void reset();
 
     // Execute one instruction
-    void execute();
+    Z80_CONSTEXPR void execute();
 
 #ifdef WITH_BREAKPOINT_SUPPORT
-    [[nodiscard]] bool isBreakpoint() {
+    [[nodiscard]] Z80_CONSTEXPR bool isBreakpoint() {
         return breakpointEnabled;
     }
 
-    void setBreakpoint(bool state) {
+    Z80_CONSTEXPR void setBreakpoint(bool state) {
         breakpointEnabled = state;
     }
 #endif
 
 #ifdef WITH_EXEC_DONE
-    void setExecDone(bool status) {
+    Z80_CONSTEXPR void setExecDone(bool status) {
         execDone = status;
     }
 #endif
 
+#ifdef WITH_OPCODE_HISTOGRAM
+    // Count every executed opcode in 'histogram', which may be shared by several CPUs of one thread
+    Z80_CONSTEXPR void setOpcodeHistogram(Z80OpcodeHistogram* histogram) {
+        m_histogram = histogram;
+    }
+
+    [[nodiscard]] Z80_CONSTEXPR Z80OpcodeHistogram* getOpcodeHistogram() const {
+        return m_histogram;
+    }
+#endif
+
+#ifdef WITH_HANDLER_PROFILING
+    // Time every executed opcode handler into 'profile', which may be shared by several CPUs of one thread
+    Z80_CONSTEXPR void setHandlerProfile(Z80HandlerProfile* profile) {
+        m_handlerProfile = profile;
+    }
+
+    [[nodiscard]] Z80_CONSTEXPR Z80HandlerProfile* getHandlerProfile() const {
+        return m_handlerProfile;
+    }
+#endif
+
   private:
     // Rota a la izquierda el valor del argumento
-    inline void rlc(uint8_t& oper8);
+    Z80_CONSTEXPR inline void rlc(uint8_t& oper8);
 
     // Rota a la izquierda el valor del argumento
-    inline void rl(uint8_t& oper8);
+    Z80_CONSTEXPR inline void rl(uint8_t& oper8);
 
     // Rota a la izquierda el valor del argumento
-    inline void sla(uint8_t& oper8);
+    Z80_CONSTEXPR inline void sla(uint8_t& oper8);
 
     // Rota a la izquierda el valor del argumento (como sla salvo por el bit 0)
-    inline void sll(uint8_t& oper8);
+    Z80_CONSTEXPR inline void sll(uint8_t& oper8);
 
     // Rota a la derecha el valor del argumento
-    inline void rrc(uint8_t& oper8);
+    Z80_CONSTEXPR inline void rrc(uint8_t& oper8);
 
     // Rota a la derecha el valor del argumento
-    inline void rr(uint8_t& oper8);
+    Z80_CONSTEXPR inline void rr(uint8_t& oper8);
 
     // Rota a la derecha 1 bit el valor del argumento
-    inline void sra(uint8_t& oper8);
+    Z80_CONSTEXPR inline void sra(uint8_t& oper8);
 
     // Rota a la derecha 1 bit el valor del argumento
-    inline void srl(uint8_t& oper8);
+    Z80_CONSTEXPR inline void srl(uint8_t& oper8);
 
     // Incrementa un valor de 8 bits modificando los flags oportunos
-    inline void inc8(uint8_t& oper8);
+    Z80_CONSTEXPR inline void inc8(uint8_t& oper8);
 
     // Decrementa un valor de 8 bits modificando los flags oportunos
-    inline void dec8(uint8_t& oper8);
+    Z80_CONSTEXPR inline void dec8(uint8_t& oper8);
 
     // Suma de 8 bits afectando a los flags
-    inline void add(uint8_t oper8);
+    Z80_CONSTEXPR inline void add(uint8_t oper8);
 
     // Suma con acarreo de 8 bits
-    inline void adc(uint8_t oper8);
+    Z80_CONSTEXPR inline void adc(uint8_t oper8);
 
     // Suma dos operandos de 16 bits sin carry afectando a los flags
-    inline void add16(RegisterPair& reg16, uint16_t oper16);
+    Z80_CONSTEXPR inline void add16(RegisterPair& reg16, uint16_t oper16);
 
     // Suma con acarreo de 16 bits
-    inline void adc16(uint16_t reg16);
+    Z80_CONSTEXPR inline void adc16(uint16_t reg16);
 
     // Resta de 8 bits
-    inline void sub(uint8_t oper8);
+    Z80_CONSTEXPR inline void sub(uint8_t oper8);
 
     // Resta con acarreo de 8 bits
-    inline void sbc(uint8_t oper8);
+    Z80_CONSTEXPR inline void sbc(uint8_t oper8);
 
     // Resta con acarreo de 16 bits
-    inline void sbc16(uint16_t reg16);
+    Z80_CONSTEXPR inline void sbc16(uint16_t reg16);
 
     // Operación AND lógica
     // Simple 'and' is C++ reserved keyword
-    inline void and_(uint8_t oper8);
+    Z80_CONSTEXPR inline void and_(uint8_t oper8);
 
     // Operación XOR lógica
     // Simple 'xor' is C++ reserved keyword
-    inline void xor_(uint8_t oper8);
+    Z80_CONSTEXPR inline void xor_(uint8_t oper8);
 
     // Operación OR lógica
     // Simple 'or' is C++ reserved keyword
-    inline void or_(uint8_t oper8);
+    Z80_CONSTEXPR inline void or_(uint8_t oper8);
 
     // Operación de comparación con el registro A
     // es como SUB, pero solo afecta a los flags
     // Los flags SIGN y ZERO se calculan a partir del resultado
     // Los flags 3 y 5 se copian desde el operando (sigh!)
-    inline void cp(uint8_t oper8);
+    Z80_CONSTEXPR inline void cp(uint8_t oper8);
 
     // DAA
-    inline void daa();
+    Z80_CONSTEXPR inline void daa();
 
     // POP
-    inline uint16_t pop();
+    Z80_CONSTEXPR inline uint16_t pop();
 
     // PUSH
-    inline void push(uint16_t word);
+    Z80_CONSTEXPR inline void push(uint16_t word);
+
+    // RET, RETI y RETN, 'from' es la dirección de la instrucción
+    Z80_CONSTEXPR inline void ret(Z80FlowKind kind, uint16_t from);
 
     // LDI
-    void ldi();
+    Z80_CONSTEXPR void ldi();
 
     // LDD
-    void ldd();
+    Z80_CONSTEXPR void ldd();
 
     // CPI
-    void cpi();
+    Z80_CONSTEXPR void cpi();
 
     // CPD
-    void cpd();
+    Z80_CONSTEXPR void cpd();
 
     // INI
-    void ini();
+    Z80_CONSTEXPR void ini();
 
     // IND
-    void ind();
+    Z80_CONSTEXPR void ind();
 
     // OUTI
-    void outi();
+    Z80_CONSTEXPR void outi();
 
     // OUTD
-    void outd();
+    Z80_CONSTEXPR void outd();
 
     // BIT n,r
-    inline void bitTest(uint8_t mask, uint8_t reg);
+    Z80_CONSTEXPR inline void bitTest(uint8_t mask, uint8_t reg);
 
     // Interrupción
-    void interrupt();
+    Z80_CONSTEXPR void interrupt();
 
     // Interrupción NMI
-    void nmi();
+    Z80_CONSTEXPR void nmi();
 
     // Decode main opcodes
-    void decodeOpcode(uint8_t opCode);
+    Z80_CONSTEXPR void decodeOpcode(uint8_t opCode);
 
     // Subconjunto de instrucciones 0xCB
     // decode CBXX opcodes
-    void decodeCB();
+    Z80_CONSTEXPR void decodeCB();
 
     // Subconjunto de instrucciones 0xDD / 0xFD
     //  Decode DD/FD opcodes
-    void decodeDDFD(uint8_t opCode, RegisterPair& regIXY);
+    Z80_CONSTEXPR void decodeDDFD(uint8_t opCode, RegisterPair& regIXY);
 
     // Subconjunto de instrucciones 0xDD / 0xFD 0xCB
     // Decode DD / FD CB opcodes
-    void decodeDDFDCB(uint8_t opCode, uint16_t address);
+    Z80_CONSTEXPR void decodeDDFDCB(uint8_t opCode, uint16_t address);
 
     // Subconjunto de instrucciones 0xED
     //  Decode EDXX opcodes
-    void decodeED(uint8_t opCode);
+    Z80_CONSTEXPR void decodeED(uint8_t opCode);
 };
 
 // Constructor de la clase
 template <typename TBusInterface>
-Z80<TBusInterface>::Z80(TBusInterface& ops)
-    : m_busInterface(ops),
-      sz53n_addTable(getFlagTables().sz53n_add),
-      sz53pn_addTable(getFlagTables().sz53pn_add),
-      sz53n_subTable(getFlagTables().sz53n_sub),
-      sz53pn_subTable(getFlagTables().sz53pn_sub) {
+Z80_CONSTEXPR Z80<TBusInterface>::Z80(TBusInterface& ops) : m_busInterface(&ops) {
+    static_assert(sizeof(Z80) <= kSizeBudget, "Z80 state no longer fits in its cache line budget");
+    reset();
+}
 
+template <typename TBusInterface> Z80_CONSTEXPR Z80<TBusInterface>::Z80() {
+    static_assert(sizeof(Z80) <= kSizeBudget, "Z80 state no longer fits in its cache line budget");
     reset();
 }
 
-template <typename TBusInterface> Z80<TBusInterface>::~Z80() = default;
+template <typename TBusInterface> Z80_CONSTEXPR Z80<TBusInterface>::~Z80() = default;
 
-template <typename TBusInterface> RegisterPair Z80<TBusInterface>::getPairIR() const {
+template <typename TBusInterface> Z80_CONSTEXPR RegisterPair Z80<TBusInterface>::getPairIR() const {
     RegisterPair IR;
     IR.byte8.hi = regI;
     IR.byte8.lo = regR & 0x7f;
@@ -822,43 +922,100 @@ template <typename TBusInterface> RegisterPair Z80<TBusInterface>::getPairIR() c
     return IR;
 }
 
-template <typename TBusInterface> void Z80<TBusInterface>::setAddSubFlag(bool state) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::setAddSubFlag(bool state) {
     // Branchless flag update to reduce mispredictions in hot paths
     const uint8_t mask = state ? 0xFF : 0x00;
     sz5h3pnFlags = static_cast<uint8_t>((sz5h3pnFlags & static_cast<uint8_t>(~ADDSUB_MASK)) | (mask & ADDSUB_MASK));
 }
 
-template <typename TBusInterface> void Z80<TBusInterface>::setParOverFlag(bool state) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::setParOverFlag(bool state) {
     const uint8_t mask = state ? 0xFF : 0x00;
     sz5h3pnFlags = static_cast<uint8_t>((sz5h3pnFlags & static_cast<uint8_t>(~PARITY_MASK)) | (mask & PARITY_MASK));
 }
 
-template <typename TBusInterface> void Z80<TBusInterface>::setBit3Flag(bool state) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::setBit3Flag(bool state) {
     const uint8_t mask = state ? 0xFF : 0x00;
     sz5h3pnFlags = static_cast<uint8_t>((sz5h3pnFlags & static_cast<uint8_t>(~BIT3_MASK)) | (mask & BIT3_MASK));
 }
 
-template <typename TBusInterface> void Z80<TBusInterface>::setHalfCarryFlag(bool state) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::setHalfCarryFlag(bool state) {
     const uint8_t mask = state ? 0xFF : 0x00;
     sz5h3pnFlags =
         static_cast<uint8_t>((sz5h3pnFlags & static_cast<uint8_t>(~HALFCARRY_MASK)) | (mask & HALFCARRY_MASK));
 }
 
-template <typename TBusInterface> void Z80<TBusInterface>::setBit5Flag(bool state) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::setBit5Flag(bool state) {
     const uint8_t mask = state ? 0xFF : 0x00;
     sz5h3pnFlags = static_cast<uint8_t>((sz5h3pnFlags & static_cast<uint8_t>(~BIT5_MASK)) | (mask & BIT5_MASK));
 }
 
-template <typename TBusInterface> void Z80<TBusInterface>::setZeroFlag(bool state) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::setZeroFlag(bool state) {
     const uint8_t mask = state ? 0xFF : 0x00;
     sz5h3pnFlags = static_cast<uint8_t>((sz5h3pnFlags & static_cast<uint8_t>(~ZERO_MASK)) | (mask & ZERO_MASK));
 }
 
-template <typename TBusInterface> void Z80<TBusInterface>::setSignFlag(bool state) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::setSignFlag(bool state) {
     const uint8_t mask = state ? 0xFF : 0x00;
     sz5h3pnFlags = static_cast<uint8_t>((sz5h3pnFlags & static_cast<uint8_t>(~SIGN_MASK)) | (mask & SIGN_MASK));
 }
 
+template <typename TBusInterface> Z80_CONSTEXPR Z80State Z80<TBusInterface>::getState() const {
+    Z80State state;
+    state.af = getRegAF();
+    state.bc = REG_BC;
+    state.de = REG_DE;
+    state.hl = REG_HL;
+    state.afx = REG_AFx;
+    state.bcx = REG_BCx;
+    state.dex = REG_DEx;
+    state.hlx = REG_HLx;
+    state.ix = REG_IX;
+    state.iy = REG_IY;
+    state.sp = REG_SP;
+    state.pc = REG_PC;
+    state.memptr = REG_WZ;
+    state.i = regI;
+    state.r = getRegR();
+    state.im = static_cast<uint8_t>(modeINT);
+    state.iff1 = ffIFF1;
+    state.iff2 = ffIFF2;
+    state.pendingEI = pendingEI;
+    state.activeNMI = activeNMI;
+    state.halted = halted;
+    state.pinReset = pinReset;
+    state.flagQ = flagQ;
+    state.lastFlagQ = lastFlagQ;
+    return state;
+}
+
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::setState(const Z80State& state) {
+    setRegAF(state.af);
+    REG_BC = state.bc;
+    REG_DE = state.de;
+    REG_HL = state.hl;
+    REG_AFx = state.afx;
+    REG_BCx = state.bcx;
+    REG_DEx = state.dex;
+    REG_HLx = state.hlx;
+    REG_IX = state.ix;
+    REG_IY = state.iy;
+    REG_SP = state.sp;
+    REG_PC = state.pc;
+    REG_WZ = state.memptr;
+    regI = state.i;
+    setRegR(state.r);
+    modeINT = static_cast<IntMode>(state.im);
+    ffIFF1 = state.iff1;
+    ffIFF2 = state.iff2;
+    pendingEI = state.pendingEI;
+    activeNMI = state.activeNMI;
+    halted = state.halted;
+    pinReset = state.pinReset;
+    flagQ = state.flagQ;
+    lastFlagQ = state.lastFlagQ;
+    prefixOpcode = 0x00;
+}
+
 // Reset
 /* Según el documento de Sean Young, que se encuentra en
  * [http://www.myquest.com/z80undocumented], la mejor manera de emular el
@@ -874,7 +1031,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::setSignFlag(bool stat
  *             modelo Zilog Z8400APS. Z80A CPU.
  *             http://www.worldofspectrum.org/forums/showthread.php?t=34574
  */
-template <typename TBusInterface> void Z80<TBusInterface>::reset() {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::reset() {
     if (pinReset) {
         pinReset = false;
     } else {
@@ -909,89 +1066,89 @@ template <typename TBusInterface> void Z80<TBusInterface>::reset() {
 
 // Rota a la izquierda el valor del argumento
 // El bit 0 y el flag C toman el valor del bit 7 antes de la operación
-template <typename TBusInterface> void Z80<TBusInterface>::rlc(uint8_t& oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::rlc(uint8_t& oper8) {
     carryFlag = (oper8 > 0x7f);
     oper8 <<= 1;
     if (carryFlag) {
         oper8 |= CARRY_MASK;
     }
-    sz5h3pnFlags = sz53pn_addTable[oper8];
+    sz5h3pnFlags = kFlagTables.sz53pn_add[oper8];
 }
 
 // Rota a la izquierda el valor del argumento
 // El bit 7 va al carry flag
 // El bit 0 toma el valor del flag C antes de la operación
-template <typename TBusInterface> void Z80<TBusInterface>::rl(uint8_t& oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::rl(uint8_t& oper8) {
     bool carry = carryFlag;
     carryFlag = (oper8 > 0x7f);
     oper8 <<= 1;
     if (carry) {
         oper8 |= CARRY_MASK;
     }
-    sz5h3pnFlags = sz53pn_addTable[oper8];
+    sz5h3pnFlags = kFlagTables.sz53pn_add[oper8];
 }
 
 // Rota a la izquierda el valor del argumento
 // El bit 7 va al carry flag
 // El bit 0 toma el valor 0
-template <typename TBusInterface> void Z80<TBusInterface>::sla(uint8_t& oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::sla(uint8_t& oper8) {
     carryFlag = (oper8 > 0x7f);
     oper8 <<= 1;
-    sz5h3pnFlags = sz53pn_addTable[oper8];
+    sz5h3pnFlags = kFlagTables.sz53pn_add[oper8];
 }
 
 // Rota a la izquierda el valor del argumento (como sla salvo por el bit 0)
 // El bit 7 va al carry flag
 // El bit 0 toma el valor 1
 // Instrucción indocumentada
-template <typename TBusInterface> void Z80<TBusInterface>::sll(uint8_t& oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::sll(uint8_t& oper8) {
     carryFlag = (oper8 > 0x7f);
     oper8 <<= 1;
     oper8 |= CARRY_MASK;
-    sz5h3pnFlags = sz53pn_addTable[oper8];
+    sz5h3pnFlags = kFlagTables.sz53pn_add[oper8];
 }
 
 // Rota a la derecha el valor del argumento
 // El bit 7 y el flag C toman el valor del bit 0 antes de la operación
-template <typename TBusInterface> void Z80<TBusInterface>::rrc(uint8_t& oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::rrc(uint8_t& oper8) {
     carryFlag = (oper8 & CARRY_MASK) != 0;
     oper8 >>= 1;
     if (carryFlag) {
         oper8 |= SIGN_MASK;
     }
-    sz5h3pnFlags = sz53pn_addTable[oper8];
+    sz5h3pnFlags = kFlagTables.sz53pn_add[oper8];
 }
 
 // Rota a la derecha el valor del argumento
 // El bit 0 va al carry flag
 // El bit 7 toma el valor del flag C antes de la operación
-template <typename TBusInterface> void Z80<TBusInterface>::rr(uint8_t& oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::rr(uint8_t& oper8) {
     bool carry = carryFlag;
     carryFlag = (oper8 & CARRY_MASK) != 0;
     oper8 >>= 1;
     if (carry) {
         oper8 |= SIGN_MASK;
     }
-    sz5h3pnFlags = sz53pn_addTable[oper8];
+    sz5h3pnFlags = kFlagTables.sz53pn_add[oper8];
 }
 
 // Rota a la derecha 1 bit el valor del argumento
 // El bit 0 pasa al carry.
 // El bit 7 conserva el valor que tenga
-template <typename TBusInterface> void Z80<TBusInterface>::sra(uint8_t& oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::sra(uint8_t& oper8) {
     uint8_t sign = oper8 & SIGN_MASK;
     carryFlag = (oper8 & CARRY_MASK) != 0;
     oper8 = (oper8 >> 1) | sign;
-    sz5h3pnFlags = sz53pn_addTable[oper8];
+    sz5h3pnFlags = kFlagTables.sz53pn_add[oper8];
 }
 
 // Rota a la derecha 1 bit el valor del argumento
 // El bit 0 pasa al carry.
 // El bit 7 toma el valor 0
-template <typename TBusInterface> void Z80<TBusInterface>::srl(uint8_t& oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::srl(uint8_t& oper8) {
     carryFlag = (oper8 & CARRY_MASK) != 0;
     oper8 >>= 1;
-    sz5h3pnFlags = sz53pn_addTable[oper8];
+    sz5h3pnFlags = kFlagTables.sz53pn_add[oper8];
 }
 
 /*
@@ -1015,10 +1172,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::srl(uint8_t& oper8) {
  * V_FLAG = RESULT == 0x7F
  */
 // Incrementa un valor de 8 bits modificando los flags oportunos
-template <typename TBusInterface> void Z80<TBusInterface>::inc8(uint8_t& oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::inc8(uint8_t& oper8) {
     oper8++;
 
-    sz5h3pnFlags = sz53n_addTable[oper8];
+    sz5h3pnFlags = kFlagTables.sz53n_add[oper8];
 
     if ((oper8 & 0x0f) == 0) {
         sz5h3pnFlags |= HALFCARRY_MASK;
@@ -1030,10 +1187,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::inc8(uint8_t& oper8)
 }
 
 // Decrementa un valor de 8 bits modificando los flags oportunos
-template <typename TBusInterface> void Z80<TBusInterface>::dec8(uint8_t& oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::dec8(uint8_t& oper8) {
     oper8--;
 
-    sz5h3pnFlags = sz53n_subTable[oper8];
+    sz5h3pnFlags = kFlagTables.sz53n_sub[oper8];
 
     if ((oper8 & 0x0f) == 0x0f) {
         sz5h3pnFlags |= HALFCARRY_MASK;
@@ -1045,12 +1202,12 @@ template <typename TBusInterface> void Z80<TBusInterface>::dec8(uint8_t& oper8)
 }
 
 // Suma de 8 bits afectando a los flags
-template <typename TBusInterface> void Z80<TBusInterface>::add(uint8_t oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::add(uint8_t oper8) {
     uint16_t res = regA + oper8;
 
     carryFlag = res > 0xff;
     res &= 0xff;
-    sz5h3pnFlags = sz53n_addTable[res];
+    sz5h3pnFlags = kFlagTables.sz53n_add[res];
 
     /* El módulo 16 del resultado será menor que el módulo 16 del registro A
      * si ha habido HalfCarry. Sucede lo mismo para todos los métodos suma
@@ -1067,7 +1224,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::add(uint8_t oper8) {
 }
 
 // Suma con acarreo de 8 bits
-template <typename TBusInterface> void Z80<TBusInterface>::adc(uint8_t oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::adc(uint8_t oper8) {
     uint16_t res = regA + oper8;
 
     if (carryFlag) {
@@ -1076,7 +1233,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::adc(uint8_t oper8) {
 
     carryFlag = res > 0xff;
     res &= 0xff;
-    sz5h3pnFlags = sz53n_addTable[res];
+    sz5h3pnFlags = kFlagTables.sz53n_add[res];
 
     if (((regA ^ oper8 ^ res) & 0x10) != 0) {
         sz5h3pnFlags |= HALFCARRY_MASK;
@@ -1090,21 +1247,21 @@ template <typename TBusInterface> void Z80<TBusInterface>::adc(uint8_t oper8) {
 }
 
 // Suma dos operandos de 16 bits sin carry afectando a los flags
-template <typename TBusInterface> void Z80<TBusInterface>::add16(RegisterPair& reg16, uint16_t oper16) {
-    uint32_t tmp = oper16 + reg16.word;
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::add16(RegisterPair& reg16, uint16_t oper16) {
+    uint32_t tmp = oper16 + Z80_WORD(reg16);
 
-    REG_WZ = reg16.word + 1;
+    REG_WZ = Z80_WORD(reg16) + 1;
     carryFlag = tmp > 0xffff;
-    reg16.word = tmp;
-    sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZP_MASK) | ((reg16.word >> 8) & FLAG_53_MASK);
+    Z80_WORD(reg16) = tmp;
+    sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZP_MASK) | ((Z80_WORD(reg16) >> 8) & FLAG_53_MASK);
 
-    if ((reg16.word & 0x0fff) < (oper16 & 0x0fff)) {
+    if ((Z80_WORD(reg16) & 0x0fff) < (oper16 & 0x0fff)) {
         sz5h3pnFlags |= HALFCARRY_MASK;
     }
 }
 
 // Suma con acarreo de 16 bits
-template <typename TBusInterface> void Z80<TBusInterface>::adc16(uint16_t reg16) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::adc16(uint16_t reg16) {
     uint16_t tmpHL = REG_HL;
     REG_WZ = REG_HL + 1;
 
@@ -1117,7 +1274,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::adc16(uint16_t reg16)
     res &= 0xffff;
     REG_HL = static_cast<uint16_t>(res);
 
-    sz5h3pnFlags = sz53n_addTable[REG_H];
+    sz5h3pnFlags = kFlagTables.sz53n_add[REG_H];
     if (res != 0) {
         sz5h3pnFlags &= ~ZERO_MASK;
     }
@@ -1132,12 +1289,12 @@ template <typename TBusInterface> void Z80<TBusInterface>::adc16(uint16_t reg16)
 }
 
 // Resta de 8 bits
-template <typename TBusInterface> void Z80<TBusInterface>::sub(uint8_t oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::sub(uint8_t oper8) {
     auto res = static_cast<int16_t>(regA - oper8);
 
     carryFlag = res < 0;
     res &= 0xff;
-    sz5h3pnFlags = sz53n_subTable[res];
+    sz5h3pnFlags = kFlagTables.sz53n_sub[res];
 
     /* El módulo 16 del resultado será mayor que el módulo 16 del registro A
      * si ha habido HalfCarry. Sucede lo mismo para todos los métodos resta
@@ -1154,7 +1311,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::sub(uint8_t oper8) {
 }
 
 // Resta con acarreo de 8 bits
-template <typename TBusInterface> void Z80<TBusInterface>::sbc(uint8_t oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::sbc(uint8_t oper8) {
     auto res = static_cast<int16_t>(regA - oper8);
 
     if (carryFlag) {
@@ -1163,7 +1320,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::sbc(uint8_t oper8) {
 
     carryFlag = res < 0;
     res &= 0xff;
-    sz5h3pnFlags = sz53n_subTable[res];
+    sz5h3pnFlags = kFlagTables.sz53n_sub[res];
 
     if (((regA ^ oper8 ^ res) & 0x10) != 0) {
         sz5h3pnFlags |= HALFCARRY_MASK;
@@ -1177,7 +1334,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::sbc(uint8_t oper8) {
 }
 
 // Resta con acarreo de 16 bits
-template <typename TBusInterface> void Z80<TBusInterface>::sbc16(uint16_t reg16) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::sbc16(uint16_t reg16) {
     uint16_t tmpHL = REG_HL;
     REG_WZ = REG_HL + 1;
 
@@ -1190,7 +1347,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::sbc16(uint16_t reg16)
     res &= 0xffff;
     REG_HL = static_cast<uint16_t>(res);
 
-    sz5h3pnFlags = sz53n_subTable[REG_H];
+    sz5h3pnFlags = kFlagTables.sz53n_sub[REG_H];
     if (res != 0) {
         sz5h3pnFlags &= ~ZERO_MASK;
     }
@@ -1205,39 +1362,39 @@ template <typename TBusInterface> void Z80<TBusInterface>::sbc16(uint16_t reg16)
 }
 
 // Operación AND lógica
-template <typename TBusInterface> void Z80<TBusInterface>::and_(uint8_t oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::and_(uint8_t oper8) {
     regA &= oper8;
     carryFlag = false;
-    sz5h3pnFlags = sz53pn_addTable[regA] | HALFCARRY_MASK;
+    sz5h3pnFlags = kFlagTables.sz53pn_add[regA] | HALFCARRY_MASK;
 }
 
 // Operación XOR lógica
-template <typename TBusInterface> void Z80<TBusInterface>::xor_(uint8_t oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::xor_(uint8_t oper8) {
     regA ^= oper8;
     carryFlag = false;
-    sz5h3pnFlags = sz53pn_addTable[regA];
+    sz5h3pnFlags = kFlagTables.sz53pn_add[regA];
 }
 
 // Operación OR lógica
-template <typename TBusInterface> void Z80<TBusInterface>::or_(uint8_t oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::or_(uint8_t oper8) {
     regA |= oper8;
     carryFlag = false;
-    sz5h3pnFlags = sz53pn_addTable[regA];
+    sz5h3pnFlags = kFlagTables.sz53pn_add[regA];
 }
 
 // Operación de comparación con el registro A
 // es como SUB, pero solo afecta a los flags
 // Los flags SIGN y ZERO se calculan a partir del resultado
 // Los flags 3 y 5 se copian desde el operando (sigh!)
-template <typename TBusInterface> void Z80<TBusInterface>::cp(uint8_t oper8) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::cp(uint8_t oper8) {
     auto res = static_cast<int16_t>(regA - oper8);
 
     carryFlag = res < 0;
     res &= 0xff;
 
-    sz5h3pnFlags = (sz53n_addTable[oper8] & FLAG_53_MASK)
+    sz5h3pnFlags = (kFlagTables.sz53n_add[oper8] & FLAG_53_MASK)
                    | // No necesito preservar H, pero está a 0 en la tabla de todas formas
-                   (sz53n_subTable[res] & FLAG_SZHN_MASK);
+                   (kFlagTables.sz53n_sub[res] & FLAG_SZHN_MASK);
 
     if ((res & 0x0f) > (regA & 0x0f)) {
         sz5h3pnFlags |= HALFCARRY_MASK;
@@ -1249,7 +1406,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::cp(uint8_t oper8) {
 }
 
 // DAA
-template <typename TBusInterface> void Z80<TBusInterface>::daa() {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::daa() {
     uint8_t suma = 0;
     bool carry = carryFlag;
 
@@ -1267,10 +1424,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::daa() {
 
     if ((sz5h3pnFlags & ADDSUB_MASK) != 0) {
         sub(suma);
-        sz5h3pnFlags = (sz5h3pnFlags & HALFCARRY_MASK) | sz53pn_subTable[regA];
+        sz5h3pnFlags = (sz5h3pnFlags & HALFCARRY_MASK) | kFlagTables.sz53pn_sub[regA];
     } else {
         add(suma);
-        sz5h3pnFlags = (sz5h3pnFlags & HALFCARRY_MASK) | sz53pn_addTable[regA];
+        sz5h3pnFlags = (sz5h3pnFlags & HALFCARRY_MASK) | kFlagTables.sz53pn_add[regA];
     }
 
     carryFlag = carry;
@@ -1278,23 +1435,30 @@ template <typename TBusInterface> void Z80<TBusInterface>::daa() {
 }
 
 // POP
-template <typename TBusInterface> uint16_t Z80<TBusInterface>::pop() {
-    uint16_t word = m_busInterface.peek16(REG_SP);
+template <typename TBusInterface> Z80_CONSTEXPR uint16_t Z80<TBusInterface>::pop() {
+    uint16_t word = m_busInterface->peek16(REG_SP);
     REG_SP = REG_SP + 2;
     return word;
 }
 
 // PUSH
-template <typename TBusInterface> void Z80<TBusInterface>::push(uint16_t word) {
-    m_busInterface.poke8(--REG_SP, word >> 8);
-    m_busInterface.poke8(--REG_SP, word);
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::push(uint16_t word) {
+    m_busInterface->poke8(--REG_SP, word >> 8);
+    m_busInterface->poke8(--REG_SP, word);
+}
+
+// RET
+template <typename TBusInterface>
+Z80_CONSTEXPR void Z80<TBusInterface>::ret([[maybe_unused]] Z80FlowKind kind, [[maybe_unused]] uint16_t from) {
+    REG_PC = REG_WZ = pop();
+    Z80_FLOW_EVENT(kind, from, REG_PC);
 }
 
 // LDI
-template <typename TBusInterface> void Z80<TBusInterface>::ldi() {
-    uint8_t work8 = m_busInterface.peek8(REG_HL);
-    m_busInterface.poke8(REG_DE, work8);
-    m_busInterface.addressOnBus(REG_DE, 2);
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::ldi() {
+    uint8_t work8 = m_busInterface->peek8(REG_HL);
+    m_busInterface->poke8(REG_DE, work8);
+    m_busInterface->addressOnBus(REG_DE, 2);
     REG_HL++;
     REG_DE++;
     REG_BC--;
@@ -1312,10 +1476,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::ldi() {
 }
 
 // LDD
-template <typename TBusInterface> void Z80<TBusInterface>::ldd() {
-    uint8_t work8 = m_busInterface.peek8(REG_HL);
-    m_busInterface.poke8(REG_DE, work8);
-    m_busInterface.addressOnBus(REG_DE, 2);
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::ldd() {
+    uint8_t work8 = m_busInterface->peek8(REG_HL);
+    m_busInterface->poke8(REG_DE, work8);
+    m_busInterface->addressOnBus(REG_DE, 2);
     REG_HL--;
     REG_DE--;
     REG_BC--;
@@ -1333,12 +1497,12 @@ template <typename TBusInterface> void Z80<TBusInterface>::ldd() {
 }
 
 // CPI
-template <typename TBusInterface> void Z80<TBusInterface>::cpi() {
-    uint8_t memHL = m_busInterface.peek8(REG_HL);
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::cpi() {
+    uint8_t memHL = m_busInterface->peek8(REG_HL);
     bool carry = carryFlag; // lo guardo porque cp lo toca
     cp(memHL);
     carryFlag = carry;
-    m_busInterface.addressOnBus(REG_HL, 5);
+    m_busInterface->addressOnBus(REG_HL, 5);
     REG_HL++;
     REG_BC--;
     memHL = regA - memHL - ((sz5h3pnFlags & HALFCARRY_MASK) != 0 ? 1 : 0);
@@ -1356,12 +1520,12 @@ template <typename TBusInterface> void Z80<TBusInterface>::cpi() {
 }
 
 // CPD
-template <typename TBusInterface> void Z80<TBusInterface>::cpd() {
-    uint8_t memHL = m_busInterface.peek8(REG_HL);
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::cpd() {
+    uint8_t memHL = m_busInterface->peek8(REG_HL);
     bool carry = carryFlag; // lo guardo porque cp lo toca
     cp(memHL);
     carryFlag = carry;
-    m_busInterface.addressOnBus(REG_HL, 5);
+    m_busInterface->addressOnBus(REG_HL, 5);
     REG_HL--;
     REG_BC--;
     memHL = regA - memHL - ((sz5h3pnFlags & HALFCARRY_MASK) != 0 ? 1 : 0);
@@ -1379,16 +1543,16 @@ template <typename TBusInterface> void Z80<TBusInterface>::cpd() {
 }
 
 // INI
-template <typename TBusInterface> void Z80<TBusInterface>::ini() {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::ini() {
     REG_WZ = REG_BC;
-    m_busInterface.addressOnBus(getPairIR().word, 1);
-    uint8_t work8 = m_busInterface.inPort(REG_WZ++);
-    m_busInterface.poke8(REG_HL, work8);
+    m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
+    uint8_t work8 = m_busInterface->inPort(REG_WZ++);
+    m_busInterface->poke8(REG_HL, work8);
 
     REG_B--;
     REG_HL++;
 
-    sz5h3pnFlags = sz53pn_addTable[REG_B];
+    sz5h3pnFlags = kFlagTables.sz53pn_add[REG_B];
     if (work8 > 0x7f) {
         sz5h3pnFlags |= ADDSUB_MASK;
     }
@@ -1400,7 +1564,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::ini() {
         carryFlag = true;
     }
 
-    if ((sz53pn_addTable[((tmp & 0x07) ^ REG_B)] & PARITY_MASK) == PARITY_MASK) {
+    if ((kFlagTables.sz53pn_add[((tmp & 0x07) ^ REG_B)] & PARITY_MASK) == PARITY_MASK) {
         sz5h3pnFlags |= PARITY_MASK;
     } else {
         sz5h3pnFlags &= ~PARITY_MASK;
@@ -1408,16 +1572,16 @@ template <typename TBusInterface> void Z80<TBusInterface>::ini() {
 }
 
 // IND
-template <typename TBusInterface> void Z80<TBusInterface>::ind() {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::ind() {
     REG_WZ = REG_BC;
-    m_busInterface.addressOnBus(getPairIR().word, 1);
-    uint8_t work8 = m_busInterface.inPort(REG_WZ--);
-    m_busInterface.poke8(REG_HL, work8);
+    m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
+    uint8_t work8 = m_busInterface->inPort(REG_WZ--);
+    m_busInterface->poke8(REG_HL, work8);
 
     REG_B--;
     REG_HL--;
 
-    sz5h3pnFlags = sz53pn_addTable[REG_B];
+    sz5h3pnFlags = kFlagTables.sz53pn_add[REG_B];
     if (work8 > 0x7f) {
         sz5h3pnFlags |= ADDSUB_MASK;
     }
@@ -1429,7 +1593,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::ind() {
         carryFlag = true;
     }
 
-    if ((sz53pn_addTable[((tmp & 0x07) ^ REG_B)] & PARITY_MASK) == PARITY_MASK) {
+    if ((kFlagTables.sz53pn_add[((tmp & 0x07) ^ REG_B)] & PARITY_MASK) == PARITY_MASK) {
         sz5h3pnFlags |= PARITY_MASK;
     } else {
         sz5h3pnFlags &= ~PARITY_MASK;
@@ -1437,23 +1601,23 @@ template <typename TBusInterface> void Z80<TBusInterface>::ind() {
 }
 
 // OUTI
-template <typename TBusInterface> void Z80<TBusInterface>::outi() {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::outi() {
 
-    m_busInterface.addressOnBus(getPairIR().word, 1);
+    m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
 
     REG_B--;
     REG_WZ = REG_BC;
 
-    uint8_t work8 = m_busInterface.peek8(REG_HL);
-    m_busInterface.outPort(REG_WZ++, work8);
+    uint8_t work8 = m_busInterface->peek8(REG_HL);
+    m_busInterface->outPort(REG_WZ++, work8);
 
     REG_HL++;
 
     carryFlag = false;
     if (work8 > 0x7f) {
-        sz5h3pnFlags = sz53n_subTable[REG_B];
+        sz5h3pnFlags = kFlagTables.sz53n_sub[REG_B];
     } else {
-        sz5h3pnFlags = sz53n_addTable[REG_B];
+        sz5h3pnFlags = kFlagTables.sz53n_add[REG_B];
     }
 
     if ((REG_L + work8) > 0xff) {
@@ -1461,29 +1625,29 @@ template <typename TBusInterface> void Z80<TBusInterface>::outi() {
         carryFlag = true;
     }
 
-    if ((sz53pn_addTable[(((REG_L + work8) & 0x07) ^ REG_B)] & PARITY_MASK) == PARITY_MASK) {
+    if ((kFlagTables.sz53pn_add[(((REG_L + work8) & 0x07) ^ REG_B)] & PARITY_MASK) == PARITY_MASK) {
         sz5h3pnFlags |= PARITY_MASK;
     }
 }
 
 // OUTD
-template <typename TBusInterface> void Z80<TBusInterface>::outd() {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::outd() {
 
-    m_busInterface.addressOnBus(getPairIR().word, 1);
+    m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
 
     REG_B--;
     REG_WZ = REG_BC;
 
-    uint8_t work8 = m_busInterface.peek8(REG_HL);
-    m_busInterface.outPort(REG_WZ--, work8);
+    uint8_t work8 = m_busInterface->peek8(REG_HL);
+    m_busInterface->outPort(REG_WZ--, work8);
 
     REG_HL--;
 
     carryFlag = false;
     if (work8 > 0x7f) {
-        sz5h3pnFlags = sz53n_subTable[REG_B];
+        sz5h3pnFlags = kFlagTables.sz53n_sub[REG_B];
     } else {
-        sz5h3pnFlags = sz53n_addTable[REG_B];
+        sz5h3pnFlags = kFlagTables.sz53n_add[REG_B];
     }
 
     if ((REG_L + work8) > 0xff) {
@@ -1491,7 +1655,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::outd() {
         carryFlag = true;
     }
 
-    if ((sz53pn_addTable[(((REG_L + work8) & 0x07) ^ REG_B)] & PARITY_MASK) == PARITY_MASK) {
+    if ((kFlagTables.sz53pn_add[(((REG_L + work8) & 0x07) ^ REG_B)] & PARITY_MASK) == PARITY_MASK) {
         sz5h3pnFlags |= PARITY_MASK;
     }
 }
@@ -1508,10 +1672,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::outd() {
  * 04/12/08 Confirmado el comentario anterior:
  *          http://scratchpad.wikia.com/wiki/Z80
  */
-template <typename TBusInterface> void Z80<TBusInterface>::bitTest(uint8_t mask, uint8_t reg) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::bitTest(uint8_t mask, uint8_t reg) {
     bool zeroFlag = (mask & reg) == 0;
 
-    sz5h3pnFlags = (sz53n_addTable[reg] & ~FLAG_SZP_MASK) | HALFCARRY_MASK;
+    sz5h3pnFlags = (kFlagTables.sz53n_add[reg] & ~FLAG_SZP_MASK) | HALFCARRY_MASK;
 
     if (zeroFlag) {
         sz5h3pnFlags |= (PARITY_MASK | ZERO_MASK);
@@ -1539,21 +1703,23 @@ template <typename TBusInterface> void Z80<TBusInterface>::bitTest(uint8_t mask,
  *      M4: 3 T-Estados -> leer byte bajo del vector de INT
  *      M5: 3 T-Estados -> leer byte alto y saltar a la rutina de INT
  */
-template <typename TBusInterface> void Z80<TBusInterface>::interrupt() {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::interrupt() {
     // Si estaba en un HALT esperando una INT, lo saca de la espera
     halted = false;
 
-    m_busInterface.interruptHandlingTime(7);
+    m_busInterface->interruptHandlingTime(7);
 
     regR++;
     ffIFF1 = ffIFF2 = false;
+    [[maybe_unused]] uint16_t interrupted = REG_PC;
     push(REG_PC); // el push añadirá 6 t-estados (+contended si toca)
     if (modeINT == IntMode::IM2) {
-        REG_PC = m_busInterface.peek16((regI << 8) | 0xff); // +6 t-estados
+        REG_PC = m_busInterface->peek16((regI << 8) | 0xff); // +6 t-estados
     } else {
         REG_PC = 0x0038;
     }
     REG_WZ = REG_PC;
+    Z80_FLOW_EVENT(Z80FlowKind::Interrupt, interrupted, REG_PC);
 }
 
 // Interrupción NMI, no utilizado por ahora
@@ -1562,36 +1728,46 @@ template <typename TBusInterface> void Z80<TBusInterface>::interrupt() {
  * M2: 3 T-Estados -> escribe byte alto de PC y decSP
  * M3: 3 T-Estados -> escrib e byte bajo de PC y PC=0x0066
  */
-template <typename TBusInterface> void Z80<TBusInterface>::nmi() {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::nmi() {
     halted = false;
     // Esta lectura consigue dos cosas:
     //      1.- La lectura del opcode del M1 que se descarta
     //      2.- Si estaba en un HALT esperando una INT, lo saca de la espera
-    m_busInterface.fetchOpcode(REG_PC);
-    m_busInterface.interruptHandlingTime(1);
+    m_busInterface->fetchOpcode(REG_PC);
+    m_busInterface->interruptHandlingTime(1);
     regR++;
     ffIFF1 = false;
     push(REG_PC); // 3+3 t-estados + contended si procede
+    Z80_FLOW_EVENT(Z80FlowKind::Nmi, REG_PC, 0x0066);
     REG_PC = REG_WZ = 0x0066;
 }
 
-template <typename TBusInterface> void Z80<TBusInterface>::execute() {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::execute() {
     prefixOpcode = 0;
+#ifdef WITH_HANDLER_PROFILING
+    uint64_t handlerStart = m_handlerProfile != nullptr ? Z80HandlerProfile::now() : 0;
+#endif
 
     if (halted) {
-        m_opCode = m_busInterface.fetchOpcode(REG_PC);
+        m_opCode = m_busInterface->fetchOpcode(REG_PC);
         regR++;
+#ifdef WITH_OPCODE_HISTOGRAM
+        if (m_histogram != nullptr) {
+            m_histogram->count(Z80OpcodeTable::Main, 0x76);
+        }
+#endif
+        Z80_HANDLER_SELECT(Z80OpcodeTable::Main, 0x76);
     } else {
         uint8_t currentPrefix = 0;
         bool firstByteOfInstruction = true;
 
         while (true) {
-            m_opCode = m_busInterface.fetchOpcode(REG_PC);
+            m_opCode = m_busInterface->fetchOpcode(REG_PC);
             regR++;
 
 #ifdef WITH_BREAKPOINT_SUPPORT
             if (breakpointEnabled && currentPrefix == 0) {
-                m_opCode = m_busInterface.breakpoint(REG_PC, m_opCode);
+                m_opCode = m_busInterface->breakpoint(REG_PC, m_opCode);
             }
 #endif
 
@@ -1604,6 +1780,16 @@ template <typename TBusInterface> void Z80<TBusInterface>::execute() {
                 pendingEI = false;
             }
 
+#ifdef WITH_OPCODE_HISTOGRAM
+            // Los subconjuntos se cuentan en decodeCB/decodeDDFD/decodeED
+            if (m_histogram != nullptr && currentPrefix == 0) {
+                m_histogram->count(Z80OpcodeTable::Main, m_opCode);
+            }
+#endif
+            if (currentPrefix == 0) {
+                Z80_HANDLER_SELECT(Z80OpcodeTable::Main, m_opCode);
+            }
+
             switch (currentPrefix) {
                 case 0x00:
                     decodeOpcode(m_opCode);
@@ -1635,11 +1821,17 @@ template <typename TBusInterface> void Z80<TBusInterface>::execute() {
 
 #ifdef WITH_EXEC_DONE
         if (Z80_UNLIKELY(execDone)) {
-            m_busInterface.execDone();
+            m_busInterface->execDone();
         }
 #endif
     }
 
+#ifdef WITH_HANDLER_PROFILING
+    if (m_handlerProfile != nullptr) {
+        m_handlerProfile->charge(handlerStart);
+    }
+#endif
+
     // Primero se comprueba NMI
     // Si se activa NMI no se comprueba INT porque la siguiente
     // instrucción debe ser la de 0x0066.
@@ -1651,13 +1843,13 @@ template <typename TBusInterface> void Z80<TBusInterface>::execute() {
     }
 
     // Ahora se comprueba si está activada la señal INT
-    if (Z80_UNLIKELY(ffIFF1 && !pendingEI && m_busInterface.isActiveINT())) {
+    if (Z80_UNLIKELY(ffIFF1 && !pendingEI && m_busInterface->isActiveINT())) {
         lastFlagQ = false;
         interrupt();
     }
 }
 
-template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t opCode) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::decodeOpcode(uint8_t opCode) {
 
     switch (opCode) {
         default:
@@ -1665,19 +1857,19 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x01: /* LD BC,nn */
-            REG_BC = m_busInterface.peek16(REG_PC);
+            REG_BC = m_busInterface->peek16(REG_PC);
             REG_PC = REG_PC + 2;
             break;
 
         case 0x02: /* LD (BC),A */
-            m_busInterface.poke8(REG_BC, regA);
+            m_busInterface->poke8(REG_BC, regA);
             REG_W = regA;
             REG_Z = REG_C + 1;
             // REG_WZ = (regA << 8) | (REG_C + 1);
             break;
 
         case 0x03: /* INC BC */
-            m_busInterface.addressOnBus(getPairIR().word, 2);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 2);
             REG_BC++;
             break;
 
@@ -1690,7 +1882,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x06: /* LD B,n */
-            REG_B = m_busInterface.peek8(REG_PC);
+            REG_B = m_busInterface->peek8(REG_PC);
             REG_PC++;
             break;
 
@@ -1715,17 +1907,17 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
         }
 
         case 0x09: /* ADD HL,BC */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             add16(regHL, REG_BC);
             break;
 
         case 0x0A: /* LD A,(BC) */
-            regA = m_busInterface.peek8(REG_BC);
+            regA = m_busInterface->peek8(REG_BC);
             REG_WZ = REG_BC + 1;
             break;
 
         case 0x0B: /* DEC BC */
-            m_busInterface.addressOnBus(getPairIR().word, 2);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 2);
             REG_BC--;
             break;
 
@@ -1738,7 +1930,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x0E: /* LD C,n */
-            REG_C = m_busInterface.peek8(REG_PC);
+            REG_C = m_busInterface->peek8(REG_PC);
             REG_PC++;
             break;
 
@@ -1752,10 +1944,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0x10: { /* DJNZ e */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
-            auto offset = static_cast<int8_t>(m_busInterface.peek8(REG_PC));
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
+            auto offset = static_cast<int8_t>(m_busInterface->peek8(REG_PC));
             if (--REG_B != 0) {
-                m_busInterface.addressOnBus(REG_PC, 5);
+                m_busInterface->addressOnBus(REG_PC, 5);
                 REG_PC = REG_WZ = REG_PC + offset + 1;
             } else {
                 REG_PC++;
@@ -1763,19 +1955,19 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0x11: /* LD DE,nn */
-            REG_DE = m_busInterface.peek16(REG_PC);
+            REG_DE = m_busInterface->peek16(REG_PC);
             REG_PC = REG_PC + 2;
             break;
 
         case 0x12: /* LD (DE),A */
-            m_busInterface.poke8(REG_DE, regA);
+            m_busInterface->poke8(REG_DE, regA);
             REG_W = regA;
             REG_Z = REG_E + 1;
             // REG_WZ = (regA << 8) | (REG_E + 1);
             break;
 
         case 0x13: /* INC DE */
-            m_busInterface.addressOnBus(getPairIR().word, 2);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 2);
             REG_DE++;
             break;
 
@@ -1788,7 +1980,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x16: /* LD D,n */
-            REG_D = m_busInterface.peek8(REG_PC);
+            REG_D = m_busInterface->peek8(REG_PC);
             REG_PC++;
             break;
 
@@ -1803,23 +1995,23 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0x18: { /* JR e */
-            auto offset = static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            auto offset = static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC = REG_WZ = REG_PC + offset + 1;
             break;
         }
         case 0x19: /* ADD HL,DE */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             add16(regHL, REG_DE);
             break;
 
         case 0x1A: /* LD A,(DE) */
-            regA = m_busInterface.peek8(REG_DE);
+            regA = m_busInterface->peek8(REG_DE);
             REG_WZ = REG_DE + 1;
             break;
 
         case 0x1B: /* DEC DE */
-            m_busInterface.addressOnBus(getPairIR().word, 2);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 2);
             REG_DE--;
             break;
 
@@ -1832,7 +2024,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x1E: /* LD E,n */
-            REG_E = m_busInterface.peek8(REG_PC);
+            REG_E = m_busInterface->peek8(REG_PC);
             REG_PC++;
             break;
 
@@ -1847,9 +2039,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0x20: { /* JR NZ,e */
-            auto offset = static_cast<int8_t>(m_busInterface.peek8(REG_PC));
+            auto offset = static_cast<int8_t>(m_busInterface->peek8(REG_PC));
             if ((sz5h3pnFlags & ZERO_MASK) == 0) {
-                m_busInterface.addressOnBus(REG_PC, 5);
+                m_busInterface->addressOnBus(REG_PC, 5);
                 REG_PC += offset;
                 REG_WZ = REG_PC + 1;
             }
@@ -1857,19 +2049,19 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0x21: /* LD HL,nn */
-            REG_HL = m_busInterface.peek16(REG_PC);
+            REG_HL = m_busInterface->peek16(REG_PC);
             REG_PC = REG_PC + 2;
             break;
 
         case 0x22: /* LD (nn),HL */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            m_busInterface.poke16(REG_WZ, regHL);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            m_busInterface->poke16(REG_WZ, regHL);
             REG_WZ++;
             REG_PC = REG_PC + 2;
             break;
 
         case 0x23: /* INC HL */
-            m_busInterface.addressOnBus(getPairIR().word, 2);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 2);
             REG_HL++;
             break;
 
@@ -1882,7 +2074,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x26: /* LD H,n */
-            REG_H = m_busInterface.peek8(REG_PC);
+            REG_H = m_busInterface->peek8(REG_PC);
             REG_PC++;
             break;
 
@@ -1891,9 +2083,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x28: { /* JR Z,e */
-            auto offset = static_cast<int8_t>(m_busInterface.peek8(REG_PC));
+            auto offset = static_cast<int8_t>(m_busInterface->peek8(REG_PC));
             if ((sz5h3pnFlags & ZERO_MASK) != 0) {
-                m_busInterface.addressOnBus(REG_PC, 5);
+                m_busInterface->addressOnBus(REG_PC, 5);
                 REG_PC += offset;
                 REG_WZ = REG_PC + 1;
             }
@@ -1901,19 +2093,19 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0x29: /* ADD HL,HL */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             add16(regHL, REG_HL);
             break;
 
         case 0x2A: /* LD HL,(nn) */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            REG_HL = m_busInterface.peek16(REG_WZ);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            REG_HL = m_busInterface->peek16(REG_WZ);
             REG_WZ++;
             REG_PC = REG_PC + 2;
             break;
 
         case 0x2B: /* DEC HL */
-            m_busInterface.addressOnBus(getPairIR().word, 2);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 2);
             REG_HL--;
             break;
 
@@ -1926,7 +2118,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x2E: /* LD L,n */
-            REG_L = m_busInterface.peek8(REG_PC);
+            REG_L = m_busInterface->peek8(REG_PC);
             REG_PC++;
             break;
 
@@ -1936,9 +2128,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x30: { /* JR NC,e */
-            auto offset = static_cast<int8_t>(m_busInterface.peek8(REG_PC));
+            auto offset = static_cast<int8_t>(m_busInterface->peek8(REG_PC));
             if (!carryFlag) {
-                m_busInterface.addressOnBus(REG_PC, 5);
+                m_busInterface->addressOnBus(REG_PC, 5);
                 REG_PC += offset;
                 REG_WZ = REG_PC + 1;
             }
@@ -1946,40 +2138,40 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0x31: /* LD SP,nn */
-            REG_SP = m_busInterface.peek16(REG_PC);
+            REG_SP = m_busInterface->peek16(REG_PC);
             REG_PC = REG_PC + 2;
             break;
 
         case 0x32: /* LD (nn),A */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            m_busInterface.poke8(REG_WZ, regA);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            m_busInterface->poke8(REG_WZ, regA);
             REG_WZ = (regA << 8) | ((REG_WZ + 1) & 0xff);
             REG_PC = REG_PC + 2;
             break;
 
         case 0x33: /* INC SP */
-            m_busInterface.addressOnBus(getPairIR().word, 2);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 2);
             REG_SP++;
             break;
 
         case 0x34: /* INC (HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL);
+            uint8_t work8 = m_busInterface->peek8(REG_HL);
             inc8(work8);
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
         case 0x35: /* DEC (HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL);
+            uint8_t work8 = m_busInterface->peek8(REG_HL);
             dec8(work8);
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
         case 0x36: /* LD (HL),n */
-            m_busInterface.poke8(REG_HL, m_busInterface.peek8(REG_PC));
+            m_busInterface->poke8(REG_HL, m_busInterface->peek8(REG_PC));
             REG_PC++;
             break;
 
@@ -1991,9 +2183,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
         }
 
         case 0x38: { /* JR C,e */
-            auto offset = static_cast<int8_t>(m_busInterface.peek8(REG_PC));
+            auto offset = static_cast<int8_t>(m_busInterface->peek8(REG_PC));
             if (carryFlag) {
-                m_busInterface.addressOnBus(REG_PC, 5);
+                m_busInterface->addressOnBus(REG_PC, 5);
                 REG_PC += offset;
                 REG_WZ = REG_PC + 1;
             }
@@ -2001,19 +2193,19 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0x39: /* ADD HL,SP */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             add16(regHL, REG_SP);
             break;
 
         case 0x3A: /* LD A,(nn) */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            regA = m_busInterface.peek8(REG_WZ);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            regA = m_busInterface->peek8(REG_WZ);
             REG_WZ++;
             REG_PC = REG_PC + 2;
             break;
 
         case 0x3B: /* DEC SP */
-            m_busInterface.addressOnBus(getPairIR().word, 2);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 2);
             REG_SP--;
             break;
 
@@ -2026,7 +2218,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x3E: /* LD A,n */
-            regA = m_busInterface.peek8(REG_PC);
+            regA = m_busInterface->peek8(REG_PC);
             REG_PC++;
             break;
 
@@ -2063,7 +2255,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x46: /* LD B,(HL) */
-            REG_B = m_busInterface.peek8(REG_HL);
+            REG_B = m_busInterface->peek8(REG_HL);
             break;
 
         case 0x47: /* LD B,A */
@@ -2094,7 +2286,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x4E: /* LD C,(HL) */
-            REG_C = m_busInterface.peek8(REG_HL);
+            REG_C = m_busInterface->peek8(REG_HL);
             break;
 
         case 0x4F: /* LD C,A */
@@ -2125,7 +2317,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x56: /* LD D,(HL) */
-            REG_D = m_busInterface.peek8(REG_HL);
+            REG_D = m_busInterface->peek8(REG_HL);
             break;
 
         case 0x57: /* LD D,A */
@@ -2156,7 +2348,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x5E: /* LD E,(HL) */
-            REG_E = m_busInterface.peek8(REG_HL);
+            REG_E = m_busInterface->peek8(REG_HL);
             break;
 
         case 0x5F: /* LD E,A */
@@ -2187,7 +2379,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x66: /* LD H,(HL) */
-            REG_H = m_busInterface.peek8(REG_HL);
+            REG_H = m_busInterface->peek8(REG_HL);
             break;
 
         case 0x67: /* LD H,A */
@@ -2218,7 +2410,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x6E: /* LD L,(HL) */
-            REG_L = m_busInterface.peek8(REG_HL);
+            REG_L = m_busInterface->peek8(REG_HL);
             break;
 
         case 0x6F: /* LD L,A */
@@ -2226,35 +2418,36 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x70: /* LD (HL),B */
-            m_busInterface.poke8(REG_HL, REG_B);
+            m_busInterface->poke8(REG_HL, REG_B);
             break;
 
         case 0x71: /* LD (HL),C */
-            m_busInterface.poke8(REG_HL, REG_C);
+            m_busInterface->poke8(REG_HL, REG_C);
             break;
 
         case 0x72: /* LD (HL),D */
-            m_busInterface.poke8(REG_HL, REG_D);
+            m_busInterface->poke8(REG_HL, REG_D);
             break;
 
         case 0x73: /* LD (HL),E */
-            m_busInterface.poke8(REG_HL, REG_E);
+            m_busInterface->poke8(REG_HL, REG_E);
             break;
 
         case 0x74: /* LD (HL),H */
-            m_busInterface.poke8(REG_HL, REG_H);
+            m_busInterface->poke8(REG_HL, REG_H);
             break;
 
         case 0x75: /* LD (HL),L */
-            m_busInterface.poke8(REG_HL, REG_L);
+            m_busInterface->poke8(REG_HL, REG_L);
             break;
 
         case 0x76: /* HALT */
             halted = true;
+            Z80_FLOW_EVENT(Z80FlowKind::Halt, REG_PC - 1, REG_PC - 1);
             break;
 
         case 0x77: /* LD (HL),A */
-            m_busInterface.poke8(REG_HL, regA);
+            m_busInterface->poke8(REG_HL, regA);
             break;
 
         case 0x78: /* LD A,B */
@@ -2282,7 +2475,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x7E: /* LD A,(HL) */
-            regA = m_busInterface.peek8(REG_HL);
+            regA = m_busInterface->peek8(REG_HL);
             break;
 
         case 0x7F: /* LD A,A */
@@ -2313,7 +2506,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x86: /* ADD A,(HL) */
-            add(m_busInterface.peek8(REG_HL));
+            add(m_busInterface->peek8(REG_HL));
             break;
 
         case 0x87: /* ADD A,A */
@@ -2345,7 +2538,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x8E: /* ADC A,(HL) */
-            adc(m_busInterface.peek8(REG_HL));
+            adc(m_busInterface->peek8(REG_HL));
             break;
 
         case 0x8F: /* ADC A,A */
@@ -2377,7 +2570,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x96: /* SUB (HL) */
-            sub(m_busInterface.peek8(REG_HL));
+            sub(m_busInterface->peek8(REG_HL));
             break;
 
         case 0x97: /* SUB A */
@@ -2409,7 +2602,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0x9E: /* SBC A,(HL) */
-            sbc(m_busInterface.peek8(REG_HL));
+            sbc(m_busInterface->peek8(REG_HL));
             break;
 
         case 0x9F: /* SBC A,A */
@@ -2441,7 +2634,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0xA6: /* AND (HL) */
-            and_(m_busInterface.peek8(REG_HL));
+            and_(m_busInterface->peek8(REG_HL));
             break;
 
         case 0xA7: /* AND A */
@@ -2473,7 +2666,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0xAE: /* XOR (HL) */
-            xor_(m_busInterface.peek8(REG_HL));
+            xor_(m_busInterface->peek8(REG_HL));
             break;
 
         case 0xAF: /* XOR A */
@@ -2505,7 +2698,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0xB6: /* OR (HL) */
-            or_(m_busInterface.peek8(REG_HL));
+            or_(m_busInterface->peek8(REG_HL));
             break;
 
         case 0xB7: /* OR A */
@@ -2537,7 +2730,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0xBE: /* CP (HL) */
-            cp(m_busInterface.peek8(REG_HL));
+            cp(m_busInterface->peek8(REG_HL));
             break;
 
         case 0xBF: /* CP A */
@@ -2545,9 +2738,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0xC0: { /* RET NZ */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             if ((sz5h3pnFlags & ZERO_MASK) == 0) {
-                REG_PC = REG_WZ = pop();
+                ret(Z80FlowKind::Ret, REG_PC - 1);
             }
             break;
         }
@@ -2556,7 +2749,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0xC2: { /* JP NZ,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if ((sz5h3pnFlags & ZERO_MASK) == 0) {
                 REG_PC = REG_WZ;
                 break;
@@ -2565,14 +2758,15 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0xC3: /* JP nn */
-            REG_WZ = REG_PC = m_busInterface.peek16(REG_PC);
+            REG_WZ = REG_PC = m_busInterface->peek16(REG_PC);
             break;
 
         case 0xC4: { /* CALL NZ,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if ((sz5h3pnFlags & ZERO_MASK) == 0) {
-                m_busInterface.addressOnBus(REG_PC + 1, 1);
+                m_busInterface->addressOnBus(REG_PC + 1, 1);
                 push(REG_PC + 2);
+                Z80_FLOW_EVENT(Z80FlowKind::Call, REG_PC - 1, REG_WZ);
                 REG_PC = REG_WZ;
                 break;
             }
@@ -2580,34 +2774,35 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0xC5: /* PUSH BC */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             push(REG_BC);
             break;
 
         case 0xC6: /* ADD A,n */
-            add(m_busInterface.peek8(REG_PC));
+            add(m_busInterface->peek8(REG_PC));
             REG_PC++;
             break;
 
         case 0xC7: /* RST 00H */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             push(REG_PC);
+            Z80_FLOW_EVENT(Z80FlowKind::Rst, REG_PC - 1, 0x00);
             REG_PC = REG_WZ = 0x00;
             break;
 
         case 0xC8: { /* RET Z */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             if ((sz5h3pnFlags & ZERO_MASK) != 0) {
-                REG_PC = REG_WZ = pop();
+                ret(Z80FlowKind::Ret, REG_PC - 1);
             }
             break;
         }
         case 0xC9: /* RET */
-            REG_PC = REG_WZ = pop();
+            ret(Z80FlowKind::Ret, REG_PC - 1);
             break;
 
         case 0xCA: { /* JP Z,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if ((sz5h3pnFlags & ZERO_MASK) != 0) {
                 REG_PC = REG_WZ;
                 break;
@@ -2620,10 +2815,11 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0xCC: { /* CALL Z,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if ((sz5h3pnFlags & ZERO_MASK) != 0) {
-                m_busInterface.addressOnBus(REG_PC + 1, 1);
+                m_busInterface->addressOnBus(REG_PC + 1, 1);
                 push(REG_PC + 2);
+                Z80_FLOW_EVENT(Z80FlowKind::Call, REG_PC - 1, REG_WZ);
                 REG_PC = REG_WZ;
                 break;
             }
@@ -2631,27 +2827,29 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0xCD: /* CALL nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            m_busInterface.addressOnBus(REG_PC + 1, 1);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            m_busInterface->addressOnBus(REG_PC + 1, 1);
             push(REG_PC + 2);
+            Z80_FLOW_EVENT(Z80FlowKind::Call, REG_PC - 1, REG_WZ);
             REG_PC = REG_WZ;
             break;
 
         case 0xCE: /* ADC A,n */
-            adc(m_busInterface.peek8(REG_PC));
+            adc(m_busInterface->peek8(REG_PC));
             REG_PC++;
             break;
 
         case 0xCF: /* RST 08H */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             push(REG_PC);
+            Z80_FLOW_EVENT(Z80FlowKind::Rst, REG_PC - 1, 0x08);
             REG_PC = REG_WZ = 0x08;
             break;
 
         case 0xD0: { /* RET NC */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             if (!carryFlag) {
-                REG_PC = REG_WZ = pop();
+                ret(Z80FlowKind::Ret, REG_PC - 1);
             }
             break;
         }
@@ -2660,7 +2858,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
 
         case 0xD2: { /* JP NC,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if (!carryFlag) {
                 REG_PC = REG_WZ;
                 break;
@@ -2669,19 +2867,20 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0xD3: /* OUT (n),A */ {
-            uint8_t work8 = m_busInterface.peek8(REG_PC);
+            uint8_t work8 = m_busInterface->peek8(REG_PC);
             REG_PC++;
             REG_WZ = regA << 8;
-            m_busInterface.outPort(REG_WZ | work8, regA);
+            m_busInterface->outPort(REG_WZ | work8, regA);
             REG_WZ |= (work8 + 1);
             break;
         }
 
         case 0xD4: { /* CALL NC,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if (!carryFlag) {
-                m_busInterface.addressOnBus(REG_PC + 1, 1);
+                m_busInterface->addressOnBus(REG_PC + 1, 1);
                 push(REG_PC + 2);
+                Z80_FLOW_EVENT(Z80FlowKind::Call, REG_PC - 1, REG_WZ);
                 REG_PC = REG_WZ;
                 break;
             }
@@ -2689,25 +2888,26 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0xD5: /* PUSH DE */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             push(REG_DE);
             break;
 
         case 0xD6: /* SUB n */
-            sub(m_busInterface.peek8(REG_PC));
+            sub(m_busInterface->peek8(REG_PC));
             REG_PC++;
             break;
 
         case 0xD7: /* RST 10H */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             push(REG_PC);
+            Z80_FLOW_EVENT(Z80FlowKind::Rst, REG_PC - 1, 0x10);
             REG_PC = REG_WZ = 0x10;
             break;
 
         case 0xD8: { /* RET C */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             if (carryFlag) {
-                REG_PC = REG_WZ = pop();
+                ret(Z80FlowKind::Ret, REG_PC - 1);
             }
             break;
         }
@@ -2728,7 +2928,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
         }
 
         case 0xDA: { /* JP C,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if (carryFlag) {
                 REG_PC = REG_WZ;
                 break;
@@ -2738,18 +2938,19 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
         }
         case 0xDB: /* IN A,(n) */
             REG_W = regA;
-            REG_Z = m_busInterface.peek8(REG_PC);
-            // REG_WZ = (regA << 8) | m_busInterface.peek8(REG_PC);
+            REG_Z = m_busInterface->peek8(REG_PC);
+            // REG_WZ = (regA << 8) | m_busInterface->peek8(REG_PC);
             REG_PC++;
-            regA = m_busInterface.inPort(REG_WZ);
+            regA = m_busInterface->inPort(REG_WZ);
             REG_WZ++;
             break;
 
         case 0xDC: { /* CALL C,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if (carryFlag) {
-                m_busInterface.addressOnBus(REG_PC + 1, 1);
+                m_busInterface->addressOnBus(REG_PC + 1, 1);
                 push(REG_PC + 2);
+                Z80_FLOW_EVENT(Z80FlowKind::Call, REG_PC - 1, REG_WZ);
                 REG_PC = REG_WZ;
                 break;
             }
@@ -2757,33 +2958,34 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         }
         case 0xDD: /* Subconjunto de instrucciones */
-            opCode = m_busInterface.fetchOpcode(REG_PC++);
+            opCode = m_busInterface->fetchOpcode(REG_PC++);
             regR++;
             decodeDDFD(opCode, regIX);
             break;
 
         case 0xDE: /* SBC A,n */
-            sbc(m_busInterface.peek8(REG_PC));
+            sbc(m_busInterface->peek8(REG_PC));
             REG_PC++;
             break;
 
         case 0xDF: /* RST 18H */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             push(REG_PC);
+            Z80_FLOW_EVENT(Z80FlowKind::Rst, REG_PC - 1, 0x18);
             REG_PC = REG_WZ = 0x18;
             break;
 
         case 0xE0: /* RET PO */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             if ((sz5h3pnFlags & PARITY_MASK) == 0) {
-                REG_PC = REG_WZ = pop();
+                ret(Z80FlowKind::Ret, REG_PC - 1);
             }
             break;
         case 0xE1: /* POP HL */
             REG_HL = pop();
             break;
         case 0xE2: /* JP PO,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if ((sz5h3pnFlags & PARITY_MASK) == 0) {
                 REG_PC = REG_WZ;
                 break;
@@ -2793,50 +2995,52 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
         case 0xE3: /* EX (SP),HL */ {
             // Instrucción de ejecución sutil.
             RegisterPair work = regHL;
-            REG_HL = m_busInterface.peek16(REG_SP);
-            m_busInterface.addressOnBus(REG_SP + 1, 1);
+            REG_HL = m_busInterface->peek16(REG_SP);
+            m_busInterface->addressOnBus(REG_SP + 1, 1);
             // No se usa poke16 porque el Z80 escribe los bytes AL REVES
-            m_busInterface.poke8(REG_SP + 1, work.byte8.hi);
-            m_busInterface.poke8(REG_SP, work.byte8.lo);
-            m_busInterface.addressOnBus(REG_SP, 2);
+            m_busInterface->poke8(REG_SP + 1, work.byte8.hi);
+            m_busInterface->poke8(REG_SP, work.byte8.lo);
+            m_busInterface->addressOnBus(REG_SP, 2);
             REG_WZ = REG_HL;
             break;
         }
 
         case 0xE4: /* CALL PO,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if ((sz5h3pnFlags & PARITY_MASK) == 0) {
-                m_busInterface.addressOnBus(REG_PC + 1, 1);
+                m_busInterface->addressOnBus(REG_PC + 1, 1);
                 push(REG_PC + 2);
+                Z80_FLOW_EVENT(Z80FlowKind::Call, REG_PC - 1, REG_WZ);
                 REG_PC = REG_WZ;
                 break;
             }
             REG_PC = REG_PC + 2;
             break;
         case 0xE5: /* PUSH HL */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             push(REG_HL);
             break;
         case 0xE6: /* AND n */
-            and_(m_busInterface.peek8(REG_PC));
+            and_(m_busInterface->peek8(REG_PC));
             REG_PC++;
             break;
         case 0xE7: /* RST 20H */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             push(REG_PC);
+            Z80_FLOW_EVENT(Z80FlowKind::Rst, REG_PC - 1, 0x20);
             REG_PC = REG_WZ = 0x20;
             break;
         case 0xE8: /* RET PE */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             if ((sz5h3pnFlags & PARITY_MASK) != 0) {
-                REG_PC = REG_WZ = pop();
+                ret(Z80FlowKind::Ret, REG_PC - 1);
             }
             break;
         case 0xE9: /* JP (HL) */
             REG_PC = REG_HL;
             break;
         case 0xEA: /* JP PE,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if ((sz5h3pnFlags & PARITY_MASK) != 0) {
                 REG_PC = REG_WZ;
                 break;
@@ -2851,40 +3055,42 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
         }
 
         case 0xEC: /* CALL PE,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if ((sz5h3pnFlags & PARITY_MASK) != 0) {
-                m_busInterface.addressOnBus(REG_PC + 1, 1);
+                m_busInterface->addressOnBus(REG_PC + 1, 1);
                 push(REG_PC + 2);
+                Z80_FLOW_EVENT(Z80FlowKind::Call, REG_PC - 1, REG_WZ);
                 REG_PC = REG_WZ;
                 break;
             }
             REG_PC = REG_PC + 2;
             break;
         case 0xED: /*Subconjunto de instrucciones*/
-            opCode = m_busInterface.fetchOpcode(REG_PC++);
+            opCode = m_busInterface->fetchOpcode(REG_PC++);
             regR++;
             decodeED(opCode);
             break;
         case 0xEE: /* XOR n */
-            xor_(m_busInterface.peek8(REG_PC));
+            xor_(m_busInterface->peek8(REG_PC));
             REG_PC++;
             break;
         case 0xEF: /* RST 28H */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             push(REG_PC);
+            Z80_FLOW_EVENT(Z80FlowKind::Rst, REG_PC - 1, 0x28);
             REG_PC = REG_WZ = 0x28;
             break;
         case 0xF0: /* RET P */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             if (sz5h3pnFlags < SIGN_MASK) {
-                REG_PC = REG_WZ = pop();
+                ret(Z80FlowKind::Ret, REG_PC - 1);
             }
             break;
         case 0xF1: /* POP AF */
             setRegAF(pop());
             break;
         case 0xF2: /* JP P,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if (sz5h3pnFlags < SIGN_MASK) {
                 REG_PC = REG_WZ;
                 break;
@@ -2893,42 +3099,45 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
             break;
         case 0xF3: /* DI */
             ffIFF1 = ffIFF2 = false;
+            Z80_FLOW_EVENT(Z80FlowKind::Di, REG_PC - 1, REG_PC);
             break;
         case 0xF4: /* CALL P,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if (sz5h3pnFlags < SIGN_MASK) {
-                m_busInterface.addressOnBus(REG_PC + 1, 1);
+                m_busInterface->addressOnBus(REG_PC + 1, 1);
                 push(REG_PC + 2);
+                Z80_FLOW_EVENT(Z80FlowKind::Call, REG_PC - 1, REG_WZ);
                 REG_PC = REG_WZ;
                 break;
             }
             REG_PC = REG_PC + 2;
             break;
         case 0xF5: /* PUSH AF */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             push(getRegAF());
             break;
         case 0xF6: /* OR n */
-            or_(m_busInterface.peek8(REG_PC));
+            or_(m_busInterface->peek8(REG_PC));
             REG_PC++;
             break;
         case 0xF7: /* RST 30H */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             push(REG_PC);
+            Z80_FLOW_EVENT(Z80FlowKind::Rst, REG_PC - 1, 0x30);
             REG_PC = REG_WZ = 0x30;
             break;
         case 0xF8: /* RET M */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             if (sz5h3pnFlags > 0x7f) {
-                REG_PC = REG_WZ = pop();
+                ret(Z80FlowKind::Ret, REG_PC - 1);
             }
             break;
         case 0xF9: /* LD SP,HL */
-            m_busInterface.addressOnBus(getPairIR().word, 2);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 2);
             REG_SP = REG_HL;
             break;
         case 0xFA: /* JP M,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if (sz5h3pnFlags > 0x7f) {
                 REG_PC = REG_WZ;
                 break;
@@ -2938,38 +3147,47 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeOpcode(uint8_t
         case 0xFB: /* EI */
             ffIFF1 = ffIFF2 = true;
             pendingEI = true;
+            Z80_FLOW_EVENT(Z80FlowKind::Ei, REG_PC - 1, REG_PC);
             break;
         case 0xFC: /* CALL M,nn */
-            REG_WZ = m_busInterface.peek16(REG_PC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
             if (sz5h3pnFlags > 0x7f) {
-                m_busInterface.addressOnBus(REG_PC + 1, 1);
+                m_busInterface->addressOnBus(REG_PC + 1, 1);
                 push(REG_PC + 2);
+                Z80_FLOW_EVENT(Z80FlowKind::Call, REG_PC - 1, REG_WZ);
                 REG_PC = REG_WZ;
                 break;
             }
             REG_PC = REG_PC + 2;
             break;
         case 0xFD: /* Subconjunto de instrucciones */
-            opCode = m_busInterface.fetchOpcode(REG_PC++);
+            opCode = m_busInterface->fetchOpcode(REG_PC++);
             regR++;
             decodeDDFD(opCode, regIY);
             break;
         case 0xFE: /* CP n */
-            cp(m_busInterface.peek8(REG_PC));
+            cp(m_busInterface->peek8(REG_PC));
             REG_PC++;
             break;
         case 0xFF: /* RST 38H */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             push(REG_PC);
+            Z80_FLOW_EVENT(Z80FlowKind::Rst, REG_PC - 1, 0x38);
             REG_PC = REG_WZ = 0x38;
     } /* del switch( codigo ) */
 }
 
 // Subconjunto de instrucciones 0xCB
 
-template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
-    uint8_t opCode = m_busInterface.fetchOpcode(REG_PC++);
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::decodeCB() {
+    uint8_t opCode = m_busInterface->fetchOpcode(REG_PC++);
     regR++;
+#ifdef WITH_OPCODE_HISTOGRAM
+    if (m_histogram != nullptr) {
+        m_histogram->count(Z80OpcodeTable::CB, opCode);
+    }
+#endif
+    Z80_HANDLER_SELECT(Z80OpcodeTable::CB, opCode);
 
     switch (opCode) {
         case 0x00: /* RLC B */
@@ -2997,10 +3215,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x06: /* RLC (HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL);
+            uint8_t work8 = m_busInterface->peek8(REG_HL);
             rlc(work8);
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3033,10 +3251,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x0E: /* RRC (HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL);
+            uint8_t work8 = m_busInterface->peek8(REG_HL);
             rrc(work8);
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3069,10 +3287,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x16: /* RL (HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL);
+            uint8_t work8 = m_busInterface->peek8(REG_HL);
             rl(work8);
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3105,10 +3323,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x1E: /* RR (HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL);
+            uint8_t work8 = m_busInterface->peek8(REG_HL);
             rr(work8);
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3141,10 +3359,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x26: /* SLA (HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL);
+            uint8_t work8 = m_busInterface->peek8(REG_HL);
             sla(work8);
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3177,10 +3395,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x2E: /* SRA (HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL);
+            uint8_t work8 = m_busInterface->peek8(REG_HL);
             sra(work8);
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3213,10 +3431,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x36: /* SLL (HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL);
+            uint8_t work8 = m_busInterface->peek8(REG_HL);
             sll(work8);
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3249,10 +3467,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x3E: /* SRL (HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL);
+            uint8_t work8 = m_busInterface->peek8(REG_HL);
             srl(work8);
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3285,9 +3503,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x46: /* BIT 0,(HL) */
-            bitTest(0x01, m_busInterface.peek8(REG_HL));
+            bitTest(0x01, m_busInterface->peek8(REG_HL));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | (REG_W & FLAG_53_MASK);
-            m_busInterface.addressOnBus(REG_HL, 1);
+            m_busInterface->addressOnBus(REG_HL, 1);
             break;
 
         case 0x47: /* BIT 0,A */
@@ -3319,9 +3537,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x4E: /* BIT 1,(HL) */
-            bitTest(0x02, m_busInterface.peek8(REG_HL));
+            bitTest(0x02, m_busInterface->peek8(REG_HL));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | (REG_W & FLAG_53_MASK);
-            m_busInterface.addressOnBus(REG_HL, 1);
+            m_busInterface->addressOnBus(REG_HL, 1);
             break;
 
         case 0x4F: /* BIT 1,A */
@@ -3353,9 +3571,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x56: /* BIT 2,(HL) */
-            bitTest(0x04, m_busInterface.peek8(REG_HL));
+            bitTest(0x04, m_busInterface->peek8(REG_HL));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | (REG_W & FLAG_53_MASK);
-            m_busInterface.addressOnBus(REG_HL, 1);
+            m_busInterface->addressOnBus(REG_HL, 1);
             break;
 
         case 0x57: /* BIT 2,A */
@@ -3387,9 +3605,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x5E: /* BIT 3,(HL) */
-            bitTest(0x08, m_busInterface.peek8(REG_HL));
+            bitTest(0x08, m_busInterface->peek8(REG_HL));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | (REG_W & FLAG_53_MASK);
-            m_busInterface.addressOnBus(REG_HL, 1);
+            m_busInterface->addressOnBus(REG_HL, 1);
             break;
 
         case 0x5F: /* BIT 3,A */
@@ -3421,9 +3639,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x66: /* BIT 4,(HL) */
-            bitTest(0x10, m_busInterface.peek8(REG_HL));
+            bitTest(0x10, m_busInterface->peek8(REG_HL));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | (REG_W & FLAG_53_MASK);
-            m_busInterface.addressOnBus(REG_HL, 1);
+            m_busInterface->addressOnBus(REG_HL, 1);
             break;
 
         case 0x67: /* BIT 4,A */
@@ -3455,9 +3673,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x6E: /* BIT 5,(HL) */
-            bitTest(0x20, m_busInterface.peek8(REG_HL));
+            bitTest(0x20, m_busInterface->peek8(REG_HL));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | (REG_W & FLAG_53_MASK);
-            m_busInterface.addressOnBus(REG_HL, 1);
+            m_busInterface->addressOnBus(REG_HL, 1);
             break;
 
         case 0x6F: /* BIT 5,A */
@@ -3489,9 +3707,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x76: /* BIT 6,(HL) */
-            bitTest(0x40, m_busInterface.peek8(REG_HL));
+            bitTest(0x40, m_busInterface->peek8(REG_HL));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | (REG_W & FLAG_53_MASK);
-            m_busInterface.addressOnBus(REG_HL, 1);
+            m_busInterface->addressOnBus(REG_HL, 1);
             break;
 
         case 0x77: /* BIT 6,A */
@@ -3523,9 +3741,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x7E: /* BIT 7,(HL) */
-            bitTest(0x80, m_busInterface.peek8(REG_HL));
+            bitTest(0x80, m_busInterface->peek8(REG_HL));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | (REG_W & FLAG_53_MASK);
-            m_busInterface.addressOnBus(REG_HL, 1);
+            m_busInterface->addressOnBus(REG_HL, 1);
             break;
 
         case 0x7F: /* BIT 7,A */
@@ -3557,9 +3775,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x86: /* RES 0,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) & 0xFE;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) & 0xFE;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3592,9 +3810,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x8E: /* RES 1,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) & 0xFD;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) & 0xFD;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3627,9 +3845,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x96: /* RES 2,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) & 0xFB;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) & 0xFB;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3662,9 +3880,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0x9E: /* RES 3,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) & 0xF7;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) & 0xF7;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3697,9 +3915,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0xA6: /* RES 4,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) & 0xEF;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) & 0xEF;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3732,9 +3950,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0xAE: /* RES 5,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) & 0xDF;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) & 0xDF;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3767,9 +3985,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0xB6: /* RES 6,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) & 0xBF;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) & 0xBF;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3802,9 +4020,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0xBE: /* RES 7,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) & 0x7F;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) & 0x7F;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3837,9 +4055,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0xC6: /* SET 0,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) | 0x01;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) | 0x01;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3872,9 +4090,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0xCE: /* SET 1,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) | 0x02;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) | 0x02;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3907,9 +4125,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0xD6: /* SET 2,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) | 0x04;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) | 0x04;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3942,9 +4160,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0xDE: /* SET 3,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) | 0x08;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) | 0x08;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -3977,9 +4195,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0xE6: /* SET 4,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) | 0x10;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) | 0x10;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -4012,9 +4230,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0xEE: /* SET 5,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) | 0x20;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) | 0x20;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -4047,9 +4265,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0xF6: /* SET 6,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) | 0x40;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) | 0x40;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -4082,9 +4300,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
             break;
 
         case 0xFE: /* SET 7,(HL) */ {
-            uint8_t work8 = m_busInterface.peek8(REG_HL) | 0x80;
-            m_busInterface.addressOnBus(REG_HL, 1);
-            m_busInterface.poke8(REG_HL, work8);
+            uint8_t work8 = m_busInterface->peek8(REG_HL) | 0x80;
+            m_busInterface->addressOnBus(REG_HL, 1);
+            m_busInterface->poke8(REG_HL, work8);
             break;
         }
 
@@ -4111,32 +4329,38 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeCB() {
  * Naturalmente, en una serie repetida de DDFD no hay que comprobar las
  * interrupciones entre cada prefijo.
  */
-template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t opCode, RegisterPair& regIXY) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::decodeDDFD(uint8_t opCode, RegisterPair& regIXY) {
+#ifdef WITH_OPCODE_HISTOGRAM
+    if (m_histogram != nullptr) {
+        m_histogram->count(&regIXY == &regIX ? Z80OpcodeTable::DD : Z80OpcodeTable::FD, opCode);
+    }
+#endif
+    Z80_HANDLER_SELECT(&regIXY == &regIX ? Z80OpcodeTable::DD : Z80OpcodeTable::FD, opCode);
     switch (opCode) {
         case 0x09: /* ADD IX,BC */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             add16(regIXY, REG_BC);
             break;
 
         case 0x19: /* ADD IX,DE */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             add16(regIXY, REG_DE);
             break;
 
         case 0x21: /* LD IX,nn */
-            regIXY.word = m_busInterface.peek16(REG_PC);
+            Z80_WORD(regIXY) = m_busInterface->peek16(REG_PC);
             REG_PC = REG_PC + 2;
             break;
 
         case 0x22: /* LD (nn),IX */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            m_busInterface.poke16(REG_WZ++, regIXY);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            m_busInterface->poke16(REG_WZ++, regIXY);
             REG_PC = REG_PC + 2;
             break;
 
         case 0x23: /* INC IX */
-            m_busInterface.addressOnBus(getPairIR().word, 2);
-            regIXY.word++;
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 2);
+            Z80_WORD(regIXY)++;
             break;
 
         case 0x24: /* INC IXh */
@@ -4148,24 +4372,24 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x26: /* LD IXh,n */
-            regIXY.byte8.hi = m_busInterface.peek8(REG_PC);
+            regIXY.byte8.hi = m_busInterface->peek8(REG_PC);
             REG_PC++;
             break;
 
         case 0x29: /* ADD IX,IX */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
-            add16(regIXY, regIXY.word);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
+            add16(regIXY, Z80_WORD(regIXY));
             break;
 
         case 0x2A: /* LD IX,(nn) */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            regIXY.word = m_busInterface.peek16(REG_WZ++);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            Z80_WORD(regIXY) = m_busInterface->peek16(REG_WZ++);
             REG_PC = REG_PC + 2;
             break;
 
         case 0x2B: /* DEC IX */
-            m_busInterface.addressOnBus(getPairIR().word, 2);
-            regIXY.word--;
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 2);
+            Z80_WORD(regIXY)--;
             break;
 
         case 0x2C: /* INC IXl */
@@ -4177,44 +4401,44 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x2E: /* LD IXl,n */
-            regIXY.byte8.lo = m_busInterface.peek8(REG_PC);
+            regIXY.byte8.lo = m_busInterface->peek8(REG_PC);
             REG_PC++;
             break;
 
         case 0x34: /* INC (IX+d) */ {
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            uint8_t work8 = m_busInterface.peek8(REG_WZ);
-            m_busInterface.addressOnBus(REG_WZ, 1);
+            uint8_t work8 = m_busInterface->peek8(REG_WZ);
+            m_busInterface->addressOnBus(REG_WZ, 1);
             inc8(work8);
-            m_busInterface.poke8(REG_WZ, work8);
+            m_busInterface->poke8(REG_WZ, work8);
             break;
         }
 
         case 0x35: /* DEC (IX+d) */ {
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            uint8_t work8 = m_busInterface.peek8(REG_WZ);
-            m_busInterface.addressOnBus(REG_WZ, 1);
+            uint8_t work8 = m_busInterface->peek8(REG_WZ);
+            m_busInterface->addressOnBus(REG_WZ, 1);
             dec8(work8);
-            m_busInterface.poke8(REG_WZ, work8);
+            m_busInterface->poke8(REG_WZ, work8);
             break;
         }
 
         case 0x36: /* LD (IX+d),n */ {
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
             REG_PC++;
-            uint8_t work8 = m_busInterface.peek8(REG_PC);
-            m_busInterface.addressOnBus(REG_PC, 2);
+            uint8_t work8 = m_busInterface->peek8(REG_PC);
+            m_busInterface->addressOnBus(REG_PC, 2);
             REG_PC++;
-            m_busInterface.poke8(REG_WZ, work8);
+            m_busInterface->poke8(REG_WZ, work8);
             break;
         }
 
         case 0x39: /* ADD IX,SP */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             add16(regIXY, REG_SP);
             break;
 
@@ -4227,10 +4451,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x46: /* LD B,(IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            REG_B = m_busInterface.peek8(REG_WZ);
+            REG_B = m_busInterface->peek8(REG_WZ);
             break;
 
         case 0x4C: /* LD C,IXh */
@@ -4242,10 +4466,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x4E: /* LD C,(IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            REG_C = m_busInterface.peek8(REG_WZ);
+            REG_C = m_busInterface->peek8(REG_WZ);
             break;
 
         case 0x54: /* LD D,IXh */
@@ -4257,10 +4481,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x56: /* LD D,(IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            REG_D = m_busInterface.peek8(REG_WZ);
+            REG_D = m_busInterface->peek8(REG_WZ);
             break;
 
         case 0x5C: /* LD E,IXh */
@@ -4272,10 +4496,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x5E: /* LD E,(IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            REG_E = m_busInterface.peek8(REG_WZ);
+            REG_E = m_busInterface->peek8(REG_WZ);
             break;
 
         case 0x60: /* LD IXh,B */
@@ -4302,10 +4526,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x66: /* LD H,(IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            REG_H = m_busInterface.peek8(REG_WZ);
+            REG_H = m_busInterface->peek8(REG_WZ);
             break;
 
         case 0x67: /* LD IXh,A */
@@ -4336,10 +4560,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x6E: /* LD L,(IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            REG_L = m_busInterface.peek8(REG_WZ);
+            REG_L = m_busInterface->peek8(REG_WZ);
             break;
 
         case 0x6F: /* LD IXl,A */
@@ -4347,52 +4571,52 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x70: /* LD (IX+d),B */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            m_busInterface.poke8(REG_WZ, REG_B);
+            m_busInterface->poke8(REG_WZ, REG_B);
             break;
 
         case 0x71: /* LD (IX+d),C */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            m_busInterface.poke8(REG_WZ, REG_C);
+            m_busInterface->poke8(REG_WZ, REG_C);
             break;
 
         case 0x72: /* LD (IX+d),D */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            m_busInterface.poke8(REG_WZ, REG_D);
+            m_busInterface->poke8(REG_WZ, REG_D);
             break;
 
         case 0x73: /* LD (IX+d),E */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            m_busInterface.poke8(REG_WZ, REG_E);
+            m_busInterface->poke8(REG_WZ, REG_E);
             break;
 
         case 0x74: /* LD (IX+d),H */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            m_busInterface.poke8(REG_WZ, REG_H);
+            m_busInterface->poke8(REG_WZ, REG_H);
             break;
 
         case 0x75: /* LD (IX+d),L */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            m_busInterface.poke8(REG_WZ, REG_L);
+            m_busInterface->poke8(REG_WZ, REG_L);
             break;
 
         case 0x77: /* LD (IX+d),A */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            m_busInterface.poke8(REG_WZ, regA);
+            m_busInterface->poke8(REG_WZ, regA);
             break;
 
         case 0x7C: /* LD A,IXh */
@@ -4404,10 +4628,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x7E: /* LD A,(IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            regA = m_busInterface.peek8(REG_WZ);
+            regA = m_busInterface->peek8(REG_WZ);
             break;
 
         case 0x84: /* ADD A,IXh */
@@ -4419,10 +4643,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x86: /* ADD A,(IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            add(m_busInterface.peek8(REG_WZ));
+            add(m_busInterface->peek8(REG_WZ));
             break;
 
         case 0x8C: /* ADC A,IXh */
@@ -4434,10 +4658,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x8E: /* ADC A,(IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            adc(m_busInterface.peek8(REG_WZ));
+            adc(m_busInterface->peek8(REG_WZ));
             break;
 
         case 0x94: /* SUB IXh */
@@ -4449,10 +4673,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x96: /* SUB (IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            sub(m_busInterface.peek8(REG_WZ));
+            sub(m_busInterface->peek8(REG_WZ));
             break;
 
         case 0x9C: /* SBC A,IXh */
@@ -4464,10 +4688,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0x9E: /* SBC A,(IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            sbc(m_busInterface.peek8(REG_WZ));
+            sbc(m_busInterface->peek8(REG_WZ));
             break;
 
         case 0xA4: /* AND IXh */
@@ -4479,10 +4703,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0xA6: /* AND (IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            and_(m_busInterface.peek8(REG_WZ));
+            and_(m_busInterface->peek8(REG_WZ));
             break;
 
         case 0xAC: /* XOR IXh */
@@ -4494,10 +4718,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0xAE: /* XOR (IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            xor_(m_busInterface.peek8(REG_WZ));
+            xor_(m_busInterface->peek8(REG_WZ));
             break;
 
         case 0xB4: /* OR IXh */
@@ -4509,10 +4733,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0xB6: /* OR (IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            or_(m_busInterface.peek8(REG_WZ));
+            or_(m_busInterface->peek8(REG_WZ));
             break;
 
         case 0xBC: /* CP IXh */
@@ -4524,18 +4748,24 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0xBE: /* CP (IX+d) */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
-            m_busInterface.addressOnBus(REG_PC, 5);
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
+            m_busInterface->addressOnBus(REG_PC, 5);
             REG_PC++;
-            cp(m_busInterface.peek8(REG_WZ));
+            cp(m_busInterface->peek8(REG_WZ));
             break;
 
         case 0xCB: /* Subconjunto de instrucciones */
-            REG_WZ = regIXY.word + static_cast<int8_t>(m_busInterface.peek8(REG_PC));
+            REG_WZ = Z80_WORD(regIXY) + static_cast<int8_t>(m_busInterface->peek8(REG_PC));
             REG_PC++;
-            opCode = m_busInterface.peek8(REG_PC);
-            m_busInterface.addressOnBus(REG_PC, 2);
+            opCode = m_busInterface->peek8(REG_PC);
+            m_busInterface->addressOnBus(REG_PC, 2);
             REG_PC++;
+#ifdef WITH_OPCODE_HISTOGRAM
+            if (m_histogram != nullptr) {
+                m_histogram->count(&regIXY == &regIX ? Z80OpcodeTable::DDCB : Z80OpcodeTable::FDCB, opCode);
+            }
+#endif
+            Z80_HANDLER_SELECT(&regIXY == &regIX ? Z80OpcodeTable::DDCB : Z80OpcodeTable::FDCB, opCode);
             decodeDDFDCB(opCode, REG_WZ);
             break;
 
@@ -4543,31 +4773,31 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             prefixOpcode = 0xDD;
             break;
         case 0xE1: /* POP IX */
-            regIXY.word = pop();
+            Z80_WORD(regIXY) = pop();
             break;
 
         case 0xE3: /* EX (SP),IX */ {
             // Instrucción de ejecución sutil como pocas... atento al dato.
             RegisterPair work16 = regIXY;
-            regIXY.word = m_busInterface.peek16(REG_SP);
-            m_busInterface.addressOnBus(REG_SP + 1, 1);
+            Z80_WORD(regIXY) = m_busInterface->peek16(REG_SP);
+            m_busInterface->addressOnBus(REG_SP + 1, 1);
             /* I can't call poke16 from here because the Z80 CPU does the writes in inverted order.
              * Same thing goes for EX (SP), HL.
              */
-            m_busInterface.poke8(REG_SP + 1, work16.byte8.hi);
-            m_busInterface.poke8(REG_SP, work16.byte8.lo);
-            m_busInterface.addressOnBus(REG_SP, 2);
-            REG_WZ = regIXY.word;
+            m_busInterface->poke8(REG_SP + 1, work16.byte8.hi);
+            m_busInterface->poke8(REG_SP, work16.byte8.lo);
+            m_busInterface->addressOnBus(REG_SP, 2);
+            REG_WZ = Z80_WORD(regIXY);
             break;
         }
 
         case 0xE5: /* PUSH IX */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
-            push(regIXY.word);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
+            push(Z80_WORD(regIXY));
             break;
 
         case 0xE9: /* JP (IX) */
-            REG_PC = regIXY.word;
+            REG_PC = Z80_WORD(regIXY);
             break;
 
         case 0xED:
@@ -4575,8 +4805,8 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             break;
 
         case 0xF9: /* LD SP,IX */
-            m_busInterface.addressOnBus(getPairIR().word, 2);
-            REG_SP = regIXY.word;
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 2);
+            REG_SP = Z80_WORD(regIXY);
             break;
 
         case 0xFD:
@@ -4591,7 +4821,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
             // ld <bcdexya>,<bcdexya> de ZEXALL.
 #ifdef WITH_BREAKPOINT_SUPPORT
             if (breakpointEnabled && prefixOpcode == 0) {
-                opCode = m_busInterface.breakpoint(REG_PC, opCode);
+                opCode = m_busInterface->breakpoint(REG_PC, opCode);
             }
 #endif
             decodeOpcode(opCode);
@@ -4601,7 +4831,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFD(uint8_t op
 }
 
 // Subconjunto de instrucciones 0xDDCB
-template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t opCode, uint16_t address) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::decodeDDFDCB(uint8_t opCode, uint16_t address) {
 
     switch (opCode) {
         default:
@@ -4614,10 +4844,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x06: /* RLC (IX+d)   */
         case 0x07: /* RLC (IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address);
+            uint8_t work8 = m_busInterface->peek8(address);
             rlc(work8);
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4630,10 +4860,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x0E: /* RRC (IX+d)   */
         case 0x0F: /* RRC (IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address);
+            uint8_t work8 = m_busInterface->peek8(address);
             rrc(work8);
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4646,10 +4876,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x16: /* RL (IX+d)   */
         case 0x17: /* RL (IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address);
+            uint8_t work8 = m_busInterface->peek8(address);
             rl(work8);
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4662,10 +4892,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x1E: /* RR (IX+d)   */
         case 0x1F: /* RR (IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address);
+            uint8_t work8 = m_busInterface->peek8(address);
             rr(work8);
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4678,10 +4908,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x26: /* SLA (IX+d)   */
         case 0x27: /* SLA (IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address);
+            uint8_t work8 = m_busInterface->peek8(address);
             sla(work8);
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4694,10 +4924,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x2E: /* SRA (IX+d)   */
         case 0x2F: /* SRA (IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address);
+            uint8_t work8 = m_busInterface->peek8(address);
             sra(work8);
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4710,10 +4940,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x36: /* SLL (IX+d)   */
         case 0x37: /* SLL (IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address);
+            uint8_t work8 = m_busInterface->peek8(address);
             sll(work8);
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4726,10 +4956,10 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x3E: /* SRL (IX+d)   */
         case 0x3F: /* SRL (IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address);
+            uint8_t work8 = m_busInterface->peek8(address);
             srl(work8);
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4741,9 +4971,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x45:
         case 0x46:
         case 0x47: /* BIT 0,(IX+d) */
-            bitTest(0x01, m_busInterface.peek8(address));
+            bitTest(0x01, m_busInterface->peek8(address));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | ((address >> 8) & FLAG_53_MASK);
-            m_busInterface.addressOnBus(address, 1);
+            m_busInterface->addressOnBus(address, 1);
             break;
 
         case 0x48:
@@ -4754,9 +4984,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x4D:
         case 0x4E:
         case 0x4F: /* BIT 1,(IX+d) */
-            bitTest(0x02, m_busInterface.peek8(address));
+            bitTest(0x02, m_busInterface->peek8(address));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | ((address >> 8) & FLAG_53_MASK);
-            m_busInterface.addressOnBus(address, 1);
+            m_busInterface->addressOnBus(address, 1);
             break;
 
         case 0x50:
@@ -4767,9 +4997,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x55:
         case 0x56:
         case 0x57: /* BIT 2,(IX+d) */
-            bitTest(0x04, m_busInterface.peek8(address));
+            bitTest(0x04, m_busInterface->peek8(address));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | ((address >> 8) & FLAG_53_MASK);
-            m_busInterface.addressOnBus(address, 1);
+            m_busInterface->addressOnBus(address, 1);
             break;
 
         case 0x58:
@@ -4780,9 +5010,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x5D:
         case 0x5E:
         case 0x5F: /* BIT 3,(IX+d) */
-            bitTest(0x08, m_busInterface.peek8(address));
+            bitTest(0x08, m_busInterface->peek8(address));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | ((address >> 8) & FLAG_53_MASK);
-            m_busInterface.addressOnBus(address, 1);
+            m_busInterface->addressOnBus(address, 1);
             break;
 
         case 0x60:
@@ -4793,9 +5023,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x65:
         case 0x66:
         case 0x67: /* BIT 4,(IX+d) */
-            bitTest(0x10, m_busInterface.peek8(address));
+            bitTest(0x10, m_busInterface->peek8(address));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | ((address >> 8) & FLAG_53_MASK);
-            m_busInterface.addressOnBus(address, 1);
+            m_busInterface->addressOnBus(address, 1);
             break;
 
         case 0x68:
@@ -4806,9 +5036,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x6D:
         case 0x6E:
         case 0x6F: /* BIT 5,(IX+d) */
-            bitTest(0x20, m_busInterface.peek8(address));
+            bitTest(0x20, m_busInterface->peek8(address));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | ((address >> 8) & FLAG_53_MASK);
-            m_busInterface.addressOnBus(address, 1);
+            m_busInterface->addressOnBus(address, 1);
             break;
 
         case 0x70:
@@ -4819,9 +5049,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x75:
         case 0x76:
         case 0x77: /* BIT 6,(IX+d) */
-            bitTest(0x40, m_busInterface.peek8(address));
+            bitTest(0x40, m_busInterface->peek8(address));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | ((address >> 8) & FLAG_53_MASK);
-            m_busInterface.addressOnBus(address, 1);
+            m_busInterface->addressOnBus(address, 1);
             break;
 
         case 0x78:
@@ -4832,9 +5062,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x7D:
         case 0x7E:
         case 0x7F: /* BIT 7,(IX+d) */
-            bitTest(0x80, m_busInterface.peek8(address));
+            bitTest(0x80, m_busInterface->peek8(address));
             sz5h3pnFlags = (sz5h3pnFlags & FLAG_SZHP_MASK) | ((address >> 8) & FLAG_53_MASK);
-            m_busInterface.addressOnBus(address, 1);
+            m_busInterface->addressOnBus(address, 1);
             break;
 
         case 0x80: /* RES 0,(IX+d),B */
@@ -4846,9 +5076,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x86: /* RES 0,(IX+d)   */
         case 0x87: /* RES 0,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) & 0xFE;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) & 0xFE;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4861,9 +5091,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x8E: /* RES 1,(IX+d)   */
         case 0x8F: /* RES 1,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) & 0xFD;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) & 0xFD;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4876,9 +5106,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x96: /* RES 2,(IX+d)   */
         case 0x97: /* RES 2,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) & 0xFB;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) & 0xFB;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4891,9 +5121,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0x9E: /* RES 3,(IX+d)   */
         case 0x9F: /* RES 3,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) & 0xF7;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) & 0xF7;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4906,9 +5136,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0xA6: /* RES 4,(IX+d)   */
         case 0xA7: /* RES 4,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) & 0xEF;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) & 0xEF;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4921,9 +5151,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0xAE: /* RES 5,(IX+d)   */
         case 0xAF: /* RES 5,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) & 0xDF;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) & 0xDF;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4936,9 +5166,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0xB6: /* RES 6,(IX+d)   */
         case 0xB7: /* RES 6,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) & 0xBF;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) & 0xBF;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4951,9 +5181,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0xBE: /* RES 7,(IX+d)   */
         case 0xBF: /* RES 7,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) & 0x7F;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) & 0x7F;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4966,9 +5196,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0xC6: /* SET 0,(IX+d)   */
         case 0xC7: /* SET 0,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) | 0x01;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) | 0x01;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4981,9 +5211,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0xCE: /* SET 1,(IX+d)   */
         case 0xCF: /* SET 1,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) | 0x02;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) | 0x02;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -4996,9 +5226,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0xD6: /* SET 2,(IX+d)   */
         case 0xD7: /* SET 2,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) | 0x04;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) | 0x04;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -5011,9 +5241,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0xDE: /* SET 3,(IX+d)   */
         case 0xDF: /* SET 3,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) | 0x08;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) | 0x08;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -5026,9 +5256,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0xE6: /* SET 4,(IX+d)   */
         case 0xE7: /* SET 4,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) | 0x10;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) | 0x10;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -5041,9 +5271,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0xEE: /* SET 5,(IX+d)   */
         case 0xEF: /* SET 5,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) | 0x20;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) | 0x20;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -5056,9 +5286,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0xF6: /* SET 6,(IX+d)   */
         case 0xF7: /* SET 6,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) | 0x40;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) | 0x40;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -5071,9 +5301,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
         case 0xFE: /* SET 7,(IX+d)   */
         case 0xFF: /* SET 7,(IX+d),A */
         {
-            uint8_t work8 = m_busInterface.peek8(address) | 0x80;
-            m_busInterface.addressOnBus(address, 1);
-            m_busInterface.poke8(address, work8);
+            uint8_t work8 = m_busInterface->peek8(address) | 0x80;
+            m_busInterface->addressOnBus(address, 1);
+            m_busInterface->poke8(address, work8);
             copyToRegister(opCode, work8);
             break;
         }
@@ -5082,29 +5312,35 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeDDFDCB(uint8_t
 
 // Subconjunto de instrucciones 0xED
 
-template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCode) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::decodeED(uint8_t opCode) {
+#ifdef WITH_OPCODE_HISTOGRAM
+    if (m_histogram != nullptr) {
+        m_histogram->count(Z80OpcodeTable::ED, opCode);
+    }
+#endif
+    Z80_HANDLER_SELECT(Z80OpcodeTable::ED, opCode);
     switch (opCode) {
         case 0x40: /* IN B,(C) */
             REG_WZ = REG_BC;
-            REG_B = m_busInterface.inPort(REG_WZ);
+            REG_B = m_busInterface->inPort(REG_WZ);
             REG_WZ++;
-            sz5h3pnFlags = sz53pn_addTable[REG_B];
+            sz5h3pnFlags = kFlagTables.sz53pn_add[REG_B];
             break;
 
         case 0x41: /* OUT (C),B */
             REG_WZ = REG_BC;
-            m_busInterface.outPort(REG_WZ, REG_B);
+            m_busInterface->outPort(REG_WZ, REG_B);
             REG_WZ++;
             break;
 
         case 0x42: /* SBC HL,BC */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             sbc16(REG_BC);
             break;
 
         case 0x43: /* LD (nn),BC */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            m_busInterface.poke16(REG_WZ, regBC);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            m_busInterface->poke16(REG_WZ, regBC);
             REG_WZ++;
             REG_PC = REG_PC + 2;
             break;
@@ -5132,7 +5368,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
         case 0x75:
         case 0x7D: /* RETN */
             ffIFF1 = ffIFF2;
-            REG_PC = REG_WZ = pop();
+            ret(Z80FlowKind::Retn, REG_PC - 2);
             break;
 
         case 0x4D: /* RETI */
@@ -5140,7 +5376,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
              * IFF2; only RETN does this (to restore interrupts after NMI). This affects
              * precise interrupt handling behavior.
              */
-            REG_PC = REG_WZ = pop();
+            ret(Z80FlowKind::Reti, REG_PC - 2);
             break;
 
         case 0x46:
@@ -5155,31 +5391,31 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
              * El par IR se pone en el bus de direcciones *antes*
              * de poner A en el registro I. Detalle importante.
              */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             regI = regA;
             break;
 
         case 0x48: /* IN C,(C) */
             REG_WZ = REG_BC;
-            REG_C = m_busInterface.inPort(REG_WZ);
+            REG_C = m_busInterface->inPort(REG_WZ);
             REG_WZ++;
-            sz5h3pnFlags = sz53pn_addTable[REG_C];
+            sz5h3pnFlags = kFlagTables.sz53pn_add[REG_C];
             break;
 
         case 0x49: /* OUT (C),C */
             REG_WZ = REG_BC;
-            m_busInterface.outPort(REG_WZ, REG_C);
+            m_busInterface->outPort(REG_WZ, REG_C);
             REG_WZ++;
             break;
 
         case 0x4A: /* ADC HL,BC */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             adc16(REG_BC);
             break;
 
         case 0x4B: /* LD BC,(nn) */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            REG_BC = m_busInterface.peek16(REG_WZ);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            REG_BC = m_busInterface->peek16(REG_WZ);
             REG_WZ++;
             REG_PC = REG_PC + 2;
             break;
@@ -5189,30 +5425,30 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
              * El par IR se pone en el bus de direcciones *antes*
              * de poner A en el registro R. Detalle importante.
              */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             setRegR(regA);
             break;
 
         case 0x50: /* IN D,(C) */
             REG_WZ = REG_BC;
-            REG_D = m_busInterface.inPort(REG_WZ);
+            REG_D = m_busInterface->inPort(REG_WZ);
             REG_WZ++;
-            sz5h3pnFlags = sz53pn_addTable[REG_D];
+            sz5h3pnFlags = kFlagTables.sz53pn_add[REG_D];
             break;
 
         case 0x51: /* OUT (C),D */
             REG_WZ = REG_BC;
-            m_busInterface.outPort(REG_WZ++, REG_D);
+            m_busInterface->outPort(REG_WZ++, REG_D);
             break;
 
         case 0x52: /* SBC HL,DE */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             sbc16(REG_DE);
             break;
 
         case 0x53: /* LD (nn),DE */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            m_busInterface.poke16(REG_WZ++, regDE);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            m_busInterface->poke16(REG_WZ++, regDE);
             REG_PC = REG_PC + 2;
             break;
 
@@ -5222,9 +5458,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
             break;
 
         case 0x57: { /* LD A,I */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             regA = regI;
-            sz5h3pnFlags = sz53n_addTable[regA];
+            sz5h3pnFlags = kFlagTables.sz53n_add[regA];
             /*
              * The P / V flag should reflect IFF2 state regardless of whether an
              * interrupt is currently being signaled on the bus.
@@ -5236,23 +5472,23 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
         }
         case 0x58: /* IN E,(C) */
             REG_WZ = REG_BC;
-            REG_E = m_busInterface.inPort(REG_WZ++);
-            sz5h3pnFlags = sz53pn_addTable[REG_E];
+            REG_E = m_busInterface->inPort(REG_WZ++);
+            sz5h3pnFlags = kFlagTables.sz53pn_add[REG_E];
             break;
 
         case 0x59: /* OUT (C),E */
             REG_WZ = REG_BC;
-            m_busInterface.outPort(REG_WZ++, REG_E);
+            m_busInterface->outPort(REG_WZ++, REG_E);
             break;
 
         case 0x5A: /* ADC HL,DE */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             adc16(REG_DE);
             break;
 
         case 0x5B: /* LD DE,(nn) */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            REG_DE = m_busInterface.peek16(REG_WZ++);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            REG_DE = m_busInterface->peek16(REG_WZ++);
             REG_PC = REG_PC + 2;
             break;
 
@@ -5262,9 +5498,9 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
             break;
 
         case 0x5F: { /* LD A,R */
-            m_busInterface.addressOnBus(getPairIR().word, 1);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 1);
             regA = getRegR();
-            sz5h3pnFlags = sz53n_addTable[regA];
+            sz5h3pnFlags = kFlagTables.sz53n_add[regA];
             /*
              * The P / V flag should reflect IFF2 state regardless of whether an
              * interrupt is currently being signaled on the bus.
@@ -5276,23 +5512,23 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
         }
         case 0x60: /* IN H,(C) */
             REG_WZ = REG_BC;
-            REG_H = m_busInterface.inPort(REG_WZ++);
-            sz5h3pnFlags = sz53pn_addTable[REG_H];
+            REG_H = m_busInterface->inPort(REG_WZ++);
+            sz5h3pnFlags = kFlagTables.sz53pn_add[REG_H];
             break;
 
         case 0x61: /* OUT (C),H */
             REG_WZ = REG_BC;
-            m_busInterface.outPort(REG_WZ++, REG_H);
+            m_busInterface->outPort(REG_WZ++, REG_H);
             break;
 
         case 0x62: /* SBC HL,HL */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             sbc16(REG_HL);
             break;
 
         case 0x63: /* LD (nn),HL */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            m_busInterface.poke16(REG_WZ++, regHL);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            m_busInterface->poke16(REG_WZ++, regHL);
             REG_PC = REG_PC + 2;
             break;
 
@@ -5305,33 +5541,33 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
             // Los 4 bits superiores de A no se tocan. ¡p'habernos matao!
             uint8_t aux = regA << 4;
             REG_WZ = REG_HL;
-            uint16_t memHL = m_busInterface.peek8(REG_WZ);
+            uint16_t memHL = m_busInterface->peek8(REG_WZ);
             regA = (regA & 0xf0) | (memHL & 0x0f);
-            m_busInterface.addressOnBus(REG_WZ, 4);
-            m_busInterface.poke8(REG_WZ++, (memHL >> 4) | aux);
-            sz5h3pnFlags = sz53pn_addTable[regA];
+            m_busInterface->addressOnBus(REG_WZ, 4);
+            m_busInterface->poke8(REG_WZ++, (memHL >> 4) | aux);
+            sz5h3pnFlags = kFlagTables.sz53pn_add[regA];
             break;
         }
 
         case 0x68: /* IN L,(C) */
             REG_WZ = REG_BC;
-            REG_L = m_busInterface.inPort(REG_WZ++);
-            sz5h3pnFlags = sz53pn_addTable[REG_L];
+            REG_L = m_busInterface->inPort(REG_WZ++);
+            sz5h3pnFlags = kFlagTables.sz53pn_add[REG_L];
             break;
 
         case 0x69: /* OUT (C),L */
             REG_WZ = REG_BC;
-            m_busInterface.outPort(REG_WZ++, REG_L);
+            m_busInterface->outPort(REG_WZ++, REG_L);
             break;
 
         case 0x6A: /* ADC HL,HL */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             adc16(REG_HL);
             break;
 
         case 0x6B: /* LD HL,(nn) */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            REG_HL = m_busInterface.peek16(REG_WZ++);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            REG_HL = m_busInterface->peek16(REG_WZ++);
             REG_PC = REG_PC + 2;
             break;
 
@@ -5344,56 +5580,56 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
             // Los 4 bits superiores de A no se tocan. ¡p'habernos matao!
             uint8_t aux = regA & 0x0f;
             REG_WZ = REG_HL;
-            uint16_t memHL = m_busInterface.peek8(REG_WZ);
+            uint16_t memHL = m_busInterface->peek8(REG_WZ);
             regA = (regA & 0xf0) | (memHL >> 4);
-            m_busInterface.addressOnBus(REG_WZ, 4);
-            m_busInterface.poke8(REG_WZ++, (memHL << 4) | aux);
-            sz5h3pnFlags = sz53pn_addTable[regA];
+            m_busInterface->addressOnBus(REG_WZ, 4);
+            m_busInterface->poke8(REG_WZ++, (memHL << 4) | aux);
+            sz5h3pnFlags = kFlagTables.sz53pn_add[regA];
             break;
         }
 
         case 0x70: /* IN (C) */ {
             REG_WZ = REG_BC;
-            uint8_t inPort = m_busInterface.inPort(REG_WZ++);
-            sz5h3pnFlags = sz53pn_addTable[inPort];
+            uint8_t inPort = m_busInterface->inPort(REG_WZ++);
+            sz5h3pnFlags = kFlagTables.sz53pn_add[inPort];
             break;
         }
 
         case 0x71: /* OUT (C),0 */
             REG_WZ = REG_BC;
-            m_busInterface.outPort(REG_WZ++, 0x00);
+            m_busInterface->outPort(REG_WZ++, 0x00);
             break;
 
         case 0x72: /* SBC HL,SP */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             sbc16(REG_SP);
             break;
 
         case 0x73: /* LD (nn),SP */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            m_busInterface.poke16(REG_WZ++, regSP);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            m_busInterface->poke16(REG_WZ++, regSP);
             REG_PC = REG_PC + 2;
             break;
 
         case 0x78: /* IN A,(C) */
             REG_WZ = REG_BC;
-            regA = m_busInterface.inPort(REG_WZ++);
-            sz5h3pnFlags = sz53pn_addTable[regA];
+            regA = m_busInterface->inPort(REG_WZ++);
+            sz5h3pnFlags = kFlagTables.sz53pn_add[regA];
             break;
 
         case 0x79: /* OUT (C),A */
             REG_WZ = REG_BC;
-            m_busInterface.outPort(REG_WZ++, regA);
+            m_busInterface->outPort(REG_WZ++, regA);
             break;
 
         case 0x7A: /* ADC HL,SP */
-            m_busInterface.addressOnBus(getPairIR().word, 7);
+            m_busInterface->addressOnBus(Z80_WORD(getPairIR()), 7);
             adc16(REG_SP);
             break;
 
         case 0x7B: /* LD SP,(nn) */
-            REG_WZ = m_busInterface.peek16(REG_PC);
-            REG_SP = m_busInterface.peek16(REG_WZ++);
+            REG_WZ = m_busInterface->peek16(REG_PC);
+            REG_SP = m_busInterface->peek16(REG_WZ++);
             REG_PC = REG_PC + 2;
             break;
 
@@ -5434,7 +5670,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
             if (REG_BC != 0) {
                 REG_PC = REG_PC - 2;
                 REG_WZ = REG_PC + 1;
-                m_busInterface.addressOnBus(REG_DE - 1, 5);
+                m_busInterface->addressOnBus(REG_DE - 1, 5);
                 sz5h3pnFlags &= ~FLAG_53_MASK;
                 sz5h3pnFlags |= (REG_PCh & FLAG_53_MASK);
             }
@@ -5445,7 +5681,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
             if ((sz5h3pnFlags & PARITY_MASK) == PARITY_MASK && (sz5h3pnFlags & ZERO_MASK) == 0) {
                 REG_PC = REG_PC - 2;
                 REG_WZ = REG_PC + 1;
-                m_busInterface.addressOnBus(REG_HL - 1, 5);
+                m_busInterface->addressOnBus(REG_HL - 1, 5);
                 sz5h3pnFlags &= ~FLAG_53_MASK;
                 sz5h3pnFlags |= (REG_PCh & FLAG_53_MASK);
             }
@@ -5456,7 +5692,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
             if (REG_B != 0) {
                 REG_PC = REG_PC - 2;
                 REG_WZ = REG_PC + 1;
-                m_busInterface.addressOnBus(REG_HL - 1, 5);
+                m_busInterface->addressOnBus(REG_HL - 1, 5);
                 adjustINxROUTxRFlags();
             }
             break;
@@ -5466,7 +5702,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
             if (REG_B != 0) {
                 REG_PC = REG_PC - 2;
                 REG_WZ = REG_PC + 1;
-                m_busInterface.addressOnBus(REG_BC, 5);
+                m_busInterface->addressOnBus(REG_BC, 5);
                 adjustINxROUTxRFlags();
             }
             break;
@@ -5476,7 +5712,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
             if (REG_BC != 0) {
                 REG_PC = REG_PC - 2;
                 REG_WZ = REG_PC + 1;
-                m_busInterface.addressOnBus(REG_DE + 1, 5);
+                m_busInterface->addressOnBus(REG_DE + 1, 5);
                 sz5h3pnFlags &= ~FLAG_53_MASK;
                 sz5h3pnFlags |= (REG_PCh & FLAG_53_MASK);
             }
@@ -5487,7 +5723,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
             if ((sz5h3pnFlags & PARITY_MASK) == PARITY_MASK && (sz5h3pnFlags & ZERO_MASK) == 0) {
                 REG_PC = REG_PC - 2;
                 REG_WZ = REG_PC + 1;
-                m_busInterface.addressOnBus(REG_HL + 1, 5);
+                m_busInterface->addressOnBus(REG_HL + 1, 5);
                 sz5h3pnFlags &= ~FLAG_53_MASK;
                 sz5h3pnFlags |= (REG_PCh & FLAG_53_MASK);
             }
@@ -5498,7 +5734,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
             if (REG_B != 0) {
                 REG_PC = REG_PC - 2;
                 REG_WZ = REG_PC + 1;
-                m_busInterface.addressOnBus(REG_HL + 1, 5);
+                m_busInterface->addressOnBus(REG_HL + 1, 5);
                 adjustINxROUTxRFlags();
             }
             break;
@@ -5508,7 +5744,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
             if (REG_B != 0) {
                 REG_PC = REG_PC - 2;
                 REG_WZ = REG_PC + 1;
-                m_busInterface.addressOnBus(REG_BC, 5);
+                m_busInterface->addressOnBus(REG_BC, 5);
                 adjustINxROUTxRFlags();
             }
             break;
@@ -5527,7 +5763,7 @@ template <typename TBusInterface> void Z80<TBusInterface>::decodeED(uint8_t opCo
     }
 }
 
-template <typename TBusInterface> void Z80<TBusInterface>::copyToRegister(uint8_t opCode, uint8_t value) {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::copyToRegister(uint8_t opCode, uint8_t value) {
     switch (opCode & 0x07) {
         case 0x00:
             REG_B = value;
@@ -5554,21 +5790,21 @@ template <typename TBusInterface> void Z80<TBusInterface>::copyToRegister(uint8_
     }
 }
 
-template <typename TBusInterface> void Z80<TBusInterface>::adjustINxROUTxRFlags() {
+template <typename TBusInterface> Z80_CONSTEXPR void Z80<TBusInterface>::adjustINxROUTxRFlags() {
     sz5h3pnFlags &= ~FLAG_53_MASK;
     sz5h3pnFlags |= (REG_PCh & FLAG_53_MASK);
 
     uint8_t pf = sz5h3pnFlags & PARITY_MASK;
     if (carryFlag) {
         int8_t addsub = 1 - (sz5h3pnFlags & ADDSUB_MASK);
-        pf ^= sz53pn_addTable[(REG_B + addsub) & 0x07] ^ PARITY_MASK;
+        pf ^= kFlagTables.sz53pn_add[(REG_B + addsub) & 0x07] ^ PARITY_MASK;
         if ((REG_B & 0x0F) == (addsub != 1 ? 0x00 : 0x0F)) {
             sz5h3pnFlags |= HALFCARRY_MASK;
         } else {
             sz5h3pnFlags &= ~HALFCARRY_MASK;
         }
     } else {
-        pf ^= sz53pn_addTable[REG_B & 0x07] ^ PARITY_MASK;
+        pf ^= kFlagTables.sz53pn_add[REG_B & 0x07] ^ PARITY_MASK;
         sz5h3pnFlags &= ~HALFCARRY_MASK;
     }
 
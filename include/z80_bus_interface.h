@@ -13,72 +13,81 @@ template <typename TBusInterface> class Z80BusInterface {
     Z80BusInterface& operator=(Z80BusInterface&&) = default;
 
     /* Read opcode from RAM */
-    Z80_FORCE_INLINE uint8_t fetchOpcode(uint16_t address) {
+    Z80_FORCE_INLINE Z80_CONSTEXPR uint8_t fetchOpcode(uint16_t address) {
         return derived().fetchOpcodeImpl(address);
     }
 
     /* Read/Write byte from/to RAM */
-    Z80_FORCE_INLINE uint8_t peek8(uint16_t address) {
+    Z80_FORCE_INLINE Z80_CONSTEXPR uint8_t peek8(uint16_t address) {
         return derived().peek8Impl(address);
     }
 
-    Z80_FORCE_INLINE void poke8(uint16_t address, uint8_t value) {
+    Z80_FORCE_INLINE Z80_CONSTEXPR void poke8(uint16_t address, uint8_t value) {
         derived().poke8Impl(address, value);
     }
 
     /* Read/Write word from/to RAM */
-    Z80_FORCE_INLINE uint16_t peek16(uint16_t address) {
+    Z80_FORCE_INLINE Z80_CONSTEXPR uint16_t peek16(uint16_t address) {
         return derived().peek16Impl(address);
     }
 
-    Z80_FORCE_INLINE void poke16(uint16_t address, RegisterPair word) {
+    Z80_FORCE_INLINE Z80_CONSTEXPR void poke16(uint16_t address, RegisterPair word) {
         derived().poke16Impl(address, word);
     }
 
     /* In/Out byte from/to IO Bus */
-    Z80_FORCE_INLINE uint8_t inPort(uint16_t port) {
+    Z80_FORCE_INLINE Z80_CONSTEXPR uint8_t inPort(uint16_t port) {
         return derived().inPortImpl(port);
     }
 
-    Z80_FORCE_INLINE void outPort(uint16_t port, uint8_t value) {
+    Z80_FORCE_INLINE Z80_CONSTEXPR void outPort(uint16_t port, uint8_t value) {
         derived().outPortImpl(port, value);
     }
 
     /* Put an address on bus lasting 'tstates' cycles */
-    Z80_FORCE_INLINE void addressOnBus(uint16_t address, int32_t wstates) {
+    Z80_FORCE_INLINE Z80_CONSTEXPR void addressOnBus(uint16_t address, int32_t wstates) {
         derived().addressOnBusImpl(address, wstates);
     }
 
     /* Clocks needed for processing INT and NMI */
-    Z80_FORCE_INLINE void interruptHandlingTime(int32_t wstates) {
+    Z80_FORCE_INLINE Z80_CONSTEXPR void interruptHandlingTime(int32_t wstates) {
         derived().interruptHandlingTimeImpl(wstates);
     }
 
     /* Callback to know when the INT signal is active */
-    Z80_FORCE_INLINE bool isActiveINT() {
+    Z80_FORCE_INLINE Z80_CONSTEXPR bool isActiveINT() {
         return derived().isActiveINTImpl();
     }
 
 #ifdef WITH_BREAKPOINT_SUPPORT
     /* Callback for notify at PC address */
-    uint8_t breakpoint(uint16_t address, uint8_t opcode) {
+    Z80_CONSTEXPR uint8_t breakpoint(uint16_t address, uint8_t opcode) {
         return derived().breakpointImpl(address, opcode);
     }
 #endif
 
 #ifdef WITH_EXEC_DONE
     /* Callback to notify that one instruction has ended */
-    void execDone(void) {
+    Z80_CONSTEXPR void execDone(void) {
         derived().execDoneImpl();
     }
 #endif
 
+#ifdef WITH_FLOW_EVENTS
+    /* Callback for every control transfer: 'from' is the address of the
+     * instruction (the interrupted PC for Interrupt/Nmi), 'to' the new PC
+     * and 'sp' the stack pointer once the return address is pushed/popped */
+    Z80_CONSTEXPR void flowEvent(Z80FlowKind kind, uint16_t from, uint16_t to, uint16_t sp) {
+        derived().flowEventImpl(kind, from, to, sp);
+    }
+#endif
+
   private:
     Z80BusInterface() = default;
     Z80BusInterface(const Z80BusInterface&) = default;
     Z80BusInterface(Z80BusInterface&&) = default;
 
-    TBusInterface& derived() {
+    Z80_CONSTEXPR TBusInterface& derived() {
         return static_cast<TBusInterface&>(*this);
     }
 
@@ -0,0 +1,368 @@
+#ifndef Z80_CHECKPOINT_H
+#define Z80_CHECKPOINT_H
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "z80.h"
+#include "z80_encoding.h"
+#include "z80_hash.h"
+#include "z80_memory.h"
+
+/* Versioned, endian-stable machine checkpoints.
+ *
+ * File layout, every integer little-endian:
+ *
+ *   magic       8 bytes  "Z80CKPT\0"
+ *   version     u16      kVersion
+ *   reserved    u16      0
+ *   tstates     u64      bus T-state counter
+ *   cpu         u16 x13  AF BC DE HL AF' BC' DE' HL' IX IY SP PC MEMPTR
+ *               u8 x3    I R IM
+ *               u8       IFF1 | IFF2 << 1 | pendingEI << 2 | activeNMI << 3 |
+ *                        halted << 4 | pinReset << 5 | flagQ << 6 | lastFlagQ << 7
+ *   memory      32 bytes bitmap of the non-zero 256-byte pages
+ *               n * 256  contents of those pages, in address order
+ *   devices     u32      length, followed by the opaque bus device state
+ *   checksum    u64      z80HashBytes() of everything above
+ *
+ * Readers accept any version up to kVersion; a later version adds fields
+ * at the end of a section and bumps kVersion.
+ */
+struct Z80Checkpoint {
+    static constexpr uint16_t kVersion = 1;
+    static constexpr std::array<char, 8> kMagic = {'Z', '8', '0', 'C', 'K', 'P', 'T', '\0'};
+
+    Z80State cpu;
+    uint64_t tstates{0};
+    std::vector<uint8_t> memory;  // 64K, as seen by the CPU
+    std::vector<uint8_t> devices; // Opaque bus device state
+
+    // Copy the machine state. This is the only part that runs on the emulation thread.
+    template <typename TBusInterface>
+    void capture(const Z80<TBusInterface>& cpuRef, const Z80Memory& memoryRef, uint64_t tstatesNow) {
+        cpu = cpuRef.getState();
+        tstates = tstatesNow;
+        memory.resize(0x10000);
+        memoryRef.copyTo(0, memory.data(), memory.size());
+    }
+
+    // Restore CPU and memory. Writes to read-only pages are discarded, so ROMs must be mapped beforehand.
+    template <typename TBusInterface> void restore(Z80<TBusInterface>& cpuRef, Z80Memory& memoryRef) const {
+        cpuRef.setState(cpu);
+        memoryRef.load(0, memory.data(), memory.size());
+    }
+
+    [[nodiscard]] std::vector<uint8_t> serialize() const {
+        std::vector<uint8_t> out(kMagic.begin(), kMagic.end());
+        out.reserve(0x10000 + devices.size() + 128);
+
+        z80PutLE(out, kVersion, 2);
+        z80PutLE(out, 0, 2);
+        z80PutLE(out, tstates, 8);
+
+        for (uint16_t word : {cpu.af, cpu.bc, cpu.de, cpu.hl, cpu.afx, cpu.bcx, cpu.dex, cpu.hlx, cpu.ix, cpu.iy,
+                              cpu.sp, cpu.pc, cpu.memptr}) {
+            z80PutLE(out, word, 2);
+        }
+        out.push_back(cpu.i);
+        out.push_back(cpu.r);
+        out.push_back(cpu.im);
+        out.push_back(packFlags(cpu));
+
+        std::array<uint8_t, Z80Memory::kPageCount / 8> bitmap{};
+        for (uint32_t page = 0; page < Z80Memory::kPageCount && memory.size() == 0x10000; page++) {
+            const uint8_t* data = &memory[page << Z80Memory::kPageShift];
+            for (uint32_t idx = 0; idx < Z80Memory::kPageSize; idx++) {
+                if (data[idx] != 0) {
+                    bitmap[page >> 3] |= static_cast<uint8_t>(1U << (page & 7));
+                    break;
+                }
+            }
+        }
+        out.insert(out.end(), bitmap.begin(), bitmap.end());
+        for (uint32_t page = 0; page < Z80Memory::kPageCount; page++) {
+            if ((bitmap[page >> 3] & (1U << (page & 7))) != 0) {
+                auto first = memory.begin() + (page << Z80Memory::kPageShift);
+                out.insert(out.end(), first, first + Z80Memory::kPageSize);
+            }
+        }
+
+        z80PutLE(out, devices.size(), 4);
+        out.insert(out.end(), devices.begin(), devices.end());
+
+        z80PutLE(out, z80HashBytes(out.data(), out.size()), 8);
+        return out;
+    }
+
+    // Returns false on a truncated, corrupt or newer-version image
+    static bool deserialize(const uint8_t* data, size_t size, Z80Checkpoint& out) {
+        if (size < kMagic.size() + 8 || std::memcmp(data, kMagic.data(), kMagic.size()) != 0) {
+            return false;
+        }
+        if (z80GetLE(data + size - 8, 8) != z80HashBytes(data, size - 8)) {
+            return false;
+        }
+
+        Reader reader{data + kMagic.size(), data + size - 8};
+        uint16_t version = reader.u16();
+        reader.u16(); // reserved
+        if (version == 0 || version > kVersion) {
+            return false;
+        }
+
+        out.tstates = reader.u64();
+        for (uint16_t* word : {&out.cpu.af, &out.cpu.bc, &out.cpu.de, &out.cpu.hl, &out.cpu.afx, &out.cpu.bcx,
+                               &out.cpu.dex, &out.cpu.hlx, &out.cpu.ix, &out.cpu.iy, &out.cpu.sp, &out.cpu.pc,
+                               &out.cpu.memptr}) {
+            *word = reader.u16();
+        }
+        out.cpu.i = reader.u8();
+        out.cpu.r = reader.u8();
+        out.cpu.im = reader.u8();
+        unpackFlags(reader.u8(), out.cpu);
+
+        std::array<uint8_t, Z80Memory::kPageCount / 8> bitmap{};
+        reader.bytes(bitmap.data(), bitmap.size());
+        out.memory.assign(0x10000, 0);
+        for (uint32_t page = 0; page < Z80Memory::kPageCount; page++) {
+            if ((bitmap[page >> 3] & (1U << (page & 7))) != 0) {
+                reader.bytes(&out.memory[page << Z80Memory::kPageShift], Z80Memory::kPageSize);
+            }
+        }
+
+        // Checked before resizing: a forged length must not allocate up to 4G
+        uint32_t deviceSize = reader.u32();
+        if (!reader.ok || deviceSize > static_cast<size_t>(reader.end - reader.pos)) {
+            return false;
+        }
+        out.devices.resize(deviceSize);
+        reader.bytes(out.devices.data(), out.devices.size());
+
+        return reader.ok && out.cpu.im <= 2;
+    }
+
+    // Write atomically: a preempted save never leaves a half written checkpoint behind
+    [[nodiscard]] bool save(const std::string& path) const {
+        std::vector<uint8_t> bytes = serialize();
+        std::string tmpPath = path + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                return false;
+            }
+            file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            if (!file.good()) {
+                return false;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(tmpPath, path, error);
+        return !error;
+    }
+
+    static bool load(const std::string& path, Z80Checkpoint& out) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return deserialize(bytes.data(), bytes.size(), out);
+    }
+
+  private:
+    struct Reader {
+        const uint8_t* pos;
+        const uint8_t* end;
+        bool ok{true};
+
+        void bytes(uint8_t* dest, size_t count) {
+            if (static_cast<size_t>(end - pos) < count) {
+                ok = false;
+                pos = end;
+                return;
+            }
+            std::memcpy(dest, pos, count);
+            pos += count;
+        }
+
+        uint8_t u8() {
+            uint8_t value = 0;
+            bytes(&value, 1);
+            return value;
+        }
+
+        uint16_t u16() {
+            return static_cast<uint16_t>(le(2));
+        }
+
+        uint32_t u32() {
+            return static_cast<uint32_t>(le(4));
+        }
+
+        uint64_t u64() {
+            return le(8);
+        }
+
+        uint64_t le(int size) {
+            std::array<uint8_t, 8> raw{};
+            bytes(raw.data(), size);
+            return z80GetLE(raw.data(), size);
+        }
+    };
+
+    static uint8_t packFlags(const Z80State& state) {
+        return (state.iff1 ? 0x01 : 0) | (state.iff2 ? 0x02 : 0) | (state.pendingEI ? 0x04 : 0)
+               | (state.activeNMI ? 0x08 : 0) | (state.halted ? 0x10 : 0) | (state.pinReset ? 0x20 : 0)
+               | (state.flagQ ? 0x40 : 0) | (state.lastFlagQ ? 0x80 : 0);
+    }
+
+    static void unpackFlags(uint8_t bits, Z80State& state) {
+        state.iff1 = (bits & 0x01) != 0;
+        state.iff2 = (bits & 0x02) != 0;
+        state.pendingEI = (bits & 0x04) != 0;
+        state.activeNMI = (bits & 0x08) != 0;
+        state.halted = (bits & 0x10) != 0;
+        state.pinReset = (bits & 0x20) != 0;
+        state.flagQ = (bits & 0x40) != 0;
+        state.lastFlagQ = (bits & 0x80) != 0;
+    }
+};
+
+/* Writes checkpoints from a background thread.
+ *
+ * checkpoint() only copies the machine state (one 64K memcpy) into a
+ * recycled buffer and queues it; serialization and disk I/O happen on the
+ * writer thread. When maxPending checkpoints are already queued the new one
+ * is dropped instead of stalling the emulation thread.
+ */
+class Z80CheckpointWriter {
+  public:
+    explicit Z80CheckpointWriter(size_t maxPending = 2) : m_maxPending(maxPending) {
+        m_thread = std::thread([this] { writerLoop(); });
+    }
+
+    Z80CheckpointWriter(const Z80CheckpointWriter&) = delete;
+    Z80CheckpointWriter& operator=(const Z80CheckpointWriter&) = delete;
+    Z80CheckpointWriter(Z80CheckpointWriter&&) = delete;
+    Z80CheckpointWriter& operator=(Z80CheckpointWriter&&) = delete;
+
+    // Writes every queued checkpoint before returning
+    ~Z80CheckpointWriter() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wakeWriter.notify_one();
+        m_thread.join();
+    }
+
+    // Returns false if the checkpoint was dropped because the writer is behind
+    template <typename TBusInterface>
+    bool checkpoint(const Z80<TBusInterface>& cpu, const Z80Memory& memory, uint64_t tstates, std::string path,
+                    const std::vector<uint8_t>& devices = {}) {
+        Pending pending;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_queue.size() >= m_maxPending) {
+                m_dropped++;
+                return false;
+            }
+            if (!m_free.empty()) {
+                pending.checkpoint = std::move(m_free.back());
+                m_free.pop_back();
+            }
+        }
+
+        pending.checkpoint.capture(cpu, memory, tstates);
+        pending.checkpoint.devices.assign(devices.begin(), devices.end());
+        pending.path = std::move(path);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(pending));
+        }
+        m_wakeWriter.notify_one();
+        return true;
+    }
+
+    // Block until every queued checkpoint is on disk
+    void flush() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+    }
+
+    [[nodiscard]] uint64_t getWritten() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_written;
+    }
+
+    [[nodiscard]] uint64_t getFailed() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_failed;
+    }
+
+    [[nodiscard]] uint64_t getDropped() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_dropped;
+    }
+
+  private:
+    struct Pending {
+        Z80Checkpoint checkpoint;
+        std::string path;
+    };
+
+    size_t m_maxPending;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeWriter;
+    std::condition_variable m_idle;
+    std::deque<Pending> m_queue;
+    std::vector<Z80Checkpoint> m_free;
+    uint64_t m_written{0};
+    uint64_t m_failed{0};
+    uint64_t m_dropped{0};
+    bool m_busy{false};
+    bool m_stop{false};
+    std::thread m_thread;
+
+    void writerLoop() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_wakeWriter.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return; // m_stop and nothing left to write
+            }
+
+            Pending pending = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_busy = true;
+            lock.unlock();
+
+            bool saved = pending.checkpoint.save(pending.path);
+
+            lock.lock();
+            m_busy = false;
+            saved ? m_written++ : m_failed++;
+            m_free.push_back(std::move(pending.checkpoint));
+            if (m_queue.empty()) {
+                m_idle.notify_all();
+            }
+        }
+    }
+};
+
+#endif // Z80_CHECKPOINT_H
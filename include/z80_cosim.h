@@ -0,0 +1,125 @@
+#ifndef Z80_COSIM_H
+#define Z80_COSIM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "z80.h"
+
+/* Runs several Z80s, each on its own bus, on one host thread.
+ *
+ * Time is counted in ticks of a common clock; each CPU converts its own
+ * T-states with an integer ticksPerTState, so a 3.5 MHz main CPU and a
+ * 1.75 MHz sound CPU use 1 and 2. The scheduler cuts time into slices and
+ * runs every CPU up to the end of the slice before moving on; switching
+ * CPUs is an indirect call, there is no thread or stack switch.
+ *
+ * Slices can be long because CPUs resynchronize on demand: before touching
+ * shared state (a latch, shared RAM) a bus calls syncFrom(core), which
+ * first runs every other CPU up to the caller's current time. Tight
+ * interleaving is then only paid for when the CPUs actually talk.
+ *
+ * Every bus must provide 'uint64_t getTstates() const'.
+ */
+class Z80CoSim {
+  public:
+    explicit Z80CoSim(uint64_t sliceTicks = 10000) : m_sliceTicks(sliceTicks) {
+    }
+
+    Z80CoSim(const Z80CoSim&) = delete;
+    Z80CoSim& operator=(const Z80CoSim&) = delete;
+
+    // Returns the core index used by syncFrom() and getTicks()
+    template <typename TBusInterface> size_t addCpu(Z80<TBusInterface>& cpu, uint32_t ticksPerTState = 1) {
+        Core core;
+        core.cpu = &cpu;
+        core.execute = [](void* cpuPtr) { static_cast<Z80<TBusInterface>*>(cpuPtr)->execute(); };
+        core.tstates = [](const void* cpuPtr) {
+            return static_cast<const Z80<TBusInterface>*>(cpuPtr)->getBus()->getTstates();
+        };
+        core.ticksPerTState = ticksPerTState;
+        m_cores.push_back(core);
+        return m_cores.size() - 1;
+    }
+
+    [[nodiscard]] uint64_t getTicks(size_t core) const {
+        return m_cores[core].tstates(m_cores[core].cpu) * m_cores[core].ticksPerTState;
+    }
+
+    void setSliceTicks(uint64_t sliceTicks) {
+        m_sliceTicks = sliceTicks;
+    }
+
+    // Run every CPU that is not on the call stack up to 'ticks'
+    void syncTo(uint64_t ticks) {
+        m_syncs++;
+        for (auto& core : m_cores) {
+            if (!core.running) {
+                m_catchUpInstructions += runCore(core, ticks);
+            }
+        }
+    }
+
+    // Called by a bus before a shared access: bring the other CPUs up to this CPU's time
+    void syncFrom(size_t core) {
+        syncTo(getTicks(core));
+    }
+
+    // Run every CPU up to 'untilTicks', one slice at a time
+    void run(uint64_t untilTicks) {
+        while (m_now < untilTicks) {
+            m_now = (untilTicks - m_now > m_sliceTicks) ? m_now + m_sliceTicks : untilTicks;
+            for (auto& core : m_cores) {
+                runCore(core, m_now);
+            }
+            m_slices++;
+        }
+    }
+
+    [[nodiscard]] uint64_t getNow() const {
+        return m_now;
+    }
+
+    [[nodiscard]] uint64_t getSlices() const {
+        return m_slices;
+    }
+
+    [[nodiscard]] uint64_t getSyncs() const {
+        return m_syncs;
+    }
+
+    [[nodiscard]] uint64_t getCatchUpInstructions() const {
+        return m_catchUpInstructions;
+    }
+
+  private:
+    struct Core {
+        void* cpu{nullptr};
+        void (*execute)(void*){nullptr};
+        uint64_t (*tstates)(const void*){nullptr};
+        uint64_t ticksPerTState{1};
+        bool running{false};
+    };
+
+    std::vector<Core> m_cores;
+    uint64_t m_sliceTicks;
+    uint64_t m_now{0};
+    uint64_t m_slices{0};
+    uint64_t m_syncs{0};
+    uint64_t m_catchUpInstructions{0};
+
+    // A CPU on the call stack is ahead of whoever it is catching up, so it is never re-entered
+    uint64_t runCore(Core& core, uint64_t ticks) {
+        uint64_t instructions = 0;
+        core.running = true;
+        while (core.tstates(core.cpu) * core.ticksPerTState < ticks) {
+            core.execute(core.cpu);
+            instructions++;
+        }
+        core.running = false;
+        return instructions;
+    }
+};
+
+#endif // Z80_COSIM_H
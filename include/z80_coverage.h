@@ -0,0 +1,256 @@
+#ifndef Z80_COVERAGE_H
+#define Z80_COVERAGE_H
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "z80_symbols.h"
+#include "z80_types.h"
+
+/* Length in bytes of the instruction at 'address', its bytes read through
+ * 'read(uint16_t)'. A chain of prefixes belongs to the instruction that
+ * follows it, the way the core executes it in a single execute(): DD and
+ * FD, and an ED followed by another DD, ED or FD. */
+template <typename TRead> uint32_t z80InstructionLength(uint16_t address, TRead&& read) {
+    uint32_t prefixes = 0;
+    uint8_t opcode = read(address);
+    while (prefixes < 0xFFFF) {
+        if (opcode == 0xED) {
+            uint8_t next = read(static_cast<uint16_t>(address + prefixes + 1));
+            if (next != 0xDD && next != 0xED && next != 0xFD) {
+                // LD (nn),rr and LD rr,(nn)
+                return prefixes + ((next & 0xC7) == 0x43 ? 4 : 2);
+            }
+        } else if (opcode != 0xDD && opcode != 0xFD) {
+            break;
+        }
+        opcode = read(static_cast<uint16_t>(address + ++prefixes));
+    }
+    if (opcode == 0xCB) {
+        return prefixes + (prefixes > 0 ? 3 : 2);
+    }
+
+    uint32_t length = 1;
+    if ((opcode & 0xCF) == 0x01 || (opcode & 0xE7) == 0x22 || (opcode & 0xC7) == 0xC2 || (opcode & 0xC7) == 0xC4
+        || opcode == 0xC3 || opcode == 0xCD) {
+        length = 3;
+    } else if ((opcode & 0xC7) == 0x06 || (opcode & 0xC7) == 0xC6 || ((opcode & 0xC7) == 0x00 && opcode >= 0x10)
+               || opcode == 0xD3 || opcode == 0xDB) {
+        length = 2;
+    }
+    // (HL) becomes (IX+d) and takes a displacement byte
+    bool memory = opcode == 0x34 || opcode == 0x35 || opcode == 0x36 || (opcode & 0xC7) == 0x86
+                  || (((opcode & 0xC7) == 0x46 || (opcode & 0xF8) == 0x70) && opcode != 0x76);
+    return prefixes + length + (prefixes > 0 && memory ? 1 : 0);
+}
+
+/* Guest code coverage: one bit per address where an instruction started.
+ *
+ * The run loop calls mark() with the PC of every instruction before
+ * executing it, which is a single OR into the bitmap; Z80Machine::
+ * runCovered() does. The PC of a halted CPU is not an instruction start
+ * and must not be marked.
+ *
+ * Paged machines keep one bitmap per bank. The address space is cut into
+ * slots of 'bankSize' bytes, slot N showing bank N % banks at first, and
+ * the bus calls mapBank() whenever it switches the bank of a slot.
+ *
+ * Reports need the bytes of the instructions, not only where they start:
+ * executedBytes() extends every start to the length of its instruction,
+ * read from the memory the bank is seen through. writeLcov() and
+ * writeJson() report the executed bytes of one bank by address, and by
+ * symbol when given a Z80SymbolMap; a symbol runs up to the next one.
+ */
+class Z80Coverage {
+  public:
+    using Reader = std::function<uint8_t(uint16_t)>;
+
+    explicit Z80Coverage(uint32_t banks = 1, uint32_t bankSize = 0x10000)
+        : m_banks(std::max<uint32_t>(banks, 1)), m_bankSize(validBankSize(bankSize)),
+          m_slotShift(shiftOf(m_bankSize)), m_slotOffset(0x10000 / m_bankSize),
+          m_bits((static_cast<size_t>(m_banks) * m_bankSize + 63) / 64) {
+        for (uint32_t slot = 0; slot < m_slotOffset.size(); slot++) {
+            mapBank(static_cast<uint16_t>(slot * m_bankSize), slot % m_banks);
+        }
+    }
+
+    Z80_FORCE_INLINE void mark(uint16_t pc) {
+        uint32_t bit = m_slotOffset[pc >> m_slotShift] + pc;
+        m_bits[bit >> 6] |= uint64_t{1} << (bit & 63);
+    }
+
+    // The slot holding 'address' now shows 'bank'
+    void mapBank(uint16_t address, uint32_t bank) {
+        uint32_t slot = address >> m_slotShift;
+        m_slotOffset[slot] = (bank % m_banks) * m_bankSize - (slot << m_slotShift);
+    }
+
+    [[nodiscard]] bool isExecuted(uint32_t bank, uint32_t offset) const {
+        size_t bit = static_cast<size_t>(bank) * m_bankSize + offset;
+        return (m_bits[bit >> 6] >> (bit & 63) & 1) != 0;
+    }
+
+    // Addresses where an instruction started, in every bank
+    [[nodiscard]] uint64_t getExecuted() const {
+        uint64_t executed = 0;
+        for (uint64_t word : m_bits) {
+            executed += std::bitset<64>(word).count();
+        }
+        return executed;
+    }
+
+    /* Adds the coverage of another run with the same banks and returns the
+     * number of instruction starts it covered that this one did not: the
+     * "new coverage" signal of a coverage-guided fuzzer. */
+    uint64_t merge(const Z80Coverage& other) {
+        uint64_t added = 0;
+        for (size_t idx = 0; idx < m_bits.size() && idx < other.m_bits.size(); idx++) {
+            added += std::bitset<64>(other.m_bits[idx] & ~m_bits[idx]).count();
+            m_bits[idx] |= other.m_bits[idx];
+        }
+        return added;
+    }
+
+    void clear() {
+        std::fill(m_bits.begin(), m_bits.end(), 0);
+    }
+
+    [[nodiscard]] uint32_t getBanks() const {
+        return m_banks;
+    }
+
+    [[nodiscard]] uint32_t getBankSize() const {
+        return m_bankSize;
+    }
+
+    /* One flag per byte of 'bank', set where an executed instruction lies.
+     * 'read' returns the byte at a CPU address with the bank mapped at
+     * 'base'; instructions are cut at the end of the bank. */
+    [[nodiscard]] std::vector<uint8_t> executedBytes(uint32_t bank, uint16_t base, const Reader& read) const {
+        std::vector<uint8_t> bytes(m_bankSize);
+        for (uint32_t offset = 0; offset < m_bankSize; offset++) {
+            if (isExecuted(bank, offset)) {
+                uint32_t length = z80InstructionLength(static_cast<uint16_t>(base + offset), read);
+                std::fill_n(bytes.begin() + offset, std::min(length, m_bankSize - offset), 1);
+            }
+        }
+        return bytes;
+    }
+
+    /* An lcov tracefile record for 'bank', named 'source' ("bank<N>" when
+     * empty). Line N is CPU address N - 1, since lcov counts lines from 1;
+     * symbols are reported as functions, hit if any of their bytes ran. */
+    void writeLcov(std::ostream& out, uint32_t bank, uint16_t base, const Reader& read,
+                   const Z80SymbolMap* symbols = nullptr, const std::string& source = "") const {
+        std::vector<uint8_t> bytes = executedBytes(bank, base, read);
+        out << "TN:\nSF:" << (source.empty() ? "bank" + std::to_string(bank) : source) << '\n';
+        std::vector<SymbolCoverage> functions = symbolCoverage(bytes, base, symbols);
+        size_t hitFunctions = 0;
+        for (const SymbolCoverage& function : functions) {
+            out << "FN:" << function.address + 1 << ',' << function.name << '\n';
+        }
+        for (const SymbolCoverage& function : functions) {
+            out << "FNDA:" << (function.executed > 0 ? 1 : 0) << ',' << function.name << '\n';
+            hitFunctions += function.executed > 0 ? 1 : 0;
+        }
+        out << "FNF:" << functions.size() << "\nFNH:" << hitFunctions << '\n';
+        size_t hitLines = 0;
+        for (uint32_t offset = 0; offset < m_bankSize; offset++) {
+            out << "DA:" << base + offset + 1 << ',' << static_cast<int>(bytes[offset]) << '\n';
+            hitLines += bytes[offset];
+        }
+        out << "LF:" << m_bankSize << "\nLH:" << hitLines << "\nend_of_record\n";
+    }
+
+    /* Executed bytes of 'bank' as a JSON object: address ranges
+     * [start, end) and, with symbols, the executed bytes of each symbol. */
+    void writeJson(std::ostream& out, uint32_t bank, uint16_t base, const Reader& read,
+                   const Z80SymbolMap* symbols = nullptr) const {
+        std::vector<uint8_t> bytes = executedBytes(bank, base, read);
+        size_t executed = std::count(bytes.begin(), bytes.end(), 1);
+        out << "{\"bank\":" << bank << ",\"base\":" << base << ",\"size\":" << m_bankSize
+            << ",\"executed\":" << executed << ",\"ranges\":[";
+        const char* separator = "";
+        for (uint32_t offset = 0; offset < m_bankSize;) {
+            if (bytes[offset] == 0) {
+                offset++;
+                continue;
+            }
+            uint32_t end = offset;
+            while (end < m_bankSize && bytes[end] != 0) {
+                end++;
+            }
+            out << separator << '[' << base + offset << ',' << base + end << ']';
+            separator = ",";
+            offset = end;
+        }
+        out << "],\"symbols\":[";
+        separator = "";
+        for (const SymbolCoverage& symbol : symbolCoverage(bytes, base, symbols)) {
+            out << separator << "{\"name\":\"" << symbol.name << "\",\"address\":" << symbol.address
+                << ",\"size\":" << symbol.size << ",\"executed\":" << symbol.executed << '}';
+            separator = ",";
+        }
+        out << "]}\n";
+    }
+
+  private:
+    struct SymbolCoverage {
+        std::string name;
+        uint32_t address;
+        uint32_t size;
+        uint32_t executed;
+    };
+
+    uint32_t m_banks;
+    uint32_t m_bankSize;
+    uint32_t m_slotShift;
+    // Bit index of a PC in a slot minus the PC
+    std::vector<uint32_t> m_slotOffset;
+    std::vector<uint64_t> m_bits;
+
+    // Symbols inside [base, base + bank size), each up to the next one or the end of the bank
+    [[nodiscard]] std::vector<SymbolCoverage> symbolCoverage(const std::vector<uint8_t>& bytes, uint16_t base,
+                                                             const Z80SymbolMap* symbols) const {
+        std::vector<SymbolCoverage> result;
+        if (symbols == nullptr) {
+            return result;
+        }
+        uint32_t end = base + m_bankSize;
+        const auto& labels = symbols->getLabels();
+        for (auto label = labels.lower_bound(base); label != labels.end() && label->first < end; ++label) {
+            auto next = std::next(label);
+            uint32_t stop = next != labels.end() ? std::min<uint32_t>(next->first, end) : end;
+            auto executed = static_cast<uint32_t>(
+                std::count(bytes.begin() + (label->first - base), bytes.begin() + (stop - base), 1));
+            result.push_back({label->second, label->first, stop - label->first, executed});
+        }
+        return result;
+    }
+
+    static uint32_t validBankSize(uint32_t bankSize) {
+        uint32_t size = 256;
+        while (size < bankSize && size < 0x10000) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    static uint32_t shiftOf(uint32_t size) {
+        uint32_t shift = 0;
+        while ((1U << shift) < size) {
+            shift++;
+        }
+        return shift;
+    }
+};
+
+#endif // Z80_COVERAGE_H
@@ -0,0 +1,65 @@
+#ifndef Z80_ENCODING_H
+#define Z80_ENCODING_H
+
+#include <cstdint>
+#include <vector>
+
+/* Byte encodings shared by the binary file formats: traces, columnar
+ * traces, checkpoints and heatmaps. */
+
+// Append the low 'size' bytes of 'value', least significant first
+inline void z80PutLE(std::vector<uint8_t>& out, uint64_t value, int size) {
+    for (int idx = 0; idx < size; idx++) {
+        out.push_back(static_cast<uint8_t>(value >> (idx * 8)));
+    }
+}
+
+// Store the low 'size' bytes of 'value' at 'out', least significant first
+inline void z80StoreLE(uint8_t* out, uint64_t value, int size) {
+    for (int idx = 0; idx < size; idx++) {
+        out[idx] = static_cast<uint8_t>(value >> (idx * 8));
+    }
+}
+
+inline uint64_t z80GetLE(const uint8_t* data, int size) {
+    uint64_t value = 0;
+    for (int idx = size - 1; idx >= 0; idx--) {
+        value = (value << 8) | data[idx];
+    }
+    return value;
+}
+
+// LEB128: 7 bits per byte, low bits first, high bit set on every byte but the last
+inline void z80PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// false if the input ends inside the varint or it is longer than 64 bits
+inline bool z80GetVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; pos < end && shift < 64; shift += 7) {
+        uint8_t byte = *pos++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Zigzag encoding of an unsigned two's complement delta: 0, -1, 1, -2 ... as 0, 1, 2, 3 ...
+template <typename U> constexpr U z80ZigzagEncode(U delta) {
+    U sign = (delta >> (sizeof(U) * 8 - 1)) != 0 ? static_cast<U>(~U{0}) : U{0};
+    return static_cast<U>(static_cast<U>(delta << 1) ^ sign);
+}
+
+// Inverse of z80ZigzagEncode, as a two's complement bit pattern
+constexpr uint64_t z80ZigzagDecode(uint64_t zigzag) {
+    return (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+}
+
+#endif // Z80_ENCODING_H
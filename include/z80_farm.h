@@ -0,0 +1,178 @@
+#ifndef Z80_FARM_H
+#define Z80_FARM_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/* Result of one machine of a Z80Farm run.
+ *
+ * Each slot is written only by the worker that currently owns the machine,
+ * and slots are cache-line aligned, so workers never share a line.
+ */
+struct alignas(64) Z80FarmResult {
+    uint64_t instructions{0};
+    uint64_t slices{0};
+    uint64_t finishNanos{0}; // Since the start of run()
+    uint32_t worker{0};      // Worker that ran the last slice
+};
+
+/* Runs many independent machines on a work-stealing thread pool.
+ *
+ * Execution is cut into slices of 'quantum' T-states. A machine waits in
+ * the local queue of one worker; the worker runs a slice and puts it back
+ * at the end of its queue unless it has finished. An idle worker steals
+ * from the other end of another worker's queue, so machines spread over
+ * the workers and a long job does not keep a core to itself.
+ *
+ * TMachine must provide:
+ *   uint64_t runSlice(uint64_t quantum)  // Instructions executed
+ *   bool isFinished() const
+ * Z80Machine does.
+ */
+template <typename TMachine> class Z80Farm {
+  public:
+    explicit Z80Farm(uint64_t quantum = 10000) : m_quantum(quantum) {
+    }
+
+    Z80Farm(const Z80Farm&) = delete;
+    Z80Farm& operator=(const Z80Farm&) = delete;
+
+    // Machines live in a deque, so references stay valid and TMachine need not be movable
+    template <typename... Args> TMachine& add(Args&&... args) {
+        return m_machines.emplace_back(std::forward<Args>(args)...);
+    }
+
+    [[nodiscard]] size_t size() const {
+        return m_machines.size();
+    }
+
+    TMachine& machine(size_t idx) {
+        return m_machines[idx];
+    }
+
+    [[nodiscard]] const std::vector<Z80FarmResult>& getResults() const {
+        return m_results;
+    }
+
+    [[nodiscard]] uint64_t getSteals() const {
+        return m_steals;
+    }
+
+    [[nodiscard]] uint64_t getElapsedNanos() const {
+        return m_elapsedNanos;
+    }
+
+    // Run every machine to completion on 'threads' workers. Blocks until done.
+    void run(size_t threads) {
+        threads = std::max<size_t>(threads, 1);
+        m_results.assign(m_machines.size(), Z80FarmResult{});
+        m_remaining.store(m_machines.size(), std::memory_order_relaxed);
+
+        // Deal the machines round robin; stealing evens out any imbalance later
+        std::vector<Worker> workers(threads);
+        for (size_t idx = 0; idx < m_machines.size(); idx++) {
+            if (m_machines[idx].isFinished()) {
+                m_remaining.fetch_sub(1, std::memory_order_relaxed);
+            } else {
+                workers[idx % threads].queue.push_back(idx);
+            }
+        }
+
+        m_start = std::chrono::steady_clock::now();
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for (size_t id = 1; id < threads; id++) {
+            pool.emplace_back([this, &workers, id] { workerLoop(workers, id); });
+        }
+        workerLoop(workers, 0);
+        for (auto& thread : pool) {
+            thread.join();
+        }
+
+        m_elapsedNanos = nanosSinceStart();
+        m_steals = 0;
+        for (const auto& worker : workers) {
+            m_steals += worker.steals;
+        }
+    }
+
+  private:
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<size_t> queue;
+        uint64_t steals{0};
+    };
+
+    uint64_t m_quantum;
+    std::deque<TMachine> m_machines;
+    std::vector<Z80FarmResult> m_results;
+    std::atomic<size_t> m_remaining{0};
+    std::chrono::steady_clock::time_point m_start;
+    uint64_t m_steals{0};
+    uint64_t m_elapsedNanos{0};
+
+    [[nodiscard]] uint64_t nanosSinceStart() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start)
+            .count();
+    }
+
+    bool popLocal(Worker& worker, size_t& idx) {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.queue.empty()) {
+            return false;
+        }
+        idx = worker.queue.front();
+        worker.queue.pop_front();
+        return true;
+    }
+
+    bool steal(std::vector<Worker>& workers, size_t self, size_t& idx) {
+        for (size_t offset = 1; offset < workers.size(); offset++) {
+            Worker& victim = workers[(self + offset) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.queue.empty()) {
+                idx = victim.queue.back();
+                victim.queue.pop_back();
+                workers[self].steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(std::vector<Worker>& workers, size_t self) {
+        Worker& worker = workers[self];
+        while (m_remaining.load(std::memory_order_acquire) != 0) {
+            size_t idx = 0;
+            if (!popLocal(worker, idx) && !steal(workers, self, idx)) {
+                // Every remaining machine is being run by another worker
+                std::this_thread::yield();
+                continue;
+            }
+
+            TMachine& machine = m_machines[idx];
+            Z80FarmResult& result = m_results[idx];
+            result.instructions += machine.runSlice(m_quantum);
+            result.slices++;
+            result.worker = static_cast<uint32_t>(self);
+
+            if (machine.isFinished()) {
+                result.finishNanos = nanosSinceStart();
+                m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+            } else {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                worker.queue.push_back(idx);
+            }
+        }
+    }
+};
+
+#endif // Z80_FARM_H
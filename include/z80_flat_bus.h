@@ -0,0 +1,116 @@
+#ifndef Z80_FLAT_BUS_H
+#define Z80_FLAT_BUS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "z80.h"
+#include "z80_bus_interface.h"
+#include "z80_types.h"
+
+/* Flat RAM bus that can be used in constant evaluation (C++20).
+ *
+ * Size bytes of RAM, mirrored over the 64K address space, with the
+ * uncontended Z80 timings. I/O reads return 0xFF and writes are ignored,
+ * so a routine takes its input from RAM and leaves its output there.
+ *
+ * Built as C++20, a constexpr function can load a routine, run() it and
+ * copy the result out of 'ram', so that the table ends up in the binary
+ * instead of being generated at startup:
+ *
+ *   constexpr auto kTable = [] {
+ *       Z80FlatBus<1024> bus;
+ *       bus.load(0, kGenerator.data(), kGenerator.size());
+ *       bus.run(0, 10000);
+ *       std::array<uint8_t, 256> table{};
+ *       ...copy from bus.ram...
+ *       return table;
+ *   }();
+ *
+ * Compilers bound the work done in constant evaluation (GCC:
+ * -fconstexpr-ops-limit, Clang: -fconstexpr-steps), which allows routines
+ * of a few thousand instructions with the default limits.
+ */
+template <size_t Size> class Z80FlatBus : public Z80BusInterface<Z80FlatBus<Size>> {
+    static_assert(Size >= 256 && Size <= 0x10000 && (Size & (Size - 1)) == 0,
+                  "Size must be a power of two between 256 and 64K");
+
+  public:
+    std::array<uint8_t, Size> ram{};
+    uint64_t tstates{0};
+    // CPU state when run() returned
+    Z80State state{};
+
+    Z80_CONSTEXPR void load(uint16_t address, const uint8_t* data, size_t size) {
+        for (size_t idx = 0; idx < size; idx++) {
+            ram[(address + idx) & kMask] = data[idx];
+        }
+    }
+
+    // Run from 'start' until HALT or 'maxInstructions'; returns the instructions executed
+    Z80_CONSTEXPR uint64_t run(uint16_t start, uint64_t maxInstructions) {
+        Z80<Z80FlatBus> cpu(*this);
+        cpu.setRegPC(start);
+        uint64_t instructions = 0;
+        while (instructions < maxInstructions && !cpu.isHalted()) {
+            cpu.execute();
+            instructions++;
+        }
+        state = cpu.getState();
+        return instructions;
+    }
+
+    Z80_CONSTEXPR uint8_t fetchOpcodeImpl(uint16_t address) {
+        tstates += 4;
+        return ram[address & kMask];
+    }
+
+    Z80_CONSTEXPR uint8_t peek8Impl(uint16_t address) {
+        tstates += 3;
+        return ram[address & kMask];
+    }
+
+    Z80_CONSTEXPR void poke8Impl(uint16_t address, uint8_t value) {
+        tstates += 3;
+        ram[address & kMask] = value;
+    }
+
+    Z80_CONSTEXPR uint16_t peek16Impl(uint16_t address) {
+        tstates += 6;
+        return ram[address & kMask] | (ram[(address + 1) & kMask] << 8);
+    }
+
+    // Only the bytes of 'word' may be read here, see RegisterWord
+    Z80_CONSTEXPR void poke16Impl(uint16_t address, RegisterPair word) {
+        tstates += 6;
+        ram[address & kMask] = word.byte8.lo;
+        ram[(address + 1) & kMask] = word.byte8.hi;
+    }
+
+    Z80_CONSTEXPR uint8_t inPortImpl(uint16_t port) {
+        tstates += 4;
+        return 0xFF;
+    }
+
+    Z80_CONSTEXPR void outPortImpl(uint16_t port, uint8_t value) {
+        tstates += 4;
+    }
+
+    Z80_CONSTEXPR void addressOnBusImpl(uint16_t address, int32_t wstates) {
+        tstates += wstates;
+    }
+
+    Z80_CONSTEXPR void interruptHandlingTimeImpl(int32_t wstates) {
+        tstates += wstates;
+    }
+
+    static constexpr bool isActiveINTImpl() {
+        return false;
+    }
+
+  private:
+    static constexpr uint32_t kMask = Size - 1;
+};
+
+#endif // Z80_FLAT_BUS_H
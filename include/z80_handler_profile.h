@@ -0,0 +1,195 @@
+#ifndef Z80_HANDLER_PROFILE_H
+#define Z80_HANDLER_PROFILE_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#    include <x86intrin.h>
+#endif
+
+#include "z80_histogram.h"
+#include "z80_types.h"
+
+/* Host time spent in each opcode handler, 7 tables of 256 entries.
+ *
+ * Filled by a Z80 built with WITH_HANDLER_PROFILING once it has been given
+ * a profile with setHandlerProfile(). Without the define the decoders
+ * contain no timing code at all.
+ *
+ * execute() reads the clock before fetching an instruction and after its
+ * handler returns, before interrupts are checked, and charges the time to
+ * the decoder entry that ran last: a DD-prefixed instruction is charged
+ * to its DD entry, prefix fetch included, and a DDCB one to DDCB. A CPU
+ * stopped on HALT charges Main 0x76 for each NOP. Each sample has the
+ * cost of reading the clock itself, measured when the profile is built,
+ * subtracted from it.
+ *
+ * On x86 the clock is the time stamp counter, so costs are reference
+ * cycles; elsewhere it is the steady clock in nanoseconds. getTicksPerNs()
+ * converts between the two. Profiling adds two clock reads to every
+ * instruction, so the emulator runs several times slower while it is on;
+ * the relative costs are what it is meant for.
+ */
+class Z80HandlerProfile {
+  public:
+    static constexpr size_t kTables = Z80OpcodeHistogram::kTables;
+
+    struct Entry {
+        Z80OpcodeTable table;
+        uint8_t opcode;
+        uint64_t count;
+        uint64_t ticks;
+    };
+
+    Z80HandlerProfile() {
+        calibrate();
+    }
+
+    static Z80_FORCE_INLINE uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+#endif
+    }
+
+    static const char* getClockName() {
+#if defined(__x86_64__) || defined(__i386__)
+        return "rdtsc";
+#else
+        return "steady_clock";
+#endif
+    }
+
+    // The decoder entry the running instruction has reached
+    Z80_FORCE_INLINE void select(Z80OpcodeTable table, uint8_t opcode) {
+        m_table = table;
+        m_opcode = opcode;
+    }
+
+    // Charge the time since 'start', a now() taken before the fetch, to the selected entry
+    Z80_FORCE_INLINE void charge(uint64_t start) {
+        uint64_t elapsed = now() - start;
+        size_t table = static_cast<size_t>(m_table);
+        m_counts[table][m_opcode]++;
+        m_ticks[table][m_opcode] += elapsed > m_overhead ? elapsed - m_overhead : 0;
+    }
+
+    [[nodiscard]] uint64_t getCount(Z80OpcodeTable table, uint8_t opcode) const {
+        return m_counts[static_cast<size_t>(table)][opcode];
+    }
+
+    [[nodiscard]] uint64_t getTicks(Z80OpcodeTable table, uint8_t opcode) const {
+        return m_ticks[static_cast<size_t>(table)][opcode];
+    }
+
+    [[nodiscard]] uint64_t getTotalTicks() const {
+        uint64_t total = 0;
+        for (const auto& table : m_ticks) {
+            for (uint64_t ticks : table) {
+                total += ticks;
+            }
+        }
+        return total;
+    }
+
+    // Clock ticks subtracted from every sample
+    [[nodiscard]] uint64_t getOverhead() const {
+        return m_overhead;
+    }
+
+    [[nodiscard]] double getTicksPerNs() const {
+        return m_ticksPerNs;
+    }
+
+    void clear() {
+        for (auto& table : m_counts) {
+            table.fill(0);
+        }
+        for (auto& table : m_ticks) {
+            table.fill(0);
+        }
+    }
+
+    void merge(const Z80HandlerProfile& other) {
+        for (size_t table = 0; table < kTables; table++) {
+            for (size_t opcode = 0; opcode < 256; opcode++) {
+                m_counts[table][opcode] += other.m_counts[table][opcode];
+                m_ticks[table][opcode] += other.m_ticks[table][opcode];
+            }
+        }
+    }
+
+    // Executed entries, highest total cost first; 'limit' == 0 returns all of them
+    [[nodiscard]] std::vector<Entry> getTop(size_t limit = 0) const {
+        std::vector<Entry> entries;
+        for (size_t table = 0; table < kTables; table++) {
+            for (uint32_t opcode = 0; opcode < 256; opcode++) {
+                if (m_counts[table][opcode] != 0) {
+                    entries.push_back({static_cast<Z80OpcodeTable>(table), static_cast<uint8_t>(opcode),
+                                       m_counts[table][opcode], m_ticks[table][opcode]});
+                }
+            }
+        }
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const Entry& lhs, const Entry& rhs) { return lhs.ticks > rhs.ticks; });
+        if (limit != 0 && entries.size() > limit) {
+            entries.resize(limit);
+        }
+        return entries;
+    }
+
+    // "table,opcode,count,ticks,ticks_per_op,share" per executed entry, highest total cost first
+    void writeCsv(std::ostream& out) const {
+        static constexpr char kDigits[] = "0123456789abcdef";
+        uint64_t total = getTotalTicks();
+        out << "table,opcode,count,ticks,ticks_per_op,share" << '\n';
+        for (const Entry& entry : getTop()) {
+            out << Z80OpcodeHistogram::tableName(entry.table) << ",0x" << kDigits[entry.opcode >> 4]
+                << kDigits[entry.opcode & 0x0F] << ',' << entry.count << ',' << entry.ticks << ','
+                << static_cast<double>(entry.ticks) / static_cast<double>(entry.count) << ','
+                << (total == 0 ? 0.0 : static_cast<double>(entry.ticks) / static_cast<double>(total)) << '\n';
+        }
+    }
+
+  private:
+    static constexpr int kCalibrationSamples = 10001;
+
+    std::array<std::array<uint64_t, 256>, kTables> m_counts{};
+    std::array<std::array<uint64_t, 256>, kTables> m_ticks{};
+    Z80OpcodeTable m_table{Z80OpcodeTable::Main};
+    uint8_t m_opcode{};
+    uint64_t m_overhead{};
+    double m_ticksPerNs{1.0};
+
+    /* The median of back-to-back clock reads is what every sample pays for
+     * the clock; the median, not the minimum, so that the rare read that
+     * overlaps the previous one does not set it. The tick rate is taken
+     * against the steady clock over a millisecond. */
+    void calibrate() {
+        std::vector<uint64_t> samples(kCalibrationSamples);
+        for (uint64_t& sample : samples) {
+            uint64_t start = now();
+            sample = now() - start;
+        }
+        std::nth_element(samples.begin(), samples.begin() + kCalibrationSamples / 2, samples.end());
+        m_overhead = samples[kCalibrationSamples / 2];
+
+        auto clockStart = std::chrono::steady_clock::now();
+        uint64_t start = now();
+        while (std::chrono::steady_clock::now() - clockStart < std::chrono::milliseconds(1)) {
+        }
+        auto nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - clockStart);
+        m_ticksPerNs = static_cast<double>(now() - start) / nanoseconds.count();
+    }
+};
+
+#endif // Z80_HANDLER_PROFILE_H
@@ -0,0 +1,70 @@
+#ifndef Z80_HASH_H
+#define Z80_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "z80_types.h"
+
+/* Fast non-cryptographic 64-bit hashing used to fingerprint machine state.
+ * Intended for determinism checks and deduplication of runs, not security. */
+
+inline constexpr uint64_t kZ80HashSeed = 0x9E3779B97F4A7C15ULL;
+
+// Final avalanche step (splitmix64)
+Z80_FORCE_INLINE constexpr uint64_t z80HashMix(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ULL;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBULL;
+    value ^= value >> 31;
+    return value;
+}
+
+Z80_FORCE_INLINE constexpr uint64_t z80HashCombine(uint64_t seed, uint64_t value) {
+    return z80HashMix(seed ^ (value + kZ80HashSeed + (seed << 6) + (seed >> 2)));
+}
+
+// Hash a byte range, 8 bytes per step
+inline uint64_t z80HashBytes(const uint8_t* data, size_t size, uint64_t seed = kZ80HashSeed) {
+    uint64_t hash = seed ^ (size * 0xFF51AFD7ED558CCDULL);
+
+    size_t idx = 0;
+    for (; idx + 8 <= size; idx += 8) {
+        uint64_t word = 0;
+        std::memcpy(&word, data + idx, sizeof(word));
+        hash = (hash ^ word) * 0x9FB21C651E98DF25ULL;
+        hash ^= hash >> 29;
+    }
+
+    uint64_t tail = 0;
+    for (size_t shift = 0; idx < size; idx++, shift += 8) {
+        tail |= static_cast<uint64_t>(data[idx]) << shift;
+    }
+
+    return z80HashMix(hash ^ tail);
+}
+
+// Hash every field of a CPU state. Fields are packed explicitly so that
+// padding bytes never leak into the result.
+inline uint64_t z80HashState(const Z80State& state) {
+    uint64_t regs0 = static_cast<uint64_t>(state.af) | (static_cast<uint64_t>(state.bc) << 16)
+                     | (static_cast<uint64_t>(state.de) << 32) | (static_cast<uint64_t>(state.hl) << 48);
+    uint64_t regs1 = static_cast<uint64_t>(state.afx) | (static_cast<uint64_t>(state.bcx) << 16)
+                     | (static_cast<uint64_t>(state.dex) << 32) | (static_cast<uint64_t>(state.hlx) << 48);
+    uint64_t regs2 = static_cast<uint64_t>(state.ix) | (static_cast<uint64_t>(state.iy) << 16)
+                     | (static_cast<uint64_t>(state.sp) << 32) | (static_cast<uint64_t>(state.pc) << 48);
+    uint64_t misc = static_cast<uint64_t>(state.memptr) | (static_cast<uint64_t>(state.i) << 16)
+                    | (static_cast<uint64_t>(state.r) << 24) | (static_cast<uint64_t>(state.im) << 32);
+    uint64_t bits = (state.iff1 ? 0x01U : 0U) | (state.iff2 ? 0x02U : 0U) | (state.pendingEI ? 0x04U : 0U)
+                    | (state.activeNMI ? 0x08U : 0U) | (state.halted ? 0x10U : 0U) | (state.pinReset ? 0x20U : 0U)
+                    | (state.flagQ ? 0x40U : 0U) | (state.lastFlagQ ? 0x80U : 0U);
+
+    uint64_t hash = z80HashCombine(kZ80HashSeed, regs0);
+    hash = z80HashCombine(hash, regs1);
+    hash = z80HashCombine(hash, regs2);
+    return z80HashCombine(hash, misc | (bits << 40));
+}
+
+#endif // Z80_HASH_H
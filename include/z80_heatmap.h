@@ -0,0 +1,225 @@
+#ifndef Z80_HEATMAP_H
+#define Z80_HEATMAP_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "z80_bus_interface.h"
+#include "z80_encoding.h"
+#include "z80_types.h"
+
+/* Read, write and execute counts for every address of the 64K space.
+ *
+ * Counters are 32-bit and saturate at UINT32_MAX instead of wrapping.
+ * Each kind is a 256K array in address order, so the 16 addresses of a
+ * 64-byte cache line share it and code or data accessed sequentially
+ * stays in a few lines. Interleaving the three kinds per 16-address block
+ * was measured slower: the index costs more than the locality saves.
+ *
+ * writeBinary() stores the counters, every integer little-endian:
+ *
+ *   magic    8 bytes     "Z80HEAT\0"
+ *   version  u16         kVersion
+ *   kinds    u16         3
+ *   counts   u32 x 64K   for each of Read, Write, Exec, in address order
+ *
+ * writePgm() draws one kind as a 256x256 greyscale image, one row per
+ * 256-byte page, on a logarithmic scale.
+ */
+class Z80Heatmap {
+  public:
+    enum class Kind : uint8_t { Read, Write, Exec };
+
+    static constexpr uint16_t kVersion = 1;
+    static constexpr std::array<char, 8> kMagic = {'Z', '8', '0', 'H', 'E', 'A', 'T', '\0'};
+    static constexpr size_t kKinds = 3;
+
+    Z80_FORCE_INLINE void count(Kind kind, uint16_t address) {
+        uint32_t& counter = m_counts[index(kind, address)];
+        counter += counter != UINT32_MAX ? 1 : 0;
+    }
+
+    [[nodiscard]] uint32_t get(Kind kind, uint16_t address) const {
+        return m_counts[index(kind, address)];
+    }
+
+    void clear() {
+        std::fill(m_counts.begin(), m_counts.end(), 0);
+    }
+
+    // Adds the counts of another heatmap, saturating
+    void merge(const Z80Heatmap& other) {
+        for (size_t idx = 0; idx < m_counts.size(); idx++) {
+            uint64_t sum = static_cast<uint64_t>(m_counts[idx]) + other.m_counts[idx];
+            m_counts[idx] = static_cast<uint32_t>(std::min<uint64_t>(sum, UINT32_MAX));
+        }
+    }
+
+    bool writeBinary(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        std::vector<uint8_t> out(kMagic.begin(), kMagic.end());
+        out.reserve(kHeaderSize + m_counts.size() * 4);
+        z80PutLE(out, kVersion, 2);
+        z80PutLE(out, kKinds, 2);
+        for (size_t kind = 0; kind < kKinds; kind++) {
+            for (uint32_t address = 0; address < 0x10000; address++) {
+                z80PutLE(out, get(static_cast<Kind>(kind), static_cast<uint16_t>(address)), 4);
+            }
+        }
+        file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+        return file.good();
+    }
+
+    // False if the file is not a heatmap of a known version
+    bool readBinary(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<uint8_t> in(kHeaderSize + kKinds * 0x10000 * 4);
+        file.read(reinterpret_cast<char*>(in.data()), static_cast<std::streamsize>(in.size()));
+        if (file.gcount() != static_cast<std::streamsize>(in.size())
+            || !std::equal(kMagic.begin(), kMagic.end(), in.begin()) || z80GetLE(&in[8], 2) == 0
+            || z80GetLE(&in[8], 2) > kVersion || z80GetLE(&in[10], 2) != kKinds) {
+            return false;
+        }
+        const uint8_t* pos = &in[kHeaderSize];
+        for (size_t kind = 0; kind < kKinds; kind++) {
+            for (uint32_t address = 0; address < 0x10000; address++, pos += 4) {
+                m_counts[index(static_cast<Kind>(kind), static_cast<uint16_t>(address))] =
+                    static_cast<uint32_t>(z80GetLE(pos, 4));
+            }
+        }
+        return true;
+    }
+
+    // Binary PGM (P5); black is never accessed, white is the most accessed address
+    bool writePgm(const std::string& path, Kind kind) const {
+        uint32_t maxCount = 0;
+        for (uint32_t address = 0; address < 0x10000; address++) {
+            maxCount = std::max(maxCount, get(kind, static_cast<uint16_t>(address)));
+        }
+        double scale = maxCount == 0 ? 0 : 255.0 / std::log2(1.0 + maxCount);
+        std::vector<uint8_t> pixels(0x10000);
+        for (uint32_t address = 0; address < 0x10000; address++) {
+            pixels[address] =
+                static_cast<uint8_t>(std::lround(std::log2(1.0 + get(kind, static_cast<uint16_t>(address))) * scale));
+        }
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << "P5\n256 256\n255\n";
+        file.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+        return file.good();
+    }
+
+  private:
+    static constexpr size_t kHeaderSize = 12;
+
+    std::vector<uint32_t> m_counts = std::vector<uint32_t>(kKinds * 0x10000);
+
+    static Z80_FORCE_INLINE size_t index(Kind kind, uint16_t address) {
+        return static_cast<size_t>(kind) << 16 | address;
+    }
+};
+
+/* Bus layer that fills a Z80Heatmap and forwards every access to 'bus'.
+ *
+ * The CPU is built on the layer instead of the bus underneath
+ *
+ *   Z80Machine machine;
+ *   Z80HeatmapBus<Z80Machine> heat(machine);
+ *   Z80<Z80HeatmapBus<Z80Machine>> cpu(heat);
+ *
+ * Opcode fetches (M1 cycles, prefixes included) count as Exec, peek8 and
+ * peek16 as Read and poke8 and poke16 as Write, a 16-bit access counting
+ * both of its addresses. I/O, timing and the optional hooks are passed
+ * through untouched.
+ */
+template <typename TBus> class Z80HeatmapBus : public Z80BusInterface<Z80HeatmapBus<TBus>> {
+  public:
+    using Kind = Z80Heatmap::Kind;
+
+    explicit Z80HeatmapBus(TBus& bus) : m_bus(bus) {
+    }
+
+    Z80_FORCE_INLINE uint8_t fetchOpcodeImpl(uint16_t address) {
+        m_heatmap.count(Kind::Exec, address);
+        return m_bus.fetchOpcodeImpl(address);
+    }
+
+    Z80_FORCE_INLINE uint8_t peek8Impl(uint16_t address) {
+        m_heatmap.count(Kind::Read, address);
+        return m_bus.peek8Impl(address);
+    }
+
+    Z80_FORCE_INLINE void poke8Impl(uint16_t address, uint8_t value) {
+        m_heatmap.count(Kind::Write, address);
+        m_bus.poke8Impl(address, value);
+    }
+
+    Z80_FORCE_INLINE uint16_t peek16Impl(uint16_t address) {
+        m_heatmap.count(Kind::Read, address);
+        m_heatmap.count(Kind::Read, address + 1);
+        return m_bus.peek16Impl(address);
+    }
+
+    Z80_FORCE_INLINE void poke16Impl(uint16_t address, RegisterPair word) {
+        m_heatmap.count(Kind::Write, address);
+        m_heatmap.count(Kind::Write, address + 1);
+        m_bus.poke16Impl(address, word);
+    }
+
+    uint8_t inPortImpl(uint16_t port) {
+        return m_bus.inPortImpl(port);
+    }
+
+    void outPortImpl(uint16_t port, uint8_t value) {
+        m_bus.outPortImpl(port, value);
+    }
+
+    void addressOnBusImpl(uint16_t address, int32_t wstates) {
+        m_bus.addressOnBusImpl(address, wstates);
+    }
+
+    void interruptHandlingTimeImpl(int32_t wstates) {
+        m_bus.interruptHandlingTimeImpl(wstates);
+    }
+
+    bool isActiveINTImpl() {
+        return m_bus.isActiveINTImpl();
+    }
+
+#ifdef WITH_BREAKPOINT_SUPPORT
+    uint8_t breakpointImpl(uint16_t address, uint8_t opcode) {
+        return m_bus.breakpointImpl(address, opcode);
+    }
+#endif
+
+#ifdef WITH_EXEC_DONE
+    void execDoneImpl() {
+        m_bus.execDoneImpl();
+    }
+#endif
+
+#ifdef WITH_FLOW_EVENTS
+    void flowEventImpl(Z80FlowKind kind, uint16_t from, uint16_t to, uint16_t sp) {
+        m_bus.flowEventImpl(kind, from, to, sp);
+    }
+#endif
+
+    TBus& getBus() {
+        return m_bus;
+    }
+
+    Z80Heatmap& getHeatmap() {
+        return m_heatmap;
+    }
+
+  private:
+    TBus& m_bus;
+    Z80Heatmap m_heatmap;
+};
+
+#endif // Z80_HEATMAP_H
@@ -0,0 +1,157 @@
+#ifndef Z80_HISTOGRAM_H
+#define Z80_HISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "z80_types.h"
+
+// Opcode tables, one per decoder
+enum class Z80OpcodeTable : uint8_t { Main, CB, ED, DD, FD, DDCB, FDCB };
+
+/* Execution counts per opcode, 7 tables of 256 entries.
+ *
+ * Filled by a Z80 built with WITH_OPCODE_HISTOGRAM once it has been given
+ * a histogram with setOpcodeHistogram(). Without the define the decoders
+ * contain no counting code at all.
+ *
+ * Every opcode byte is counted in the table of the decoder that reads it,
+ * prefixes included: Main 0xDD counts DD-prefixed instructions, DD 0xCB
+ * counts DDCB ones, and a DD followed by an unprefixed opcode is counted
+ * as DD xx only. A CPU stopped on HALT counts Main 0x76 once per NOP it
+ * executes. getInstructions() leaves the prefix entries out.
+ *
+ * Histograms of many CPUs are combined with merge() before dumping.
+ */
+class Z80OpcodeHistogram {
+  public:
+    static constexpr size_t kTables = 7;
+
+    struct Entry {
+        Z80OpcodeTable table;
+        uint8_t opcode;
+        uint64_t count;
+    };
+
+    Z80_FORCE_INLINE Z80_CONSTEXPR void count(Z80OpcodeTable table, uint8_t opcode) {
+        m_counts[static_cast<size_t>(table)][opcode]++;
+    }
+
+    [[nodiscard]] uint64_t get(Z80OpcodeTable table, uint8_t opcode) const {
+        return m_counts[static_cast<size_t>(table)][opcode];
+    }
+
+    // Every counted opcode byte, prefixes included
+    [[nodiscard]] uint64_t getTotal() const {
+        uint64_t total = 0;
+        for (const auto& table : m_counts) {
+            for (uint64_t count : table) {
+                total += count;
+            }
+        }
+        return total;
+    }
+
+    [[nodiscard]] uint64_t getInstructions() const {
+        uint64_t instructions = getTotal();
+        for (size_t table = 0; table < kTables; table++) {
+            for (uint32_t opcode = 0; opcode < 256; opcode++) {
+                if (isPrefix(static_cast<Z80OpcodeTable>(table), static_cast<uint8_t>(opcode))) {
+                    instructions -= m_counts[table][opcode];
+                }
+            }
+        }
+        return instructions;
+    }
+
+    void clear() {
+        for (auto& table : m_counts) {
+            table.fill(0);
+        }
+    }
+
+    void merge(const Z80OpcodeHistogram& other) {
+        for (size_t table = 0; table < kTables; table++) {
+            for (size_t opcode = 0; opcode < 256; opcode++) {
+                m_counts[table][opcode] += other.m_counts[table][opcode];
+            }
+        }
+    }
+
+    // Non-zero entries, most frequent first; 'limit' == 0 returns all of them
+    [[nodiscard]] std::vector<Entry> getTop(size_t limit = 0) const {
+        std::vector<Entry> entries;
+        for (size_t table = 0; table < kTables; table++) {
+            for (uint32_t opcode = 0; opcode < 256; opcode++) {
+                if (m_counts[table][opcode] != 0) {
+                    entries.push_back(
+                        {static_cast<Z80OpcodeTable>(table), static_cast<uint8_t>(opcode), m_counts[table][opcode]});
+                }
+            }
+        }
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const Entry& lhs, const Entry& rhs) { return lhs.count > rhs.count; });
+        if (limit != 0 && entries.size() > limit) {
+            entries.resize(limit);
+        }
+        return entries;
+    }
+
+    // One "table,opcode,count" line per non-zero entry, in table order
+    void writeCsv(std::ostream& out) const {
+        out << "table,opcode,count" << '\n';
+        for (size_t table = 0; table < kTables; table++) {
+            for (uint32_t opcode = 0; opcode < 256; opcode++) {
+                if (m_counts[table][opcode] != 0) {
+                    out << tableName(static_cast<Z80OpcodeTable>(table)) << ",0x" << hexByte(opcode) << ','
+                        << m_counts[table][opcode] << '\n';
+                }
+            }
+        }
+    }
+
+    // {"total": n, "instructions": n, "tables": {"main": {"0x00": n, ...}, ...}}, non-zero entries only
+    void writeJson(std::ostream& out) const {
+        out << "{\n  \"total\": " << getTotal() << ",\n  \"instructions\": " << getInstructions()
+            << ",\n  \"tables\": {";
+        for (size_t table = 0; table < kTables; table++) {
+            out << (table == 0 ? "\n" : ",\n") << "    \"" << tableName(static_cast<Z80OpcodeTable>(table))
+                << "\": {";
+            bool first = true;
+            for (uint32_t opcode = 0; opcode < 256; opcode++) {
+                if (m_counts[table][opcode] != 0) {
+                    out << (first ? "" : ", ") << "\"0x" << hexByte(opcode) << "\": " << m_counts[table][opcode];
+                    first = false;
+                }
+            }
+            out << '}';
+        }
+        out << "\n  }\n}\n";
+    }
+
+    static const char* tableName(Z80OpcodeTable table) {
+        static constexpr std::array<const char*, kTables> kNames = {"main", "cb", "ed", "dd", "fd", "ddcb", "fdcb"};
+        return kNames[static_cast<size_t>(table)];
+    }
+
+    // Bytes that only select another table
+    static bool isPrefix(Z80OpcodeTable table, uint8_t opcode) {
+        bool prefixTable = table == Z80OpcodeTable::Main || table == Z80OpcodeTable::DD || table == Z80OpcodeTable::FD;
+        return prefixTable && (opcode == 0xCB || opcode == 0xDD || opcode == 0xED || opcode == 0xFD);
+    }
+
+  private:
+    std::array<std::array<uint64_t, 256>, kTables> m_counts{};
+
+    static std::string hexByte(uint32_t value) {
+        static constexpr char kDigits[] = "0123456789abcdef";
+        return {kDigits[(value >> 4) & 0x0F], kDigits[value & 0x0F]};
+    }
+};
+
+#endif // Z80_HISTOGRAM_H
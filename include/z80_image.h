@@ -0,0 +1,121 @@
+#ifndef Z80_IMAGE_H
+#define Z80_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#    define Z80_HAS_MMAP 1
+#endif
+
+/* ROM or program image backed by a memory mapped file.
+ *
+ * ReadOnly images are meant to be shared: map the file once and hand the
+ * same std::shared_ptr to every machine, so hundreds of instances use a
+ * single copy of the ROM. CopyOnWrite images are private mappings
+ * (MAP_PRIVATE): their pages come from the page cache until the guest
+ * writes them, which makes them a cheap way to preload RAM.
+ *
+ * On platforms without mmap the file is read into a heap buffer instead.
+ */
+class Z80Image {
+  public:
+    enum class Access : uint8_t { ReadOnly, CopyOnWrite };
+
+    Z80Image(const Z80Image&) = delete;
+    Z80Image& operator=(const Z80Image&) = delete;
+    Z80Image(Z80Image&&) = delete;
+    Z80Image& operator=(Z80Image&&) = delete;
+
+    ~Z80Image() {
+#ifdef Z80_HAS_MMAP
+        if (m_mapped) {
+            munmap(m_data, m_size);
+        }
+#endif
+    }
+
+    // Returns nullptr if the file cannot be opened or mapped
+    static std::shared_ptr<Z80Image> map(const std::string& path, Access access = Access::ReadOnly) {
+        std::shared_ptr<Z80Image> image(new Z80Image(access));
+
+#ifdef Z80_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+
+        struct stat info {};
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return nullptr;
+        }
+
+        image->m_size = static_cast<size_t>(info.st_size);
+        if (image->m_size > 0) {
+            int prot = access == Access::CopyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+            void* addr = mmap(nullptr, image->m_size, prot, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                ::close(fd);
+                return nullptr;
+            }
+            image->m_data = static_cast<uint8_t*>(addr);
+            image->m_mapped = true;
+        }
+        ::close(fd);
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return nullptr;
+        }
+        image->m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        image->m_data = image->m_buffer.data();
+        image->m_size = image->m_buffer.size();
+#endif
+
+        return image;
+    }
+
+    [[nodiscard]] const uint8_t* data() const {
+        return m_data;
+    }
+
+    // Writable view, only available for CopyOnWrite images
+    [[nodiscard]] uint8_t* mutableData() {
+        return m_access == Access::CopyOnWrite ? m_data : nullptr;
+    }
+
+    [[nodiscard]] size_t size() const {
+        return m_size;
+    }
+
+    [[nodiscard]] Access getAccess() const {
+        return m_access;
+    }
+
+    // false when the image had to be read into a private heap buffer
+    [[nodiscard]] bool isMapped() const {
+        return m_mapped;
+    }
+
+  private:
+    explicit Z80Image(Access access) : m_access(access) {
+    }
+
+    uint8_t* m_data{nullptr};
+    size_t m_size{0};
+    Access m_access;
+    bool m_mapped{false};
+    std::vector<uint8_t> m_buffer;
+};
+
+#endif // Z80_IMAGE_H
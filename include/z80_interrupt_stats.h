@@ -0,0 +1,317 @@
+#ifndef Z80_INTERRUPT_STATS_H
+#define Z80_INTERRUPT_STATS_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "z80_types.h"
+
+/* Distribution of T-state spans in power-of-two buckets: bucket 0 holds
+ * spans of 0, bucket N (1..64) those in [2^(N-1), 2^N). Count, sum, minimum
+ * and maximum are exact; percentiles are the upper bound of their bucket,
+ * clamped to the maximum. */
+class Z80TstateHistogram {
+  public:
+    static constexpr size_t kBuckets = 65;
+
+    void add(uint64_t tstates) {
+        size_t bucket = 0;
+        while (bucket < 64 && (tstates >> bucket) != 0) {
+            bucket++;
+        }
+        m_buckets[bucket]++;
+        m_min = m_count == 0 ? tstates : std::min(m_min, tstates);
+        m_max = std::max(m_max, tstates);
+        m_count++;
+        m_sum += tstates;
+    }
+
+    [[nodiscard]] uint64_t getCount() const {
+        return m_count;
+    }
+
+    [[nodiscard]] uint64_t getSum() const {
+        return m_sum;
+    }
+
+    [[nodiscard]] uint64_t getMin() const {
+        return m_min;
+    }
+
+    [[nodiscard]] uint64_t getMax() const {
+        return m_max;
+    }
+
+    [[nodiscard]] double getMean() const {
+        return m_count == 0 ? 0.0 : static_cast<double>(m_sum) / static_cast<double>(m_count);
+    }
+
+    [[nodiscard]] uint64_t getBucket(size_t bucket) const {
+        return m_buckets[bucket];
+    }
+
+    // Smallest span of a bucket
+    static uint64_t bucketLow(size_t bucket) {
+        return bucket == 0 ? 0 : uint64_t{1} << (bucket - 1);
+    }
+
+    // Largest span of a bucket
+    static uint64_t bucketHigh(size_t bucket) {
+        return bucket == 0 ? 0 : bucket == 64 ? UINT64_MAX : (uint64_t{1} << bucket) - 1;
+    }
+
+    // The span below which 'fraction' (0..1) of them fall, to bucket precision
+    [[nodiscard]] uint64_t percentile(double fraction) const {
+        if (m_count == 0) {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(std::max(1.0, fraction * static_cast<double>(m_count) + 0.5));
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+            seen += m_buckets[bucket];
+            if (seen >= rank) {
+                return std::clamp(bucketHigh(bucket), m_min, m_max);
+            }
+        }
+        return m_max;
+    }
+
+    void clear() {
+        *this = Z80TstateHistogram();
+    }
+
+    void merge(const Z80TstateHistogram& other) {
+        if (other.m_count == 0) {
+            return;
+        }
+        for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+            m_buckets[bucket] += other.m_buckets[bucket];
+        }
+        m_min = m_count == 0 ? other.m_min : std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+        m_count += other.m_count;
+        m_sum += other.m_sum;
+    }
+
+    // {"count": n, "sum": n, "min": n, "max": n, "p50": n, "p99": n, "buckets": [[low, high, count], ...]}
+    void writeJson(std::ostream& out) const {
+        out << "{\"count\": " << m_count << ", \"sum\": " << m_sum << ", \"min\": " << m_min
+            << ", \"max\": " << m_max << ", \"p50\": " << percentile(0.5) << ", \"p99\": " << percentile(0.99)
+            << ", \"buckets\": [";
+        const char* separator = "";
+        for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+            if (m_buckets[bucket] != 0) {
+                out << separator << '[' << bucketLow(bucket) << ", " << bucketHigh(bucket) << ", "
+                    << m_buckets[bucket] << ']';
+                separator = ", ";
+            }
+        }
+        out << "]}";
+    }
+
+  private:
+    std::array<uint64_t, kBuckets> m_buckets{};
+    uint64_t m_count{0};
+    uint64_t m_sum{0};
+    uint64_t m_min{0};
+    uint64_t m_max{0};
+};
+
+/* Interrupt latency, HALT idle time and time with interrupts disabled of
+ * one machine, from the flow events of a core built with WITH_FLOW_EVENTS.
+ *
+ * The bus forwards every event with the T-state counter and IFF1 as they
+ * are after it, and reports the edges of its INT line with onIntLine():
+ *
+ *   void flowEventImpl(Z80FlowKind kind, uint16_t from, uint16_t to, uint16_t sp) {
+ *       stats.onFlow(kind, tstates, cpu.isIFF1());
+ *   }
+ *
+ * Z80Machine does both once given the stats with setInterruptStats().
+ *
+ * INT latency runs from the rising edge of the line to the Interrupt
+ * event, the acknowledge cycle and the push of the return address
+ * included. A line that falls before the CPU acknowledged it is a missed
+ * interrupt. A halted period runs from Halt to the Interrupt or Nmi that
+ * ends it, a disabled period from IFF1 going to 0 (DI, an acknowledge, an
+ * NMI) to it going back to 1 (EI, RETN); the one EI delays interrupts by
+ * is not part of it.
+ *
+ * The histograms get a period when it ends. The totals of halted and
+ * disabled T-states also count the open part of a period up to the last
+ * split(), so that a frame loop gets exact per-frame figures with
+ *
+ *   stats.split(frameEnd);
+ *   idle = stats.getHaltedTstates() / frameLength; ...
+ *   stats.clear();
+ */
+class Z80InterruptStats {
+  public:
+    explicit Z80InterruptStats(uint64_t tstates = 0, bool iff1 = false, bool halted = false) {
+        start(tstates, iff1, halted);
+    }
+
+    // Start from the state of a CPU at 'tstates', as after a reset by default, with the INT line inactive
+    void start(uint64_t tstates, bool iff1, bool halted) {
+        m_iff1 = iff1;
+        m_halted = halted;
+        m_intActive = m_intAcknowledged = false;
+        m_disabledStart = m_disabledSplit = tstates;
+        m_haltStart = m_haltSplit = tstates;
+    }
+
+    void onFlow(Z80FlowKind kind, uint64_t tstates, bool iff1) {
+        switch (kind) {
+            case Z80FlowKind::Halt:
+                if (!m_halted) {
+                    m_halted = true;
+                    m_haltStart = m_haltSplit = tstates;
+                }
+                break;
+            case Z80FlowKind::Interrupt:
+                m_interrupts++;
+                if (m_intActive && !m_intAcknowledged) {
+                    m_intLatency.add(tstates - m_intAsserted);
+                    m_intAcknowledged = true;
+                }
+                endHalt(tstates);
+                break;
+            case Z80FlowKind::Nmi:
+                m_nmis++;
+                endHalt(tstates);
+                break;
+            default:
+                break;
+        }
+        if (iff1 != m_iff1) {
+            m_iff1 = iff1;
+            if (iff1) {
+                m_disabledTstates += tstates - m_disabledSplit;
+                m_disabledPeriods.add(tstates - m_disabledStart);
+            } else {
+                m_disabledStart = m_disabledSplit = tstates;
+            }
+        }
+    }
+
+    void onIntLine(bool active, uint64_t tstates) {
+        if (active && !m_intActive) {
+            m_intAsserted = tstates;
+            m_intAcknowledged = false;
+            m_intsAsserted++;
+        } else if (!active && m_intActive && !m_intAcknowledged) {
+            m_missedInts++;
+        }
+        m_intActive = active;
+    }
+
+    // Count the open halted and disabled periods up to 'tstates' in the totals
+    void split(uint64_t tstates) {
+        if (m_halted) {
+            m_haltedTstates += tstates - m_haltSplit;
+            m_haltSplit = tstates;
+        }
+        if (!m_iff1) {
+            m_disabledTstates += tstates - m_disabledSplit;
+            m_disabledSplit = tstates;
+        }
+    }
+
+    // Counters, totals and histograms to zero; open periods and the INT line stay as they are
+    void clear() {
+        m_intLatency.clear();
+        m_haltPeriods.clear();
+        m_disabledPeriods.clear();
+        m_interrupts = m_nmis = m_intsAsserted = m_missedInts = 0;
+        m_haltedTstates = m_disabledTstates = 0;
+    }
+
+    [[nodiscard]] const Z80TstateHistogram& getIntLatency() const {
+        return m_intLatency;
+    }
+
+    [[nodiscard]] const Z80TstateHistogram& getHaltPeriods() const {
+        return m_haltPeriods;
+    }
+
+    [[nodiscard]] const Z80TstateHistogram& getDisabledPeriods() const {
+        return m_disabledPeriods;
+    }
+
+    // Acknowledged INTs
+    [[nodiscard]] uint64_t getInterrupts() const {
+        return m_interrupts;
+    }
+
+    [[nodiscard]] uint64_t getNmis() const {
+        return m_nmis;
+    }
+
+    // Rising edges of the INT line
+    [[nodiscard]] uint64_t getIntsAsserted() const {
+        return m_intsAsserted;
+    }
+
+    [[nodiscard]] uint64_t getMissedInts() const {
+        return m_missedInts;
+    }
+
+    [[nodiscard]] uint64_t getHaltedTstates() const {
+        return m_haltedTstates;
+    }
+
+    [[nodiscard]] uint64_t getDisabledTstates() const {
+        return m_disabledTstates;
+    }
+
+    [[nodiscard]] bool isHalted() const {
+        return m_halted;
+    }
+
+    void writeJson(std::ostream& out) const {
+        out << "{\"interrupts\": " << m_interrupts << ", \"nmis\": " << m_nmis
+            << ", \"ints_asserted\": " << m_intsAsserted << ", \"missed_ints\": " << m_missedInts
+            << ", \"halted_tstates\": " << m_haltedTstates << ", \"disabled_tstates\": " << m_disabledTstates
+            << ",\n \"int_latency\": ";
+        m_intLatency.writeJson(out);
+        out << ",\n \"halt_periods\": ";
+        m_haltPeriods.writeJson(out);
+        out << ",\n \"disabled_periods\": ";
+        m_disabledPeriods.writeJson(out);
+        out << "}\n";
+    }
+
+  private:
+    Z80TstateHistogram m_intLatency;
+    Z80TstateHistogram m_haltPeriods;
+    Z80TstateHistogram m_disabledPeriods;
+    uint64_t m_interrupts{0};
+    uint64_t m_nmis{0};
+    uint64_t m_intsAsserted{0};
+    uint64_t m_missedInts{0};
+    uint64_t m_haltedTstates{0};
+    uint64_t m_disabledTstates{0};
+    // Periods start at ...Start and are counted in the totals up to ...Split
+    uint64_t m_haltStart{0};
+    uint64_t m_haltSplit{0};
+    uint64_t m_disabledStart{0};
+    uint64_t m_disabledSplit{0};
+    uint64_t m_intAsserted{0};
+    bool m_iff1{false};
+    bool m_halted{false};
+    bool m_intActive{false};
+    bool m_intAcknowledged{false};
+
+    void endHalt(uint64_t tstates) {
+        if (m_halted) {
+            m_halted = false;
+            m_haltedTstates += tstates - m_haltSplit;
+            m_haltPeriods.add(tstates - m_haltStart);
+        }
+    }
+};
+
+#endif // Z80_INTERRUPT_STATS_H
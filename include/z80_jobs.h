@@ -0,0 +1,200 @@
+#ifndef Z80_JOBS_H
+#define Z80_JOBS_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "z80_machine.h"
+
+/* A unit of work for Z80JobPool.
+ *
+ * The program is loaded at loadAddress, where execution starts, and the
+ * input at inputAddress. The job runs until the CPU halts or one of the
+ * limits is reached; extract then reads the result out of the machine.
+ */
+template <typename TResult> struct Z80Job {
+    std::vector<uint8_t> program;
+    uint16_t loadAddress{0};
+    std::vector<uint8_t> input;
+    uint16_t inputAddress{0};
+    uint64_t tstateLimit{UINT64_MAX};
+    uint64_t instructionLimit{UINT64_MAX};
+    std::function<TResult(Z80Machine&)> extract;
+};
+
+/* Runs Z80Jobs on a fixed set of pre-constructed machines.
+ *
+ * Each machine has its own worker thread. Workers take jobs from a shared
+ * queue in submission order, so a short job never waits for a machine to
+ * be constructed. After a job the worker resets its machine while it is
+ * idle, touching only the pages the job modified (Z80Machine::reset()).
+ *
+ * Results come back through a std::future, which also carries an
+ * exception thrown by the extractor, or through a completion callback
+ * invoked on the worker thread. A job that throws, in either mode, is
+ * counted by getFailed() and not by getCompleted(); exceptions in callback
+ * mode cannot be delivered anywhere else.
+ *
+ * The destructor runs every job already submitted before it returns.
+ */
+class Z80JobPool {
+  public:
+    explicit Z80JobPool(size_t machines = std::thread::hardware_concurrency()) {
+        machines = std::max<size_t>(machines, 1);
+        m_machines.reserve(machines);
+        for (size_t idx = 0; idx < machines; idx++) {
+            m_machines.push_back(std::make_unique<Z80Machine>());
+        }
+        m_workers.reserve(machines);
+        for (size_t idx = 0; idx < machines; idx++) {
+            m_workers.emplace_back([this, idx] { workerLoop(*m_machines[idx]); });
+        }
+    }
+
+    Z80JobPool(const Z80JobPool&) = delete;
+    Z80JobPool& operator=(const Z80JobPool&) = delete;
+
+    ~Z80JobPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    template <typename TResult> std::future<TResult> submit(Z80Job<TResult> job) {
+        auto promise = std::make_shared<std::promise<TResult>>();
+        std::future<TResult> future = promise->get_future();
+        enqueue([job = std::move(job), promise](Z80Machine& machine) {
+            try {
+                promise->set_value(runJob(machine, job));
+                return true;
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+                return false;
+            }
+        });
+        return future;
+    }
+
+    /* 'done' is called with the TResult on the worker thread that ran the
+     * job. Any callable works, move-only ones included: it is held in a
+     * shared_ptr, since the queue stores copyable std::functions. */
+    template <typename TResult, typename TDone> void submit(Z80Job<TResult> job, TDone done) {
+        auto callback = std::make_shared<TDone>(std::move(done));
+        enqueue([job = std::move(job), callback](Z80Machine& machine) {
+            try {
+                (*callback)(runJob(machine, job));
+                return true;
+            } catch (...) {
+                return false;
+            }
+        });
+    }
+
+    // Block until every job submitted so far has finished
+    void wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_queue.empty() && m_busy == 0; });
+    }
+
+    [[nodiscard]] size_t size() const {
+        return m_machines.size();
+    }
+
+    [[nodiscard]] uint64_t getCompleted() const {
+        return m_completed.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t getFailed() const {
+        return m_failed.load(std::memory_order_relaxed);
+    }
+
+    // Pages zeroed by the resets between jobs, 256 per machine would mean full clears
+    [[nodiscard]] uint64_t getPagesReset() const {
+        return m_pagesReset.load(std::memory_order_relaxed);
+    }
+
+  private:
+    // Returns false if the job threw
+    using Task = std::function<bool(Z80Machine&)>;
+
+    std::vector<std::unique_ptr<Z80Machine>> m_machines;
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<Task> m_queue;
+    size_t m_busy{0};
+    bool m_stopping{false};
+    std::atomic<uint64_t> m_completed{0};
+    std::atomic<uint64_t> m_failed{0};
+    std::atomic<uint64_t> m_pagesReset{0};
+
+    template <typename TResult> static TResult runJob(Z80Machine& machine, const Z80Job<TResult>& job) {
+        machine.getMemory().load(job.loadAddress, job.program.data(), job.program.size());
+        machine.getMemory().load(job.inputAddress, job.input.data(), job.input.size());
+        Z80<Z80Machine>& cpu = machine.getCpu();
+        cpu.setRegPC(job.loadAddress);
+
+        uint64_t instructions = 0;
+        while (machine.getTstates() < job.tstateLimit && instructions < job.instructionLimit && !cpu.isHalted()) {
+            cpu.execute();
+            instructions++;
+        }
+        return job.extract(machine);
+    }
+
+    void enqueue(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(task));
+        }
+        m_wake.notify_one();
+    }
+
+    void workerLoop(Z80Machine& machine) {
+        while (true) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+                if (m_queue.empty()) {
+                    return; // Stopping and nothing left to run
+                }
+                task = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_busy++;
+            }
+
+            (task(machine) ? m_completed : m_failed).fetch_add(1, std::memory_order_relaxed);
+            // Reset while idle so the next job starts on a clean machine right away
+            m_pagesReset.fetch_add(machine.reset(), std::memory_order_relaxed);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_busy--;
+                if (m_queue.empty() && m_busy == 0) {
+                    m_idle.notify_all();
+                }
+            }
+        }
+    }
+};
+
+#endif // Z80_JOBS_H
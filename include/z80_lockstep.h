@@ -0,0 +1,614 @@
+#ifndef Z80_LOCKSTEP_H
+#define Z80_LOCKSTEP_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "z80.h"
+#include "z80_bus_interface.h"
+#include "z80_types.h"
+
+/* Bus of the scalar fallback CPU of Z80Lockstep: one lane memory, uncontended timing.
+ */
+class Z80LockstepBus : public Z80BusInterface<Z80LockstepBus> {
+  public:
+    void attach(uint8_t* memory, uint64_t tstates) {
+        m_memory = memory;
+        m_tstates = tstates;
+    }
+
+    [[nodiscard]] uint64_t getTstates() const {
+        return m_tstates;
+    }
+
+    uint8_t fetchOpcodeImpl(uint16_t address) {
+        m_tstates += 4;
+        return m_memory[address];
+    }
+
+    uint8_t peek8Impl(uint16_t address) {
+        m_tstates += 3;
+        return m_memory[address];
+    }
+
+    void poke8Impl(uint16_t address, uint8_t value) {
+        m_tstates += 3;
+        m_memory[address] = value;
+    }
+
+    uint16_t peek16Impl(uint16_t address) {
+        m_tstates += 6;
+        return m_memory[address] | (m_memory[static_cast<uint16_t>(address + 1)] << 8);
+    }
+
+    void poke16Impl(uint16_t address, RegisterPair word) {
+        m_tstates += 6;
+        m_memory[address] = word.byte8.lo;
+        m_memory[static_cast<uint16_t>(address + 1)] = word.byte8.hi;
+    }
+
+    uint8_t inPortImpl(uint16_t port) {
+        m_tstates += 4;
+        return 0xFF;
+    }
+
+    void outPortImpl(uint16_t port, uint8_t value) {
+        m_tstates += 4;
+    }
+
+    void addressOnBusImpl(uint16_t address, int32_t wstates) {
+        m_tstates += wstates;
+    }
+
+    void interruptHandlingTimeImpl(int32_t wstates) {
+        m_tstates += wstates;
+    }
+
+    static bool isActiveINTImpl() {
+        return false;
+    }
+
+  private:
+    uint8_t* m_memory{nullptr};
+    uint64_t m_tstates{0};
+};
+
+/* N Z80 instances running the same program in lockstep.
+ *
+ * Registers are kept structure-of-arrays, one array element per lane, and
+ * every lane has its own 64K memory. Each step picks the lane that is most
+ * behind in T-states and executes its instruction on every lane that sits
+ * at the same PC with the same opcode; the other lanes are masked out and
+ * catch up in a later step. The per-lane loops are branch free so that the
+ * compiler vectorizes them for whatever SIMD width the target has.
+ *
+ * Loads, 8-bit ALU, INC/DEC and jumps run on the lanes. Everything else
+ * (prefixed opcodes, stack, I/O, HALT...) runs on a scalar Z80 that is
+ * loaded with the lane state, so results always match the scalar core:
+ * flags are computed bit for bit as the helpers in z80.h do, and timing
+ * follows the same bus model as Z80Machine.
+ */
+template <size_t N> class Z80Lockstep {
+    static_assert(N > 0 && N % 8 == 0, "Lane count must be a multiple of 8");
+
+  public:
+    static constexpr size_t kLanes = N;
+    static constexpr size_t kLaneMemory = 0x10000;
+
+    Z80Lockstep() : m_memory(N * kLaneMemory, 0) {
+        m_scalar.rebind(m_bus);
+        m_scalar.reset();
+        Z80State initial = m_scalar.getState();
+        for (size_t lane = 0; lane < N; lane++) {
+            setLaneState(lane, initial);
+        }
+    }
+
+    Z80Lockstep(const Z80Lockstep&) = delete;
+    Z80Lockstep& operator=(const Z80Lockstep&) = delete;
+    Z80Lockstep(Z80Lockstep&&) = delete;
+    Z80Lockstep& operator=(Z80Lockstep&&) = delete;
+
+    uint8_t* laneMemory(size_t lane) {
+        return &m_memory[lane * kLaneMemory];
+    }
+
+    // Copy the same bytes into every lane
+    void load(uint16_t address, const uint8_t* data, size_t size) {
+        for (size_t lane = 0; lane < N; lane++) {
+            uint8_t* memory = laneMemory(lane);
+            for (size_t idx = 0; idx < size; idx++) {
+                memory[static_cast<uint16_t>(address + idx)] = data[idx];
+            }
+        }
+    }
+
+    [[nodiscard]] Z80State getLaneState(size_t lane) const {
+        Z80State state = m_cold[lane];
+        state.af = (m_r8[kRegA][lane] << 8) | m_r8[kRegF][lane];
+        state.bc = (m_r8[kRegB][lane] << 8) | m_r8[kRegC][lane];
+        state.de = (m_r8[kRegD][lane] << 8) | m_r8[kRegE][lane];
+        state.hl = (m_r8[kRegH][lane] << 8) | m_r8[kRegL][lane];
+        state.sp = m_sp[lane];
+        state.pc = m_pc[lane];
+        state.memptr = m_memptr[lane];
+        state.r = m_r[lane];
+        state.flagQ = m_flagQ[lane] != 0;
+        state.lastFlagQ = m_lastFlagQ[lane] != 0;
+        return state;
+    }
+
+    void setLaneState(size_t lane, const Z80State& state) {
+        m_cold[lane] = state;
+        m_r8[kRegA][lane] = state.af >> 8;
+        m_r8[kRegF][lane] = state.af & 0xFF;
+        m_r8[kRegB][lane] = state.bc >> 8;
+        m_r8[kRegC][lane] = state.bc & 0xFF;
+        m_r8[kRegD][lane] = state.de >> 8;
+        m_r8[kRegE][lane] = state.de & 0xFF;
+        m_r8[kRegH][lane] = state.hl >> 8;
+        m_r8[kRegL][lane] = state.hl & 0xFF;
+        m_sp[lane] = state.sp;
+        m_pc[lane] = state.pc;
+        m_memptr[lane] = state.memptr;
+        m_r[lane] = state.r;
+        m_flagQ[lane] = state.flagQ ? 1 : 0;
+        m_lastFlagQ[lane] = state.lastFlagQ ? 1 : 0;
+        // The lane paths do not model the EI delay or NMI acceptance
+        m_scalarOnly[lane] = (state.pendingEI || state.activeNMI || state.halted) ? 1 : 0;
+    }
+
+    [[nodiscard]] uint64_t getLaneTstates(size_t lane) const {
+        return m_tstates[lane];
+    }
+
+    void setLaneTstates(size_t lane, uint64_t tstates) {
+        m_tstates[lane] = tstates;
+    }
+
+    [[nodiscard]] bool isLaneHalted(size_t lane) const {
+        return m_cold[lane].halted;
+    }
+
+    // Lane-instructions executed by the vector paths and by the scalar fallback
+    [[nodiscard]] uint64_t getVectorInstructions() const {
+        return m_vectorInstructions;
+    }
+
+    [[nodiscard]] uint64_t getScalarInstructions() const {
+        return m_scalarInstructions;
+    }
+
+    // Run every lane until its T-state counter reaches 'limit' or it halts, like Z80Machine::runUntil
+    void run(uint64_t limit) {
+        while (true) {
+            size_t leader = N;
+            uint64_t least = UINT64_MAX;
+            for (size_t lane = 0; lane < N; lane++) {
+                if (!m_cold[lane].halted && m_tstates[lane] < limit && m_tstates[lane] < least) {
+                    least = m_tstates[lane];
+                    leader = lane;
+                }
+            }
+            if (leader == N) {
+                return;
+            }
+
+            uint16_t pc = m_pc[leader];
+            uint8_t opCode = laneMemory(leader)[pc];
+            Lanes<uint8_t> mask{};
+            uint32_t active = 0;
+            for (size_t lane = 0; lane < N; lane++) {
+                bool same = m_pc[lane] == pc && m_tstates[lane] < limit && !m_cold[lane].halted
+                            && m_scalarOnly[lane] == m_scalarOnly[leader] && laneMemory(lane)[pc] == opCode;
+                mask[lane] = same ? 1 : 0;
+                active += mask[lane];
+            }
+
+            if (m_scalarOnly[leader] == 0 && executeLanes(opCode, mask)) {
+                m_vectorInstructions += active;
+                continue;
+            }
+
+            for (size_t lane = 0; lane < N; lane++) {
+                if (mask[lane] != 0) {
+                    stepScalar(lane);
+                }
+            }
+        }
+    }
+
+  private:
+    template <typename T> using Lanes = std::array<T, N>;
+
+    // 8-bit registers indexed as in the opcode encoding, F takes the (HL) slot
+    static constexpr uint32_t kRegB = 0;
+    static constexpr uint32_t kRegC = 1;
+    static constexpr uint32_t kRegD = 2;
+    static constexpr uint32_t kRegE = 3;
+    static constexpr uint32_t kRegH = 4;
+    static constexpr uint32_t kRegL = 5;
+    static constexpr uint32_t kRegF = 6;
+    static constexpr uint32_t kRegA = 7;
+    static constexpr uint32_t kOperandHL = 6;
+
+    static constexpr uint8_t kCarry = 0x01;
+    static constexpr uint8_t kAddSub = 0x02;
+    static constexpr uint8_t kOverflow = 0x04;
+    static constexpr uint8_t kHalfCarry = 0x10;
+    static constexpr uint8_t kZero = 0x40;
+    static constexpr uint8_t kSign = 0x80;
+
+    alignas(64) std::array<Lanes<uint8_t>, 8> m_r8{};
+    alignas(64) Lanes<uint16_t> m_pc{};
+    alignas(64) Lanes<uint16_t> m_sp{};
+    alignas(64) Lanes<uint16_t> m_memptr{};
+    alignas(64) Lanes<uint8_t> m_r{};
+    alignas(64) Lanes<uint8_t> m_flagQ{};
+    alignas(64) Lanes<uint8_t> m_lastFlagQ{};
+    alignas(64) Lanes<uint8_t> m_scalarOnly{};
+    alignas(64) Lanes<uint64_t> m_tstates{};
+    // State the lane paths never touch
+    std::array<Z80State, N> m_cold{};
+    std::vector<uint8_t> m_memory;
+    uint64_t m_vectorInstructions{0};
+    uint64_t m_scalarInstructions{0};
+    Z80LockstepBus m_bus;
+    Z80<Z80LockstepBus> m_scalar;
+
+    void stepScalar(size_t lane) {
+        m_bus.attach(laneMemory(lane), m_tstates[lane]);
+        m_scalar.setState(getLaneState(lane));
+        m_scalar.execute();
+        setLaneState(lane, m_scalar.getState());
+        m_tstates[lane] = m_bus.getTstates();
+        m_scalarInstructions++;
+    }
+
+    // Same bits as kFlagTables.sz53n_add
+    static uint8_t sz53(uint8_t value) {
+        return (value & 0xA8) | (value == 0 ? kZero : 0);
+    }
+
+    // Parity bit of kFlagTables.sz53pn_add
+    static uint8_t parity(uint8_t value) {
+        value ^= value >> 4;
+        value ^= value >> 2;
+        value ^= value >> 1;
+        return (value & 1) != 0 ? 0 : kOverflow;
+    }
+
+    // add/adc/sub/sbc/and_/xor_/or_/cp from z80.h, selected by the opcode bits 3-5
+    template <uint32_t kOperation> static void alu(uint8_t& regA, uint8_t& regF, uint8_t oper8) {
+        uint32_t carry = regF & kCarry;
+        if constexpr (kOperation == 0 || kOperation == 1) {
+            uint32_t sum = regA + oper8 + (kOperation == 1 ? carry : 0);
+            auto res = static_cast<uint8_t>(sum);
+            uint8_t half = kOperation == 0 ? ((res & 0x0F) < (regA & 0x0F) ? kHalfCarry : 0)
+                                           : ((regA ^ oper8 ^ res) & kHalfCarry);
+            regF = sz53(res) | half | ((((regA ^ ~oper8) & (regA ^ res)) & 0x80) != 0 ? kOverflow : 0)
+                   | (sum > 0xFF ? kCarry : 0);
+            regA = res;
+        } else if constexpr (kOperation == 2 || kOperation == 3 || kOperation == 7) {
+            int32_t diff = regA - oper8 - (kOperation == 3 ? static_cast<int32_t>(carry) : 0);
+            auto res = static_cast<uint8_t>(diff);
+            uint8_t half = kOperation == 3 ? ((regA ^ oper8 ^ res) & kHalfCarry)
+                                           : ((res & 0x0F) > (regA & 0x0F) ? kHalfCarry : 0);
+            uint8_t overflow = (((regA ^ oper8) & (regA ^ res)) & 0x80) != 0 ? kOverflow : 0;
+            uint8_t borrow = diff < 0 ? kCarry : 0;
+            if constexpr (kOperation == 7) {
+                regF = (oper8 & 0x28) | (sz53(res) & 0xC0) | kAddSub | half | overflow | borrow;
+            } else {
+                regF = sz53(res) | kAddSub | half | overflow | borrow;
+                regA = res;
+            }
+        } else {
+            uint8_t res = kOperation == 4 ? (regA & oper8) : kOperation == 5 ? (regA ^ oper8) : (regA | oper8);
+            regF = sz53(res) | parity(res) | (kOperation == 4 ? kHalfCarry : 0);
+            regA = res;
+        }
+    }
+
+    // Source operand of an opcode: a register or (HL)
+    void readOperand(uint32_t index, Lanes<uint8_t>& value) {
+        if (index == kOperandHL) {
+            for (size_t lane = 0; lane < N; lane++) {
+                value[lane] = laneMemory(lane)[(m_r8[kRegH][lane] << 8) | m_r8[kRegL][lane]];
+            }
+        } else {
+            value = m_r8[index];
+        }
+    }
+
+    void writeOperand(uint32_t index, const Lanes<uint8_t>& mask, const Lanes<uint8_t>& value) {
+        if (index == kOperandHL) {
+            for (size_t lane = 0; lane < N; lane++) {
+                if (mask[lane] != 0) {
+                    laneMemory(lane)[(m_r8[kRegH][lane] << 8) | m_r8[kRegL][lane]] = value[lane];
+                }
+            }
+        } else {
+            Lanes<uint8_t>& reg = m_r8[index];
+            for (size_t lane = 0; lane < N; lane++) {
+                reg[lane] = mask[lane] != 0 ? value[lane] : reg[lane];
+            }
+        }
+    }
+
+    // Immediate operands, read from each lane's own memory
+    void readImmediate8(Lanes<uint8_t>& value) {
+        for (size_t lane = 0; lane < N; lane++) {
+            value[lane] = laneMemory(lane)[static_cast<uint16_t>(m_pc[lane] + 1)];
+        }
+    }
+
+    void readImmediate16(Lanes<uint16_t>& value) {
+        for (size_t lane = 0; lane < N; lane++) {
+            const uint8_t* memory = laneMemory(lane);
+            value[lane] = memory[static_cast<uint16_t>(m_pc[lane] + 1)]
+                          | (memory[static_cast<uint16_t>(m_pc[lane] + 2)] << 8);
+        }
+    }
+
+    // M1 bookkeeping shared by every instruction: R, Q, PC and T-states
+    void finish(const Lanes<uint8_t>& mask, const Lanes<uint16_t>& nextPc, const Lanes<uint8_t>& cycles) {
+        for (size_t lane = 0; lane < N; lane++) {
+            bool on = mask[lane] != 0;
+            uint8_t regR = (m_r[lane] & 0x80) | ((m_r[lane] + 1) & 0x7F);
+            m_r[lane] = on ? regR : m_r[lane];
+            // The scalar core sets Q on every unprefixed instruction
+            m_flagQ[lane] = on ? 1 : m_flagQ[lane];
+            m_lastFlagQ[lane] = on ? 1 : m_lastFlagQ[lane];
+            m_pc[lane] = on ? nextPc[lane] : m_pc[lane];
+            m_tstates[lane] += on ? cycles[lane] : 0;
+        }
+    }
+
+    void finish(const Lanes<uint8_t>& mask, uint16_t length, uint8_t cycles) {
+        Lanes<uint16_t> nextPc;
+        Lanes<uint8_t> laneCycles;
+        for (size_t lane = 0; lane < N; lane++) {
+            nextPc[lane] = m_pc[lane] + length;
+            laneCycles[lane] = cycles;
+        }
+        finish(mask, nextPc, laneCycles);
+    }
+
+    template <uint32_t kOperation> void aluLanes(const Lanes<uint8_t>& mask, const Lanes<uint8_t>& value) {
+        Lanes<uint8_t>& regA = m_r8[kRegA];
+        Lanes<uint8_t>& regF = m_r8[kRegF];
+        for (size_t lane = 0; lane < N; lane++) {
+            uint8_t newA = regA[lane];
+            uint8_t newF = regF[lane];
+            alu<kOperation>(newA, newF, value[lane]);
+            regA[lane] = mask[lane] != 0 ? newA : regA[lane];
+            regF[lane] = mask[lane] != 0 ? newF : regF[lane];
+        }
+    }
+
+    void aluLanes(uint32_t operation, const Lanes<uint8_t>& mask, const Lanes<uint8_t>& value) {
+        switch (operation) {
+            case 0:
+                aluLanes<0>(mask, value);
+                break;
+            case 1:
+                aluLanes<1>(mask, value);
+                break;
+            case 2:
+                aluLanes<2>(mask, value);
+                break;
+            case 3:
+                aluLanes<3>(mask, value);
+                break;
+            case 4:
+                aluLanes<4>(mask, value);
+                break;
+            case 5:
+                aluLanes<5>(mask, value);
+                break;
+            case 6:
+                aluLanes<6>(mask, value);
+                break;
+            default:
+                aluLanes<7>(mask, value);
+                break;
+        }
+    }
+
+    // Condition codes NZ, Z, NC, C, PO, PE, P, M
+    static bool condition(uint32_t code, uint8_t regF) {
+        constexpr std::array<uint8_t, 4> kMasks = {kZero, kCarry, kOverflow, kSign};
+        bool set = (regF & kMasks[code >> 1]) != 0;
+        return (code & 1) != 0 ? set : !set;
+    }
+
+    // Relative jumps: JR e, JR cc,e and DJNZ
+    void jumpRelative(const Lanes<uint8_t>& mask, const Lanes<uint8_t>& taken, uint8_t baseCycles) {
+        Lanes<uint8_t> offset;
+        Lanes<uint16_t> nextPc;
+        Lanes<uint8_t> cycles;
+        readImmediate8(offset);
+        for (size_t lane = 0; lane < N; lane++) {
+            uint16_t target = m_pc[lane] + 2 + static_cast<int8_t>(offset[lane]);
+            bool jump = taken[lane] != 0;
+            nextPc[lane] = jump ? target : static_cast<uint16_t>(m_pc[lane] + 2);
+            m_memptr[lane] = (jump && mask[lane] != 0) ? target : m_memptr[lane];
+            cycles[lane] = jump ? baseCycles + 5 : baseCycles;
+        }
+        finish(mask, nextPc, cycles);
+    }
+
+    // Returns false for opcodes that only the scalar core implements
+    bool executeLanes(uint8_t opCode, const Lanes<uint8_t>& mask) {
+        Lanes<uint8_t> value;
+        uint32_t dest = (opCode >> 3) & 7;
+        uint32_t source = opCode & 7;
+
+        if (opCode == 0x00) { /* NOP */
+            finish(mask, 1, 4);
+            return true;
+        }
+
+        if ((opCode & 0xC0) == 0x40 && opCode != 0x76) { /* LD r,r' */
+            readOperand(source, value);
+            writeOperand(dest, mask, value);
+            finish(mask, 1, 4 + (source == kOperandHL ? 3 : 0) + (dest == kOperandHL ? 3 : 0));
+            return true;
+        }
+
+        if ((opCode & 0xC0) == 0x80) { /* ALU A,r */
+            readOperand(source, value);
+            aluLanes(dest, mask, value);
+            finish(mask, 1, source == kOperandHL ? 7 : 4);
+            return true;
+        }
+
+        switch (opCode & 0xC7) {
+            case 0x06: /* LD r,n */
+                readImmediate8(value);
+                writeOperand(dest, mask, value);
+                finish(mask, 2, dest == kOperandHL ? 10 : 7);
+                return true;
+
+            case 0xC6: /* ALU A,n */
+                readImmediate8(value);
+                aluLanes(dest, mask, value);
+                finish(mask, 2, 7);
+                return true;
+
+            case 0x04: /* INC r */
+            case 0x05: { /* DEC r */
+                bool increment = (opCode & 1) == 0;
+                Lanes<uint8_t>& regF = m_r8[kRegF];
+                readOperand(dest, value);
+                for (size_t lane = 0; lane < N; lane++) {
+                    uint8_t res = increment ? value[lane] + 1 : value[lane] - 1;
+                    uint8_t flags = increment ? (sz53(res) | ((res & 0x0F) == 0 ? kHalfCarry : 0)
+                                                 | (res == 0x80 ? kOverflow : 0))
+                                              : (sz53(res) | kAddSub | ((res & 0x0F) == 0x0F ? kHalfCarry : 0)
+                                                 | (res == 0x7F ? kOverflow : 0));
+                    value[lane] = res;
+                    regF[lane] = mask[lane] != 0 ? static_cast<uint8_t>(flags | (regF[lane] & kCarry)) : regF[lane];
+                }
+                writeOperand(dest, mask, value);
+                finish(mask, 1, dest == kOperandHL ? 11 : 4);
+                return true;
+            }
+
+            case 0xC2: { /* JP cc,nn */
+                Lanes<uint16_t> address;
+                Lanes<uint16_t> nextPc;
+                readImmediate16(address);
+                for (size_t lane = 0; lane < N; lane++) {
+                    nextPc[lane] = condition(dest, m_r8[kRegF][lane]) ? address[lane]
+                                                                      : static_cast<uint16_t>(m_pc[lane] + 3);
+                    m_memptr[lane] = mask[lane] != 0 ? address[lane] : m_memptr[lane];
+                }
+                Lanes<uint8_t> cycles;
+                cycles.fill(10);
+                finish(mask, nextPc, cycles);
+                return true;
+            }
+
+            default:
+                break;
+        }
+
+        switch (opCode & 0xCF) {
+            case 0x01: { /* LD rr,nn */
+                Lanes<uint16_t> word;
+                readImmediate16(word);
+                setPair((opCode >> 4) & 3, mask, word);
+                finish(mask, 3, 10);
+                return true;
+            }
+
+            case 0x03: /* INC rr */
+            case 0x0B: { /* DEC rr */
+                uint32_t pair = (opCode >> 4) & 3;
+                Lanes<uint16_t> word;
+                getPair(pair, word);
+                for (size_t lane = 0; lane < N; lane++) {
+                    word[lane] = (opCode & 0x08) == 0 ? word[lane] + 1 : word[lane] - 1;
+                }
+                setPair(pair, mask, word);
+                finish(mask, 1, 6);
+                return true;
+            }
+
+            default:
+                break;
+        }
+
+        Lanes<uint8_t> taken;
+        switch (opCode) {
+            case 0x10: { /* DJNZ e */
+                Lanes<uint8_t>& regB = m_r8[kRegB];
+                for (size_t lane = 0; lane < N; lane++) {
+                    uint8_t count = regB[lane] - 1;
+                    regB[lane] = mask[lane] != 0 ? count : regB[lane];
+                    taken[lane] = count != 0 ? 1 : 0;
+                }
+                jumpRelative(mask, taken, 8);
+                return true;
+            }
+
+            case 0x18: /* JR e */
+                taken.fill(1);
+                jumpRelative(mask, taken, 7);
+                return true;
+
+            case 0x20: /* JR NZ,e */
+            case 0x28: /* JR Z,e */
+            case 0x30: /* JR NC,e */
+            case 0x38: /* JR C,e */
+                for (size_t lane = 0; lane < N; lane++) {
+                    taken[lane] = condition((opCode >> 3) & 3, m_r8[kRegF][lane]) ? 1 : 0;
+                }
+                jumpRelative(mask, taken, 7);
+                return true;
+
+            case 0xC3: { /* JP nn */
+                Lanes<uint16_t> address;
+                Lanes<uint8_t> cycles;
+                readImmediate16(address);
+                for (size_t lane = 0; lane < N; lane++) {
+                    m_memptr[lane] = mask[lane] != 0 ? address[lane] : m_memptr[lane];
+                }
+                cycles.fill(10);
+                finish(mask, address, cycles);
+                return true;
+            }
+
+            default:
+                return false;
+        }
+    }
+
+    // Register pairs BC, DE, HL and SP, as encoded in opcode bits 4-5
+    void getPair(uint32_t pair, Lanes<uint16_t>& word) const {
+        if (pair == 3) {
+            word = m_sp;
+            return;
+        }
+        for (size_t lane = 0; lane < N; lane++) {
+            word[lane] = (m_r8[pair * 2][lane] << 8) | m_r8[(pair * 2) + 1][lane];
+        }
+    }
+
+    void setPair(uint32_t pair, const Lanes<uint8_t>& mask, const Lanes<uint16_t>& word) {
+        for (size_t lane = 0; lane < N; lane++) {
+            bool on = mask[lane] != 0;
+            if (pair == 3) {
+                m_sp[lane] = on ? word[lane] : m_sp[lane];
+            } else {
+                m_r8[pair * 2][lane] = on ? static_cast<uint8_t>(word[lane] >> 8) : m_r8[pair * 2][lane];
+                m_r8[(pair * 2) + 1][lane] = on ? static_cast<uint8_t>(word[lane]) : m_r8[(pair * 2) + 1][lane];
+            }
+        }
+    }
+};
+
+#endif // Z80_LOCKSTEP_H
@@ -0,0 +1,257 @@
+#ifndef Z80_MACHINE_H
+#define Z80_MACHINE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "z80.h"
+#include "z80_bus_interface.h"
+#include "z80_image.h"
+#include "z80_memory.h"
+
+#ifdef WITH_FLOW_EVENTS
+#    include "z80_interrupt_stats.h"
+#endif
+
+// Tracers with appendWrite(address, value) record the memory writes of each instruction
+template <typename TTracer, typename = void> struct Z80RecordsWrites : std::false_type {};
+
+template <typename TTracer>
+struct Z80RecordsWrites<TTracer, std::void_t<decltype(std::declval<TTracer&>().appendWrite(uint16_t{}, uint8_t{}))>>
+    : std::true_type {};
+
+/* Ready to use machine: a Z80 on a paged memory bus.
+ *
+ * Timing follows the uncontended Z80 memory cycles (4 T-states per opcode
+ * fetch, 3 per memory access, 4 per I/O access). I/O reads return 0xFF and
+ * writes are ignored. ROMs and programs are mapped from files instead of
+ * being copied, see Z80Memory and Z80Image.
+ *
+ * Built with WITH_FLOW_EVENTS, the machine feeds the Z80InterruptStats
+ * given to setInterruptStats() with its flow events and INT line.
+ *
+ * setWriteHook() reports every memory write the CPU makes; runTraced()
+ * uses it to feed tracers that record writes (Z80ColumnTraceWriter).
+ */
+class Z80Machine : public Z80BusInterface<Z80Machine> {
+  public:
+    Z80Machine() : m_cpu(*this) {
+    }
+
+    Z80Machine(const Z80Machine&) = delete;
+    Z80Machine& operator=(const Z80Machine&) = delete;
+    Z80Machine(Z80Machine&&) = delete;
+    Z80Machine& operator=(Z80Machine&&) = delete;
+
+    // Bus Interface Implementation
+    Z80_FORCE_INLINE uint8_t fetchOpcodeImpl(uint16_t address) {
+        m_tstates += 4;
+        return m_memory.read(address);
+    }
+
+    Z80_FORCE_INLINE uint8_t peek8Impl(uint16_t address) {
+        m_tstates += 3;
+        return m_memory.read(address);
+    }
+
+    Z80_FORCE_INLINE void poke8Impl(uint16_t address, uint8_t value) {
+        m_tstates += 3;
+        m_memory.write(address, value);
+        if (m_writeHook != nullptr) {
+            m_writeHook(m_writeContext, address, value);
+        }
+    }
+
+    Z80_FORCE_INLINE uint16_t peek16Impl(uint16_t address) {
+        m_tstates += 6;
+        return m_memory.read16(address);
+    }
+
+    Z80_FORCE_INLINE void poke16Impl(uint16_t address, RegisterPair word) {
+        m_tstates += 6;
+        m_memory.write16(address, word);
+        if (m_writeHook != nullptr) {
+            m_writeHook(m_writeContext, address, word.byte8.lo);
+            m_writeHook(m_writeContext, address + 1, word.byte8.hi);
+        }
+    }
+
+    uint8_t inPortImpl(uint16_t port) {
+        m_tstates += 4;
+        return 0xFF;
+    }
+
+    void outPortImpl(uint16_t port, uint8_t value) {
+        m_tstates += 4;
+    }
+
+    void addressOnBusImpl(uint16_t address, int32_t wstates) {
+        m_tstates += wstates;
+    }
+
+    void interruptHandlingTimeImpl(int32_t wstates) {
+        m_tstates += wstates;
+    }
+
+    [[nodiscard]] bool isActiveINTImpl() const {
+        return m_activeINT;
+    }
+
+#ifdef WITH_FLOW_EVENTS
+    void flowEventImpl(Z80FlowKind kind, uint16_t from, uint16_t to, uint16_t sp) {
+        if (m_interruptStats != nullptr) {
+            m_interruptStats->onFlow(kind, m_tstates, m_cpu.isIFF1());
+        }
+    }
+
+    // Statistics start from the current CPU state; nullptr stops them
+    void setInterruptStats(Z80InterruptStats* stats) {
+        m_interruptStats = stats;
+        if (stats != nullptr) {
+            stats->start(m_tstates, m_cpu.isIFF1(), m_cpu.isHalted());
+            stats->onIntLine(m_activeINT, m_tstates);
+        }
+    }
+
+    [[nodiscard]] Z80InterruptStats* getInterruptStats() const {
+        return m_interruptStats;
+    }
+#endif
+
+    // Map a shared ROM image at 'address'. The same image can be mapped by any number of machines.
+    bool mapRom(uint16_t address, const std::shared_ptr<const Z80Image>& image) {
+        return m_memory.mapReadOnly(address, image);
+    }
+
+    bool mapRom(uint16_t address, const std::string& path) {
+        return mapRom(address, Z80Image::map(path, Z80Image::Access::ReadOnly));
+    }
+
+    // Preload RAM from a file through a private copy-on-write mapping
+    bool preloadRam(uint16_t address, const std::string& path) {
+        return m_memory.mapCopyOnWrite(address, path);
+    }
+
+    // Run until the T-state counter reaches 'limit' or the CPU halts
+    void runUntil(uint64_t limit) {
+        while (m_tstates < limit && !m_cpu.isHalted()) {
+            m_cpu.execute();
+        }
+    }
+
+    /* Like runUntil(), appending every instruction to 'tracer', a
+     * Z80TraceWriter or Z80ColumnTraceWriter. The instruction bytes are
+     * read before execute() so that self-modifying code is traced as it
+     * ran. A tracer with appendWrite() also gets the memory writes of each
+     * instruction, through the write hook, for the run only. */
+    template <typename TTracer> void runTraced(uint64_t limit, TTracer& tracer) {
+        if constexpr (Z80RecordsWrites<TTracer>::value) {
+            setWriteHook(
+                [](void* context, uint16_t address, uint8_t value) {
+                    static_cast<TTracer*>(context)->appendWrite(address, value);
+                },
+                &tracer);
+        }
+        while (m_tstates < limit && !m_cpu.isHalted()) {
+            uint16_t pc = m_cpu.getRegPC();
+            uint64_t start = m_tstates;
+            uint32_t bytes = m_memory.read32(pc);
+            m_cpu.execute();
+            tracer.append(m_cpu, start, pc, bytes);
+        }
+        if constexpr (Z80RecordsWrites<TTracer>::value) {
+            setWriteHook(nullptr, nullptr);
+        }
+    }
+
+    // Like runUntil(), marking every instruction in 'coverage', a Z80Coverage
+    template <typename TCoverage> void runCovered(uint64_t limit, TCoverage& coverage) {
+        while (m_tstates < limit && !m_cpu.isHalted()) {
+            coverage.mark(m_cpu.getRegPC());
+            m_cpu.execute();
+        }
+    }
+
+    // Run for 'quantum' T-states at most and return the number of instructions executed
+    uint64_t runSlice(uint64_t quantum) {
+        uint64_t limit = m_tstates + quantum;
+        uint64_t instructions = 0;
+        while (m_tstates < limit && !m_cpu.isHalted()) {
+            m_cpu.execute();
+            instructions++;
+        }
+        return instructions;
+    }
+
+    /* Back to the power-on state for a new job: cold CPU reset, cleared
+     * memory and T-state counter at zero. Only the pages modified since the
+     * last reset are touched. Returns the number of pages reset. */
+    uint32_t reset() {
+        m_cpu.reset();
+        m_tstates = 0;
+        m_activeINT = false;
+#ifdef WITH_FLOW_EVENTS
+        if (m_interruptStats != nullptr) {
+            m_interruptStats->start(0, false, false);
+        }
+#endif
+        return m_memory.resetModified();
+    }
+
+    // 'hook' is called with 'context' after every memory write; nullptr stops it
+    using WriteHook = void (*)(void* context, uint16_t address, uint8_t value);
+
+    void setWriteHook(WriteHook hook, void* context) {
+        m_writeHook = hook;
+        m_writeContext = context;
+    }
+
+    [[nodiscard]] bool isFinished() const {
+        return m_cpu.isHalted();
+    }
+
+    [[nodiscard]] uint64_t hash() {
+        return z80MachineHash(m_cpu, m_memory);
+    }
+
+    Z80<Z80Machine>& getCpu() {
+        return m_cpu;
+    }
+
+    Z80Memory& getMemory() {
+        return m_memory;
+    }
+
+    [[nodiscard]] uint64_t getTstates() const {
+        return m_tstates;
+    }
+
+    void setTstates(uint64_t tstates) {
+        m_tstates = tstates;
+    }
+
+    void setActiveINT(bool state) {
+#ifdef WITH_FLOW_EVENTS
+        if (m_interruptStats != nullptr) {
+            m_interruptStats->onIntLine(state, m_tstates);
+        }
+#endif
+        m_activeINT = state;
+    }
+
+  private:
+    Z80<Z80Machine> m_cpu;
+    uint64_t m_tstates{0};
+    bool m_activeINT{false};
+    WriteHook m_writeHook{nullptr};
+    void* m_writeContext{nullptr};
+#ifdef WITH_FLOW_EVENTS
+    Z80InterruptStats* m_interruptStats{nullptr};
+#endif
+    Z80Memory m_memory;
+};
+
+#endif // Z80_MACHINE_H
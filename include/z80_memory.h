@@ -0,0 +1,299 @@
+#ifndef Z80_MEMORY_H
+#define Z80_MEMORY_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "z80.h"
+#include "z80_hash.h"
+#include "z80_image.h"
+
+/* Paged 64K memory with dirty-page tracking.
+ *
+ * The address space is split into 256-byte pages. Each page is read through
+ * its own pointer, so a page can live in the memory's own RAM, in a shared
+ * read-only image (ROM) or in a private copy-on-write image (preloaded RAM).
+ * Writes to read-only pages are discarded.
+ *
+ * Every write marks its page as dirty. hash() only rehashes the pages
+ * written since the previous call and keeps the whole-memory hash as an
+ * XOR of per-page contributions, so hashing a machine every frame costs
+ * O(dirty pages) instead of rehashing 64K.
+ *
+ * The same write also marks the page as modified since the last reset,
+ * with a single byte store for both marks. resetModified() brings memory
+ * back to its cleared state in O(modified pages), so a pooled machine can
+ * be reused for a new job without zeroing 64K.
+ *
+ * Buses call read()/write() from their peek8Impl/poke8Impl and
+ * read16()/write16() from peek16Impl/poke16Impl.
+ */
+class Z80Memory {
+  public:
+    static constexpr uint32_t kPageShift = 8;
+    static constexpr uint32_t kPageSize = 1U << kPageShift;
+    static constexpr uint32_t kPageMask = kPageSize - 1;
+    static constexpr uint32_t kPageCount = 0x10000 >> kPageShift;
+
+    Z80Memory() {
+        uint64_t zeroHash = z80HashBytes(m_ram.data(), kPageSize);
+        for (uint32_t page = 0; page < kPageCount; page++) {
+            m_readPage[page] = m_writePage[page] = &m_ram[page << kPageShift];
+            m_pageHash[page] = zeroHash;
+            m_combinedHash ^= pageContribution(page, zeroHash);
+        }
+    }
+
+    // Page pointers refer to the object itself
+    Z80Memory(const Z80Memory&) = delete;
+    Z80Memory& operator=(const Z80Memory&) = delete;
+    Z80Memory(Z80Memory&&) = delete;
+    Z80Memory& operator=(Z80Memory&&) = delete;
+
+    Z80_FORCE_INLINE uint8_t read(uint16_t address) const {
+        return m_readPage[address >> kPageShift][address & kPageMask];
+    }
+
+    Z80_FORCE_INLINE void write(uint16_t address, uint8_t value) {
+        m_writePage[address >> kPageShift][address & kPageMask] = value;
+        m_pageFlags[address >> kPageShift] = kHashStale | kModified;
+    }
+
+    Z80_FORCE_INLINE uint16_t read16(uint16_t address) const {
+        return read(address) | (read(address + 1) << 8);
+    }
+
+    Z80_FORCE_INLINE void write16(uint16_t address, RegisterPair word) {
+        write(address, word.byte8.lo);
+        write(address + 1, word.byte8.hi);
+    }
+
+    // Four bytes, the first one in the low byte; one page lookup unless they cross a page
+    Z80_FORCE_INLINE uint32_t read32(uint16_t address) const {
+        if ((address & kPageMask) > kPageSize - 4) {
+            return read16(address) | (static_cast<uint32_t>(read16(address + 2)) << 16);
+        }
+        const uint8_t* bytes = m_readPage[address >> kPageShift] + (address & kPageMask);
+        return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    }
+
+    // Copy a block into memory, wrapping at 0xFFFF
+    void load(uint16_t address, const uint8_t* data, size_t size) {
+        while (size > 0) {
+            uint32_t page = address >> kPageShift;
+            size_t bytes = std::min<size_t>(size, kPageSize - (address & kPageMask));
+            std::memcpy(m_writePage[page] + (address & kPageMask), data, bytes);
+            m_pageFlags[page] = kHashStale | kModified;
+            address = static_cast<uint16_t>(address + bytes);
+            data += bytes;
+            size -= bytes;
+        }
+    }
+
+    // Copy a block out of memory, wrapping at 0xFFFF
+    void copyTo(uint16_t address, uint8_t* out, size_t size) const {
+        while (size > 0) {
+            size_t bytes = std::min<size_t>(size, kPageSize - (address & kPageMask));
+            std::memcpy(out, m_readPage[address >> kPageShift] + (address & kPageMask), bytes);
+            address = static_cast<uint16_t>(address + bytes);
+            out += bytes;
+            size -= bytes;
+        }
+    }
+
+    // Zero the RAM and drop every mapped image
+    void clear() {
+        m_ram.fill(0);
+        unmap(0, 0x10000);
+        m_images.clear();
+        m_pageFlags.fill(kHashStale);
+    }
+
+    /* Same result as clear(), but only the pages written or mapped since the
+     * last reset are zeroed and pointed back to the own RAM. Returns the
+     * number of pages that had to be reset. */
+    uint32_t resetModified() {
+        uint32_t count = 0;
+        for (uint32_t page = 0; page < kPageCount; page++) {
+            if ((m_pageFlags[page] & kModified) != 0) {
+                std::memset(&m_ram[page << kPageShift], 0, kPageSize);
+                m_readPage[page] = m_writePage[page] = &m_ram[page << kPageShift];
+                m_pageFlags[page] = kHashStale;
+                count++;
+            }
+        }
+        m_images.clear();
+        return count;
+    }
+
+    /* Map a shared read-only image (ROM) at 'address', which must be a
+     * multiple of kPageSize. Full pages point straight into the image; a
+     * trailing partial page is copied into RAM and made read-only too. */
+    bool mapReadOnly(uint16_t address, const std::shared_ptr<const Z80Image>& image, size_t offset = 0,
+                     size_t size = std::numeric_limits<size_t>::max()) {
+        if (!image || !mapPages(address, image->data(), image->size(), offset, size, true)) {
+            return false;
+        }
+        m_images.push_back(image);
+        return true;
+    }
+
+    /* Map the file at 'path' as RAM through a private copy-on-write mapping
+     * of its own (see Z80Image::Access::CopyOnWrite). Pages stay shared with
+     * the page cache until the guest writes them. A private mapping is
+     * copy-on-write per mapping, so the image is not taken from the caller:
+     * two memories sharing one would see each other's writes. */
+    bool mapCopyOnWrite(uint16_t address, const std::string& path, size_t offset = 0,
+                        size_t size = std::numeric_limits<size_t>::max()) {
+        std::shared_ptr<Z80Image> image = Z80Image::map(path, Z80Image::Access::CopyOnWrite);
+        if (!image || image->mutableData() == nullptr
+            || !mapPages(address, image->mutableData(), image->size(), offset, size, false)) {
+            return false;
+        }
+        m_images.push_back(image);
+        return true;
+    }
+
+    // Point the pages in [address, address + size) back to the memory's own RAM
+    void unmap(uint16_t address, size_t size) {
+        uint32_t first = address >> kPageShift;
+        uint32_t last = std::min<size_t>(kPageCount, (address + size + kPageMask) >> kPageShift);
+        for (uint32_t page = first; page < last; page++) {
+            m_readPage[page] = m_writePage[page] = &m_ram[page << kPageShift];
+            m_pageFlags[page] = kHashStale | kModified;
+        }
+    }
+
+    [[nodiscard]] const uint8_t* pageData(uint32_t page) const {
+        return m_readPage[page];
+    }
+
+    [[nodiscard]] bool isPageReadOnly(uint32_t page) const {
+        return m_writePage[page] == m_romSink.data();
+    }
+
+    void markDirty(uint16_t address) {
+        m_pageFlags[address >> kPageShift] |= kHashStale | kModified;
+    }
+
+    void markAllDirty() {
+        for (uint8_t& flags : m_pageFlags) {
+            flags |= kHashStale | kModified;
+        }
+    }
+
+    [[nodiscard]] bool isPageDirty(uint32_t page) const {
+        return (m_pageFlags[page] & kHashStale) != 0;
+    }
+
+    [[nodiscard]] uint32_t dirtyPageCount() const {
+        uint32_t count = 0;
+        for (uint8_t flags : m_pageFlags) {
+            count += flags & kHashStale;
+        }
+        return count;
+    }
+
+    [[nodiscard]] bool isPageModified(uint32_t page) const {
+        return (m_pageFlags[page] & kModified) != 0;
+    }
+
+    [[nodiscard]] uint32_t modifiedPageCount() const {
+        uint32_t count = 0;
+        for (uint8_t flags : m_pageFlags) {
+            count += (flags & kModified) != 0 ? 1 : 0;
+        }
+        return count;
+    }
+
+    // Hash of the whole 64K, refreshing only the pages written since the last call
+    uint64_t hash() {
+        for (uint32_t base = 0; base < kPageCount; base += 8) {
+            uint64_t flags8 = 0;
+            std::memcpy(&flags8, &m_pageFlags[base], sizeof(flags8));
+            if ((flags8 & kHashStale8) == 0) {
+                continue;
+            }
+
+            for (uint32_t page = base; page < base + 8; page++) {
+                if ((m_pageFlags[page] & kHashStale) != 0) {
+                    refreshPage(page);
+                }
+            }
+        }
+        return m_combinedHash;
+    }
+
+  private:
+    // Page flags: the page hash must be recomputed / the page differs from a cleared memory
+    static constexpr uint8_t kHashStale = 0x01;
+    static constexpr uint8_t kModified = 0x02;
+    static constexpr uint64_t kHashStale8 = 0x0101010101010101ULL * kHashStale;
+
+    std::array<const uint8_t*, kPageCount> m_readPage{};
+    std::array<uint8_t*, kPageCount> m_writePage{};
+    std::array<uint8_t, 0x10000> m_ram{};
+    // Writes to read-only pages land here and are never read back
+    std::array<uint8_t, kPageSize> m_romSink{};
+    // kHashStale and kModified bits per page, see above
+    alignas(8) std::array<uint8_t, kPageCount> m_pageFlags{};
+    std::array<uint64_t, kPageCount> m_pageHash{};
+    // Always the XOR of pageContribution() for every cached page hash
+    uint64_t m_combinedHash{0};
+    // Keeps mapped images alive
+    std::vector<std::shared_ptr<const Z80Image>> m_images;
+
+    static uint64_t pageContribution(uint32_t page, uint64_t pageHash) {
+        return z80HashMix(pageHash + (static_cast<uint64_t>(page) + 1) * kZ80HashSeed);
+    }
+
+    bool mapPages(uint16_t address, const uint8_t* data, size_t dataSize, size_t offset, size_t size,
+                  bool readOnly) {
+        if ((address & kPageMask) != 0 || offset > dataSize) {
+            return false;
+        }
+
+        size = std::min({size, dataSize - offset, static_cast<size_t>(0x10000 - address)});
+        for (size_t done = 0; done < size; done += kPageSize) {
+            uint32_t page = (address + done) >> kPageShift;
+            size_t bytes = std::min<size_t>(kPageSize, size - done);
+            uint8_t* ram = &m_ram[page << kPageShift];
+
+            if (bytes == kPageSize) {
+                m_readPage[page] = data + offset + done;
+                // Only reached for CopyOnWrite images, whose data is writable
+                m_writePage[page] = readOnly ? m_romSink.data() : const_cast<uint8_t*>(data + offset + done);
+            } else {
+                // Never read past the end of the image
+                std::memcpy(ram, data + offset + done, bytes);
+                std::memset(ram + bytes, 0, kPageSize - bytes);
+                m_readPage[page] = ram;
+                m_writePage[page] = readOnly ? m_romSink.data() : ram;
+            }
+            m_pageFlags[page] = kHashStale | kModified;
+        }
+        return true;
+    }
+
+    void refreshPage(uint32_t page) {
+        uint64_t newHash = z80HashBytes(m_readPage[page], kPageSize);
+        m_combinedHash ^= pageContribution(page, m_pageHash[page]);
+        m_pageHash[page] = newHash;
+        m_combinedHash ^= pageContribution(page, newHash);
+        m_pageFlags[page] &= ~kHashStale;
+    }
+};
+
+// Fingerprint of a whole machine: CPU state plus RAM. Cost is O(dirty pages).
+template <typename TBusInterface> uint64_t z80MachineHash(const Z80<TBusInterface>& cpu, Z80Memory& memory) {
+    return z80HashCombine(z80HashState(cpu.getState()), memory.hash());
+}
+
+#endif // Z80_MEMORY_H
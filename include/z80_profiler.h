@@ -0,0 +1,173 @@
+#ifndef Z80_PROFILER_H
+#define Z80_PROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "z80_symbols.h"
+#include "z80_types.h"
+
+/* Sampling PC profiler with a shadow call stack, for flame graphs.
+ *
+ * The stack is kept from the flow events of a Z80 built with
+ * WITH_FLOW_EVENTS: the bus forwards flowEventImpl() to onFlow(), and the
+ * run loop calls sample() after every execute() with its T-state counter
+ *
+ *   void flowEventImpl(Z80FlowKind kind, uint16_t from, uint16_t to, uint16_t sp) {
+ *       profiler.onFlow(kind, from, to, sp);
+ *   }
+ *   ...
+ *   cpu.execute();
+ *   profiler.sample(tstates, cpu.getRegPC());
+ *
+ * Every 'sampleInterval' T-states the current stack and PC are recorded.
+ * sample() is a single compare between samples.
+ *
+ * Frames are matched by SP rather than by counting: a return drops every
+ * frame whose return address lies below the new SP, so code that
+ * discards its return address (POP + JP, LD SP,nn) does not leave stale
+ * frames behind for longer than the next return. A return that takes its
+ * address from 0xFFFE or 0xFFFF leaves SP at 0 or 1 after wrapping, and is
+ * compared as SP + 0x10000. Frames deeper than 'maxDepth' are not tracked.
+ *
+ * writeFolded() writes one "frame;frame;...;leaf count" line per stack,
+ * the input of flamegraph.pl, inferno or speedscope.
+ */
+class Z80Profiler {
+  public:
+    struct Frame {
+        uint16_t entry;
+        // SP once the return address was pushed
+        uint16_t sp;
+        Z80FlowKind kind;
+    };
+
+    explicit Z80Profiler(uint32_t sampleInterval = 1000, size_t maxDepth = 256)
+        : m_sampleInterval(sampleInterval == 0 ? 1 : sampleInterval), m_maxDepth(maxDepth),
+          m_nextSample(m_sampleInterval) {
+        m_stack.reserve(maxDepth);
+    }
+
+    void onFlow(Z80FlowKind kind, uint16_t from, uint16_t to, uint16_t sp) {
+        switch (kind) {
+            case Z80FlowKind::Call:
+            case Z80FlowKind::Rst:
+            case Z80FlowKind::Interrupt:
+            case Z80FlowKind::Nmi:
+                // The return address overwrote whatever frames lived at or below it
+                unwind(sp + 1);
+                if (m_stack.size() < m_maxDepth) {
+                    m_stack.push_back({to, sp, kind});
+                } else {
+                    m_dropped++;
+                }
+                break;
+            case Z80FlowKind::Ret:
+            case Z80FlowKind::Reti:
+            case Z80FlowKind::Retn:
+                // SP wrapped past 0xFFFF popping the return address
+                unwind(sp < 2 ? sp + 0x10000U : sp);
+                break;
+            case Z80FlowKind::Halt:
+            case Z80FlowKind::Di:
+            case Z80FlowKind::Ei:
+                break;
+        }
+    }
+
+    Z80_FORCE_INLINE void sample(uint64_t tstates, uint16_t pc) {
+        if (Z80_UNLIKELY(tstates >= m_nextSample)) {
+            record(tstates, pc);
+        }
+    }
+
+    // Folded stacks; without symbols frames are entry addresses and leaves are PCs
+    void writeFolded(std::ostream& out, const Z80SymbolMap* symbols = nullptr) const {
+        std::map<std::string, uint64_t> folded;
+        for (const auto& [key, count] : m_samples) {
+            std::string line;
+            std::string last;
+            for (size_t idx = 0; idx + 1 < key.size(); idx++) {
+                auto kind = static_cast<Z80FlowKind>(key[idx] >> 16);
+                last = name(static_cast<uint16_t>(key[idx]), symbols);
+                line += (idx == 0 ? "" : ";") + prefix(kind) + last;
+            }
+            // Time spent in the body of the innermost routine is not split further
+            std::string leaf = name(static_cast<uint16_t>(key.back()), symbols);
+            if (leaf != last || key.size() == 1) {
+                line += (key.size() == 1 ? "" : ";") + leaf;
+            }
+            folded[line] += count;
+        }
+        for (const auto& [line, count] : folded) {
+            out << line << ' ' << count << '\n';
+        }
+    }
+
+    [[nodiscard]] uint64_t getSamples() const {
+        return m_sampleCount;
+    }
+
+    [[nodiscard]] const std::vector<Frame>& getStack() const {
+        return m_stack;
+    }
+
+    // Calls not tracked because the stack was 'maxDepth' deep
+    [[nodiscard]] uint64_t getDropped() const {
+        return m_dropped;
+    }
+
+    void reset() {
+        m_stack.clear();
+        m_samples.clear();
+        m_sampleCount = 0;
+        m_dropped = 0;
+        m_nextSample = m_sampleInterval;
+    }
+
+  private:
+    uint32_t m_sampleInterval;
+    size_t m_maxDepth;
+    uint64_t m_nextSample;
+    uint64_t m_sampleCount{0};
+    uint64_t m_dropped{0};
+    std::vector<Frame> m_stack;
+    // Frame entries (kind << 16 | entry) followed by the PC
+    std::vector<uint32_t> m_key;
+    std::map<std::vector<uint32_t>, uint64_t> m_samples;
+
+    void unwind(uint32_t sp) {
+        while (!m_stack.empty() && m_stack.back().sp < sp) {
+            m_stack.pop_back();
+        }
+    }
+
+    void record(uint64_t tstates, uint16_t pc) {
+        m_key.clear();
+        for (const Frame& frame : m_stack) {
+            m_key.push_back(static_cast<uint32_t>(frame.kind) << 16 | frame.entry);
+        }
+        m_key.push_back(pc);
+        m_samples[m_key]++;
+        m_sampleCount++;
+        // An instruction longer than the interval still yields one sample
+        m_nextSample = tstates - tstates % m_sampleInterval + m_sampleInterval;
+    }
+
+    static std::string name(uint16_t address, const Z80SymbolMap* symbols) {
+        return symbols != nullptr ? symbols->name(address) : Z80SymbolMap::hexAddress(address);
+    }
+
+    static std::string prefix(Z80FlowKind kind) {
+        if (kind == Z80FlowKind::Interrupt) {
+            return "[int] ";
+        }
+        return kind == Z80FlowKind::Nmi ? "[nmi] " : "";
+    }
+};
+
+#endif // Z80_PROFILER_H
@@ -0,0 +1,198 @@
+#ifndef Z80_SPSC_H
+#define Z80_SPSC_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// What a push does with items that do not fit in the ring
+enum class Z80DropPolicy : uint8_t {
+    DropNewest, // Keep what fits, drop the rest of the batch
+    DropBatch   // Drop the whole batch unless all of it fits
+};
+
+// An OUT instruction as seen by the bus, for consumers on other threads
+struct Z80PortEvent {
+    uint64_t tstates;
+    uint16_t port;
+    uint8_t value;
+};
+
+/* Single-producer/single-consumer ring buffer.
+ *
+ * Both ends are wait-free: a push or pop is a bounded number of loads and
+ * stores, and never waits for the other side. When the ring is full the
+ * producer drops items according to the drop policy and counts them, so
+ * the emulation thread never blocks on a slow consumer. The producer and
+ * consumer indices live on separate cache lines, each with a cached copy
+ * of the other side's index, so that the two threads only share a line
+ * when the ring runs empty or full.
+ *
+ * Typical use: the bus pushes Z80PortEvents from outPortImpl() and a
+ * frontend thread pops them; a second ring carries input the other way.
+ * Z80PortChannels below packages that pair.
+ */
+template <typename T, size_t Capacity> class Z80SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "Ring items are copied with plain stores");
+
+  public:
+    explicit Z80SpscRing(Z80DropPolicy policy = Z80DropPolicy::DropNewest) : m_policy(policy) {
+    }
+
+    Z80SpscRing(const Z80SpscRing&) = delete;
+    Z80SpscRing& operator=(const Z80SpscRing&) = delete;
+
+    static constexpr size_t capacity() {
+        return Capacity;
+    }
+
+    // Producer side
+
+    bool tryPush(const T& item) {
+        return pushBatch(&item, 1) == 1;
+    }
+
+    // Returns the number of items accepted, the rest are counted as dropped
+    size_t pushBatch(const T* items, size_t count) {
+        size_t tail = m_producer.index.load(std::memory_order_relaxed);
+        size_t space = Capacity - (tail - m_producer.cachedOther);
+        if (space < count) {
+            m_producer.cachedOther = m_consumer.index.load(std::memory_order_acquire);
+            space = Capacity - (tail - m_producer.cachedOther);
+        }
+
+        size_t accepted = std::min(space, count);
+        if (m_policy == Z80DropPolicy::DropBatch && accepted < count) {
+            accepted = 0;
+        }
+        for (size_t idx = 0; idx < accepted; idx++) {
+            m_items[(tail + idx) & kMask] = items[idx];
+        }
+        if (accepted > 0) {
+            m_producer.index.store(tail + accepted, std::memory_order_release);
+        }
+        if (accepted < count) {
+            m_dropped.store(m_dropped.load(std::memory_order_relaxed) + (count - accepted), std::memory_order_relaxed);
+        }
+        return accepted;
+    }
+
+    // Consumer side
+
+    bool tryPop(T& item) {
+        return popBatch(&item, 1) == 1;
+    }
+
+    // Returns the number of items copied to 'out', at most 'maxCount'
+    size_t popBatch(T* out, size_t maxCount) {
+        size_t head = m_consumer.index.load(std::memory_order_relaxed);
+        size_t available = m_consumer.cachedOther - head;
+        if (available < maxCount) {
+            m_consumer.cachedOther = m_producer.index.load(std::memory_order_acquire);
+            available = m_consumer.cachedOther - head;
+        }
+
+        size_t count = std::min(available, maxCount);
+        for (size_t idx = 0; idx < count; idx++) {
+            out[idx] = m_items[(head + idx) & kMask];
+        }
+        if (count > 0) {
+            m_consumer.index.store(head + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // Either side; only a snapshot while the other side is running
+    [[nodiscard]] size_t size() const {
+        return m_producer.index.load(std::memory_order_acquire) - m_consumer.index.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool empty() const {
+        return size() == 0;
+    }
+
+    [[nodiscard]] uint64_t getDropped() const {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] Z80DropPolicy getPolicy() const {
+        return m_policy;
+    }
+
+  private:
+    static constexpr size_t kMask = Capacity - 1;
+
+    // One side's own index and its cached copy of the other side's index
+    struct alignas(64) End {
+        std::atomic<size_t> index{0};
+        size_t cachedOther{0};
+    };
+
+    End m_producer;
+    End m_consumer;
+    // Written by the producer only
+    alignas(64) std::atomic<uint64_t> m_dropped{0};
+    Z80DropPolicy m_policy;
+    alignas(64) std::array<T, Capacity> m_items{};
+};
+
+/* The two channels between a bus and a frontend thread: OUT writes go out
+ * as Z80PortEvents, input state comes back as bytes. A bus keeps one as a
+ * member and forwards to it:
+ *
+ *     void outPortImpl(uint16_t port, uint8_t value) {
+ *         tstates += 4;
+ *         channels.outPort(tstates, port, value);
+ *     }
+ *
+ *     uint8_t inPortImpl(uint16_t port) {
+ *         tstates += 4;
+ *         return channels.inPort();
+ *     }
+ *
+ * The frontend pops events() and calls pushInput(). A single input state
+ * answers every port; buses that decode ports keep one adapter per device.
+ */
+template <size_t EventCapacity = 256, size_t InputCapacity = 16> class Z80PortChannels {
+  public:
+    explicit Z80PortChannels(Z80DropPolicy policy = Z80DropPolicy::DropNewest, uint8_t idleInput = 0xFF)
+        : m_events(policy), m_inputState(idleInput) {
+    }
+
+    // Emulation thread
+
+    void outPort(uint64_t tstates, uint16_t port, uint8_t value) {
+        m_events.tryPush({tstates, port, value});
+    }
+
+    // Drains the input ring, the latest state wins
+    uint8_t inPort() {
+        uint8_t value = 0;
+        while (m_input.tryPop(value)) {
+            m_inputState = value;
+        }
+        return m_inputState;
+    }
+
+    // Frontend thread
+
+    Z80SpscRing<Z80PortEvent, EventCapacity>& events() {
+        return m_events;
+    }
+
+    bool pushInput(uint8_t state) {
+        return m_input.tryPush(state);
+    }
+
+  private:
+    Z80SpscRing<Z80PortEvent, EventCapacity> m_events;
+    Z80SpscRing<uint8_t, InputCapacity> m_input;
+    // Written by the emulation thread only
+    uint8_t m_inputState;
+};
+
+#endif // Z80_SPSC_H
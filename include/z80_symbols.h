@@ -0,0 +1,165 @@
+#ifndef Z80_SYMBOLS_H
+#define Z80_SYMBOLS_H
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/* Address to label map read from assembler symbol files.
+ *
+ * One symbol per line, in any of the usual forms:
+ *
+ *   label: EQU 0x1234        sjasmplus --sym
+ *   label EQU 1234H          pasmo, zmac
+ *   label = $1234 ; ...      z88dk .map
+ *   1234 label               two columns, the address in hex
+ *
+ * Numbers may be written 0x1234, $1234, #1234, &1234 or 1234H; bare
+ * digits are decimal after EQU/= and hex in the two column form. Text after
+ * ';' is a comment. Values above 0xFFFF are skipped, and when several
+ * labels share an address the first one wins. Constants defined with EQU
+ * look like labels and are kept too.
+ */
+class Z80SymbolMap {
+  public:
+    // Adds the symbols of 'path'; false if it cannot be opened
+    bool load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            return false;
+        }
+        parse(file);
+        return true;
+    }
+
+    // Returns the number of symbols added
+    size_t parse(std::istream& in) {
+        size_t added = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            if (parseLine(line)) {
+                added++;
+            }
+        }
+        return added;
+    }
+
+    // Returns false if 'address' already has a label
+    bool add(uint16_t address, const std::string& name) {
+        return m_labels.emplace(address, name).second;
+    }
+
+    // Nearest label at or below 'address', nullptr if there is none
+    [[nodiscard]] const std::string* lookup(uint16_t address) const {
+        auto label = m_labels.upper_bound(address);
+        if (label == m_labels.begin()) {
+            return nullptr;
+        }
+        return &std::prev(label)->second;
+    }
+
+    // Label for 'address', "0x1234" if it has none below
+    [[nodiscard]] std::string name(uint16_t address) const {
+        const std::string* label = lookup(address);
+        return label != nullptr ? *label : hexAddress(address);
+    }
+
+    [[nodiscard]] size_t size() const {
+        return m_labels.size();
+    }
+
+    // Every label, in address order
+    [[nodiscard]] const std::map<uint16_t, std::string>& getLabels() const {
+        return m_labels;
+    }
+
+    static std::string hexAddress(uint16_t address) {
+        static constexpr char kDigits[] = "0123456789abcdef";
+        return {'0', 'x', kDigits[address >> 12], kDigits[(address >> 8) & 0x0F], kDigits[(address >> 4) & 0x0F],
+                kDigits[address & 0x0F]};
+    }
+
+  private:
+    std::map<uint16_t, std::string> m_labels;
+
+    bool parseLine(std::string line) {
+        line = line.substr(0, line.find(';'));
+        bool assignment = line.find('=') != std::string::npos;
+        for (char& chr : line) {
+            if (chr == ':' || chr == '=' || chr == ',') {
+                chr = ' ';
+            }
+        }
+        std::istringstream words(line);
+        std::vector<std::string> tokens;
+        for (std::string token; words >> token;) {
+            tokens.push_back(token);
+        }
+
+        uint32_t value = 0;
+        if (tokens.size() >= 3 && upper(tokens[1]) == "EQU") {
+            if (!parseNumber(tokens[2], false, value)) {
+                return false;
+            }
+        } else if (tokens.size() >= 2 && parseNumber(tokens[1], !assignment, value) && isName(tokens[0])) {
+            // label = value, or label value
+        } else if (tokens.size() >= 2 && parseNumber(tokens[0], true, value) && isName(tokens[1])) {
+            std::swap(tokens[0], tokens[1]);
+        } else {
+            return false;
+        }
+        return value <= 0xFFFF && isName(tokens[0]) && add(static_cast<uint16_t>(value), tokens[0]);
+    }
+
+    static bool isName(const std::string& token) {
+        return !token.empty() && (std::isalpha(static_cast<unsigned char>(token[0])) != 0 || token[0] == '_'
+                                  || token[0] == '.' || token[0] == '@');
+    }
+
+    static std::string upper(std::string token) {
+        for (char& chr : token) {
+            chr = static_cast<char>(std::toupper(static_cast<unsigned char>(chr)));
+        }
+        return token;
+    }
+
+    static bool parseNumber(const std::string& token, bool bareHex, uint32_t& value) {
+        std::string digits = token;
+        int base = bareHex ? 16 : 10;
+        if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+            digits = digits.substr(2);
+            base = 16;
+        } else if (digits.size() > 1 && (digits[0] == '$' || digits[0] == '#' || digits[0] == '&')) {
+            digits = digits.substr(1);
+            base = 16;
+        } else if (digits.size() > 1 && (digits.back() == 'h' || digits.back() == 'H')) {
+            digits.pop_back();
+            base = 16;
+        }
+        if (digits.empty() || digits.size() > 8) {
+            return false;
+        }
+        value = 0;
+        for (char chr : digits) {
+            int digit = std::isdigit(static_cast<unsigned char>(chr)) != 0
+                            ? chr - '0'
+                            : (std::isxdigit(static_cast<unsigned char>(chr)) != 0
+                                   ? std::tolower(static_cast<unsigned char>(chr)) - 'a' + 10
+                                   : base);
+            if (digit >= base) {
+                return false;
+            }
+            value = value * base + digit;
+        }
+        return true;
+    }
+};
+
+#endif // Z80_SYMBOLS_H
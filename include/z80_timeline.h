@@ -0,0 +1,306 @@
+#ifndef Z80_TIMELINE_H
+#define Z80_TIMELINE_H
+
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "z80_types.h"
+
+/* Buffered writer of Chrome trace event JSON, which chrome://tracing and
+ * the Perfetto UI open as they are.
+ *
+ * Events are formatted into a string that goes to the file every
+ * 'bufferSize' bytes, so the caller never waits on the disk for a single
+ * event. Timestamps and durations are microseconds of host time, see
+ * nowMicros(). Tracks are the threads of a single process and get their
+ * names from nameTrack(). Event arguments are numeric.
+ */
+class Z80ChromeTraceWriter {
+  public:
+    using Args = std::initializer_list<std::pair<std::string_view, uint64_t>>;
+
+    explicit Z80ChromeTraceWriter(const std::string& path, size_t bufferSize = 1 << 16)
+        : m_file(path, std::ios::binary | std::ios::trunc), m_bufferSize(bufferSize),
+          m_start(std::chrono::steady_clock::now()), m_failed(!m_file.is_open()) {
+        m_buffer.reserve(m_bufferSize + 512);
+        m_buffer += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    }
+
+    Z80ChromeTraceWriter(const Z80ChromeTraceWriter&) = delete;
+    Z80ChromeTraceWriter& operator=(const Z80ChromeTraceWriter&) = delete;
+    Z80ChromeTraceWriter(Z80ChromeTraceWriter&&) = delete;
+    Z80ChromeTraceWriter& operator=(Z80ChromeTraceWriter&&) = delete;
+
+    ~Z80ChromeTraceWriter() {
+        close();
+    }
+
+    // Host time since the writer was created
+    [[nodiscard]] double nowMicros() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+    void nameTrack(uint32_t track, std::string_view name) {
+        open("M", "thread_name", "", track);
+        m_buffer += ",\"args\":{\"name\":\"";
+        escape(name);
+        m_buffer += "\"}";
+        finish();
+    }
+
+    // A slice of 'duration' microseconds from 'start'
+    void complete(std::string_view name, std::string_view category, uint32_t track, double start, double duration,
+                  Args args = {}) {
+        open("X", name, category, track);
+        number(",\"ts\":", start);
+        number(",\"dur\":", duration);
+        arguments(args);
+        finish();
+    }
+
+    void instant(std::string_view name, std::string_view category, uint32_t track, double timestamp, Args args = {}) {
+        open("i", name, category, track);
+        number(",\"ts\":", timestamp);
+        m_buffer += ",\"s\":\"t\"";
+        arguments(args);
+        finish();
+    }
+
+    // One sample of the counter track 'name'
+    void counter(std::string_view name, double timestamp, uint64_t value) {
+        open("C", name, "", 0);
+        number(",\"ts\":", timestamp);
+        m_buffer += ",\"args\":{\"value\":";
+        integer(value);
+        m_buffer += '}';
+        finish();
+    }
+
+    // Completes the JSON and flushes it; false if any write failed
+    bool close() {
+        if (!m_file.is_open()) {
+            return !m_failed;
+        }
+        m_buffer += "\n]}\n";
+        flush();
+        m_file.close();
+        return !m_failed;
+    }
+
+    [[nodiscard]] bool good() const {
+        return !m_failed;
+    }
+
+    [[nodiscard]] uint64_t getEvents() const {
+        return m_events;
+    }
+
+  private:
+    std::ofstream m_file;
+    size_t m_bufferSize;
+    std::chrono::steady_clock::time_point m_start;
+    std::string m_buffer;
+    uint64_t m_events{0};
+    bool m_failed{false};
+
+    void open(std::string_view phase, std::string_view name, std::string_view category, uint32_t track) {
+        m_buffer += m_events == 0 ? "\n{\"ph\":\"" : ",\n{\"ph\":\"";
+        m_buffer += phase;
+        m_buffer += "\",\"name\":\"";
+        escape(name);
+        if (!category.empty()) {
+            m_buffer += "\",\"cat\":\"";
+            escape(category);
+        }
+        m_buffer += "\",\"pid\":1,\"tid\":";
+        integer(track);
+    }
+
+    void arguments(Args args) {
+        if (args.size() == 0) {
+            return;
+        }
+        char separator = '{';
+        m_buffer += ",\"args\":";
+        for (const auto& [key, value] : args) {
+            m_buffer += separator;
+            m_buffer += '"';
+            escape(key);
+            m_buffer += "\":";
+            integer(value);
+            separator = ',';
+        }
+        m_buffer += '}';
+    }
+
+    void number(std::string_view key, double value) {
+        char text[64];
+        auto result = std::to_chars(text, text + sizeof(text), value, std::chars_format::fixed, 3);
+        m_buffer += key;
+        m_buffer.append(text, result.ptr);
+    }
+
+    void integer(uint64_t value) {
+        char text[24];
+        auto result = std::to_chars(text, text + sizeof(text), value);
+        m_buffer.append(text, result.ptr);
+    }
+
+    void escape(std::string_view text) {
+        for (char chr : text) {
+            if (chr == '"' || chr == '\\') {
+                m_buffer += '\\';
+                m_buffer += chr;
+            } else if (static_cast<unsigned char>(chr) < 0x20) {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", chr);
+                m_buffer += code;
+            } else {
+                m_buffer += chr;
+            }
+        }
+    }
+
+    void finish() {
+        m_buffer += '}';
+        m_events++;
+        if (m_buffer.size() >= m_bufferSize) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (m_file.is_open()) {
+            m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+            m_failed = m_failed || !m_file.good();
+        }
+        m_buffer.clear();
+    }
+};
+
+/* Host side timeline of an emulation loop, on a Z80ChromeTraceWriter.
+ *
+ * The loop brackets every frame with beginFrame()/endFrame() and the bus
+ * of a Z80 built with WITH_FLOW_EVENTS forwards flow events with its
+ * T-state counter
+ *
+ *   void flowEventImpl(Z80FlowKind kind, uint16_t from, uint16_t to, uint16_t sp) {
+ *       timeline.onFlow(kind, to, tstates);
+ *   }
+ *
+ * The "emulation" track gets a slice per frame with the HALT periods
+ * nested in it and an instant per INT and NMI acknowledge. The "host"
+ * track gets the stalls the loop reports (waiting for audio, vsync, a
+ * full writer queue...), and counter() plots per-frame values such as
+ * memory accesses to spot bus-heavy phases. Frames that take longer than
+ * 'budgetMicros' of host time are marked with an "over budget" instant.
+ * Every event carries the emulated T-state it happened at, so a slow frame
+ * can be matched with the code that ran in it.
+ */
+class Z80Timeline {
+  public:
+    static constexpr uint32_t kEmulationTrack = 1;
+    static constexpr uint32_t kHostTrack = 2;
+
+    explicit Z80Timeline(Z80ChromeTraceWriter& writer, double budgetMicros = 20000)
+        : m_writer(writer), m_budgetMicros(budgetMicros) {
+        m_writer.nameTrack(kEmulationTrack, "emulation");
+        m_writer.nameTrack(kHostTrack, "host");
+    }
+
+    void beginFrame(uint64_t tstates) {
+        m_frameStart = m_writer.nowMicros();
+        m_frameTstates = tstates;
+        m_interrupts = 0;
+        if (m_halted) {
+            m_haltStart = m_frameStart;
+            m_haltTstates = tstates;
+        }
+    }
+
+    void endFrame(uint64_t tstates) {
+        double now = m_writer.nowMicros();
+        // A HALT still waiting goes on in the next frame
+        if (m_halted) {
+            endHalt(now, tstates);
+            m_halted = true;
+        }
+        double duration = now - m_frameStart;
+        m_writer.complete("frame", "emulation", kEmulationTrack, m_frameStart, duration,
+                          {{"frame", m_frames}, {"tstates", m_frameTstates}, {"length", tstates - m_frameTstates},
+                           {"interrupts", m_interrupts}});
+        if (duration > m_budgetMicros) {
+            m_writer.instant("over budget", "emulation", kEmulationTrack, now, {{"frame", m_frames}});
+            m_overBudget++;
+        }
+        m_frames++;
+    }
+
+    void onFlow(Z80FlowKind kind, uint16_t to, uint64_t tstates) {
+        switch (kind) {
+            case Z80FlowKind::Halt:
+                m_halted = true;
+                m_haltStart = m_writer.nowMicros();
+                m_haltTstates = tstates;
+                break;
+            case Z80FlowKind::Interrupt:
+            case Z80FlowKind::Nmi: {
+                double now = m_writer.nowMicros();
+                if (m_halted) {
+                    endHalt(now, tstates);
+                }
+                m_writer.instant(kind == Z80FlowKind::Interrupt ? "INT" : "NMI", "emulation", kEmulationTrack, now,
+                                 {{"tstates", tstates}, {"handler", to}});
+                m_interrupts++;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    // A host stall that started at 'start' (nowMicros() of the writer) and ends now
+    void stall(std::string_view name, double start) {
+        m_writer.complete(name, "host", kHostTrack, start, m_writer.nowMicros() - start);
+    }
+
+    void counter(std::string_view name, uint64_t value) {
+        m_writer.counter(name, m_writer.nowMicros(), value);
+    }
+
+    [[nodiscard]] uint64_t getFrames() const {
+        return m_frames;
+    }
+
+    [[nodiscard]] uint64_t getOverBudget() const {
+        return m_overBudget;
+    }
+
+  private:
+    Z80ChromeTraceWriter& m_writer;
+    double m_budgetMicros;
+    double m_frameStart{0};
+    uint64_t m_frameTstates{0};
+    uint64_t m_frames{0};
+    uint64_t m_interrupts{0};
+    uint64_t m_overBudget{0};
+    bool m_halted{false};
+    double m_haltStart{0};
+    uint64_t m_haltTstates{0};
+
+    void endHalt(double now, uint64_t tstates) {
+        m_writer.complete("HALT", "emulation", kEmulationTrack, m_haltStart, now - m_haltStart,
+                          {{"tstates", m_haltTstates}, {"length", tstates - m_haltTstates}});
+        m_halted = false;
+    }
+};
+
+#endif // Z80_TIMELINE_H
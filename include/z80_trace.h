@@ -0,0 +1,443 @@
+#ifndef Z80_TRACE_H
+#define Z80_TRACE_H
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "z80_encoding.h"
+#include "z80_types.h"
+
+/* One executed instruction: where it was, its first bytes and the
+ * registers it left behind. Fixed size, written in place into the block
+ * being filled by Z80TraceWriter::append(). */
+struct Z80TraceRecord {
+    uint64_t tstates; // T-state counter before the instruction
+    uint16_t pc;
+    uint16_t af, bc, de, hl, ix, iy, sp;
+    uint32_t bytes; // Up to four bytes at pc, the first one in the low byte
+    uint8_t r;
+    uint8_t status; // IFF1 | IFF2 << 1 | halted << 2 | IM << 3
+    uint16_t reserved;
+
+    bool operator==(const Z80TraceRecord& other) const {
+        return tstates == other.tstates && pc == other.pc && af == other.af && bc == other.bc && de == other.de
+               && hl == other.hl && ix == other.ix && iy == other.iy && sp == other.sp && bytes == other.bytes
+               && r == other.r && status == other.status;
+    }
+};
+
+static_assert(sizeof(Z80TraceRecord) == 32, "Trace records are half a cache line");
+
+/* Fill 'record' for the instruction at 'pc' that 'cpu' has just executed.
+ * The registers come from one getState() copy rather than a getter each;
+ * once inlined, the fields the record does not keep are never stored. */
+template <typename TCpu>
+Z80_FORCE_INLINE void z80CaptureTrace(Z80TraceRecord& record, const TCpu& cpu, uint64_t tstates, uint16_t pc,
+                                      uint32_t bytes) {
+    const Z80State state = cpu.getState();
+    record.tstates = tstates;
+    record.pc = pc;
+    record.af = state.af;
+    record.bc = state.bc;
+    record.de = state.de;
+    record.hl = state.hl;
+    record.ix = state.ix;
+    record.iy = state.iy;
+    record.sp = state.sp;
+    record.bytes = bytes;
+    record.r = state.r;
+    record.status = static_cast<uint8_t>((state.iff1 ? 0x01 : 0) | (state.iff2 ? 0x02 : 0) | (state.halted ? 0x04 : 0)
+                                         | (state.im << 3));
+    record.reserved = 0;
+}
+
+/* Block compression of trace records.
+ *
+ * Each record is stored against the previous one: a varint mask of the
+ * fields that changed, the T-state and PC deltas, then only the changed
+ * fields. Registers are zigzag varint deltas. Instruction bytes are
+ * compared with the last ones seen at the same PC, so a loop costs no
+ * instruction bytes after its first pass and self-modifying code is still
+ * recorded. Blocks start from a zeroed state and decode on their own.
+ *
+ * A typical record takes 4 to 8 bytes instead of 32.
+ */
+class Z80TraceCodec {
+  public:
+    // Field bits of the per-record mask, the common ones fit in its first byte
+    enum : uint32_t {
+        kBytes = 1U << 0,
+        kAF = 1U << 1,
+        kBC = 1U << 2,
+        kDE = 1U << 3,
+        kHL = 1U << 4,
+        kSP = 1U << 5,
+        kR = 1U << 6,
+        kIX = 1U << 7,
+        kIY = 1U << 8,
+        kStatus = 1U << 9,
+    };
+
+    void encode(const Z80TraceRecord* records, size_t count, std::vector<uint8_t>& out) {
+        std::fill(m_lastBytes.begin(), m_lastBytes.end(), kNoBytes);
+        Z80TraceRecord prev{};
+        for (size_t idx = 0; idx < count; idx++) {
+            const Z80TraceRecord& rec = records[idx];
+            uint32_t mask = m_lastBytes[rec.pc] != rec.bytes ? kBytes : 0;
+            mask |= changed(rec.af, prev.af, kAF) | changed(rec.bc, prev.bc, kBC) | changed(rec.de, prev.de, kDE)
+                    | changed(rec.hl, prev.hl, kHL) | changed(rec.sp, prev.sp, kSP) | changed(rec.ix, prev.ix, kIX)
+                    | changed(rec.iy, prev.iy, kIY);
+            mask |= (rec.r != prev.r ? kR : 0) | (rec.status != prev.status ? kStatus : 0);
+
+            z80PutVarint(out, mask);
+            z80PutVarint(out, rec.tstates - prev.tstates);
+            putDelta(out, rec.pc, prev.pc);
+            if ((mask & kBytes) != 0) {
+                for (int shift = 0; shift < 32; shift += 8) {
+                    out.push_back(static_cast<uint8_t>(rec.bytes >> shift));
+                }
+                m_lastBytes[rec.pc] = rec.bytes;
+            }
+            putField(out, mask, kAF, rec.af, prev.af);
+            putField(out, mask, kBC, rec.bc, prev.bc);
+            putField(out, mask, kDE, rec.de, prev.de);
+            putField(out, mask, kHL, rec.hl, prev.hl);
+            putField(out, mask, kSP, rec.sp, prev.sp);
+            if ((mask & kR) != 0) {
+                out.push_back(static_cast<uint8_t>(rec.r - prev.r));
+            }
+            putField(out, mask, kIX, rec.ix, prev.ix);
+            putField(out, mask, kIY, rec.iy, prev.iy);
+            if ((mask & kStatus) != 0) {
+                out.push_back(rec.status);
+            }
+            prev = rec;
+        }
+    }
+
+    // Returns false if 'data' does not hold exactly 'count' records
+    bool decode(const uint8_t* data, size_t size, size_t count, std::vector<Z80TraceRecord>& out) {
+        std::fill(m_lastBytes.begin(), m_lastBytes.end(), kNoBytes);
+        const uint8_t* pos = data;
+        const uint8_t* end = data + size;
+        Z80TraceRecord prev{};
+        for (size_t idx = 0; idx < count; idx++) {
+            Z80TraceRecord rec = prev;
+            uint64_t mask = 0;
+            uint64_t tstates = 0;
+            if (!z80GetVarint(pos, end, mask) || !z80GetVarint(pos, end, tstates) || !getDelta(pos, end, rec.pc)) {
+                return false;
+            }
+            rec.tstates = prev.tstates + tstates;
+            if ((mask & kBytes) != 0) {
+                if (end - pos < 4) {
+                    return false;
+                }
+                rec.bytes = pos[0] | (pos[1] << 8) | (pos[2] << 16) | (static_cast<uint32_t>(pos[3]) << 24);
+                pos += 4;
+                m_lastBytes[rec.pc] = rec.bytes;
+            } else {
+                rec.bytes = m_lastBytes[rec.pc];
+            }
+            bool ok = getField(pos, end, mask, kAF, rec.af) && getField(pos, end, mask, kBC, rec.bc)
+                      && getField(pos, end, mask, kDE, rec.de) && getField(pos, end, mask, kHL, rec.hl)
+                      && getField(pos, end, mask, kSP, rec.sp) && getByte(pos, end, mask, kR, rec.r, true)
+                      && getField(pos, end, mask, kIX, rec.ix) && getField(pos, end, mask, kIY, rec.iy)
+                      && getByte(pos, end, mask, kStatus, rec.status, false);
+            if (!ok) {
+                return false;
+            }
+            out.push_back(rec);
+            prev = rec;
+        }
+        return pos == end;
+    }
+
+  private:
+    // Bytes assumed at an address not seen yet in the block
+    static constexpr uint32_t kNoBytes = 0;
+    // Last instruction bytes seen at every address in the current block
+    std::vector<uint32_t> m_lastBytes = std::vector<uint32_t>(0x10000);
+
+    static uint32_t changed(uint16_t value, uint16_t prev, uint32_t bit) {
+        return value != prev ? bit : 0;
+    }
+
+    static void putDelta(std::vector<uint8_t>& out, uint16_t value, uint16_t prev) {
+        auto delta = static_cast<uint16_t>(value - prev);
+        z80PutVarint(out, z80ZigzagEncode(delta));
+    }
+
+    static void putField(std::vector<uint8_t>& out, uint32_t mask, uint32_t bit, uint16_t value, uint16_t prev) {
+        if ((mask & bit) != 0) {
+            putDelta(out, value, prev);
+        }
+    }
+
+    static bool getDelta(const uint8_t*& pos, const uint8_t* end, uint16_t& value) {
+        uint64_t zigzag = 0;
+        if (!z80GetVarint(pos, end, zigzag)) {
+            return false;
+        }
+        auto delta = static_cast<uint16_t>(z80ZigzagDecode(zigzag));
+        value = static_cast<uint16_t>(value + delta);
+        return true;
+    }
+
+    static bool getField(const uint8_t*& pos, const uint8_t* end, uint64_t mask, uint32_t bit, uint16_t& value) {
+        return (mask & bit) == 0 || getDelta(pos, end, value);
+    }
+
+    static bool getByte(const uint8_t*& pos, const uint8_t* end, uint64_t mask, uint32_t bit, uint8_t& value,
+                        bool delta) {
+        if ((mask & bit) == 0) {
+            return true;
+        }
+        if (pos == end) {
+            return false;
+        }
+        value = delta ? static_cast<uint8_t>(value + *pos++) : *pos++;
+        return true;
+    }
+};
+
+/* Execution tracer streaming compressed records to a file.
+ *
+ * append() writes one Z80TraceRecord in place into the current block of
+ * a preallocated set; nothing is allocated or locked per instruction. A
+ * full block is handed to the writer thread, which compresses it with
+ * Z80TraceCodec and appends it to the file while the emulation thread
+ * fills the next one. If every block is waiting for the writer, append()
+ * waits for one to come back rather than losing records; getStalls()
+ * counts those waits.
+ *
+ * Z80Machine::runTraced() feeds a tracer; another bus calls append()
+ * after every execute() with the PC and T-state counter from before it.
+ *
+ * File layout, every integer little-endian:
+ *
+ *   magic    8 bytes  "Z80TRCE\0"
+ *   version  u16      kVersion
+ *   reserved u16      0
+ *   blocks   u32      records, u32 payload size, payload (Z80TraceCodec)
+ */
+class Z80TraceWriter {
+  public:
+    static constexpr uint16_t kVersion = 1;
+    static constexpr std::array<char, 8> kMagic = {'Z', '8', '0', 'T', 'R', 'C', 'E', '\0'};
+
+    explicit Z80TraceWriter(const std::string& path, size_t blockRecords = 1 << 16, size_t blocks = 4)
+        : m_file(path, std::ios::binary | std::ios::trunc), m_blockRecords(blockRecords == 0 ? 1 : blockRecords) {
+        if (m_file.is_open()) {
+            m_file.write(kMagic.data(), kMagic.size());
+            std::array<char, 4> version = {static_cast<char>(kVersion & 0xFF), static_cast<char>(kVersion >> 8), 0,
+                                           0};
+            m_file.write(version.data(), version.size());
+        }
+        m_blocks.resize(blocks < 2 ? 2 : blocks);
+        for (size_t idx = 0; idx < m_blocks.size(); idx++) {
+            m_blocks[idx].resize(m_blockRecords);
+            m_free.push_back(idx);
+        }
+        m_current = takeFree();
+        m_block = m_blocks[m_current].data();
+        m_thread = std::thread([this] { writerLoop(); });
+    }
+
+    Z80TraceWriter(const Z80TraceWriter&) = delete;
+    Z80TraceWriter& operator=(const Z80TraceWriter&) = delete;
+    Z80TraceWriter(Z80TraceWriter&&) = delete;
+    Z80TraceWriter& operator=(Z80TraceWriter&&) = delete;
+
+    ~Z80TraceWriter() {
+        close();
+    }
+
+    template <typename TCpu>
+    Z80_FORCE_INLINE void append(const TCpu& cpu, uint64_t tstates, uint16_t pc, uint32_t bytes) {
+        z80CaptureTrace(m_block[m_fill], cpu, tstates, pc, bytes);
+        if (Z80_UNLIKELY(++m_fill == m_blockRecords)) {
+            submit();
+        }
+    }
+
+    // Writes the partial block and every queued one, then closes the file
+    void close() {
+        if (!m_thread.joinable()) {
+            return;
+        }
+        if (m_fill > 0) {
+            submit();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wakeWriter.notify_one();
+        m_thread.join();
+        m_file.close();
+    }
+
+    // False if the file could not be created or a write failed
+    [[nodiscard]] bool good() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return !m_failed;
+    }
+
+    // Records appended so far, including those not yet on disk
+    [[nodiscard]] uint64_t getRecords() const {
+        return m_submitted + m_fill;
+    }
+
+    [[nodiscard]] uint64_t getBytesWritten() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_bytesWritten;
+    }
+
+    [[nodiscard]] uint64_t getStalls() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stalls;
+    }
+
+  private:
+    std::ofstream m_file;
+    size_t m_blockRecords;
+    std::vector<std::vector<Z80TraceRecord>> m_blocks;
+    // Producer side
+    size_t m_current{0};
+    Z80TraceRecord* m_block{nullptr};
+    size_t m_fill{0};
+    uint64_t m_submitted{0};
+    // Shared with the writer thread
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeWriter;
+    std::condition_variable m_blockFreed;
+    std::deque<std::pair<size_t, size_t>> m_full; // block, records
+    std::vector<size_t> m_free;
+    uint64_t m_bytesWritten{0};
+    uint64_t m_stalls{0};
+    bool m_failed{false};
+    bool m_stop{false};
+    std::thread m_thread;
+
+    size_t takeFree() {
+        size_t block = m_free.back();
+        m_free.pop_back();
+        return block;
+    }
+
+    void submit() {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_full.emplace_back(m_current, m_fill);
+            if (m_free.empty()) {
+                m_stalls++;
+                m_wakeWriter.notify_one();
+                m_blockFreed.wait(lock, [this] { return !m_free.empty(); });
+            }
+            m_current = takeFree();
+        }
+        m_wakeWriter.notify_one();
+        m_block = m_blocks[m_current].data();
+        m_submitted += m_fill;
+        m_fill = 0;
+    }
+
+    void writerLoop() {
+        Z80TraceCodec codec;
+        std::vector<uint8_t> payload;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_failed = !m_file.is_open();
+        while (true) {
+            m_wakeWriter.wait(lock, [this] { return m_stop || !m_full.empty(); });
+            if (m_full.empty()) {
+                return; // m_stop and nothing left to write
+            }
+            auto [block, records] = m_full.front();
+            m_full.pop_front();
+            lock.unlock();
+
+            payload.clear();
+            payload.resize(8);
+            codec.encode(m_blocks[block].data(), records, payload);
+            z80StoreLE(payload.data(), records, 4);
+            z80StoreLE(payload.data() + 4, payload.size() - 8, 4);
+            m_file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+            bool written = m_file.good();
+
+            lock.lock();
+            m_free.push_back(block);
+            m_bytesWritten += payload.size();
+            m_failed = m_failed || !written;
+            m_blockFreed.notify_one();
+        }
+    }
+};
+
+/* Reads back the records of a Z80TraceWriter file, one block at a time. */
+class Z80TraceReader {
+  public:
+    // False if the file cannot be opened or is not a trace of a known version
+    bool open(const std::string& path) {
+        m_file.open(path, std::ios::binary);
+        std::array<char, 12> header{};
+        if (!m_file.read(header.data(), header.size())
+            || std::memcmp(header.data(), Z80TraceWriter::kMagic.data(), Z80TraceWriter::kMagic.size()) != 0) {
+            return false;
+        }
+        auto version = static_cast<uint16_t>(z80GetLE(reinterpret_cast<const uint8_t*>(header.data()) + 8, 2));
+        return version != 0 && version <= Z80TraceWriter::kVersion;
+    }
+
+    // False at the end of the trace or on a corrupt block, see isCorrupt()
+    bool next(Z80TraceRecord& record) {
+        if (m_pos == m_records.size() && !readBlock()) {
+            return false;
+        }
+        record = m_records[m_pos++];
+        return true;
+    }
+
+    [[nodiscard]] bool isCorrupt() const {
+        return m_corrupt;
+    }
+
+  private:
+    std::ifstream m_file;
+    Z80TraceCodec m_codec;
+    std::vector<uint8_t> m_payload;
+    std::vector<Z80TraceRecord> m_records;
+    size_t m_pos{0};
+    bool m_corrupt{false};
+
+    bool readBlock() {
+        std::array<uint8_t, 8> header{};
+        if (!m_file.read(reinterpret_cast<char*>(header.data()), header.size())) {
+            return false;
+        }
+        auto records = static_cast<uint32_t>(z80GetLE(header.data(), 4));
+        m_payload.resize(z80GetLE(header.data() + 4, 4));
+        m_records.clear();
+        m_pos = 0;
+        if (!m_file.read(reinterpret_cast<char*>(m_payload.data()), static_cast<std::streamsize>(m_payload.size()))
+            || !m_codec.decode(m_payload.data(), m_payload.size(), records, m_records) || records == 0) {
+            m_corrupt = true;
+            m_records.clear();
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif // Z80_TRACE_H
@@ -0,0 +1,601 @@
+#ifndef Z80_TRACE_COLUMNS_H
+#define Z80_TRACE_COLUMNS_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "z80_histogram.h"
+#include "z80_image.h"
+#include "z80_trace.h"
+
+/* Decoded columns of one chunk of a columnar trace.
+ *
+ * Record 'idx' made the memory writes writeAddress/writeValue
+ * [writeStart[idx], writeStart[idx + 1]).
+ */
+struct Z80TraceChunk {
+    uint64_t firstInstruction{0};
+    std::vector<uint64_t> tstates;
+    std::vector<uint16_t> pc, af, bc, de, hl, ix, iy, sp;
+    std::vector<uint32_t> bytes;
+    std::vector<uint8_t> r, status;
+    std::vector<uint32_t> writeStart;
+    std::vector<uint16_t> writeAddress;
+    std::vector<uint8_t> writeValue;
+
+    [[nodiscard]] size_t size() const {
+        return pc.size();
+    }
+
+    [[nodiscard]] Z80TraceRecord record(size_t idx) const {
+        return {tstates[idx], pc[idx], af[idx], bc[idx], de[idx], hl[idx], ix[idx], iy[idx], sp[idx], bytes[idx],
+                r[idx], status[idx], 0};
+    }
+
+    void clear() {
+        for (auto* column : {&pc, &af, &bc, &de, &hl, &ix, &iy, &sp, &writeAddress}) {
+            column->clear();
+        }
+        tstates.clear();
+        bytes.clear();
+        r.clear();
+        status.clear();
+        writeStart.assign(1, 0);
+        writeValue.clear();
+    }
+
+    void push(const Z80TraceRecord& record) {
+        tstates.push_back(record.tstates);
+        pc.push_back(record.pc);
+        af.push_back(record.af);
+        bc.push_back(record.bc);
+        de.push_back(record.de);
+        hl.push_back(record.hl);
+        ix.push_back(record.ix);
+        iy.push_back(record.iy);
+        sp.push_back(record.sp);
+        bytes.push_back(record.bytes);
+        r.push_back(record.r);
+        status.push_back(record.status);
+        writeStart.push_back(static_cast<uint32_t>(writeAddress.size()));
+    }
+};
+
+/* Column encodings of the columnar trace.
+ *
+ * Numeric columns store the difference with the previous value as a
+ * zigzag varint, and runs of unchanged values as a single varint, so a
+ * register that does not change over a chunk costs one or two bytes.
+ * Instruction bytes are only stored where they differ from the last ones
+ * seen at the same PC in the chunk, with one flag bit per record.
+ */
+class Z80ColumnCodec {
+  public:
+    enum Column : uint8_t {
+        kTstates,
+        kPC,
+        kAF,
+        kBC,
+        kDE,
+        kHL,
+        kIX,
+        kIY,
+        kSP,
+        kBytesChanged,
+        kBytes,
+        kR,
+        kStatus,
+        kWriteCount,
+        kWriteAddress,
+        kWriteValue,
+        kColumns
+    };
+
+    template <typename T> static void encodeDeltas(const std::vector<T>& values, std::vector<uint8_t>& out) {
+        using U = std::make_unsigned_t<T>;
+        U prev = 0;
+        uint64_t zeros = 0;
+        for (T value : values) {
+            auto delta = static_cast<U>(static_cast<U>(value) - prev);
+            prev = static_cast<U>(value);
+            if (delta == 0) {
+                zeros++;
+                continue;
+            }
+            if (zeros > 0) {
+                z80PutVarint(out, zeros << 1 | 1);
+                zeros = 0;
+            }
+            z80PutVarint(out, static_cast<uint64_t>(z80ZigzagEncode(delta)) << 1);
+        }
+        if (zeros > 0) {
+            z80PutVarint(out, zeros << 1 | 1);
+        }
+    }
+
+    template <typename T>
+    static bool decodeDeltas(const uint8_t* data, size_t size, size_t count, std::vector<T>& out) {
+        using U = std::make_unsigned_t<T>;
+        const uint8_t* pos = data;
+        const uint8_t* end = data + size;
+        U value = 0;
+        out.clear();
+        out.reserve(count);
+        while (out.size() < count) {
+            uint64_t word = 0;
+            if (!z80GetVarint(pos, end, word)) {
+                return false;
+            }
+            if ((word & 1) != 0) {
+                uint64_t zeros = word >> 1;
+                if (zeros > count - out.size()) {
+                    return false;
+                }
+                out.insert(out.end(), zeros, static_cast<T>(value));
+                continue;
+            }
+            uint64_t zigzag = word >> 1;
+            value = static_cast<U>(value + static_cast<U>(z80ZigzagDecode(zigzag)));
+            out.push_back(static_cast<T>(value));
+        }
+        return pos == end;
+    }
+};
+
+/* Writes a columnar, chunked trace with a seek index.
+ *
+ * Records are grouped in chunks of 'chunkRecords'; every column of a
+ * chunk is encoded on its own (Z80ColumnCodec) and chunks decode
+ * independently. The bus reports the memory writes of an instruction
+ * with appendWrite() while it executes, before its append().
+ * append(cpu, ...) has the signature of Z80TraceWriter::append(), so
+ * Z80Machine::runTraced() can feed this writer directly, writes included.
+ *
+ * File layout, every integer little-endian:
+ *
+ *   magic        8 bytes  "Z80COLS\0"
+ *   version      u16      kVersion
+ *   columns      u16      Z80ColumnCodec::kColumns
+ *   chunkRecords u32
+ *   indexOffset  u64      0 until close() writes the index
+ *   chunks       the columns of each chunk, back to back
+ *   index        u64 chunk count, then per chunk: u64 first instruction,
+ *                u64 first T-state, u64 file offset, u32 records,
+ *                u32 memory writes, u32 x columns encoded sizes
+ *
+ * A trace that was not closed has no index and is rejected by readers.
+ */
+class Z80ColumnTraceWriter {
+  public:
+    static constexpr uint16_t kVersion = 1;
+    static constexpr std::array<char, 8> kMagic = {'Z', '8', '0', 'C', 'O', 'L', 'S', '\0'};
+    static constexpr size_t kHeaderSize = 24;
+    static constexpr size_t kIndexEntrySize = 32 + 4 * Z80ColumnCodec::kColumns;
+
+    explicit Z80ColumnTraceWriter(const std::string& path, uint32_t chunkRecords = 1 << 16)
+        : m_file(path, std::ios::binary | std::ios::trunc), m_chunkRecords(chunkRecords == 0 ? 1 : chunkRecords) {
+        std::vector<uint8_t> header(kMagic.begin(), kMagic.end());
+        z80PutLE(header, kVersion, 2);
+        z80PutLE(header, Z80ColumnCodec::kColumns, 2);
+        z80PutLE(header, m_chunkRecords, 4);
+        z80PutLE(header, 0, 8);
+        write(header);
+        m_chunk.clear();
+    }
+
+    Z80ColumnTraceWriter(const Z80ColumnTraceWriter&) = delete;
+    Z80ColumnTraceWriter& operator=(const Z80ColumnTraceWriter&) = delete;
+    Z80ColumnTraceWriter(Z80ColumnTraceWriter&&) = delete;
+    Z80ColumnTraceWriter& operator=(Z80ColumnTraceWriter&&) = delete;
+
+    ~Z80ColumnTraceWriter() {
+        close();
+    }
+
+    template <typename TCpu> void append(const TCpu& cpu, uint64_t tstates, uint16_t pc, uint32_t bytes) {
+        Z80TraceRecord record;
+        z80CaptureTrace(record, cpu, tstates, pc, bytes);
+        append(record);
+    }
+
+    void append(const Z80TraceRecord& record) {
+        m_chunk.push(record);
+        if (m_chunk.size() == m_chunkRecords) {
+            flushChunk();
+        }
+    }
+
+    // A memory write of the instruction being executed, which the next append() records
+    void appendWrite(uint16_t address, uint8_t value) {
+        m_chunk.writeAddress.push_back(address);
+        m_chunk.writeValue.push_back(value);
+    }
+
+    // Writes the last chunk and the index; false if any write failed
+    bool close() {
+        if (!m_file.is_open()) {
+            return !m_failed;
+        }
+        if (m_chunk.size() > 0) {
+            // Writes after the last record belong to no instruction
+            m_chunk.writeAddress.resize(m_chunk.writeStart.back());
+            m_chunk.writeValue.resize(m_chunk.writeStart.back());
+            flushChunk();
+        }
+        auto indexOffset = static_cast<uint64_t>(m_offset);
+        std::vector<uint8_t> index;
+        z80PutLE(index, m_index.size() / kIndexEntrySize, 8);
+        index.insert(index.end(), m_index.begin(), m_index.end());
+        write(index);
+        m_file.seekp(16);
+        std::vector<uint8_t> offset;
+        z80PutLE(offset, indexOffset, 8);
+        m_file.write(reinterpret_cast<const char*>(offset.data()), static_cast<std::streamsize>(offset.size()));
+        m_failed = m_failed || !m_file.good();
+        m_file.close();
+        return !m_failed;
+    }
+
+    [[nodiscard]] uint64_t getRecords() const {
+        return m_records + m_chunk.size();
+    }
+
+    [[nodiscard]] uint64_t getBytesWritten() const {
+        return m_offset;
+    }
+
+  private:
+    std::ofstream m_file;
+    uint32_t m_chunkRecords;
+    Z80TraceChunk m_chunk;
+    std::vector<uint8_t> m_index;
+    std::array<std::vector<uint8_t>, Z80ColumnCodec::kColumns> m_columns;
+    std::vector<uint8_t> m_lastBytesSeen = std::vector<uint8_t>(0x10000);
+    std::vector<uint32_t> m_lastBytes = std::vector<uint32_t>(0x10000);
+    uint64_t m_records{0};
+    uint64_t m_offset{0};
+    bool m_failed{false};
+
+    void flushChunk() {
+        using C = Z80ColumnCodec;
+        for (auto& column : m_columns) {
+            column.clear();
+        }
+        C::encodeDeltas(m_chunk.tstates, m_columns[C::kTstates]);
+        C::encodeDeltas(m_chunk.pc, m_columns[C::kPC]);
+        C::encodeDeltas(m_chunk.af, m_columns[C::kAF]);
+        C::encodeDeltas(m_chunk.bc, m_columns[C::kBC]);
+        C::encodeDeltas(m_chunk.de, m_columns[C::kDE]);
+        C::encodeDeltas(m_chunk.hl, m_columns[C::kHL]);
+        C::encodeDeltas(m_chunk.ix, m_columns[C::kIX]);
+        C::encodeDeltas(m_chunk.iy, m_columns[C::kIY]);
+        C::encodeDeltas(m_chunk.sp, m_columns[C::kSP]);
+        C::encodeDeltas(m_chunk.r, m_columns[C::kR]);
+        C::encodeDeltas(m_chunk.status, m_columns[C::kStatus]);
+
+        // Instruction bytes where they differ from the last ones at the same PC
+        std::fill(m_lastBytesSeen.begin(), m_lastBytesSeen.end(), 0);
+        std::vector<uint8_t>& changed = m_columns[C::kBytesChanged];
+        changed.assign((m_chunk.size() + 7) / 8, 0);
+        for (size_t idx = 0; idx < m_chunk.size(); idx++) {
+            uint16_t pc = m_chunk.pc[idx];
+            if (m_lastBytesSeen[pc] == 0 || m_lastBytes[pc] != m_chunk.bytes[idx]) {
+                changed[idx >> 3] |= static_cast<uint8_t>(1U << (idx & 7));
+                z80PutLE(m_columns[C::kBytes], m_chunk.bytes[idx], 4);
+                m_lastBytesSeen[pc] = 1;
+                m_lastBytes[pc] = m_chunk.bytes[idx];
+            }
+        }
+
+        // Running total of the writes: each delta is the write count of a record, mostly runs of zeros
+        std::vector<uint32_t> writeEnds(m_chunk.writeStart.begin() + 1, m_chunk.writeStart.end());
+        C::encodeDeltas(writeEnds, m_columns[C::kWriteCount]);
+        C::encodeDeltas(m_chunk.writeAddress, m_columns[C::kWriteAddress]);
+        m_columns[C::kWriteValue] = m_chunk.writeValue;
+
+        std::vector<uint8_t> entry;
+        z80PutLE(entry, m_records, 8);
+        z80PutLE(entry, m_chunk.tstates.front(), 8);
+        z80PutLE(entry, m_offset, 8);
+        z80PutLE(entry, m_chunk.size(), 4);
+        z80PutLE(entry, m_chunk.writeAddress.size(), 4);
+        for (const auto& column : m_columns) {
+            z80PutLE(entry, column.size(), 4);
+            write(column);
+        }
+        m_index.insert(m_index.end(), entry.begin(), entry.end());
+
+        m_records += m_chunk.size();
+        m_chunk.clear();
+    }
+
+    void write(const std::vector<uint8_t>& bytes) {
+        m_file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        m_failed = m_failed || !m_file.good();
+        m_offset += bytes.size();
+    }
+};
+
+/* Reader of columnar traces, over a memory mapped file.
+ *
+ * open() maps the file and reads the index; nothing else is read until a
+ * chunk is decoded, so jumping to instruction N or T-state T costs a
+ * binary search in the index and the decoding of one chunk. The const
+ * members can be used from several threads at once.
+ */
+class Z80ColumnTrace {
+  public:
+    struct ChunkInfo {
+        uint64_t firstInstruction;
+        uint64_t firstTstates;
+        uint64_t offset;
+        uint32_t records;
+        uint32_t writes;
+        std::array<uint32_t, Z80ColumnCodec::kColumns> columnSizes;
+    };
+
+    // False if the file cannot be mapped, is not a closed columnar trace or its index is inconsistent
+    bool open(const std::string& path) {
+        m_chunks.clear();
+        m_records = 0;
+        m_image = Z80Image::map(path, Z80Image::Access::ReadOnly);
+        if (!m_image || m_image->size() < Z80ColumnTraceWriter::kHeaderSize) {
+            return false;
+        }
+        const uint8_t* data = m_image->data();
+        size_t size = m_image->size();
+        const auto& magic = Z80ColumnTraceWriter::kMagic;
+        auto version = static_cast<uint16_t>(z80GetLE(data + 8, 2));
+        if (std::memcmp(data, magic.data(), magic.size()) != 0 || version == 0
+            || version > Z80ColumnTraceWriter::kVersion || z80GetLE(data + 10, 2) != Z80ColumnCodec::kColumns) {
+            return false;
+        }
+        uint64_t indexOffset = z80GetLE(data + 16, 8);
+        if (indexOffset < Z80ColumnTraceWriter::kHeaderSize || indexOffset > size - 8) {
+            return false;
+        }
+        uint64_t chunks = z80GetLE(data + indexOffset, 8);
+        if (chunks > (size - indexOffset - 8) / Z80ColumnTraceWriter::kIndexEntrySize) {
+            return false;
+        }
+
+        const uint8_t* entry = data + indexOffset + 8;
+        for (uint64_t chunk = 0; chunk < chunks; chunk++, entry += Z80ColumnTraceWriter::kIndexEntrySize) {
+            ChunkInfo info{z80GetLE(entry, 8), z80GetLE(entry + 8, 8), z80GetLE(entry + 16, 8),
+                           static_cast<uint32_t>(z80GetLE(entry + 24, 4)), static_cast<uint32_t>(z80GetLE(entry + 28, 4)),
+                           {}};
+            uint64_t end = info.offset;
+            for (size_t column = 0; column < info.columnSizes.size(); column++) {
+                info.columnSizes[column] = static_cast<uint32_t>(z80GetLE(entry + 32 + column * 4, 4));
+                end += info.columnSizes[column];
+            }
+            if (info.firstInstruction != m_records || info.records == 0 || end > indexOffset) {
+                return false;
+            }
+            m_records += info.records;
+            m_chunks.push_back(info);
+        }
+        return true;
+    }
+
+    [[nodiscard]] size_t getChunkCount() const {
+        return m_chunks.size();
+    }
+
+    [[nodiscard]] const ChunkInfo& getChunk(size_t chunk) const {
+        return m_chunks[chunk];
+    }
+
+    [[nodiscard]] uint64_t getRecords() const {
+        return m_records;
+    }
+
+    // Chunk holding instruction number 'instruction', getChunkCount() if past the end
+    [[nodiscard]] size_t findInstruction(uint64_t instruction) const {
+        if (instruction >= m_records) {
+            return m_chunks.size();
+        }
+        auto chunk = std::upper_bound(m_chunks.begin(), m_chunks.end(), instruction,
+                                      [](uint64_t value, const ChunkInfo& info) { return value < info.firstInstruction; });
+        return static_cast<size_t>(chunk - m_chunks.begin()) - 1;
+    }
+
+    // Chunk holding the instruction running at T-state 'tstates', 0 before the start of the trace
+    [[nodiscard]] size_t findTstates(uint64_t tstates) const {
+        auto chunk = std::upper_bound(m_chunks.begin(), m_chunks.end(), tstates,
+                                      [](uint64_t value, const ChunkInfo& info) { return value < info.firstTstates; });
+        return chunk == m_chunks.begin() ? 0 : static_cast<size_t>(chunk - m_chunks.begin()) - 1;
+    }
+
+    // False if the chunk does not decode to the sizes in the index
+    bool decodeChunk(size_t chunk, Z80TraceChunk& out) const {
+        using C = Z80ColumnCodec;
+        if (chunk >= m_chunks.size()) {
+            return false;
+        }
+        const ChunkInfo& info = m_chunks[chunk];
+        std::array<const uint8_t*, C::kColumns> columns{};
+        const uint8_t* pos = m_image->data() + info.offset;
+        for (size_t column = 0; column < columns.size(); column++) {
+            columns[column] = pos;
+            pos += info.columnSizes[column];
+        }
+        auto deltas = [&](C::Column column, auto& values, size_t count) {
+            return C::decodeDeltas(columns[column], info.columnSizes[column], count, values);
+        };
+
+        out.firstInstruction = info.firstInstruction;
+        size_t count = info.records;
+        bool ok = deltas(C::kTstates, out.tstates, count) && deltas(C::kPC, out.pc, count)
+                  && deltas(C::kAF, out.af, count) && deltas(C::kBC, out.bc, count) && deltas(C::kDE, out.de, count)
+                  && deltas(C::kHL, out.hl, count) && deltas(C::kIX, out.ix, count) && deltas(C::kIY, out.iy, count)
+                  && deltas(C::kSP, out.sp, count) && deltas(C::kR, out.r, count)
+                  && deltas(C::kStatus, out.status, count) && deltas(C::kWriteCount, out.writeStart, count)
+                  && deltas(C::kWriteAddress, out.writeAddress, info.writes)
+                  && info.columnSizes[C::kWriteValue] == info.writes
+                  && info.columnSizes[C::kBytesChanged] == (count + 7) / 8;
+        if (!ok || (count > 0 && out.writeStart.back() != info.writes)) {
+            return false;
+        }
+        out.writeStart.insert(out.writeStart.begin(), 0);
+        out.writeValue.assign(columns[C::kWriteValue], columns[C::kWriteValue] + info.writes);
+
+        // Instruction bytes, carried over from the last record at the same PC when unchanged
+        std::vector<uint32_t> lastBytes(0x10000);
+        const uint8_t* changed = columns[C::kBytesChanged];
+        const uint8_t* bytes = columns[C::kBytes];
+        const uint8_t* bytesEnd = bytes + info.columnSizes[C::kBytes];
+        out.bytes.resize(count);
+        for (size_t idx = 0; idx < count; idx++) {
+            uint16_t pc = out.pc[idx];
+            if ((changed[idx >> 3] & (1U << (idx & 7))) != 0) {
+                if (bytesEnd - bytes < 4) {
+                    return false;
+                }
+                lastBytes[pc] = static_cast<uint32_t>(z80GetLE(bytes, 4));
+                bytes += 4;
+            }
+            out.bytes[idx] = lastBytes[pc];
+        }
+        return bytes == bytesEnd;
+    }
+
+    // Random access to one record
+    bool read(uint64_t instruction, Z80TraceRecord& out) const {
+        Z80TraceChunk chunk;
+        if (!decodeChunk(findInstruction(instruction), chunk)) {
+            return false;
+        }
+        out = chunk.record(instruction - chunk.firstInstruction);
+        return true;
+    }
+
+  private:
+    std::shared_ptr<Z80Image> m_image;
+    std::vector<ChunkInfo> m_chunks;
+    uint64_t m_records{0};
+};
+
+// Instruction mix, hot PCs and memory write counts of a columnar trace
+struct Z80TraceStats {
+    uint64_t records{0};
+    uint64_t writes{0};
+    uint64_t chunks{0};
+    uint64_t corruptChunks{0};
+    Z80OpcodeHistogram opcodes;
+    std::vector<uint64_t> pcCounts = std::vector<uint64_t>(0x10000);
+    std::vector<uint64_t> writeCounts = std::vector<uint64_t>(0x10000);
+
+    void merge(const Z80TraceStats& other) {
+        records += other.records;
+        writes += other.writes;
+        chunks += other.chunks;
+        corruptChunks += other.corruptChunks;
+        opcodes.merge(other.opcodes);
+        for (size_t address = 0; address < pcCounts.size(); address++) {
+            pcCounts[address] += other.pcCounts[address];
+            writeCounts[address] += other.writeCounts[address];
+        }
+    }
+
+    // The 'limit' most executed addresses, most executed first
+    [[nodiscard]] std::vector<std::pair<uint16_t, uint64_t>> getHotPCs(size_t limit) const {
+        std::vector<std::pair<uint16_t, uint64_t>> hot;
+        for (size_t address = 0; address < pcCounts.size(); address++) {
+            if (pcCounts[address] != 0) {
+                hot.emplace_back(static_cast<uint16_t>(address), pcCounts[address]);
+            }
+        }
+        std::stable_sort(hot.begin(), hot.end(), [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+        if (hot.size() > limit) {
+            hot.resize(limit);
+        }
+        return hot;
+    }
+};
+
+/* Computes Z80TraceStats over the chunks of a trace on 'threads' threads.
+ *
+ * Chunks are handed out one at a time, each thread accumulates its own
+ * statistics and they are merged at the end. Opcodes are classified
+ * from the recorded instruction bytes into the tables of
+ * Z80OpcodeHistogram, prefixes counted as the core counts them; chains of
+ * redundant DD/FD prefixes are classified by their first two bytes only.
+ */
+class Z80TraceAnalyzer {
+  public:
+    static Z80TraceStats analyze(const Z80ColumnTrace& trace, size_t threads = std::thread::hardware_concurrency()) {
+        threads = std::max<size_t>(1, std::min(threads, trace.getChunkCount()));
+        std::vector<Z80TraceStats> partial(threads);
+        std::atomic<size_t> nextChunk{0};
+        auto work = [&trace, &nextChunk](Z80TraceStats& stats) {
+            Z80TraceChunk chunk;
+            for (size_t idx = nextChunk++; idx < trace.getChunkCount(); idx = nextChunk++) {
+                if (!trace.decodeChunk(idx, chunk)) {
+                    stats.corruptChunks++;
+                    continue;
+                }
+                accumulate(chunk, stats);
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (size_t idx = 1; idx < threads; idx++) {
+            pool.emplace_back(work, std::ref(partial[idx]));
+        }
+        work(partial[0]);
+        for (auto& thread : pool) {
+            thread.join();
+        }
+        for (size_t idx = 1; idx < threads; idx++) {
+            partial[0].merge(partial[idx]);
+        }
+        return std::move(partial[0]);
+    }
+
+    static void accumulate(const Z80TraceChunk& chunk, Z80TraceStats& stats) {
+        using T = Z80OpcodeTable;
+        for (size_t idx = 0; idx < chunk.size(); idx++) {
+            stats.pcCounts[chunk.pc[idx]]++;
+            uint32_t bytes = chunk.bytes[idx];
+            auto byte = [bytes](int pos) { return static_cast<uint8_t>(bytes >> (pos * 8)); };
+            stats.opcodes.count(T::Main, byte(0));
+            switch (byte(0)) {
+                case 0xCB:
+                    stats.opcodes.count(T::CB, byte(1));
+                    break;
+                case 0xED:
+                    stats.opcodes.count(T::ED, byte(1));
+                    break;
+                case 0xDD:
+                case 0xFD:
+                    stats.opcodes.count(byte(0) == 0xDD ? T::DD : T::FD, byte(1));
+                    if (byte(1) == 0xCB) {
+                        stats.opcodes.count(byte(0) == 0xDD ? T::DDCB : T::FDCB, byte(3));
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        for (uint16_t address : chunk.writeAddress) {
+            stats.writeCounts[address]++;
+        }
+        stats.records += chunk.size();
+        stats.writes += chunk.writeAddress.size();
+        stats.chunks++;
+    }
+};
+
+#endif // Z80_TRACE_COLUMNS_H
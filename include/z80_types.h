@@ -2,6 +2,7 @@
 #define Z80_TYPES_H
 
 #include <cstdint>
+#include <type_traits>
 
 #ifndef Z80_FORCE_INLINE
 #    ifdef _MSC_VER
@@ -33,6 +34,20 @@
 #    endif
 #endif
 
+/* Built as C++20, Z80 and Z80BusInterface can run in constant evaluation,
+ * so that small Z80 routines can produce constant tables at compile time.
+ * Z80_CONSTEXPR marks every function on that path; it is empty before C++20. */
+#ifndef Z80_CONSTEXPR
+#    if (__cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)) \
+        && defined(__cpp_lib_is_constant_evaluated)
+#        define Z80_CONSTEXPR_CORE 1
+#        define Z80_CONSTEXPR      constexpr
+#    else
+#        define Z80_CONSTEXPR_CORE 0
+#        define Z80_CONSTEXPR
+#    endif
+#endif
+
 /* Union allowing a register pair to be accessed as bytes or as a word */
 union RegisterPair {
 #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
@@ -47,4 +62,109 @@ union RegisterPair {
     uint16_t word;
 };
 
+#if Z80_CONSTEXPR_CORE
+/* Word view of a RegisterPair for the core. At run time it is the union's
+ * word. Constant evaluation does not allow reading an inactive union member,
+ * so there byte8 is kept as the active member and the word is assembled
+ * from, and split into, the two bytes. */
+template <typename TPair> class RegisterWord {
+  public:
+    constexpr explicit RegisterWord(TPair& pair) : m_pair(pair) {
+    }
+
+    constexpr RegisterWord(const RegisterWord&) = default;
+
+    constexpr operator uint16_t() const {
+        if (std::is_constant_evaluated()) {
+            return static_cast<uint16_t>(m_pair.byte8.lo | (m_pair.byte8.hi << 8));
+        }
+        return m_pair.word;
+    }
+
+    // Assigns the value, the view keeps referring to the same pair
+    constexpr RegisterWord& operator=(const RegisterWord& other) {
+        return *this = static_cast<uint16_t>(other);
+    }
+
+    constexpr RegisterWord& operator=(uint16_t value) {
+        if (std::is_constant_evaluated()) {
+            m_pair.byte8.lo = static_cast<uint8_t>(value);
+            m_pair.byte8.hi = static_cast<uint8_t>(value >> 8);
+        } else {
+            m_pair.word = value;
+        }
+        return *this;
+    }
+
+    constexpr RegisterWord& operator+=(int value) {
+        return *this = static_cast<uint16_t>(*this + value);
+    }
+
+    constexpr RegisterWord& operator-=(int value) {
+        return *this = static_cast<uint16_t>(*this - value);
+    }
+
+    constexpr RegisterWord& operator|=(int value) {
+        return *this = static_cast<uint16_t>(*this | value);
+    }
+
+    constexpr RegisterWord& operator&=(int value) {
+        return *this = static_cast<uint16_t>(*this & value);
+    }
+
+    constexpr RegisterWord& operator++() {
+        return *this += 1;
+    }
+
+    constexpr RegisterWord& operator--() {
+        return *this -= 1;
+    }
+
+    constexpr uint16_t operator++(int) {
+        uint16_t old = *this;
+        *this += 1;
+        return old;
+    }
+
+    constexpr uint16_t operator--(int) {
+        uint16_t old = *this;
+        *this -= 1;
+        return old;
+    }
+
+  private:
+    TPair& m_pair;
+};
+
+// Temporaries, such as the pair returned by Z80::getPairIR(), are read only
+RegisterWord(const RegisterPair&)->RegisterWord<const RegisterPair>;
+
+#    define Z80_WORD(pair) RegisterWord{pair} // NOLINT(cppcoreguidelines-macro-usage)
+#else
+#    define Z80_WORD(pair) (pair).word // NOLINT(cppcoreguidelines-macro-usage)
+#endif
+
+/* Control transfers reported to a bus built with WITH_FLOW_EVENTS. Call and
+ * Rst push a return address, the Ret kinds pop one, Interrupt and Nmi are
+ * the accepted INT and NMI. Halt is the CPU stopping on a HALT, which the
+ * next Interrupt or Nmi ends. Conditional CALL/RET report only when taken.
+ * Di and Ei are the DI and EI instructions, reported once IFF1 is set, so
+ * that with Interrupt, Nmi and Retn every change of IFF1 has an event. */
+enum class Z80FlowKind : uint8_t { Call, Rst, Ret, Reti, Retn, Interrupt, Nmi, Halt, Di, Ei };
+
+/* Complete CPU state, including the hidden registers and latches that are not
+ * visible to Z80 code (MEMPTR, Q, pending EI...). Two CPUs with the same
+ * Z80State behave identically from the next instruction on. */
+struct Z80State {
+    uint16_t af{}, bc{}, de{}, hl{};
+    uint16_t afx{}, bcx{}, dex{}, hlx{};
+    uint16_t ix{}, iy{}, sp{}, pc{};
+    uint16_t memptr{};
+    uint8_t i{}, r{};
+    uint8_t im{}; // 0, 1 or 2
+    bool iff1{}, iff2{};
+    bool pendingEI{}, activeNMI{}, halted{}, pinReset{};
+    bool flagQ{}, lastFlagQ{};
+};
+
 #endif // Z80_TYPES_H
@@ -2,14 +2,35 @@
 
 #include "../include/z80.h"
 #include "../include/z80_bus_interface.h"
+#include "../include/z80_image.h"
+#include <algorithm>
 #include <array>
 #include <chrono>
-#include <fstream>
+#include <cmath>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <ostream>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 // Benchmark configuration
 struct BenchmarkConfig {
     std::string name;
@@ -19,8 +40,201 @@ struct BenchmarkConfig {
     double expected_min_mips = 0.0; // Minimum acceptable MIPS
     bool is_cpm_program = false;    // true for CP/M (like ZEXALL), false for raw Z80
     uint16_t load_address = 0;      // Load address for raw Z80 programs
+    uint32_t seed = 0;              // Non-zero: randomize free RAM and R to vary the run
+    int warmup = 0;                 // Untimed runs before the timed ones
+    int repeats = 1;                // Timed runs; the figures are those of the median run
+};
+
+// Hardware counters read around the run loop
+enum class PerfCounter : uint8_t { Cycles, Instructions, BranchMisses, L1dMisses, L1iMisses };
+
+constexpr size_t kPerfCounters = 5;
+
+// Counts of one run, -1 where the counter could not be opened
+struct PerfCounts {
+    std::array<int64_t, kPerfCounters> values{-1, -1, -1, -1, -1};
+
+    [[nodiscard]] bool has(PerfCounter counter) const {
+        return values[static_cast<size_t>(counter)] >= 0;
+    }
+
+    [[nodiscard]] int64_t get(PerfCounter counter) const {
+        return values[static_cast<size_t>(counter)];
+    }
+
+    [[nodiscard]] bool any() const {
+        return std::any_of(values.begin(), values.end(), [](int64_t value) { return value >= 0; });
+    }
+
+    // Host instructions per host cycle, 0 without both counters
+    [[nodiscard]] double ipc() const {
+        if (!has(PerfCounter::Cycles) || !has(PerfCounter::Instructions) || get(PerfCounter::Cycles) == 0) {
+            return 0;
+        }
+        return static_cast<double>(get(PerfCounter::Instructions)) / static_cast<double>(get(PerfCounter::Cycles));
+    }
+
+    // Count per emulated instruction, -1 without the counter
+    [[nodiscard]] double perInstruction(PerfCounter counter, int64_t instructions) const {
+        if (!has(counter) || instructions <= 0) {
+            return -1;
+        }
+        return static_cast<double>(get(counter)) / static_cast<double>(instructions);
+    }
+
+    static const char* name(PerfCounter counter) {
+        static constexpr std::array<const char*, kPerfCounters> kNames = {"cycles", "instructions", "branch_misses",
+                                                                          "l1d_misses", "l1i_misses"};
+        return kNames[static_cast<size_t>(counter)];
+    }
+};
+
+/* perf_event_open counters of the calling thread, user space only.
+ *
+ * Each counter is opened on its own so that one the CPU or the kernel
+ * does not offer leaves the rest working; counts are scaled by the time
+ * a counter was actually scheduled when the PMU had to multiplex them.
+ * Where perf is not permitted (perf_event_paranoid, containers, seccomp)
+ * or not Linux, nothing opens, getError() says why and the benchmark runs
+ * as before with every count at -1.
+ */
+class PerfCounters {
+  public:
+    PerfCounters() {
+#ifdef __linux__
+        // type, config
+        const std::array<std::pair<uint32_t, uint64_t>, kPerfCounters> events = {{
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D)},
+            {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1I)},
+        }};
+        for (size_t idx = 0; idx < kPerfCounters; idx++) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = events[idx].first;
+            attr.config = events[idx].second;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            m_fds[idx] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (m_fds[idx] < 0 && m_error.empty()) {
+                m_error = std::string(PerfCounts::name(static_cast<PerfCounter>(idx))) + ": " + std::strerror(errno);
+            }
+        }
+#else
+        m_error = "perf_event_open needs Linux";
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // At least one counter opened
+    [[nodiscard]] bool isAvailable() const {
+        return std::any_of(m_fds.begin(), m_fds.end(), [](int fd) { return fd >= 0; });
+    }
+
+    // Why the first counter that failed did, empty if all opened
+    [[nodiscard]] const std::string& getError() const {
+        return m_error;
+    }
+
+    void start() {
+#ifdef __linux__
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    PerfCounts stop() {
+        PerfCounts counts;
+#ifdef __linux__
+        for (int fd : m_fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        for (size_t idx = 0; idx < kPerfCounters; idx++) {
+            // value, time enabled, time running; a counter that never got on the PMU counted nothing
+            std::array<uint64_t, 3> data{};
+            if (m_fds[idx] >= 0 && read(m_fds[idx], data.data(), sizeof(data)) == sizeof(data) && data[2] != 0) {
+                double scale = static_cast<double>(data[1]) / static_cast<double>(data[2]);
+                counts.values[idx] = static_cast<int64_t>(static_cast<double>(data[0]) * scale);
+            }
+        }
+#endif
+        return counts;
+    }
+
+  private:
+    std::array<int, kPerfCounters> m_fds{-1, -1, -1, -1, -1};
+    std::string m_error;
+
+#ifdef __linux__
+    static uint64_t cacheMiss(uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+#endif
+};
+
+// Spread of the timed runs of a benchmark, in seconds
+struct BenchmarkStats {
+    int runs{};
+    double median{};
+    double p95{};
+    double mean{};
+    double stddev{}; // Sample standard deviation, 0 for a single run
+    double cv{};     // stddev / mean
+    double min{};
+    double max{};
 };
 
+inline BenchmarkStats computeStats(std::vector<double> samples) {
+    BenchmarkStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t count = samples.size();
+    stats.runs = static_cast<int>(count);
+    stats.median = count % 2 == 1 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+    // Nearest rank
+    size_t rank = static_cast<size_t>(std::ceil(0.95 * static_cast<double>(count)));
+    stats.p95 = samples[std::max<size_t>(rank, 1) - 1];
+    stats.min = samples.front();
+    stats.max = samples.back();
+    for (double sample : samples) {
+        stats.mean += sample;
+    }
+    stats.mean /= static_cast<double>(count);
+    if (count > 1) {
+        double squares = 0;
+        for (double sample : samples) {
+            squares += (sample - stats.mean) * (sample - stats.mean);
+        }
+        stats.stddev = std::sqrt(squares / static_cast<double>(count - 1));
+    }
+    stats.cv = stats.mean > 0 ? stats.stddev / stats.mean : 0;
+    return stats;
+}
+
 // Benchmark result
 struct BenchmarkResult {
     std::string name;
@@ -31,8 +245,125 @@ struct BenchmarkResult {
     double mts_per_sec{};
     double speedup{};
     bool passed{};
+    uint32_t seed{};
+    int cpu{-1};                 // Host CPU the run was pinned to, -1 if not pinned
+    uint64_t host_cycles{};      // Time stamp counter ticks, or nanoseconds without one
+    double cycles_per_instruction{};
+    double cycles_per_tstate{};
+    PerfCounts perf;             // Hardware counters, -1 where not available
+    double branch_misses_per_instruction{-1};
+    int warmup{};
+    BenchmarkStats elapsed; // Over the timed runs; elapsed_seconds is the lower median run
 };
 
+// Host cycle counter: the time stamp counter where there is one, nanoseconds otherwise
+inline uint64_t readHostCycles() {
+#if defined(__x86_64__) || defined(__i386__) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+#endif
+}
+
+// Host CPUs this process may run on, in ascending order
+inline std::vector<int> availableCpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+// Pin the calling thread to one host CPU. Returns false where pinning is not supported.
+inline bool pinCurrentThread(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+// Quote a string for JSON output
+inline std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char chr : text) {
+        switch (chr) {
+            case '"':
+                quoted += "\\\"";
+                break;
+            case '\\':
+                quoted += "\\\\";
+                break;
+            case '\n':
+                quoted += "\\n";
+                break;
+            default:
+                if (static_cast<unsigned char>(chr) < 0x20) {
+                    std::ostringstream code;
+                    code << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(chr);
+                    quoted += code.str();
+                } else {
+                    quoted += chr;
+                }
+                break;
+        }
+    }
+    return quoted + "\"";
+}
+
+// One JSON object per result
+inline void writeBenchmarkJson(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    out << "[\n";
+    for (size_t idx = 0; idx < results.size(); idx++) {
+        const BenchmarkResult& result = results[idx];
+        out << std::fixed << std::setprecision(3) << "  {\"name\": " << jsonString(result.name)
+            << ", \"seed\": " << result.seed << ", \"cpu\": " << result.cpu
+            << ", \"elapsed_seconds\": " << std::setprecision(6) << result.elapsed_seconds
+            << ", \"instructions\": " << result.instructions << ", \"tstates\": " << result.tstates
+            << std::setprecision(3) << ", \"mips\": " << result.mips << ", \"mts_per_sec\": " << result.mts_per_sec
+            << ", \"host_cycles\": " << result.host_cycles
+            << ", \"cycles_per_instruction\": " << result.cycles_per_instruction
+            << ", \"cycles_per_tstate\": " << result.cycles_per_tstate << ", \"perf\": {";
+        for (size_t counter = 0; counter < kPerfCounters; counter++) {
+            auto kind = static_cast<PerfCounter>(counter);
+            out << (counter == 0 ? "" : ", ") << jsonString(PerfCounts::name(kind)) << ": ";
+            if (result.perf.has(kind)) {
+                out << result.perf.get(kind);
+            } else {
+                out << "null";
+            }
+        }
+        out << ", \"branch_misses_per_instruction\": ";
+        if (result.branch_misses_per_instruction >= 0) {
+            out << std::setprecision(6) << result.branch_misses_per_instruction;
+        } else {
+            out << "null";
+        }
+        out << std::setprecision(3) << ", \"ipc\": " << result.perf.ipc() << "}"
+            << ", \"warmup\": " << result.warmup << ", \"elapsed\": {\"runs\": " << result.elapsed.runs
+            << std::setprecision(6) << ", \"median\": " << result.elapsed.median << ", \"p95\": " << result.elapsed.p95
+            << ", \"mean\": " << result.elapsed.mean << ", \"stddev\": " << result.elapsed.stddev
+            << ", \"cv\": " << result.elapsed.cv << ", \"min\": " << result.elapsed.min
+            << ", \"max\": " << result.elapsed.max << "}"
+            << ", \"passed\": " << (result.passed ? "true" : "false") << "}"
+            << (idx + 1 < results.size() ? "," : "") << '\n';
+    }
+    out << "]\n";
+}
+
 class BenchmarkSim : public Z80BusInterface<BenchmarkSim> {
   public:
     Z80<BenchmarkSim> cpu;
@@ -110,42 +441,31 @@ class BenchmarkSim : public Z80BusInterface<BenchmarkSim> {
     }
 };
 
-// Run a single benchmark test
-inline BenchmarkResult runBenchmark(const BenchmarkConfig& config) {
-    BenchmarkResult result;
-    result.name = config.name;
-    result.instructions = config.instructions;
-    result.passed = false;
-
-    std::cout << "Testing: " << config.name << '\n';
-
-    // Create simulator
-    BenchmarkSim sim;
+// Load the program of 'config' into 'sim' and reset the CPU; false, with a message, if there is none
+inline bool loadBenchmark(const BenchmarkConfig& config, BenchmarkSim& sim) {
     sim.setCpmMode(config.is_cpm_program);
 
     if (!config.code.empty()) {
         // Load from memory
         if (config.code.size() + config.load_address > 0x10000) {
             std::cerr << "  ERROR: Code too large for RAM" << '\n';
-            return result;
+            return false;
         }
         std::copy(config.code.begin(), config.code.end(), std::next(sim.getRam().begin(), config.load_address));
     } else if (!config.file.empty()) {
-        // Load binary file
-        std::ifstream file(config.file, std::ios::binary | std::ios::ate);
-        if (!file.is_open()) {
+        /* Map the binary file read-only and copy it in. The sim keeps a flat
+         * array rather than Z80Memory pages: the page lookup on every access
+         * costs about 10% of ZEXALL MIPS, which is the core being measured. */
+        std::shared_ptr<const Z80Image> image = Z80Image::map(config.file, Z80Image::Access::ReadOnly);
+        if (!image) {
             std::cerr << "  ERROR: Cannot open file: " << config.file << '\n';
-            return result;
+            return false;
         }
 
-        std::streamsize size = file.tellg();
-        file.seekg(0, std::ios::beg);
-
         if (config.is_cpm_program) {
             // CP/M program (like ZEXALL) - load at 0x100
-            size = std::min<std::streamsize>(size, 0x10000 - 0x100);
-            file.read(reinterpret_cast<char*>(&sim.getRam()[0x100]), size);
-            file.close();
+            size_t size = std::min<size_t>(image->size(), 0x10000 - 0x100);
+            std::copy(image->data(), image->data() + size, std::next(sim.getRam().begin(), 0x100));
 
             // Set up CP/M environment
             sim.getRam()[0] = 0xC3; // JP 0x100
@@ -154,58 +474,175 @@ inline BenchmarkResult runBenchmark(const BenchmarkConfig& config) {
             sim.getRam()[5] = 0xC9; // RET at BDOS call address
         } else {
             // Raw Z80 program (synthetic tests) - load at 0x0000
-            size = std::min<std::streamsize>(size, 0x10000);
-            file.read(reinterpret_cast<char*>(sim.getRam().data()), size);
-            file.close();
+            size_t size = std::min<size_t>(image->size(), 0x10000);
+            std::copy(image->data(), image->data() + size, sim.getRam().begin());
         }
     } else {
         std::cerr << "  ERROR: No code or file specified" << '\n';
-        return result;
+        return false;
     }
 
     // Reset CPU
     sim.getCpu().reset();
 
+    // Seeded runs start from different free RAM contents and R register, which games use for randomness
+    if (config.seed != 0) {
+        uint32_t state = config.seed;
+        size_t codeEnd = config.load_address + config.code.size();
+        for (size_t address = 0x4000; address < sim.getRam().size(); address++) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            if (address < config.load_address || address >= codeEnd) {
+                sim.getRam()[address] = static_cast<uint8_t>(state);
+            }
+        }
+        sim.getCpu().setRegR(static_cast<uint8_t>(config.seed));
+    }
+
     // If raw Z80 program has a custom load address, we might need to set PC
     // But for now, synthetic tests assume 0x0000 or handle it.
     // For game tests, we might need to set PC to the entry point.
     if (!config.is_cpm_program && config.load_address != 0) {
         sim.getCpu().setRegPC(config.load_address);
     }
+    return true;
+}
 
+// One run of a benchmark, from a freshly loaded program
+struct BenchmarkRun {
+    double elapsed_seconds{};
+    uint64_t instructions{}; // Executed: fewer than configured if the program halts
+    uint64_t tstates{};
+    uint64_t host_cycles{};
+    PerfCounts perf;
+    std::string perf_error;
+};
+
+inline bool runBenchmarkOnce(const BenchmarkConfig& config, BenchmarkRun& run) {
+    auto sim = std::make_unique<BenchmarkSim>();
+    if (!loadBenchmark(config, *sim)) {
+        return false;
+    }
+
+    auto& cpu = sim->getCpu();
+    auto limit = static_cast<uint64_t>(std::max<int64_t>(0, config.instructions));
     uint64_t instructionsExecuted = 0;
+    PerfCounters perf;
 
     // Run benchmark
     auto start = std::chrono::high_resolution_clock::now();
+    uint64_t startCycles = readHostCycles();
+    perf.start();
 
-    while (instructionsExecuted < config.instructions && !sim.getCpu().isHalted()) {
-        sim.getCpu().execute();
+    while (instructionsExecuted < limit && !cpu.isHalted()) {
+        cpu.execute();
         instructionsExecuted++;
     }
 
+    run.perf = perf.stop();
+    uint64_t endCycles = readHostCycles();
     auto end = std::chrono::high_resolution_clock::now();
 
+    run.elapsed_seconds = std::chrono::duration<double>(end - start).count();
+    run.instructions = instructionsExecuted;
+    run.tstates = sim->getTstates();
+    run.host_cycles = endCycles - startCycles;
+    run.perf_error = perf.getError().empty() ? std::string("never scheduled") : perf.getError();
+    return true;
+}
+
+/* Run a benchmark config.warmup times untimed, then config.repeats times.
+ * Every run starts from the freshly loaded program. The figures reported
+ * are those of the median run, and the threshold applies to its MIPS, so a
+ * single run disturbed by the host does not fail the benchmark; the spread
+ * of the runs is in 'elapsed'. */
+inline BenchmarkResult runBenchmark(const BenchmarkConfig& config, std::ostream& out = std::cout) {
+    BenchmarkResult result;
+    result.name = config.name;
+    result.seed = config.seed;
+    result.warmup = std::max(0, config.warmup);
+    result.passed = false;
+
+    out << "Testing: " << config.name << '\n';
+
+    std::vector<BenchmarkRun> runs;
+    for (int idx = 0; idx < result.warmup + std::max(1, config.repeats); idx++) {
+        BenchmarkRun run;
+        if (!runBenchmarkOnce(config, run)) {
+            return result;
+        }
+        if (idx >= result.warmup) {
+            runs.push_back(run);
+        }
+    }
+
+    std::vector<double> samples;
+    for (const BenchmarkRun& run : runs) {
+        samples.push_back(run.elapsed_seconds);
+    }
+    result.elapsed = computeStats(samples);
+    std::sort(runs.begin(), runs.end(), [](const BenchmarkRun& lhs, const BenchmarkRun& rhs) {
+        return lhs.elapsed_seconds < rhs.elapsed_seconds;
+    });
+    // With an even count, the lower of the two middle runs: every figure below comes from this one run
+    const BenchmarkRun& median = runs[(runs.size() - 1) / 2];
+
     // Calculate metrics
-    std::chrono::duration<double> elapsed = end - start;
-    result.elapsed_seconds = elapsed.count();
-    result.tstates = static_cast<int64_t>(sim.getTstates());
+    result.elapsed_seconds = median.elapsed_seconds;
+    result.instructions = static_cast<int64_t>(median.instructions);
+    result.tstates = static_cast<int64_t>(median.tstates);
+    result.host_cycles = median.host_cycles;
+    result.perf = median.perf;
+    if (median.instructions > 0) {
+        result.cycles_per_instruction = static_cast<double>(result.host_cycles) / median.instructions;
+    }
+    result.branch_misses_per_instruction = result.perf.perInstruction(PerfCounter::BranchMisses, result.instructions);
+    if (result.tstates > 0) {
+        result.cycles_per_tstate = static_cast<double>(result.host_cycles) / result.tstates;
+    }
 
     if (result.elapsed_seconds > 0) {
-        result.mips = (static_cast<double>(config.instructions) / 1000000.0) / result.elapsed_seconds;
+        result.mips = (static_cast<double>(result.instructions) / 1000000.0) / result.elapsed_seconds;
         result.mts_per_sec = (static_cast<double>(result.tstates) / 1000000.0) / result.elapsed_seconds;
         result.speedup = result.mts_per_sec / 3.5; // ZX Spectrum = 3.5 MHz
         result.passed = result.mips >= config.expected_min_mips;
     }
 
     // Print results
-    std::cout << std::fixed << std::setprecision(2);
-    std::cout << "  Time: " << std::fixed << std::setprecision(3) << result.elapsed_seconds << " sec\n";
-    std::cout << "  T-States: " << result.tstates << " (" << result.mts_per_sec << " MT/s)\n";
-    std::cout << "  Speedup: " << result.speedup << "%" << '\n';
+    out << std::fixed << std::setprecision(2);
+    out << "  Time: " << std::fixed << std::setprecision(3) << result.elapsed_seconds << " sec";
+    if (result.elapsed.runs > 1) {
+        out << " (median of " << result.elapsed.runs << " runs after " << result.warmup << " warmup, p95 "
+            << result.elapsed.p95 << ", stddev " << std::setprecision(4) << result.elapsed.stddev << ", CV "
+            << std::setprecision(1) << result.elapsed.cv * 100 << "%)";
+    }
+    out << std::setprecision(2) << '\n';
+    out << "  Instructions: " << result.instructions
+        << (median.instructions < static_cast<uint64_t>(std::max<int64_t>(0, config.instructions)) ? " (halted)" : "")
+        << '\n';
+    out << "  T-States: " << result.tstates << " (" << result.mts_per_sec << " MT/s)\n";
+    out << "  Host cycles: " << result.host_cycles << " (" << result.cycles_per_instruction << " per instruction)\n";
+    if (result.perf.any()) {
+        // Per emulated instruction
+        out << "  Perf: IPC " << result.perf.ipc();
+        for (PerfCounter counter : {PerfCounter::Instructions, PerfCounter::BranchMisses, PerfCounter::L1dMisses,
+                                    PerfCounter::L1iMisses}) {
+            if (result.perf.has(counter)) {
+                out << ", " << PerfCounts::name(counter) << " "
+                    << std::setprecision(counter == PerfCounter::Instructions ? 2 : 4)
+                    << result.perf.perInstruction(counter, result.instructions);
+            }
+        }
+        out << std::setprecision(2) << " per instruction\n";
+    } else {
+        out << "  Perf: counters not available (" << median.perf_error << ")\n";
+    }
+    out << "  Speedup: " << result.speedup << "%" << '\n';
     if (result.instructions > 0) {
-        std::cout << "  MIPS: " << result.mips << "\n";
+        out << "  MIPS: " << result.mips << "\n";
     }
-    std::cout << "  Result: " << (result.passed ? "Passed" : "Failed") << "\n\n";
+    out << "  Result: " << (result.passed ? "Passed" : "Failed") << "\n\n";
 
     return result;
 }
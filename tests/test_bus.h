@@ -0,0 +1,106 @@
+#ifndef TEST_BUS_H
+#define TEST_BUS_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "../include/z80.h"
+
+/* Flat 64K RAM bus with uncontended timing: 4 T-states per opcode fetch,
+ * 3 per byte, 6 per word and 4 per I/O access. I/O reads return 0xFF,
+ * writes are ignored and INT is never active.
+ *
+ * A test bus derives from Z80BusInterface<Bus> and from this class, and
+ * declares only the *Impl methods it changes, which hide the ones below:
+ *
+ *     class PoolBus : public Z80BusInterface<PoolBus>, public FlatTestBus {};
+ *
+ * The CPU is not part of the bus, for tests that pool or rebind CPUs. */
+class FlatTestBus {
+  public:
+    std::array<uint8_t, 0x10000> ram{};
+    uint64_t tstates{0};
+
+    void load(uint16_t address, const std::vector<uint8_t>& code) {
+        std::copy(code.begin(), code.end(), ram.begin() + address);
+    }
+
+    [[nodiscard]] uint64_t getTstates() const {
+        return tstates;
+    }
+
+    uint8_t fetchOpcodeImpl(uint16_t address) {
+        tstates += 4;
+        return ram[address];
+    }
+
+    uint8_t peek8Impl(uint16_t address) {
+        tstates += 3;
+        return ram[address];
+    }
+
+    void poke8Impl(uint16_t address, uint8_t value) {
+        tstates += 3;
+        ram[address] = value;
+    }
+
+    uint16_t peek16Impl(uint16_t address) {
+        tstates += 6;
+        return ram[address] | (ram[(address + 1) & 0xFFFF] << 8);
+    }
+
+    void poke16Impl(uint16_t address, RegisterPair word) {
+        tstates += 6;
+        ram[address] = word.byte8.lo;
+        ram[(address + 1) & 0xFFFF] = word.byte8.hi;
+    }
+
+    uint8_t inPortImpl(uint16_t port) {
+        tstates += 4;
+        return 0xFF;
+    }
+
+    void outPortImpl(uint16_t port, uint8_t value) {
+        tstates += 4;
+    }
+
+    void addressOnBusImpl(uint16_t address, int32_t wstates) {
+        tstates += wstates;
+    }
+
+    void interruptHandlingTimeImpl(int32_t wstates) {
+        tstates += wstates;
+    }
+
+    static bool isActiveINTImpl() {
+        return false;
+    }
+
+#ifdef WITH_FLOW_EVENTS
+    void flowEventImpl(Z80FlowKind kind, uint16_t from, uint16_t to, uint16_t sp) {
+    }
+#endif
+};
+
+// FlatTestBus with its own CPU, bound to TBus for the bus lifetime
+template <typename TBus> class TestBus : public FlatTestBus {
+  public:
+    Z80<TBus> cpu;
+
+    TestBus() : cpu(static_cast<TBus&>(*this)) {
+    }
+
+    // The CPU points at this bus
+    TestBus(const TestBus&) = delete;
+    TestBus& operator=(const TestBus&) = delete;
+
+    void runToHalt() {
+        while (!cpu.isHalted()) {
+            cpu.execute();
+        }
+    }
+};
+
+#endif // TEST_BUS_H
@@ -0,0 +1,73 @@
+#ifndef TEST_RUNNER_H
+#define TEST_RUNNER_H
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#    include <unistd.h>
+#elif defined(_WIN32)
+#    include <process.h>
+#endif
+
+using TestList = std::vector<std::pair<std::string, std::function<bool()>>>;
+
+// 'name' in the temp directory, prefixed with the process id so that concurrent runs do not share files
+inline std::string temp_path(const std::string& name) {
+#if defined(__unix__) || defined(__APPLE__)
+    std::string prefix = std::to_string(getpid()) + "_";
+#elif defined(_WIN32)
+    std::string prefix = std::to_string(_getpid()) + "_";
+#else
+    std::string prefix;
+#endif
+    return (std::filesystem::temp_directory_path() / (prefix + name)).string();
+}
+
+// Shortest wall time of 'runs' calls of 'run', in seconds, for the informational timing tests
+template <typename TRun> double bestSeconds(int runs, TRun run) {
+    double best = 1e9;
+    for (int idx = 0; idx < runs; idx++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+// Run every test in order, print a ✓ or ✗ line for each and the totals; the exit code of the suite
+inline int runTests(const std::string& title, const TestList& tests) {
+    try {
+        std::cout << "========================================" << '\n';
+        std::cout << title << '\n';
+        std::cout << "========================================" << '\n';
+        std::cout << '\n';
+
+        size_t failed = 0;
+        for (const auto& [name, test] : tests) {
+            bool passed = test();
+            std::cout << (passed ? "✓ " : "✗ ") << name << '\n';
+            if (!passed) {
+                failed++;
+            }
+        }
+
+        std::cout << '\n';
+        std::cout << "Passed: " << tests.size() - failed << '\n';
+        std::cout << "Failed: " << failed << '\n';
+
+        return (failed == 0) ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+}
+
+#endif // TEST_RUNNER_H
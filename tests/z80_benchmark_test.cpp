@@ -209,6 +209,28 @@ int main(int argc, char* argv[]) {
         std::cout << "========================================" << '\n';
         std::cout << '\n';
 
+        // Options: --warmup N, --repeats N, --json FILE
+        int warmup = 1;
+        int repeats = 5;
+        std::string json_path = "benchmark.json";
+        for (int idx = 1; idx < argc; idx += 2) {
+            std::string option = argv[idx];
+            if (idx + 1 == argc) {
+                std::cerr << "Missing value for option: " << option << '\n';
+                return 1;
+            }
+            if (option == "--warmup") {
+                warmup = std::max(0, std::stoi(argv[idx + 1]));
+            } else if (option == "--repeats") {
+                repeats = std::max(1, std::stoi(argv[idx + 1]));
+            } else if (option == "--json") {
+                json_path = argv[idx + 1];
+            } else {
+                std::cerr << "Unknown option: " << option << '\n';
+                return 1;
+            }
+        }
+
         // Define benchmark tests
         // Paths are relative to build directory where tests run
         // Min MIPS thresholds are conservative to avoid intermittent failures
@@ -226,7 +248,9 @@ int main(int argc, char* argv[]) {
         int passed = 0;
         int failed = 0;
 
-        for (const auto& config : benchmarks) {
+        for (auto& config : benchmarks) {
+            config.warmup = warmup;
+            config.repeats = repeats;
             BenchmarkResult result = runBenchmark(config);
             results.push_back(result);
 
@@ -263,6 +287,14 @@ int main(int argc, char* argv[]) {
             std::cout << "Average Performance: " << std::fixed << std::setprecision(2) << avg_mips << " MIPS" << '\n';
         }
 
+        std::ofstream json(json_path, std::ios::trunc);
+        if (json.is_open()) {
+            writeBenchmarkJson(json, results);
+            std::cout << "JSON results written to " << json_path << '\n';
+        } else {
+            std::cerr << "Error: cannot write " << json_path << '\n';
+        }
+
         return (failed == 0) ? 0 : 1;
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << '\n';
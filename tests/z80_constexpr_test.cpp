@@ -0,0 +1,111 @@
+// Z80 Constexpr Test Suite
+// Z80 routines run during constant evaluation (C++20)
+
+#include "../include/z80.h"
+#include "../include/z80_flat_bus.h"
+#include "test_runner.h"
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static_assert(Z80_CONSTEXPR_CORE, "This test must be built as C++20");
+
+// Parity table generator: table[n] = 0x04 when n has even parity, as reported by the P/V flag
+constexpr std::array<uint8_t, 18> kParityGenerator = {
+    0x21, 0x00, 0x01, // LD HL,0x0100
+    0x31, 0x00, 0x04, // LD SP,0x0400
+    0x7D,             // loop: LD A,L
+    0xB7,             // OR A
+    0xF5,             // PUSH AF
+    0xC1,             // POP BC
+    0x79,             // LD A,C
+    0xE6, 0x04,       // AND 0x04
+    0x77,             // LD (HL),A
+    0x2C,             // INC L
+    0x20, 0xF5,       // JR NZ,loop
+    0x76,             // HALT
+};
+
+// 16-bit additive checksum of the 256 bytes at 0x0200 into BC
+constexpr std::array<uint8_t, 18> kChecksum = {
+    0x21, 0x00, 0x02, // LD HL,0x0200
+    0x01, 0x00, 0x00, // LD BC,0
+    0x5E,             // loop: LD E,(HL)
+    0x16, 0x00,       // LD D,0
+    0xEB,             // EX DE,HL
+    0x09,             // ADD HL,BC
+    0x44,             // LD B,H
+    0x4D,             // LD C,L
+    0xEB,             // EX DE,HL
+    0x2C,             // INC L
+    0x20, 0xF5,       // JR NZ,loop
+    0x76,             // HALT
+};
+
+template <size_t N> constexpr Z80FlatBus<1024> run_program(const std::array<uint8_t, N>& program) {
+    Z80FlatBus<1024> bus;
+    bus.load(0, program.data(), program.size());
+    for (size_t idx = 0; idx < 256; idx++) {
+        bus.ram[0x200 + idx] = static_cast<uint8_t>(idx * 7 + 3);
+    }
+    bus.run(0, 100000);
+    return bus;
+}
+
+constexpr std::array<uint8_t, 256> make_parity_table() {
+    Z80FlatBus<1024> bus = run_program(kParityGenerator);
+    std::array<uint8_t, 256> table{};
+    for (size_t idx = 0; idx < table.size(); idx++) {
+        table[idx] = bus.ram[0x100 + idx];
+    }
+    return table;
+}
+
+constexpr uint16_t expected_checksum() {
+    uint16_t sum = 0;
+    for (size_t idx = 0; idx < 256; idx++) {
+        sum += static_cast<uint8_t>(idx * 7 + 3);
+    }
+    return sum;
+}
+
+// Both tables are computed by the compiler, nothing runs at startup
+constexpr std::array<uint8_t, 256> kParityTable = make_parity_table();
+constexpr Z80State kChecksumState = run_program(kChecksum).state;
+
+static_assert(kParityTable[0x00] == 0x04 && kParityTable[0x01] == 0x00 && kParityTable[0x03] == 0x04
+                  && kParityTable[0x7F] == 0x00 && kParityTable[0xFF] == 0x04,
+              "Parity table generated at compile time");
+static_assert(kChecksumState.bc == expected_checksum(), "Checksum computed at compile time");
+static_assert(run_program(kParityGenerator).tstates > 0 && run_program(kParityGenerator).state.halted);
+
+bool test_parity_table_matches_flag_tables() {
+    for (size_t idx = 0; idx < kParityTable.size(); idx++) {
+        if (kParityTable[idx] != (kFlagTables.sz53pn_add[idx] & 0x04)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The same routines at run time, through the union word instead of the bytes
+bool test_runtime_matches_constexpr() {
+    Z80FlatBus<1024> parity = run_program(kParityGenerator);
+    Z80FlatBus<1024> checksum = run_program(kChecksum);
+    constexpr uint64_t kParityTstates = run_program(kParityGenerator).tstates;
+    for (size_t idx = 0; idx < kParityTable.size(); idx++) {
+        if (parity.ram[0x100 + idx] != kParityTable[idx]) {
+            return false;
+        }
+    }
+    return checksum.state.bc == kChecksumState.bc && checksum.state.pc == kChecksumState.pc
+           && parity.tstates == kParityTstates;
+}
+
+int main() {
+    return runTests("Z80 Constexpr Test Suite", {
+        {"Compile-time parity table matches the flag tables", test_parity_table_matches_flag_tables},
+        {"Run time matches compile time", test_runtime_matches_constexpr},
+    });
+}
@@ -0,0 +1,143 @@
+// Z80 Co-simulation Test Suite
+// A main CPU and a half-speed sound CPU talking through a shared latch
+
+#include "../include/z80.h"
+#include "../include/z80_bus_interface.h"
+#include "../include/z80_cosim.h"
+#include "test_bus.h"
+#include "test_runner.h"
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Shared between the CPUs: a one-byte latch on port 0x01
+struct SharedLatch {
+    uint8_t value{0};
+    uint64_t writes{0};
+};
+
+class CoSimBus : public Z80BusInterface<CoSimBus>, public TestBus<CoSimBus> {
+  public:
+    Z80CoSim* cosim{nullptr};
+    SharedLatch* latch{nullptr};
+    size_t core{0};
+    bool sync{true};
+
+    uint8_t inPortImpl(uint16_t port) {
+        tstates += 4;
+        if (sync) {
+            cosim->syncFrom(core);
+        }
+        return latch->value;
+    }
+
+    void outPortImpl(uint16_t port, uint8_t value) {
+        tstates += 4;
+        if (sync) {
+            cosim->syncFrom(core);
+        }
+        latch->value = value;
+        latch->writes++;
+    }
+};
+
+// Main CPU: writes 0..199 to the latch, one value every ~190 T-states, then HALT
+const std::vector<uint8_t> kMainProgram = {
+    0x3E, 0x00, // LD A,0
+    0xD3, 0x01, // loop: OUT (1),A
+    0x06, 0x0C, // LD B,12
+    0x10, 0xFE, // delay: DJNZ delay
+    0x3C,       // INC A
+    0xFE, 0xC8, // CP 200
+    0x20, 0xF5, // JR NZ,loop
+    0x76,       // HALT
+};
+
+// Sound CPU: counts every latch change in C until it sees 199, then HALT
+const std::vector<uint8_t> kSoundProgram = {
+    0x0E, 0x00, // LD C,0
+    0x16, 0xFF, // LD D,0xFF
+    0xDB, 0x01, // loop: IN A,(1)
+    0xBA,       // CP D
+    0x28, 0xFB, // JR Z,loop
+    0x57,       // LD D,A
+    0x0C,       // INC C
+    0xFE, 0xC7, // CP 199
+    0x20, 0xF5, // JR NZ,loop
+    0x76,       // HALT
+};
+
+struct CoSimRun {
+    uint8_t changesSeen{0};
+    bool soundHalted{false};
+    uint64_t syncs{0};
+    uint64_t slices{0};
+    double seconds{0};
+};
+
+CoSimRun run_pair(uint64_t sliceTicks, bool sync, int repeats = 1) {
+    CoSimRun result;
+    auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < repeats; repeat++) {
+        SharedLatch latch;
+        Z80CoSim cosim(sliceTicks);
+        auto main = std::make_unique<CoSimBus>();
+        auto sound = std::make_unique<CoSimBus>();
+        main->load(0, kMainProgram);
+        sound->load(0, kSoundProgram);
+        for (CoSimBus* bus : {main.get(), sound.get()}) {
+            bus->cosim = &cosim;
+            bus->latch = &latch;
+            bus->sync = sync;
+        }
+        main->core = cosim.addCpu(main->cpu, 1);
+        sound->core = cosim.addCpu(sound->cpu, 2); // Half the clock of the main CPU
+
+        cosim.run(100000);
+        result.changesSeen = sound->cpu.getRegC();
+        result.soundHalted = sound->cpu.isHalted() && main->cpu.isHalted();
+        result.syncs = cosim.getSyncs();
+        result.slices = cosim.getSlices();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+    return result;
+}
+
+bool test_fine_interleaving() {
+    CoSimRun run = run_pair(4, false);
+    return run.changesSeen == 200 && run.soundHalted;
+}
+
+bool test_long_slices_without_sync_miss_updates() {
+    // The main CPU runs its whole program before the sound CPU gets to look
+    CoSimRun run = run_pair(100000, false);
+    return run.changesSeen == 1 && run.soundHalted;
+}
+
+bool test_catch_up_sync() {
+    CoSimRun run = run_pair(100000, true);
+    return run.changesSeen == 200 && run.soundHalted && run.slices == 1;
+}
+
+bool test_catch_up_is_cheaper() {
+    constexpr int kRepeats = 20;
+    CoSimRun fine = run_pair(4, false, kRepeats);
+    CoSimRun catchUp = run_pair(20000, true, kRepeats);
+    std::cout << std::fixed << std::setprecision(3) << "  4-tick slices: " << fine.seconds * 1000 << " ms ("
+              << fine.slices << " slices), catch-up: " << catchUp.seconds * 1000 << " ms (" << catchUp.slices
+              << " slices, " << catchUp.syncs << " syncs)" << '\n';
+    return catchUp.changesSeen == 200 && catchUp.slices < fine.slices;
+}
+
+int main() {
+    return runTests("Z80 Co-simulation Test Suite", {
+        {"Fine interleaving sees every latch write", test_fine_interleaving},
+        {"Long slices without sync miss latch writes", test_long_slices_without_sync_miss_updates},
+        {"Catch-up sync sees every latch write", test_catch_up_sync},
+        {"Catch-up sync with long slices", test_catch_up_is_cheaper},
+    });
+}
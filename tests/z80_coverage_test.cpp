@@ -0,0 +1,240 @@
+// Z80 Coverage Test Suite
+// Executed-instruction bitmaps per bank, instruction lengths, lcov and JSON reports
+
+#include "../include/z80.h"
+#include "../include/z80_coverage.h"
+#include "../include/z80_flat_bus.h"
+#include "../include/z80_machine.h"
+#include "../include/z80_symbols.h"
+#include "test_runner.h"
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// main calls used twice; unused is never called
+const std::vector<uint8_t> kProgram = {
+    0x31, 0x00, 0xF0,       // 0x0000 main: LD SP,0xF000
+    0xDD, 0x21, 0x00, 0x80, // LD IX,0x8000
+    0xCD, 0x20, 0x00,       // CALL used
+    0xCD, 0x20, 0x00,       // CALL used
+    0x76,                   // HALT
+};
+
+const std::vector<uint8_t> kUsed = {
+    0xDD, 0x36, 0x05, 0x2A, // 0x0020 used: LD (IX+5),42
+    0xED, 0x4B, 0x00, 0x90, // LD BC,(0x9000)
+    0x3A, 0x00, 0x90,       // LD A,(0x9000)
+    0xFE, 0x01,             // CP 1
+    0x28, 0x01,             // JR Z,skip, taken while (0x9000) holds 1
+    0x3C,                   // INC A
+    0xC9,                   // 0x0030 skip: RET
+};
+
+const std::vector<uint8_t> kUnused = {
+    0x3E, 0x01, // 0x0040 unused: LD A,1
+    0xC9,       // RET
+};
+
+const char* const kSymbols = "main EQU 0x0000\n"
+                             "used EQU 0x0020\n"
+                             "skip EQU 0x0030\n"
+                             "unused EQU 0x0040\n";
+
+void load_program(Z80Machine& machine) {
+    machine.getMemory().load(0x0000, kProgram.data(), kProgram.size());
+    machine.getMemory().load(0x0020, kUsed.data(), kUsed.size());
+    machine.getMemory().load(0x0040, kUnused.data(), kUnused.size());
+    machine.getMemory().write(0x9000, 0x01);
+}
+
+Z80Coverage::Reader reader(Z80Machine& machine) {
+    return [&machine](uint16_t address) { return machine.getMemory().read(address); };
+}
+
+// Opcodes after which the PC does not simply move past the instruction
+bool changes_flow(uint8_t opcode) {
+    static const std::set<uint8_t> kFlow = {0x10, 0x18, 0x20, 0x28, 0x30, 0x38, 0x76, 0xE9};
+    return kFlow.count(opcode) != 0 || (opcode >= 0xC0 && (opcode & 0x07) != 1 && (opcode & 0x07) != 3
+                                        && (opcode & 0x07) != 5 && (opcode & 0x07) != 6)
+           || opcode == 0xC3 || opcode == 0xC9 || opcode == 0xCD;
+}
+
+// Execute one instruction from 0x0100 and compare its length with how far the PC moved
+bool length_matches(const std::vector<uint8_t>& code) {
+    Z80FlatBus<0x10000> bus;
+    bus.load(0x0100, code.data(), code.size());
+    Z80<Z80FlatBus<0x10000>> cpu(bus);
+    cpu.setRegPC(0x0100);
+    cpu.setRegSP(0xF000);
+    cpu.execute();
+    uint32_t length = z80InstructionLength(0x0100, [&bus](uint16_t address) { return bus.ram[address]; });
+    return cpu.getRegPC() == 0x0100 + length;
+}
+
+bool test_instruction_lengths() {
+    const std::vector<uint8_t> operands = {0x11, 0x22, 0x33};
+    size_t checked = 0;
+    for (uint32_t opcode = 0; opcode < 256; opcode++) {
+        auto op = static_cast<uint8_t>(opcode);
+        std::vector<std::vector<uint8_t>> encodings;
+        if (op != 0xCB && op != 0xDD && op != 0xED && op != 0xFD && !changes_flow(op)) {
+            encodings.push_back({op});
+            encodings.push_back({0xDD, op});
+            encodings.push_back({0xFD, 0xDD, op});
+        }
+        encodings.push_back({0xCB, op});
+        encodings.push_back({0xDD, 0xCB, 0x05, op});
+        encodings.push_back({0xFD, 0xCB, 0xFB, op});
+        // RETN/RETI and the repeated block instructions move the PC on their own
+        if ((op & 0xC7) != 0x45 && (op & 0xF4) != 0xB0) {
+            encodings.push_back({0xED, op});
+            encodings.push_back({0xDD, 0xED, op});
+        }
+        // ED followed by a prefix only chains it
+        if (op != 0xCB && op != 0xDD && op != 0xED && op != 0xFD && !changes_flow(op)) {
+            encodings.push_back({0xED, 0xFD, op});
+            encodings.push_back({0xED, 0xED, 0xDD, op});
+        }
+        for (auto code : encodings) {
+            code.insert(code.end(), operands.begin(), operands.end());
+            if (!length_matches(code)) {
+                std::cout << "  length mismatch:";
+                for (uint8_t byte : code) {
+                    std::cout << ' ' << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte);
+                }
+                std::cout << std::dec << std::setfill(' ') << '\n';
+                return false;
+            }
+            checked++;
+        }
+    }
+    std::cout << "  " << checked << " encodings checked against the core" << '\n';
+    return checked > 1500;
+}
+
+bool test_program_coverage() {
+    auto machine = std::make_unique<Z80Machine>();
+    load_program(*machine);
+    Z80Coverage coverage;
+    machine->runCovered(UINT64_MAX, coverage);
+
+    std::vector<uint8_t> bytes = coverage.executedBytes(0, 0, reader(*machine));
+    // INC A at 0x002F is skipped on both calls
+    bool ok = machine->isFinished() && coverage.getExecuted() == 5 + 6;
+    for (uint32_t address = 0; ok && address < 0x0050; address++) {
+        bool expected = address < 0x000E || (address >= 0x0020 && address < 0x0031 && address != 0x002F);
+        ok = bytes[address] == (expected ? 1 : 0);
+    }
+
+    // The branch taken the other way covers INC A
+    auto other = std::make_unique<Z80Machine>();
+    load_program(*other);
+    other->getMemory().write(0x9000, 0x02);
+    Z80Coverage more;
+    other->runCovered(UINT64_MAX, more);
+    uint64_t added = coverage.merge(more);
+    uint64_t again = coverage.merge(more);
+    return ok && added == 1 && again == 0 && coverage.isExecuted(0, 0x002F) && !coverage.isExecuted(0, 0x0040);
+}
+
+bool test_banked_coverage() {
+    // 16K slots over 4 banks; a routine at 0xC000 runs from bank 3 and then from bank 1
+    auto machine = std::make_unique<Z80Machine>();
+    const std::vector<uint8_t> routine = {0x00, 0x00, 0x3C, 0x76}; // NOP, NOP, INC A, HALT
+    Z80Coverage coverage(4, 0x4000);
+    machine->getMemory().load(0xC000, routine.data(), routine.size());
+    machine->getCpu().setRegPC(0xC000);
+    machine->runCovered(UINT64_MAX, coverage);
+
+    coverage.mapBank(0xC000, 1);
+    machine->getCpu().setHalted(false);
+    machine->getCpu().setRegPC(0xC002);
+    machine->runCovered(UINT64_MAX, coverage);
+
+    return coverage.isExecuted(3, 0x0000) && coverage.isExecuted(3, 0x0003) && !coverage.isExecuted(1, 0x0000)
+           && coverage.isExecuted(1, 0x0002) && coverage.isExecuted(1, 0x0003) && !coverage.isExecuted(0, 0x0000)
+           && coverage.getExecuted() == 6 && coverage.getBanks() == 4 && coverage.getBankSize() == 0x4000;
+}
+
+bool test_lcov_and_json_reports() {
+    auto machine = std::make_unique<Z80Machine>();
+    load_program(*machine);
+    Z80Coverage coverage(1, 0x10000);
+    machine->runCovered(UINT64_MAX, coverage);
+    Z80SymbolMap symbols;
+    std::istringstream in(kSymbols);
+    symbols.parse(in);
+
+    std::ostringstream lcov;
+    coverage.writeLcov(lcov, 0, 0, reader(*machine), &symbols, "firmware.asm");
+    std::string text = lcov.str();
+    bool lcovOk = text.rfind("TN:\nSF:firmware.asm\n", 0) == 0 && text.find("FN:33,used\n") != std::string::npos
+                  && text.find("FNDA:1,main\n") != std::string::npos
+                  && text.find("FNDA:0,unused\n") != std::string::npos
+                  && text.find("FNF:4\nFNH:3\n") != std::string::npos && text.find("DA:1,1\n") != std::string::npos
+                  && text.find("DA:48,0\n") != std::string::npos && text.find("LF:65536\nLH:30\n") != std::string::npos
+                  && text.size() > 6 && text.compare(text.size() - 14, 14, "end_of_record\n") == 0;
+
+    std::ostringstream json;
+    coverage.writeJson(json, 0, 0, reader(*machine), &symbols);
+    std::string expected = "{\"bank\":0,\"base\":0,\"size\":65536,\"executed\":30,\"ranges\":[[0,14],[32,47],[48,49]],"
+                           "\"symbols\":[{\"name\":\"main\",\"address\":0,\"size\":32,\"executed\":14},"
+                           "{\"name\":\"used\",\"address\":32,\"size\":16,\"executed\":15},"
+                           "{\"name\":\"skip\",\"address\":48,\"size\":16,\"executed\":1},"
+                           "{\"name\":\"unused\",\"address\":64,\"size\":65472,\"executed\":0}]}\n";
+    return lcovOk && json.str() == expected;
+}
+
+// Informational: cost of marking every instruction
+bool test_overhead() {
+    constexpr int kRuns = 9;
+    // Sum 0x4000 bytes 64 times
+    const std::vector<uint8_t> loop = {
+        0x0E, 0x40,       // LD C,64
+        0x21, 0x00, 0x40, // outer: LD HL,0x4000
+        0x11, 0x00, 0x40, // LD DE,0x4000
+        0x86,             // inner: ADD A,(HL)
+        0x23,             // INC HL
+        0x1B,             // DEC DE
+        0x7A,             // LD A,D
+        0xB3,             // OR E
+        0x20, 0xF9,       // JR NZ,inner
+        0x0D,             // DEC C
+        0x20, 0xF0,       // JR NZ,outer
+        0x76,             // HALT
+    };
+    uint64_t plainTstates = 0;
+    double plainSeconds = bestSeconds(kRuns, [&]() {
+        auto plain = std::make_unique<Z80Machine>();
+        plain->getMemory().load(0, loop.data(), loop.size());
+        plain->runUntil(UINT64_MAX);
+        plainTstates = plain->getTstates();
+    });
+    bool ok = true;
+    double coveredSeconds = bestSeconds(kRuns, [&]() {
+        auto covered = std::make_unique<Z80Machine>();
+        covered->getMemory().load(0, loop.data(), loop.size());
+        Z80Coverage coverage;
+        covered->runCovered(UINT64_MAX, coverage);
+        ok = ok && covered->getTstates() == plainTstates && coverage.getExecuted() == 12;
+    });
+    std::cout << std::fixed << std::setprecision(1) << "  " << (coveredSeconds / plainSeconds - 1) * 100
+              << "% overhead" << '\n';
+    return ok;
+}
+
+int main() {
+    return runTests("Z80 Coverage Test Suite", {
+        {"Instruction lengths", test_instruction_lengths},
+        {"Program coverage and merge", test_program_coverage},
+        {"Banked coverage", test_banked_coverage},
+        {"lcov and JSON reports", test_lcov_and_json_reports},
+        {"Overhead", test_overhead},
+    });
+}
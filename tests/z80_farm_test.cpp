@@ -0,0 +1,140 @@
+// Z80 Farm Test Suite
+// Many independent machines on a work-stealing thread pool, scaling from 1..N threads
+
+#include "../include/z80_farm.h"
+#include "../include/z80_machine.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Endless arithmetic loop writing into page 0x80, seeded by the byte at 0x7000
+const std::vector<uint8_t> kLoopProgram = {
+    0x3A, 0x00, 0x70, // LD A,(0x7000)
+    0x21, 0x00, 0x80, // LD HL,0x8000
+    0x77,             // loop: LD (HL),A
+    0x87,             // ADD A,A
+    0xCE, 0x01,       // ADC A,1
+    0x2C,             // INC L
+    0x18, 0xF9,       // JR loop
+};
+
+// One farm job: a machine that runs for a fixed T-state budget
+class FarmJob {
+  public:
+    FarmJob(uint8_t seed, uint64_t budget) : m_budget(budget) {
+        m_machine.getMemory().load(0, kLoopProgram.data(), kLoopProgram.size());
+        m_machine.getMemory().write(0x7000, seed);
+    }
+
+    uint64_t runSlice(uint64_t quantum) {
+        return m_machine.runSlice(std::min(quantum, m_budget - std::min(m_budget, m_machine.getTstates())));
+    }
+
+    [[nodiscard]] bool isFinished() const {
+        return m_machine.getTstates() >= m_budget || m_machine.isFinished();
+    }
+
+    uint64_t hash() {
+        return m_machine.hash();
+    }
+
+  private:
+    Z80Machine m_machine;
+    uint64_t m_budget;
+};
+
+constexpr size_t kMachines = 64;
+constexpr uint64_t kBudget = 1000000;
+constexpr uint64_t kQuantum = 20000;
+
+// Jain's fairness index: 1.0 when every instance got the same throughput
+double jain_index(const std::vector<double>& values) {
+    double sum = 0.0;
+    double squares = 0.0;
+    for (double value : values) {
+        sum += value;
+        squares += value * value;
+    }
+    return squares > 0.0 ? (sum * sum) / (static_cast<double>(values.size()) * squares) : 1.0;
+}
+
+int main() {
+    try {
+        std::cout << "========================================" << '\n';
+        std::cout << "Z80 Farm Test Suite" << '\n';
+        std::cout << "========================================" << '\n';
+        std::cout << '\n';
+
+        // Reference: every job run serially in a single slice
+        std::vector<uint64_t> expected;
+        for (size_t idx = 0; idx < kMachines; idx++) {
+            FarmJob job(static_cast<uint8_t>(idx), kBudget);
+            job.runSlice(kBudget);
+            expected.push_back(job.hash());
+        }
+
+        // At least two workers, so that stealing is exercised on single core hosts too
+        size_t maxThreads = std::max(2U, std::thread::hardware_concurrency());
+        std::vector<size_t> threadCounts;
+        for (size_t threads = 1; threads < maxThreads; threads *= 2) {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(maxThreads);
+
+        std::cout << kMachines << " machines, " << kBudget << " T-states each, quantum " << kQuantum << '\n';
+        std::cout << '\n';
+        std::cout << std::left << std::setw(10) << "Threads" << std::right << std::setw(12) << "MIPS"
+                  << std::setw(10) << "Speedup" << std::setw(10) << "Jain" << std::setw(16) << "Finish min/max"
+                  << std::setw(10) << "Steals" << '\n';
+
+        bool allPassed = true;
+        double baseMips = 0.0;
+        for (size_t threads : threadCounts) {
+            Z80Farm<FarmJob> farm(kQuantum);
+            for (size_t idx = 0; idx < kMachines; idx++) {
+                farm.add(static_cast<uint8_t>(idx), kBudget);
+            }
+            farm.run(threads);
+
+            uint64_t instructions = 0;
+            uint64_t firstFinish = UINT64_MAX;
+            uint64_t lastFinish = 0;
+            std::vector<double> throughput;
+            bool identical = true;
+            for (size_t idx = 0; idx < kMachines; idx++) {
+                const Z80FarmResult& result = farm.getResults()[idx];
+                instructions += result.instructions;
+                firstFinish = std::min(firstFinish, result.finishNanos);
+                lastFinish = std::max(lastFinish, result.finishNanos);
+                throughput.push_back(static_cast<double>(result.instructions)
+                                     / static_cast<double>(std::max<uint64_t>(result.finishNanos, 1)));
+                identical = identical && farm.machine(idx).isFinished() && farm.machine(idx).hash() == expected[idx];
+            }
+
+            double seconds = static_cast<double>(farm.getElapsedNanos()) / 1e9;
+            double mips = static_cast<double>(instructions) / seconds / 1e6;
+            if (baseMips == 0.0) {
+                baseMips = mips;
+            }
+            std::cout << std::left << std::setw(10) << threads << std::right << std::fixed << std::setprecision(2)
+                      << std::setw(12) << mips << std::setw(9) << mips / baseMips << "x" << std::setw(10)
+                      << std::setprecision(3) << jain_index(throughput) << std::setw(16) << std::setprecision(2)
+                      << static_cast<double>(firstFinish) / static_cast<double>(std::max<uint64_t>(lastFinish, 1))
+                      << std::setw(10) << farm.getSteals() << '\n';
+
+            if (!identical) {
+                std::cout << "✗ " << threads << " threads: results differ from the serial run" << '\n';
+                allPassed = false;
+            }
+        }
+
+        std::cout << '\n';
+        std::cout << (allPassed ? "✓ " : "✗ ") << "Sliced results match the serial run" << '\n';
+        return allPassed ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,114 @@
+// Z80 Footprint Test Suite
+// Per-instance size budget and throughput of large pools of CPUs
+
+#include "../include/z80.h"
+#include "../include/z80_bus_interface.h"
+#include "test_bus.h"
+#include "test_runner.h"
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One bus shared by every CPU of the pool: the program is read-only and
+// only the register state of each CPU is private
+class PoolBus : public Z80BusInterface<PoolBus>, public FlatTestBus {};
+
+// Register-only loop: every CPU keeps its own running state in A, B, C, HL and IX
+const std::vector<uint8_t> kPoolProgram = {
+    0x80,             // loop: ADD A,B
+    0x0D,             // DEC C
+    0x23,             // INC HL
+    0xDD, 0x23,       // INC IX
+    0xA9,             // XOR C
+    0xC3, 0x00, 0x00, // JP loop
+};
+
+using PoolCpu = Z80<PoolBus>;
+
+std::vector<PoolCpu> make_pool(PoolBus& bus, size_t count) {
+    std::vector<PoolCpu> pool(count);
+    for (size_t idx = 0; idx < count; idx++) {
+        pool[idx].rebind(bus);
+        pool[idx].setRegB(static_cast<uint8_t>(idx));
+        pool[idx].setRegC(static_cast<uint8_t>(idx >> 8));
+    }
+    return pool;
+}
+
+// Round-robin, one instruction per CPU per turn: the worst case for a pool,
+// every instruction touches the state of a different CPU
+void run_round_robin(std::vector<PoolCpu>& pool, uint64_t turns) {
+    for (uint64_t turn = 0; turn < turns; turn++) {
+        for (auto& cpu : pool) {
+            cpu.execute();
+        }
+    }
+}
+
+bool test_size_budget() {
+    std::cout << "  sizeof(Z80) = " << sizeof(PoolCpu) << ", alignof(Z80) = " << alignof(PoolCpu) << '\n';
+    return sizeof(PoolCpu) <= PoolCpu::kSizeBudget && alignof(PoolCpu) == 64;
+}
+
+bool test_pool_matches_single_cpu() {
+    auto bus = std::make_unique<PoolBus>();
+    bus->load(0, kPoolProgram);
+    std::vector<PoolCpu> pool = make_pool(*bus, 300);
+    run_round_robin(pool, 1000);
+
+    for (size_t idx = 0; idx < pool.size(); idx++) {
+        PoolCpu single(*bus);
+        single.setRegB(static_cast<uint8_t>(idx));
+        single.setRegC(static_cast<uint8_t>(idx >> 8));
+        for (int step = 0; step < 1000; step++) {
+            single.execute();
+        }
+        Z80State expected = single.getState();
+        Z80State actual = pool[idx].getState();
+        if (expected.af != actual.af || expected.bc != actual.bc || expected.hl != actual.hl
+            || expected.ix != actual.ix || expected.pc != actual.pc || expected.r != actual.r) {
+            std::cout << "  CPU " << idx << " differs from a single CPU" << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same number of instructions for every pool size; the pool footprint walks
+// from L1 through L2 and L3 into main memory
+bool test_many_instance_throughput() {
+    constexpr uint64_t kInstructions = 8000000;
+    auto bus = std::make_unique<PoolBus>();
+    bus->load(0, kPoolProgram);
+
+    std::cout << "  " << std::setw(8) << "CPUs" << std::setw(12) << "Footprint" << std::setw(12) << "ns/instr"
+              << std::setw(10) << "MIPS" << '\n';
+    for (size_t count : {16, 256, 4096, 65536, 262144}) {
+        std::vector<PoolCpu> pool = make_pool(*bus, count);
+        uint64_t turns = kInstructions / count;
+        run_round_robin(pool, 1); // Warm up: page in the pool
+
+        auto start = std::chrono::steady_clock::now();
+        run_round_robin(pool, turns);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        double instructions = static_cast<double>(turns * count);
+        std::cout << "  " << std::setw(8) << count << std::setw(9) << (count * sizeof(PoolCpu)) / 1024 << " KiB"
+                  << std::fixed << std::setprecision(2) << std::setw(12) << seconds * 1e9 / instructions
+                  << std::setw(10) << instructions / seconds / 1e6 << '\n';
+    }
+    // Informational only: the knees depend on the cache sizes of the host
+    return true;
+}
+
+int main() {
+    return runTests("Z80 Footprint Test Suite", {
+        {"CPU state fits the size budget", test_size_budget},
+        {"Pooled CPUs match a single CPU", test_pool_matches_single_cpu},
+        {"Many-instance throughput", test_many_instance_throughput},
+    });
+}
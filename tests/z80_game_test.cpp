@@ -1,11 +1,15 @@
 // Z80 Game Benchmark Test Suite
-// Runs real Spectrum games (extracted from TAP files) as benchmarks
+// Runs real Spectrum games (extracted from TAP files) as benchmarks, in parallel on pinned threads
 
 #include "benchmark_shared.h"
 #include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -86,6 +90,40 @@ bool load_game_from_tap(const std::string& tap_path, BenchmarkConfig& config) {
     return found_code;
 }
 
+// One benchmark run: a game with a seed
+struct GameJob {
+    BenchmarkConfig config;
+    BenchmarkResult result;
+    std::string output;
+};
+
+// Run the jobs on 'threads' workers, worker N pinned to the Nth available host CPU
+void run_jobs(std::vector<GameJob>& jobs, size_t threads) {
+    std::vector<int> cpus = availableCpus();
+    std::atomic<size_t> next{0};
+
+    auto worker = [&](size_t id) {
+        int cpu = -1;
+        if (!cpus.empty() && pinCurrentThread(cpus[id % cpus.size()])) {
+            cpu = cpus[id % cpus.size()];
+        }
+        for (size_t idx = next++; idx < jobs.size(); idx = next++) {
+            std::ostringstream output;
+            jobs[idx].result = runBenchmark(jobs[idx].config, output);
+            jobs[idx].result.cpu = cpu;
+            jobs[idx].output = output.str();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t id = 0; id < threads; id++) {
+        pool.emplace_back(worker, id);
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
 int main(int argc, char* argv[]) {
     try {
         std::cout << "========================================" << '\n';
@@ -93,6 +131,37 @@ int main(int argc, char* argv[]) {
         std::cout << "========================================" << '\n';
         std::cout << '\n';
 
+        // Options: --threads N, --seeds N, --instructions N, --warmup N, --repeats N, --json FILE
+        size_t threads = std::max<size_t>(1, availableCpus().size());
+        uint32_t seeds = 1;
+        int64_t instructions = 5000000; // Run for 5M instructions
+        int warmup = 0;
+        int repeats = 1;
+        std::string json_path = "game_benchmark.json";
+        for (int idx = 1; idx < argc; idx += 2) {
+            std::string option = argv[idx];
+            if (idx + 1 == argc) {
+                std::cerr << "Missing value for option: " << option << '\n';
+                return 1;
+            }
+            if (option == "--threads") {
+                threads = std::max<size_t>(1, std::stoul(argv[idx + 1]));
+            } else if (option == "--seeds") {
+                seeds = std::max<uint32_t>(1, std::stoul(argv[idx + 1]));
+            } else if (option == "--instructions") {
+                instructions = std::stoll(argv[idx + 1]);
+            } else if (option == "--warmup") {
+                warmup = std::max(0, std::stoi(argv[idx + 1]));
+            } else if (option == "--repeats") {
+                repeats = std::max(1, std::stoi(argv[idx + 1]));
+            } else if (option == "--json") {
+                json_path = argv[idx + 1];
+            } else {
+                std::cerr << "Unknown option: " << option << '\n';
+                return 1;
+            }
+        }
+
         // Dynamically find all TAP files in the roms directory
         std::vector<std::string> tap_files;
         const std::string roms_dir = "roms";
@@ -108,29 +177,40 @@ int main(int argc, char* argv[]) {
             std::cerr << "Warning: roms directory not found\n";
         }
 
-        std::vector<BenchmarkResult> results;
-        int passed = 0;
-        int failed = 0;
-
+        // Seed 0 is the plain run, other seeds randomize free RAM and R
+        std::vector<GameJob> jobs;
         for (const auto& tap_file : tap_files) {
             BenchmarkConfig config;
-            // Set default expectations
-            config.instructions = 5000000;  // Run for 5M instructions
+            config.instructions = instructions;
+            config.warmup = warmup;
+            config.repeats = repeats;
             config.expected_min_mips = 5.0; // Expect at least 5 MIPS (tolerant minimum)
 
-            if (load_game_from_tap(tap_file, config)) {
-                BenchmarkResult result = runBenchmark(config);
-                results.push_back(result);
+            if (!load_game_from_tap(tap_file, config)) {
+                std::cout << "Skipping " << tap_file << " (not found or no code block)\n";
+                continue;
+            }
+            for (uint32_t seed = 0; seed < seeds; seed++) {
+                config.seed = seed;
+                jobs.push_back({config, {}, {}});
+            }
+        }
 
-                if (result.passed) {
-                    passed++;
-                } else {
-                    failed++;
-                }
+        threads = std::min(threads, std::max<size_t>(1, jobs.size()));
+        std::cout << "Running " << jobs.size() << " benchmarks on " << threads << " threads\n\n";
+        run_jobs(jobs, threads);
+
+        std::vector<BenchmarkResult> results;
+        int passed = 0;
+        int failed = 0;
+        for (const auto& job : jobs) {
+            std::cout << job.output;
+            results.push_back(job.result);
+            if (job.result.passed) {
+                passed++;
             } else {
-                std::cout << "Skipping " << tap_file << " (not found or no code block)\n";
+                failed++;
             }
-            std::cout << '\n';
         }
 
         // Summary
@@ -142,6 +222,29 @@ int main(int argc, char* argv[]) {
         std::cout << "Failed: " << failed << '\n';
         std::cout << '\n';
 
+        // Per-game spread over the seeds
+        for (size_t first = 0; first < results.size(); first += seeds) {
+            double min_mips = results[first].mips;
+            double max_mips = results[first].mips;
+            double total_cpi = 0;
+            double total_misses = 0;
+            bool misses = true;
+            for (size_t idx = first; idx < first + seeds && idx < results.size(); idx++) {
+                min_mips = std::min(min_mips, results[idx].mips);
+                max_mips = std::max(max_mips, results[idx].mips);
+                total_cpi += results[idx].cycles_per_instruction;
+                total_misses += results[idx].branch_misses_per_instruction;
+                misses = misses && results[idx].branch_misses_per_instruction >= 0;
+            }
+            std::cout << std::fixed << std::setprecision(2) << "  " << std::left << std::setw(24)
+                      << results[first].name << std::right << " MIPS " << min_mips << " - " << max_mips
+                      << ", host cycles/instruction " << total_cpi / seeds;
+            if (misses) {
+                std::cout << std::setprecision(4) << ", branch misses/instruction " << total_misses / seeds;
+            }
+            std::cout << '\n';
+        }
+
         // Calculate average performance
         double total_mips = 0;
         int valid_results = 0;
@@ -162,6 +265,14 @@ int main(int argc, char* argv[]) {
             return 0;
         }
 
+        std::ofstream json(json_path, std::ios::trunc);
+        if (json.is_open()) {
+            writeBenchmarkJson(json, results);
+            std::cout << "JSON results written to " << json_path << '\n';
+        } else {
+            std::cerr << "Error: cannot write " << json_path << '\n';
+        }
+
         return (failed == 0) ? 0 : 1;
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << '\n';
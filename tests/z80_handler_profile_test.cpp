@@ -0,0 +1,189 @@
+// Z80 Handler Profile Test Suite
+// Host time per opcode handler, built with WITH_HANDLER_PROFILING and WITH_OPCODE_HISTOGRAM
+
+#include "../include/z80.h"
+#include "../include/z80_bus_interface.h"
+#include "../include/z80_handler_profile.h"
+#include "../include/z80_histogram.h"
+#include "test_bus.h"
+#include "test_runner.h"
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef WITH_HANDLER_PROFILING
+#    error "This test must be built with WITH_HANDLER_PROFILING"
+#endif
+
+#ifndef WITH_OPCODE_HISTOGRAM
+#    error "This test must be built with WITH_OPCODE_HISTOGRAM"
+#endif
+
+// Port reads take 'portDelay' of host time
+class ProfileBus : public Z80BusInterface<ProfileBus>, public TestBus<ProfileBus> {
+  public:
+    std::chrono::nanoseconds portDelay{0};
+
+    uint8_t inPortImpl(uint16_t port) {
+        auto until = std::chrono::steady_clock::now() + portDelay;
+        while (std::chrono::steady_clock::now() < until) {
+        }
+        return FlatTestBus::inPortImpl(port);
+    }
+};
+
+// Instructions from every table, 200 times
+const std::vector<uint8_t> kAllTablesProgram = {
+    0x31, 0x00, 0xF0,       // 0x0000: LD SP,0xF000
+    0x06, 0xC8,             // LD B,200
+    0x21, 0x00, 0x80,       // 0x0005 loop: LD HL,0x8000
+    0xCB, 0x06,             // RLC (HL)
+    0xDD, 0x21, 0x00, 0x80, // LD IX,0x8000
+    0xDD, 0xCB, 0x02, 0xCE, // SET 1,(IX+2)
+    0xFD, 0x7E, 0x00,       // LD A,(IY+0)
+    0xED, 0x44,             // NEG
+    0x10, 0xEC,             // DJNZ loop
+    0x76,                   // HALT
+};
+
+// 256 rounds of three NOPs and a port read
+const std::vector<uint8_t> kPortProgram = {
+    0x06, 0x00, // 0x0000: LD B,0
+    0x00,       // 0x0002 loop: NOP
+    0x00,       // NOP
+    0x00,       // NOP
+    0xED, 0x78, // IN A,(C)
+    0x10, 0xF9, // DJNZ loop
+    0x76,       // HALT
+};
+
+bool test_counts_match_histogram() {
+    auto bus = std::make_unique<ProfileBus>();
+    bus->load(0, kAllTablesProgram);
+    Z80HandlerProfile profile;
+    Z80OpcodeHistogram histogram;
+    bus->cpu.setHandlerProfile(&profile);
+    bus->cpu.setOpcodeHistogram(&histogram);
+    bus->runToHalt();
+    // Ten NOPs while halted
+    for (int idx = 0; idx < 10; idx++) {
+        bus->cpu.execute();
+    }
+
+    // Every instruction is charged once, to the entry the histogram counts last
+    bool ok = profile.getCount(Z80OpcodeTable::Main, 0x76) == 11 && profile.getCount(Z80OpcodeTable::CB, 0x06) == 200
+              && profile.getCount(Z80OpcodeTable::DDCB, 0xCE) == 200 && profile.getCount(Z80OpcodeTable::FD, 0x7E) == 200
+              && profile.getCount(Z80OpcodeTable::ED, 0x44) == 200 && profile.getCount(Z80OpcodeTable::Main, 0xDD) == 0;
+    uint64_t charged = 0;
+    for (size_t table = 0; ok && table < Z80HandlerProfile::kTables; table++) {
+        for (uint32_t opcode = 0; ok && opcode < 256; opcode++) {
+            auto tbl = static_cast<Z80OpcodeTable>(table);
+            auto op = static_cast<uint8_t>(opcode);
+            uint64_t expected = Z80OpcodeHistogram::isPrefix(tbl, op) ? 0 : histogram.get(tbl, op);
+            ok = profile.getCount(tbl, op) == expected;
+            charged += profile.getCount(tbl, op);
+        }
+    }
+    ok = ok && charged == histogram.getInstructions();
+
+    // Detached, nothing more is charged; merged, everything counts twice
+    bus->cpu.setHandlerProfile(nullptr);
+    bus->cpu.execute();
+    Z80HandlerProfile twice;
+    twice.merge(profile);
+    twice.merge(profile);
+    ok = ok && profile.getCount(Z80OpcodeTable::Main, 0x76) == 11 && bus->cpu.getHandlerProfile() == nullptr
+         && twice.getCount(Z80OpcodeTable::CB, 0x06) == 400
+         && twice.getTotalTicks() == 2 * profile.getTotalTicks();
+    twice.clear();
+    return ok && twice.getTotalTicks() == 0 && twice.getTop().empty();
+}
+
+bool test_slow_handler_ranks_first() {
+    auto bus = std::make_unique<ProfileBus>();
+    bus->load(0, kPortProgram);
+    bus->portDelay = std::chrono::microseconds(2);
+    Z80HandlerProfile profile;
+    bus->cpu.setHandlerProfile(&profile);
+    bus->runToHalt();
+
+    std::vector<Z80HandlerProfile::Entry> top = profile.getTop();
+    bool sorted = true;
+    for (size_t idx = 1; idx < top.size(); idx++) {
+        sorted = sorted && top[idx - 1].ticks >= top[idx].ticks;
+    }
+    // 2 us is thousands of ticks; a NOP after calibration is a few dozen at most
+    double inPerOp = static_cast<double>(profile.getTicks(Z80OpcodeTable::ED, 0x78)) / 256;
+    double nopPerOp = static_cast<double>(profile.getTicks(Z80OpcodeTable::Main, 0x00)) / 768;
+    double delayTicks = 2000 * profile.getTicksPerNs();
+    std::cout << std::fixed << std::setprecision(1) << "  IN A,(C) " << inPerOp << " ticks, NOP " << nopPerOp
+              << " ticks (" << Z80HandlerProfile::getClockName() << ", overhead " << profile.getOverhead()
+              << " ticks, " << profile.getTicksPerNs() << " ticks/ns)" << '\n';
+    return sorted && !top.empty() && top[0].table == Z80OpcodeTable::ED && top[0].opcode == 0x78
+           && top[0].count == 256 && profile.getCount(Z80OpcodeTable::Main, 0x00) == 768
+           && inPerOp >= delayTicks * 0.9 && nopPerOp * 10 < inPerOp;
+}
+
+bool test_csv_report() {
+    auto bus = std::make_unique<ProfileBus>();
+    bus->load(0, kPortProgram);
+    bus->portDelay = std::chrono::microseconds(1);
+    Z80HandlerProfile profile;
+    bus->cpu.setHandlerProfile(&profile);
+    bus->runToHalt();
+
+    std::ostringstream csv;
+    profile.writeCsv(csv);
+    std::istringstream in(csv.str());
+    std::string line;
+    std::getline(in, line);
+    bool ok = line == "table,opcode,count,ticks,ticks_per_op,share";
+    std::getline(in, line);
+    ok = ok && line.rfind("ed,0x78,256,", 0) == 0;
+
+    // Main NOP, LD B,n, DJNZ, HALT and ED IN A,(C), shares adding up to 1
+    size_t rows = 1;
+    double shares = std::stod(line.substr(line.rfind(',') + 1));
+    while (std::getline(in, line)) {
+        rows++;
+        shares += std::stod(line.substr(line.rfind(',') + 1));
+    }
+    return ok && rows == profile.getTop().size() && rows == 5 && std::fabs(shares - 1.0) < 1e-3;
+}
+
+// Informational: cost of timing every instruction
+bool test_overhead() {
+    constexpr int kRuns = 5;
+    constexpr int kInstructions = 2000000;
+    // LD HL,0x8000; loop: INC (HL); DEC HL; INC HL; JR loop
+    const std::vector<uint8_t> loop = {0x21, 0x00, 0x80, 0x34, 0x2B, 0x23, 0x18, 0xFB};
+    Z80HandlerProfile profile;
+    auto timed = [&loop](Z80HandlerProfile* target) {
+        auto bus = std::make_unique<ProfileBus>();
+        bus->load(0, loop);
+        bus->cpu.setHandlerProfile(target);
+        for (int idx = 0; idx < kInstructions; idx++) {
+            bus->cpu.execute();
+        }
+    };
+    double detached = bestSeconds(kRuns, [&timed]() { timed(nullptr); });
+    double attached = bestSeconds(kRuns, [&]() { timed(&profile); });
+    std::cout << std::fixed << std::setprecision(2) << "  detached " << detached * 1e9 / kInstructions
+              << " ns/instr, attached " << attached * 1e9 / kInstructions << " ns/instr" << '\n';
+    return profile.getCount(Z80OpcodeTable::Main, 0x34) == kRuns * kInstructions / 4;
+}
+
+int main() {
+    return runTests("Z80 Handler Profile Test Suite", {
+        {"Counts match the opcode histogram", test_counts_match_histogram},
+        {"Slow handler ranks first", test_slow_handler_ranks_first},
+        {"CSV report", test_csv_report},
+        {"Overhead", test_overhead},
+    });
+}
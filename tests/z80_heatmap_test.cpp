@@ -0,0 +1,185 @@
+// Z80 Heatmap Test Suite
+// Per-address read/write/execute counters filled by an instrumentation bus layer
+
+#include "../include/z80.h"
+#include "../include/z80_heatmap.h"
+#include "../include/z80_machine.h"
+#include "test_runner.h"
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using Kind = Z80Heatmap::Kind;
+using HeatmapCpu = Z80<Z80HeatmapBus<Z80Machine>>;
+
+// Fills 100 bytes, then reads a byte and a word
+const std::vector<uint8_t> kFillProgram = {
+    0x21, 0x00, 0x80,       // 0x0000: LD HL,0x8000
+    0x06, 0x64,             // LD B,100
+    0x77,                   // 0x0005 loop: LD (HL),A
+    0x23,                   // INC HL
+    0x10, 0xFC,             // DJNZ loop
+    0x3A, 0x00, 0x90,       // LD A,(0x9000)
+    0xED, 0x4B, 0x02, 0x90, // LD BC,(0x9002)
+    0x76,                   // HALT
+};
+
+// Copies 4K back and forth 64 times
+const std::vector<uint8_t> kCopyProgram = {
+    0x3E, 0x40,             // 0x0000: LD A,64
+    0x21, 0x00, 0x40,       // loop: LD HL,0x4000
+    0x11, 0x00, 0x80,       // LD DE,0x8000
+    0x01, 0x00, 0x10,       // LD BC,0x1000
+    0xED, 0xB0,             // LDIR
+    0xEB,                   // EX DE,HL
+    0x2B,                   // DEC HL
+    0x1B,                   // DEC DE
+    0x01, 0x00, 0x10,       // LD BC,0x1000
+    0xED, 0xB8,             // LDDR
+    0x3D,                   // DEC A
+    0x20, 0xEA,             // JR NZ,loop
+    0x76,                   // HALT
+};
+
+uint64_t run(HeatmapCpu& cpu) {
+    uint64_t instructions = 0;
+    while (!cpu.isHalted()) {
+        cpu.execute();
+        instructions++;
+    }
+    return instructions;
+}
+
+bool test_counts_per_address() {
+    auto machine = std::make_unique<Z80Machine>();
+    machine->getMemory().load(0, kFillProgram.data(), kFillProgram.size());
+    Z80HeatmapBus<Z80Machine> bus(*machine);
+    HeatmapCpu cpu(bus);
+    run(cpu);
+
+    const Z80Heatmap& heat = bus.getHeatmap();
+    bool writes = true;
+    for (uint32_t address = 0x8000; address < 0x8000 + 100; address++) {
+        writes = writes && heat.get(Kind::Write, address) == 1 && heat.get(Kind::Read, address) == 0;
+    }
+    // Prefix fetches count as Exec; operands and displacements as Read
+    return writes && heat.get(Kind::Write, 0x8000 + 100) == 0 && heat.get(Kind::Exec, 0x0005) == 100
+           && heat.get(Kind::Exec, 0x0007) == 100 && heat.get(Kind::Read, 0x0008) == 100
+           && heat.get(Kind::Exec, 0x0008) == 0 && heat.get(Kind::Read, 0x0004) == 1
+           && heat.get(Kind::Exec, 0x000C) == 1 && heat.get(Kind::Exec, 0x000D) == 1
+           && heat.get(Kind::Read, 0x0001) == 1 && heat.get(Kind::Read, 0x9000) == 1
+           && heat.get(Kind::Read, 0x9002) == 1 && heat.get(Kind::Read, 0x9003) == 1
+           && heat.get(Kind::Read, 0x9001) == 0 && machine->getTstates() > 0;
+}
+
+bool test_binary_round_trip_and_saturation() {
+    Z80Heatmap heat;
+    heat.count(Kind::Exec, 0x1234);
+    heat.count(Kind::Write, 0xFFFF);
+    for (int idx = 0; idx < 3; idx++) {
+        heat.count(Kind::Read, 0x0000);
+    }
+
+    // A counter one below saturation, patched into the file
+    std::string path = temp_path("z80_heatmap_test.bin");
+    if (!heat.writeBinary(path)) {
+        return false;
+    }
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(12 + (2 * 0x10000 + 0x4000) * 4);
+        for (uint8_t byte : {0xFE, 0xFF, 0xFF, 0xFF}) {
+            file.put(static_cast<char>(byte));
+        }
+    }
+    Z80Heatmap loaded;
+    bool ok = loaded.readBinary(path) && loaded.get(Kind::Exec, 0x1234) == 1 && loaded.get(Kind::Write, 0xFFFF) == 1
+              && loaded.get(Kind::Read, 0x0000) == 3 && loaded.get(Kind::Exec, 0x4000) == UINT32_MAX - 1;
+    loaded.count(Kind::Exec, 0x4000);
+    loaded.count(Kind::Exec, 0x4000);
+    ok = ok && loaded.get(Kind::Exec, 0x4000) == UINT32_MAX;
+
+    Z80Heatmap other;
+    other.count(Kind::Exec, 0x4000);
+    other.count(Kind::Read, 0x0000);
+    loaded.merge(other);
+    ok = ok && loaded.get(Kind::Exec, 0x4000) == UINT32_MAX && loaded.get(Kind::Read, 0x0000) == 4;
+
+    std::filesystem::resize_file(path, 1000);
+    Z80Heatmap truncated;
+    ok = ok && !truncated.readBinary(path);
+    std::filesystem::remove(path);
+    return ok;
+}
+
+bool test_pgm_export() {
+    auto machine = std::make_unique<Z80Machine>();
+    machine->getMemory().load(0, kCopyProgram.data(), kCopyProgram.size());
+    Z80HeatmapBus<Z80Machine> bus(*machine);
+    HeatmapCpu cpu(bus);
+    run(cpu);
+
+    std::string path = temp_path("z80_heatmap_test.pgm");
+    if (!bus.getHeatmap().writePgm(path, Kind::Write)) {
+        return false;
+    }
+    std::ifstream file(path, std::ios::binary);
+    std::string magic;
+    int width = 0;
+    int height = 0;
+    int maxValue = 0;
+    file >> magic >> width >> height >> maxValue;
+    file.get();
+    std::vector<uint8_t> pixels(0x10000);
+    file.read(reinterpret_cast<char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+    bool complete = file.gcount() == static_cast<std::streamsize>(pixels.size()) && file.peek() == EOF;
+    std::filesystem::remove(path);
+
+    // Both buffers are written 64 times, nothing else is
+    bool ok = magic == "P5" && width == 256 && height == 256 && maxValue == 255 && complete;
+    for (uint32_t address = 0; ok && address < 0x10000; address++) {
+        bool buffer = (address >= 0x4000 && address < 0x5000) || (address >= 0x8000 && address < 0x9000);
+        ok = pixels[address] == (buffer ? 255 : 0);
+    }
+    return ok;
+}
+
+// Informational: cost of the layer on a memory-bound loop, best of several runs
+bool test_overhead() {
+    constexpr int kRuns = 9;
+    uint64_t instructions = 0;
+    uint64_t heatInstructions = 0;
+    double plainSeconds = bestSeconds(kRuns, [&]() {
+        auto machine = std::make_unique<Z80Machine>();
+        machine->getMemory().load(0, kCopyProgram.data(), kCopyProgram.size());
+        instructions = 0;
+        while (!machine->isFinished()) {
+            machine->getCpu().execute();
+            instructions++;
+        }
+    });
+    double heatSeconds = bestSeconds(kRuns, [&]() {
+        auto machine = std::make_unique<Z80Machine>();
+        machine->getMemory().load(0, kCopyProgram.data(), kCopyProgram.size());
+        Z80HeatmapBus<Z80Machine> bus(*machine);
+        HeatmapCpu cpu(bus);
+        heatInstructions = run(cpu);
+    });
+    std::cout << std::fixed << std::setprecision(2) << "  plain " << plainSeconds * 1e9 / instructions
+              << " ns/instr, heatmap " << heatSeconds * 1e9 / heatInstructions << " ns/instr ("
+              << (heatSeconds / plainSeconds - 1) * 100 << "% overhead)" << '\n';
+    return instructions == heatInstructions;
+}
+
+int main() {
+    return runTests("Z80 Heatmap Test Suite", {
+        {"Counts per address", test_counts_per_address},
+        {"Binary round trip and saturation", test_binary_round_trip_and_saturation},
+        {"PGM export", test_pgm_export},
+        {"Overhead", test_overhead},
+    });
+}
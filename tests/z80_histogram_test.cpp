@@ -0,0 +1,114 @@
+// Z80 Opcode Histogram Test Suite
+// Per-opcode execution counts, built with WITH_OPCODE_HISTOGRAM
+
+#include "../include/z80.h"
+#include "../include/z80_bus_interface.h"
+#include "../include/z80_histogram.h"
+#include "test_bus.h"
+#include "test_runner.h"
+#include <array>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef WITH_OPCODE_HISTOGRAM
+#    error "This test must be built with WITH_OPCODE_HISTOGRAM"
+#endif
+
+class HistogramBus : public Z80BusInterface<HistogramBus>, public TestBus<HistogramBus> {};
+
+// One instruction from each of the 7 tables, a DD prefix in front of an unprefixed opcode, then HALT
+const std::vector<uint8_t> kAllTablesProgram = {
+    0x00,                   // NOP
+    0x06, 0x12,             // LD B,0x12
+    0xCB, 0x00,             // RLC B
+    0xED, 0x44,             // NEG
+    0xDD, 0x21, 0x00, 0x80, // LD IX,0x8000
+    0xFD, 0x23,             // INC IY
+    0xDD, 0xCB, 0x05, 0x06, // RLC (IX+5)
+    0xFD, 0xCB, 0x00, 0x46, // BIT 0,(IY+0)
+    0xDD, 0x00,             // NOP, with an ignored DD prefix
+    0x76,                   // HALT
+};
+
+// Runs the program to HALT plus three halted steps
+void run_all_tables(Z80OpcodeHistogram* histogram) {
+    auto bus = std::make_unique<HistogramBus>();
+    bus->load(0, kAllTablesProgram);
+    bus->cpu.setOpcodeHistogram(histogram);
+    bus->runToHalt();
+    for (int step = 0; step < 3; step++) {
+        bus->cpu.execute();
+    }
+}
+
+bool test_counts_per_table() {
+    Z80OpcodeHistogram histogram;
+    run_all_tables(&histogram);
+
+    using T = Z80OpcodeTable;
+    return histogram.get(T::Main, 0x00) == 1 && histogram.get(T::Main, 0x06) == 1 && histogram.get(T::Main, 0xCB) == 1
+           && histogram.get(T::Main, 0xED) == 1 && histogram.get(T::Main, 0xDD) == 3
+           && histogram.get(T::Main, 0xFD) == 2 && histogram.get(T::Main, 0x76) == 4 && histogram.get(T::CB, 0x00) == 1
+           && histogram.get(T::ED, 0x44) == 1 && histogram.get(T::DD, 0x21) == 1 && histogram.get(T::DD, 0xCB) == 1
+           && histogram.get(T::DD, 0x00) == 1 && histogram.get(T::FD, 0x23) == 1 && histogram.get(T::FD, 0xCB) == 1
+           && histogram.get(T::DDCB, 0x06) == 1 && histogram.get(T::FDCB, 0x46) == 1;
+}
+
+bool test_totals() {
+    Z80OpcodeHistogram histogram;
+    run_all_tables(&histogram);
+    // 10 instructions to the HALT plus 3 halted steps, 9 prefix bytes on the way
+    return histogram.getTotal() == 22 && histogram.getInstructions() == 13;
+}
+
+bool test_detached_cpu_counts_nothing() {
+    Z80OpcodeHistogram histogram;
+    run_all_tables(nullptr);
+    return histogram.getTotal() == 0;
+}
+
+bool test_merge_across_instances() {
+    std::vector<Z80OpcodeHistogram> perCpu(4);
+    for (auto& histogram : perCpu) {
+        run_all_tables(&histogram);
+    }
+    Z80OpcodeHistogram merged;
+    for (const auto& histogram : perCpu) {
+        merged.merge(histogram);
+    }
+    std::vector<Z80OpcodeHistogram::Entry> top = merged.getTop(2);
+    return merged.getInstructions() == 4 * 13 && top.size() == 2 && top[0].table == Z80OpcodeTable::Main
+           && top[0].opcode == 0x76 && top[0].count == 16 && top[1].opcode == 0xDD && top[1].count == 12;
+}
+
+bool test_csv_and_json_dumps() {
+    Z80OpcodeHistogram histogram;
+    run_all_tables(&histogram);
+
+    std::ostringstream csv;
+    histogram.writeCsv(csv);
+    std::ostringstream json;
+    histogram.writeJson(json);
+    std::cout << "  " << histogram.getTop().size() << " distinct entries, JSON " << json.str().size() << " bytes"
+              << '\n';
+
+    const std::string& csvText = csv.str();
+    const std::string& jsonText = json.str();
+    return csvText.rfind("table,opcode,count\n", 0) == 0 && csvText.find("\nddcb,0x06,1\n") != std::string::npos
+           && csvText.find("\nmain,0x76,4\n") != std::string::npos
+           && jsonText.find("\"total\": 22") != std::string::npos
+           && jsonText.find("\"fdcb\": {\"0x46\": 1}") != std::string::npos;
+}
+
+int main() {
+    return runTests("Z80 Opcode Histogram Test Suite", {
+        {"Counts per opcode table", test_counts_per_table},
+        {"Totals and instruction count", test_totals},
+        {"CPU without histogram counts nothing", test_detached_cpu_counts_nothing},
+        {"Merged report across instances", test_merge_across_instances},
+        {"CSV and JSON dumps", test_csv_and_json_dumps},
+    });
+}
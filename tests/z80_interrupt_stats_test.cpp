@@ -0,0 +1,183 @@
+// Z80 Interrupt Statistics Test Suite
+// INT latency, HALT idle time, disabled time and NMI counts per machine, built with WITH_FLOW_EVENTS
+
+#include "../include/z80.h"
+#include "../include/z80_interrupt_stats.h"
+#include "../include/z80_machine.h"
+#include "test_runner.h"
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef WITH_FLOW_EVENTS
+#    error "This test must be built with WITH_FLOW_EVENTS"
+#endif
+
+constexpr uint64_t kFrameTstates = 69888;
+constexpr uint64_t kIntLength = 32;
+
+// The main loop waits for the frame interrupt; the ISR copies (0xA000) bytes
+const std::vector<uint8_t> kMain = {
+    0x31, 0x00, 0xF0, // 0x0000: LD SP,0xF000
+    0xED, 0x56,       // IM 1
+    0xFB,             // EI
+    0x76,             // 0x0006 loop: HALT
+    0x18, 0xFD,       // JR loop
+};
+
+const std::vector<uint8_t> kIsr = {
+    0xF5,                   // 0x0038: PUSH AF
+    0x21, 0x00, 0x40,       // LD HL,0x4000
+    0x11, 0x00, 0x80,       // LD DE,0x8000
+    0xED, 0x4B, 0x00, 0xA0, // LD BC,(0xA000)
+    0x78,                   // LD A,B
+    0xB1,                   // OR C
+    0x28, 0x02,             // JR Z,done
+    0xED, 0xB0,             // LDIR
+    0xF1,                   // done: POP AF
+    0xFB,                   // EI
+    0xED, 0x4D,             // RETI
+};
+
+const std::vector<uint8_t> kNmi = {
+    0xED, 0x45, // 0x0066: RETN
+};
+
+std::unique_ptr<Z80Machine> make_machine(uint16_t copyLength) {
+    auto machine = std::make_unique<Z80Machine>();
+    machine->getMemory().load(0x0000, kMain.data(), kMain.size());
+    machine->getMemory().load(0x0038, kIsr.data(), kIsr.size());
+    machine->getMemory().load(0x0066, kNmi.data(), kNmi.size());
+    machine->getMemory().write(0xA000, static_cast<uint8_t>(copyLength));
+    machine->getMemory().write(0xA001, static_cast<uint8_t>(copyLength >> 8));
+    return machine;
+}
+
+void run_to(Z80Machine& machine, uint64_t until) {
+    while (machine.getTstates() < until) {
+        machine.getCpu().execute();
+    }
+}
+
+// INT for the first 32 T-states of the frame
+void run_frame(Z80Machine& machine, uint64_t frame) {
+    uint64_t start = frame * kFrameTstates;
+    run_to(machine, start);
+    machine.setActiveINT(true);
+    run_to(machine, start + kIntLength);
+    machine.setActiveINT(false);
+    run_to(machine, start + kFrameTstates);
+}
+
+bool test_idle_frames() {
+    auto machine = make_machine(0);
+    Z80InterruptStats stats;
+    machine->setInterruptStats(&stats);
+
+    // Per-frame halted share once the boot code is done
+    bool idle = true;
+    uint64_t interrupts = 0;
+    for (uint64_t frame = 0; frame < 20; frame++) {
+        run_frame(*machine, frame);
+        uint64_t end = machine->getTstates();
+        stats.split(end);
+        uint64_t length = end - (frame == 0 ? 0 : frame * kFrameTstates);
+        if (frame > 0) {
+            idle = idle && stats.getHaltedTstates() <= length && stats.getHaltedTstates() + 150 > length
+                   && stats.getDisabledTstates() < 150 && stats.getInterrupts() == 1;
+        }
+        interrupts += stats.getInterrupts();
+        if (frame + 1 < 20) {
+            stats.clear();
+        }
+    }
+
+    // The CPU is halted when INT rises: a HALT NOP at most, then the acknowledge up to the push
+    const Z80TstateHistogram& latency = stats.getIntLatency();
+    const Z80TstateHistogram& disabled = stats.getDisabledPeriods();
+    return idle && interrupts == 20 && machine->getInterruptStats() == &stats && stats.getMissedInts() == 0
+           && stats.getIntsAsserted() == 1 && latency.getCount() == 1 && latency.getMin() >= 13
+           && latency.getMax() <= 13 + 4 && stats.getHaltPeriods().getCount() == 1 && disabled.getCount() == 1
+           && disabled.getMin() > 50 && disabled.getMax() < 150 && stats.isHalted() && stats.getNmis() == 0;
+}
+
+bool test_busy_isr_misses_interrupts() {
+    // Each ISR takes about a frame and a half, so the INT rising inside it is never seen;
+    // interrupts are also disabled from reset to the first EI
+    auto machine = make_machine(5000);
+    Z80InterruptStats stats;
+    machine->setInterruptStats(&stats);
+    for (uint64_t frame = 0; frame < 12; frame++) {
+        run_frame(*machine, frame);
+    }
+    stats.split(machine->getTstates());
+
+    const Z80TstateHistogram& disabled = stats.getDisabledPeriods();
+    return stats.getIntsAsserted() == 12 && stats.getMissedInts() == 6
+           && stats.getInterrupts() + stats.getMissedInts() == stats.getIntsAsserted()
+           && stats.getIntLatency().getCount() == stats.getInterrupts() && disabled.getCount() == 1 + 6
+           && disabled.getMin() < 30 && disabled.percentile(0.5) > 5000 * 21
+           && stats.getDisabledTstates() > stats.getHaltedTstates();
+}
+
+bool test_nmi_while_halted() {
+    auto machine = make_machine(0);
+    run_frame(*machine, 0);
+    Z80InterruptStats stats;
+    machine->setInterruptStats(&stats);
+    if (!stats.isHalted()) {
+        return false;
+    }
+
+    // NMI in a frame without INT: the HALT ends, RETN restores IFF1 and the loop halts again
+    run_to(*machine, kFrameTstates + 1000);
+    machine->getCpu().triggerNMI();
+    run_frame(*machine, 2);
+    stats.split(machine->getTstates());
+
+    const Z80TstateHistogram& halts = stats.getHaltPeriods();
+    const Z80TstateHistogram& disabled = stats.getDisabledPeriods();
+    return stats.getNmis() == 1 && stats.getInterrupts() == 1 && halts.getCount() == 2 && disabled.getCount() == 2
+           && disabled.getMin() < 40 && halts.getMin() < 1100 && machine->getCpu().isIFF1();
+}
+
+bool test_histogram() {
+    Z80TstateHistogram histogram;
+    for (uint64_t tstates : {0, 1, 2, 3, 4, 7, 8, 1000}) {
+        histogram.add(tstates);
+    }
+    bool ok = histogram.getCount() == 8 && histogram.getSum() == 1025 && histogram.getMin() == 0
+              && histogram.getMax() == 1000 && histogram.getBucket(0) == 1 && histogram.getBucket(1) == 1
+              && histogram.getBucket(2) == 2 && histogram.getBucket(3) == 2 && histogram.getBucket(4) == 1
+              && histogram.getBucket(10) == 1 && Z80TstateHistogram::bucketLow(10) == 512
+              && Z80TstateHistogram::bucketHigh(10) == 1023 && Z80TstateHistogram::bucketHigh(64) == UINT64_MAX
+              && histogram.percentile(0.5) == 3 && histogram.percentile(1.0) == 1000
+              && histogram.percentile(0.0) == 0;
+
+    Z80TstateHistogram other;
+    other.add(UINT64_MAX);
+    histogram.merge(other);
+    histogram.merge(Z80TstateHistogram());
+    ok = ok && histogram.getCount() == 9 && histogram.getBucket(64) == 1 && histogram.getMax() == UINT64_MAX
+         && histogram.getMin() == 0;
+
+    std::ostringstream json;
+    Z80TstateHistogram small;
+    small.add(5);
+    small.add(6);
+    small.writeJson(json);
+    return ok
+           && json.str()
+                  == "{\"count\": 2, \"sum\": 11, \"min\": 5, \"max\": 6, \"p50\": 6, \"p99\": 6, \"buckets\": [[4, 7, 2]]}";
+}
+
+int main() {
+    return runTests("Z80 Interrupt Statistics Test Suite", {
+        {"Idle frames", test_idle_frames},
+        {"Busy ISR misses interrupts", test_busy_isr_misses_interrupts},
+        {"NMI while halted", test_nmi_while_halted},
+        {"Histogram buckets and percentiles", test_histogram},
+    });
+}
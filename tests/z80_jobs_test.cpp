@@ -0,0 +1,212 @@
+// Z80 Job Pool Test Suite
+// Batch execution on pre-constructed machines with futures and callbacks
+
+#include "../include/z80_jobs.h"
+#include "test_runner.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Sums the bytes of the input at 0x8000 (count, then the bytes) into HL, then HALT
+const std::vector<uint8_t> kSumProgram = {
+    0x21, 0x00, 0x00, // LD HL,0
+    0x11, 0x01, 0x80, // LD DE,0x8001
+    0x3A, 0x00, 0x80, // LD A,(0x8000)
+    0x47,             // LD B,A
+    0x1A,             // loop: LD A,(DE)
+    0x85,             // ADD A,L
+    0x6F,             // LD L,A
+    0x30, 0x01,       // JR NC,skip
+    0x24,             // INC H
+    0x13,             // skip: INC DE
+    0x10, 0xF7,       // DJNZ loop
+    0x76,             // HALT
+};
+
+const std::vector<uint8_t> kEndlessProgram = {
+    0x18, 0xFE, // JR $
+};
+
+Z80Job<uint16_t> make_sum_job(const std::vector<uint8_t>& values) {
+    Z80Job<uint16_t> job;
+    job.program = kSumProgram;
+    job.input.push_back(static_cast<uint8_t>(values.size()));
+    job.input.insert(job.input.end(), values.begin(), values.end());
+    job.inputAddress = 0x8000;
+    job.extract = [](Z80Machine& machine) { return machine.getCpu().getRegHL(); };
+    return job;
+}
+
+std::vector<std::vector<uint8_t>> make_inputs(size_t count) {
+    std::mt19937 rng(0x10B5);
+    std::uniform_int_distribution<uint32_t> byte(0, 255);
+    std::vector<std::vector<uint8_t>> inputs(count);
+    for (auto& values : inputs) {
+        values.resize(1 + byte(rng) % 200);
+        for (auto& value : values) {
+            value = static_cast<uint8_t>(byte(rng));
+        }
+    }
+    return inputs;
+}
+
+uint16_t expected_sum(const std::vector<uint8_t>& values) {
+    uint16_t sum = 0;
+    for (uint8_t value : values) {
+        sum += value;
+    }
+    return sum;
+}
+
+bool test_futures() {
+    Z80JobPool pool(4);
+    std::vector<std::vector<uint8_t>> inputs = make_inputs(200);
+    std::vector<std::future<uint16_t>> results;
+    for (const auto& values : inputs) {
+        results.push_back(pool.submit(make_sum_job(values)));
+    }
+    for (size_t idx = 0; idx < inputs.size(); idx++) {
+        if (results[idx].get() != expected_sum(inputs[idx])) {
+            return false;
+        }
+    }
+    // A job is counted once its worker is done with it, which is after the future is ready
+    pool.wait();
+    return pool.getCompleted() == inputs.size() && pool.getFailed() == 0;
+}
+
+bool test_callbacks() {
+    Z80JobPool pool(3);
+    std::vector<std::vector<uint8_t>> inputs = make_inputs(100);
+    std::atomic<uint32_t> matches{0};
+    for (const auto& values : inputs) {
+        uint16_t expected = expected_sum(values);
+        pool.submit(make_sum_job(values), [&matches, expected](uint16_t sum) {
+            if (sum == expected) {
+                matches++;
+            }
+        });
+    }
+    pool.wait();
+    return matches == inputs.size();
+}
+
+bool test_limits() {
+    Z80JobPool pool(2);
+    auto extractTstates = [](Z80Machine& machine) { return machine.getTstates(); };
+
+    Z80Job<uint64_t> byInstructions{kEndlessProgram, 0x4000, {}, 0, UINT64_MAX, 1000, extractTstates};
+    Z80Job<uint64_t> byTstates{kEndlessProgram, 0x4000, {}, 0, 50000, UINT64_MAX, extractTstates};
+    std::future<uint64_t> instructions = pool.submit(byInstructions);
+    std::future<uint64_t> tstates = pool.submit(byTstates);
+    // JR takes 12 T-states
+    return instructions.get() == 12000 && tstates.get() == 50004;
+}
+
+bool test_machines_are_reset_between_jobs() {
+    Z80JobPool pool(1);
+    const std::vector<uint8_t> writer = {
+        0x3E, 0xAA,       // LD A,0xAA
+        0x32, 0x00, 0x90, // LD (0x9000),A
+        0x76,             // HALT
+    };
+    const std::vector<uint8_t> reader = {
+        0x3A, 0x00, 0x90, // LD A,(0x9000)
+        0x76,             // HALT
+    };
+    auto extractA = [](Z80Machine& machine) { return machine.getCpu().getRegA(); };
+
+    std::vector<std::future<uint8_t>> seen;
+    for (int round = 0; round < 50; round++) {
+        pool.submit(Z80Job<uint8_t>{writer, 0x0000, {}, 0, UINT64_MAX, UINT64_MAX, extractA});
+        seen.push_back(pool.submit(Z80Job<uint8_t>{reader, 0x0100, {}, 0, UINT64_MAX, UINT64_MAX, extractA}));
+    }
+    for (auto& value : seen) {
+        if (value.get() != 0x00) {
+            return false;
+        }
+    }
+    pool.wait();
+    // Writer: page 0x00 (program) and 0x90; reader: page 0x01
+    return pool.getPagesReset() == 50 * 3;
+}
+
+bool test_extractor_exceptions() {
+    Z80JobPool pool(2);
+    Z80Job<int> job{kSumProgram, 0, {1, 1}, 0x8000, UINT64_MAX, UINT64_MAX,
+                    [](Z80Machine&) -> int { throw std::runtime_error("no result"); }};
+    std::future<int> result = pool.submit(job);
+    pool.submit(job, [](int) {});
+    pool.wait();
+
+    bool thrown = false;
+    try {
+        result.get();
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    return thrown && pool.getFailed() == 2 && pool.getCompleted() == 0;
+}
+
+bool test_move_only_callback() {
+    Z80JobPool pool(1);
+    std::vector<uint8_t> values = {1, 2, 3};
+    std::promise<uint16_t> sum;
+    std::future<uint16_t> result = sum.get_future();
+    pool.submit(make_sum_job(values), [sum = std::move(sum)](uint16_t value) mutable { sum.set_value(value); });
+    return result.get() == expected_sum(values);
+}
+
+// Short jobs: a pooled machine against constructing one per job
+bool test_short_job_latency() {
+    constexpr int kJobs = 2000;
+    std::vector<std::vector<uint8_t>> inputs = make_inputs(kJobs);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t constructedSum = 0;
+    for (const auto& values : inputs) {
+        auto machine = std::make_unique<Z80Machine>();
+        Z80Job<uint16_t> job = make_sum_job(values);
+        machine->getMemory().load(job.inputAddress, job.input.data(), job.input.size());
+        machine->getMemory().load(0, job.program.data(), job.program.size());
+        machine->runUntil(UINT64_MAX);
+        constructedSum += job.extract(*machine);
+    }
+    double constructedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Z80JobPool pool(1);
+    start = std::chrono::steady_clock::now();
+    std::vector<std::future<uint16_t>> results;
+    for (const auto& values : inputs) {
+        results.push_back(pool.submit(make_sum_job(values)));
+    }
+    uint64_t pooledSum = 0;
+    for (auto& result : results) {
+        pooledSum += result.get();
+    }
+    double pooledSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::fixed << std::setprecision(2) << "  per job: constructed " << constructedSeconds * 1e6 / kJobs
+              << " us, pooled " << pooledSeconds * 1e6 / kJobs << " us, "
+              << static_cast<double>(pool.getPagesReset()) / kJobs << " pages reset per job" << '\n';
+    // Informational only: timings depend on the host
+    return pooledSum == constructedSum;
+}
+
+int main() {
+    return runTests("Z80 Job Pool Test Suite", {
+        {"Results through futures", test_futures},
+        {"Results through callbacks", test_callbacks},
+        {"Instruction and T-state limits", test_limits},
+        {"Machines are reset between jobs", test_machines_are_reset_between_jobs},
+        {"Extractor exceptions", test_extractor_exceptions},
+        {"Move-only callback", test_move_only_callback},
+        {"Short job latency", test_short_job_latency},
+    });
+}
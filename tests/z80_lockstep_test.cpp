@@ -0,0 +1,165 @@
+// Z80 Lockstep Test Suite
+// Many instances of one program in SoA lanes, checked against the scalar core
+
+#include "../include/z80_hash.h"
+#include "../include/z80_lockstep.h"
+#include "../include/z80_machine.h"
+#include "test_runner.h"
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Brute-force style kernel: scramble the input byte at 0x7000 through a fixed
+// number of ALU rounds, count the rounds with a set carry and store the result
+const std::vector<uint8_t> kSearchProgram = {
+    0x3A, 0x00, 0x70, // LD A,(0x7000)
+    0x21, 0x00, 0x80, // LD HL,0x8000
+    0x0E, 0x00,       // LD C,0
+    0x06, 0x40,       // outer: LD B,64
+    0x57,             // round: LD D,A
+    0x87,             // ADD A,A
+    0xCE, 0x1D,       // ADC A,0x1D
+    0xAA,             // XOR D
+    0x30, 0x01,       // JR NC,skip
+    0x0C,             // INC C
+    0xE6, 0x7F,       // skip: AND 0x7F
+    0xFE, 0x40,       // CP 0x40
+    0x10, 0xF2,       // DJNZ round
+    0x77,             // LD (HL),A
+    0x2C,             // INC L
+    0xC2, 0x08, 0x00, // JP NZ,outer
+    0x71,             // LD (HL),C
+    0x76,             // HALT
+};
+
+// Scalar reference: one Z80Machine per lane with the same memory and registers
+template <size_t N> bool lanes_match_scalar(Z80Lockstep<N>& lockstep, const std::vector<std::vector<uint8_t>>& memory,
+                                            const std::vector<Z80State>& initial, uint64_t limit) {
+    for (size_t lane = 0; lane < N; lane++) {
+        Z80Machine machine;
+        machine.getMemory().load(0, memory[lane].data(), memory[lane].size());
+        machine.getCpu().setState(initial[lane]);
+        machine.runUntil(limit);
+
+        std::vector<uint8_t> expected(0x10000);
+        machine.getMemory().copyTo(0, expected.data(), expected.size());
+        if (z80HashState(machine.getCpu().getState()) != z80HashState(lockstep.getLaneState(lane))
+            || machine.getTstates() != lockstep.getLaneTstates(lane)
+            || std::memcmp(expected.data(), lockstep.laneMemory(lane), expected.size()) != 0) {
+            std::cout << "  lane " << lane << " differs from the scalar core" << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same program, one input byte per lane
+template <size_t N> bool test_search_matches_scalar() {
+    Z80Lockstep<N> lockstep;
+    std::vector<std::vector<uint8_t>> memory(N, std::vector<uint8_t>(0x10000, 0));
+    std::vector<Z80State> initial;
+    lockstep.load(0, kSearchProgram.data(), kSearchProgram.size());
+    for (size_t lane = 0; lane < N; lane++) {
+        std::copy(kSearchProgram.begin(), kSearchProgram.end(), memory[lane].begin());
+        memory[lane][0x7000] = static_cast<uint8_t>(lane * 37);
+        lockstep.laneMemory(lane)[0x7000] = memory[lane][0x7000];
+        initial.push_back(lockstep.getLaneState(lane));
+    }
+    lockstep.run(UINT64_MAX);
+    return lanes_match_scalar(lockstep, memory, initial, UINT64_MAX) && lockstep.isLaneHalted(0)
+           && lockstep.getVectorInstructions() > lockstep.getScalarInstructions();
+}
+
+// Random code, shared by every lane, with random registers and data per lane.
+// Lanes diverge quickly and hit every opcode, prefixed ones included.
+bool test_random_code_matches_scalar() {
+    constexpr size_t kLanes = 16;
+    constexpr uint64_t kLimit = 20000;
+    std::mt19937 rng(0x5A80);
+    std::uniform_int_distribution<uint32_t> byte(0, 255);
+
+    for (int round = 0; round < 20; round++) {
+        Z80Lockstep<kLanes> lockstep;
+        std::vector<uint8_t> code(0x10000);
+        for (auto& value : code) {
+            value = static_cast<uint8_t>(byte(rng));
+        }
+
+        std::vector<std::vector<uint8_t>> memory(kLanes);
+        std::vector<Z80State> initial;
+        for (size_t lane = 0; lane < kLanes; lane++) {
+            memory[lane] = code;
+            // Per-lane data in the upper half
+            for (size_t address = 0x8000; address < 0x10000; address += 97) {
+                memory[lane][address] = static_cast<uint8_t>(byte(rng));
+            }
+            std::memcpy(lockstep.laneMemory(lane), memory[lane].data(), memory[lane].size());
+
+            Z80State state = lockstep.getLaneState(lane);
+            state.af = static_cast<uint16_t>(byte(rng) << 8 | byte(rng));
+            state.bc = static_cast<uint16_t>(byte(rng) << 8 | byte(rng));
+            state.hl = static_cast<uint16_t>(byte(rng) << 8 | byte(rng));
+            state.sp = 0xFFF0;
+            lockstep.setLaneState(lane, state);
+            initial.push_back(state);
+        }
+
+        lockstep.run(kLimit);
+        if (!lanes_match_scalar(lockstep, memory, initial, kLimit)) {
+            std::cout << "  round " << round << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+bool test_throughput() {
+    constexpr size_t kLanes = 32;
+    constexpr int kRepeats = 20;
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t laneInstructions = 0;
+    for (int repeat = 0; repeat < kRepeats; repeat++) {
+        Z80Lockstep<kLanes> lockstep;
+        lockstep.load(0, kSearchProgram.data(), kSearchProgram.size());
+        for (size_t lane = 0; lane < kLanes; lane++) {
+            lockstep.laneMemory(lane)[0x7000] = static_cast<uint8_t>(lane);
+        }
+        lockstep.run(UINT64_MAX);
+        laneInstructions += lockstep.getVectorInstructions() + lockstep.getScalarInstructions();
+    }
+    double lockstepSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    uint64_t scalarInstructions = 0;
+    for (int repeat = 0; repeat < kRepeats; repeat++) {
+        for (size_t lane = 0; lane < kLanes; lane++) {
+            Z80Machine machine;
+            machine.getMemory().load(0, kSearchProgram.data(), kSearchProgram.size());
+            machine.getMemory().write(0x7000, static_cast<uint8_t>(lane));
+            scalarInstructions += machine.runSlice(UINT64_MAX);
+        }
+    }
+    double scalarSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double lockstepMips = static_cast<double>(laneInstructions) / lockstepSeconds / 1e6;
+    double scalarMips = static_cast<double>(scalarInstructions) / scalarSeconds / 1e6;
+    std::cout << std::fixed << std::setprecision(2) << "  " << kLanes << " lanes: " << lockstepMips
+              << " MIPS, scalar: " << scalarMips << " MIPS (" << lockstepMips / scalarMips << "x)" << '\n';
+    // Informational only: the ratio depends on the SIMD width of the host
+    return laneInstructions == scalarInstructions;
+}
+
+int main() {
+    return runTests("Z80 Lockstep Test Suite", {
+        {"8 lanes match the scalar core", test_search_matches_scalar<8>},
+        {"16 lanes match the scalar core", test_search_matches_scalar<16>},
+        {"32 lanes match the scalar core", test_search_matches_scalar<32>},
+        {"Random code matches the scalar core", test_random_code_matches_scalar},
+        {"Lockstep throughput", test_throughput},
+    });
+}
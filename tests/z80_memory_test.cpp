@@ -0,0 +1,178 @@
+// Z80 Memory Test Suite
+// Dirty-page tracking, incremental state hashing and mapped images
+
+#include "../include/z80.h"
+#include "../include/z80_machine.h"
+#include "../include/z80_memory.h"
+#include "test_runner.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Fills 0x8000..0x80FF with an increasing sequence seeded by the byte at 0x7000, then HALT
+const std::vector<uint8_t> kFillProgram = {
+    0x3A, 0x00, 0x70, // LD A,(0x7000)
+    0x21, 0x00, 0x80, // LD HL,0x8000
+    0x06, 0x00,       // LD B,0
+    0x77,             // loop: LD (HL),A
+    0x3C,             // INC A
+    0x23,             // INC HL
+    0x10, 0xFB,       // DJNZ loop
+    0xE5,             // PUSH HL
+    0x76,             // HALT
+};
+
+bool test_same_program_same_hash() {
+    Z80Machine machine1;
+    Z80Machine machine2;
+    machine1.getMemory().load(0, kFillProgram.data(), kFillProgram.size());
+    machine2.getMemory().load(0, kFillProgram.data(), kFillProgram.size());
+    machine1.runUntil(100000);
+    machine2.runUntil(100000);
+    return machine1.hash() == machine2.hash();
+}
+
+bool test_input_changes_hash() {
+    Z80Machine machine1;
+    Z80Machine machine2;
+    machine1.getMemory().load(0, kFillProgram.data(), kFillProgram.size());
+    machine2.getMemory().load(0, kFillProgram.data(), kFillProgram.size());
+    machine2.getMemory().write(0x7000, 0x42);
+    machine1.runUntil(100000);
+    machine2.runUntil(100000);
+    return machine1.hash() != machine2.hash();
+}
+
+bool test_cpu_state_changes_hash() {
+    Z80Machine machine;
+    uint64_t before = machine.hash();
+    machine.getCpu().setMemPtr(machine.getCpu().getMemPtr() ^ 0x0100);
+    return machine.hash() != before;
+}
+
+bool test_incremental_matches_full_rehash() {
+    Z80Machine machine;
+    machine.getMemory().load(0, kFillProgram.data(), kFillProgram.size());
+    uint64_t loaded = machine.getMemory().hash();
+    machine.runUntil(100000);
+    uint64_t incremental = machine.getMemory().hash();
+    if (incremental == loaded) {
+        return false;
+    }
+
+    std::vector<uint8_t> contents(0x10000);
+    machine.getMemory().copyTo(0, contents.data(), contents.size());
+    Z80Memory fresh;
+    fresh.load(0, contents.data(), contents.size());
+    return incremental == fresh.hash();
+}
+
+bool test_only_written_pages_are_dirty() {
+    Z80Machine machine;
+    machine.getMemory().load(0, kFillProgram.data(), kFillProgram.size());
+    Z80Memory& memory = machine.getMemory();
+    uint64_t loaded = memory.hash();
+    if (memory.dirtyPageCount() != 0 || memory.hash() != loaded) {
+        return false;
+    }
+    machine.runUntil(100000);
+    // Fill loop writes page 0x80, PUSH HL writes page 0xFF
+    return memory.dirtyPageCount() == 2 && memory.isPageDirty(0x80) && memory.isPageDirty(0xFF);
+}
+
+bool test_reset_modified_pages_only() {
+    Z80Machine machine;
+    uint64_t cleared = machine.getMemory().hash();
+    machine.getMemory().load(0, kFillProgram.data(), kFillProgram.size());
+    machine.runUntil(100000);
+    // Program page 0x00, fill page 0x80, stack page 0xFF
+    if (machine.getMemory().modifiedPageCount() != 3 || machine.getMemory().resetModified() != 3) {
+        return false;
+    }
+    return machine.getMemory().modifiedPageCount() == 0 && machine.getMemory().hash() == cleared;
+}
+
+bool test_restoring_bytes_restores_hash() {
+    Z80Memory memory;
+    uint64_t before = memory.hash();
+    memory.write(0x1234, 0x55);
+    uint64_t modified = memory.hash();
+    memory.write(0x1234, 0x00);
+    return modified != before && memory.hash() == before;
+}
+
+// Writes the program to a temporary file and returns its path
+std::string write_temp_image(const std::string& name, const std::vector<uint8_t>& bytes) {
+    std::string path = temp_path(name);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return path;
+}
+
+bool test_shared_rom_image() {
+    // ROM code: fill RAM and try to overwrite itself at 0x0000
+    std::vector<uint8_t> rom = kFillProgram;
+    rom.insert(rom.end() - 1, {0x32, 0x00, 0x00}); // LD (0x0000),A before the HALT
+    rom.resize(Z80Memory::kPageSize * 2, 0x00);
+    std::string path = write_temp_image("z80_memory_test_rom.bin", rom);
+
+    std::shared_ptr<const Z80Image> image = Z80Image::map(path);
+    if (!image || image->size() != rom.size()) {
+        return false;
+    }
+
+    Z80Machine machine1;
+    Z80Machine machine2;
+    if (!machine1.mapRom(0x0000, image) || !machine2.mapRom(0x0000, image)) {
+        return false;
+    }
+
+    machine1.runUntil(1000000);
+    machine2.runUntil(1000000);
+
+    std::filesystem::remove(path);
+    // Both machines read the very same bytes, and ROM writes are discarded
+    return machine1.getMemory().pageData(0) == machine2.getMemory().pageData(0)
+           && machine1.getMemory().isPageReadOnly(0) && machine1.getMemory().read(0x0000) == 0x3A
+           && machine1.getMemory().read(0x80FF) == 0xFF && machine1.hash() == machine2.hash();
+}
+
+bool test_copy_on_write_preload() {
+    std::vector<uint8_t> program(Z80Memory::kPageSize * 3 + 16, 0x00);
+    std::copy(kFillProgram.begin(), kFillProgram.end(), program.begin());
+    std::string path = write_temp_image("z80_memory_test_ram.bin", program);
+
+    Z80Machine machine1;
+    Z80Machine machine2;
+    if (!machine1.preloadRam(0x0000, path) || !machine2.preloadRam(0x0000, path)) {
+        return false;
+    }
+
+    // Guest writes only reach this instance's private copy
+    machine1.getMemory().write(0x0100, 0xAA);
+    machine1.getMemory().write(0x0300, 0xBB); // Trailing partial page, copied into RAM
+    machine1.runUntil(1000000);
+
+    std::shared_ptr<const Z80Image> original = Z80Image::map(path);
+    std::filesystem::remove(path);
+    return original && machine1.getMemory().read(0x0100) == 0xAA && machine1.getMemory().read(0x0300) == 0xBB
+           && machine2.getMemory().read(0x0100) == 0x00 && machine2.getMemory().read(0x0300) == 0x00
+           && original->data()[0x0100] == 0x00 && machine1.getMemory().read(0x8010) == 0x10
+           && !machine1.getMemory().isPageReadOnly(1);
+}
+
+int main() {
+    return runTests("Z80 Memory Test Suite", {
+        {"Same program gives same hash", test_same_program_same_hash},
+        {"Different input gives different hash", test_input_changes_hash},
+        {"CPU state is part of the hash", test_cpu_state_changes_hash},
+        {"Incremental hash matches full rehash", test_incremental_matches_full_rehash},
+        {"Only written pages are dirty", test_only_written_pages_are_dirty},
+        {"Reset touches modified pages only", test_reset_modified_pages_only},
+        {"Restoring bytes restores hash", test_restoring_bytes_restores_hash},
+        {"Shared read-only ROM image", test_shared_rom_image},
+        {"Copy-on-write RAM preload", test_copy_on_write_preload},
+    });
+}
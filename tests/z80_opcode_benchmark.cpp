@@ -0,0 +1,545 @@
+// Z80 Opcode Benchmark
+// Host time of every entry of the seven decoder tables, undocumented opcodes included
+
+#include "../include/z80_coverage.h"
+#include "../include/z80_histogram.h"
+#include "benchmark_shared.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Each opcode runs as a block of copies of itself between a prologue that
+ * puts every register back where it was and a JP to the prologue:
+ *
+ *   0x0100: LD SP,0xF000; LD HL,0x5000; LD DE,0x9000; LD BC,0x2020
+ *           LD IX,0x6000; LD IY,0x7000; LD A,0x55; OR A
+ *           <opcode> x 64
+ *           JP 0x0100
+ *
+ * so that every pass of the loop executes the same instructions. One pass
+ * is run first to count them, then whole passes are timed and the time of
+ * a block with no copies at all, the loop overhead, is subtracted before
+ * dividing by the copies executed.
+ *
+ * Operand bytes are 0x80, which keeps (nn), (IX+d) and ports away from the
+ * code. Flow instructions are made to land on the next copy: JP and CALL
+ * target it, JR and DJNZ jump by 0, and the stack holds the address of
+ * each next copy for RET, RETI and RETN. The vectors of RST hold a RET, so
+ * an RST row has the Main RET row subtracted from it. The repeating block
+ * instructions run once a pass, one execute() per iteration, since a
+ * second copy would start with BC or B at 0. Two opcodes are timed in
+ * place, with no loop to subtract: JP (HL), JP (IX) and JP (IY) jumping to
+ * themselves, and HALT as the NOPs of a halted CPU. Prefixes that select
+ * another table (CB, DD CB, FD CB)
+ * are timed through that table; DD, ED and FD in the prefix positions are
+ * timed followed by a NOP.
+ */
+
+namespace {
+
+constexpr uint16_t kCodeStart = 0x0100;
+constexpr uint16_t kStack = 0xF000;
+constexpr uint16_t kHL = 0x5000;
+constexpr uint16_t kIX = 0x6000;
+constexpr uint16_t kIY = 0x7000;
+constexpr int kCopies = 64;
+constexpr uint64_t kPrologueInstructions = 8;
+constexpr uint64_t kMaxPass = 1 << 20;
+constexpr uint8_t kOperand = 0x80;
+
+enum class OpcodeKind : uint8_t { Plain, Jump, Return, Restart, Indirect, Repeat, Halt, Prefix };
+
+const char* kindName(OpcodeKind kind) {
+    static constexpr std::array<const char*, 8> kNames = {"op",       "jump",   "return", "restart",
+                                                          "indirect", "repeat", "halt",   "prefix"};
+    return kNames[static_cast<size_t>(kind)];
+}
+
+struct OpcodeTiming {
+    Z80OpcodeTable table;
+    uint8_t opcode;
+    OpcodeKind kind;
+    uint64_t executions{0};
+    double ns{-1};
+    double cycles{-1};
+    double spread{0}; // ns per instruction between the slowest and the fastest round
+    bool measured{false};
+};
+
+struct Timing {
+    double ns;
+    double cycles;
+};
+
+OpcodeKind classify(Z80OpcodeTable table, uint8_t opcode) {
+    if (table == Z80OpcodeTable::ED) {
+        if ((opcode & 0xC7) == 0x45) {
+            return OpcodeKind::Return;
+        }
+        return (opcode & 0xF4) == 0xB0 ? OpcodeKind::Repeat : OpcodeKind::Plain;
+    }
+    if (table != Z80OpcodeTable::Main && table != Z80OpcodeTable::DD && table != Z80OpcodeTable::FD) {
+        return OpcodeKind::Plain;
+    }
+    if (opcode == 0xCB) {
+        return OpcodeKind::Prefix;
+    }
+    if (opcode == 0x76) {
+        return OpcodeKind::Halt;
+    }
+    if (opcode == 0xC3 || opcode == 0xCD || (opcode & 0xC7) == 0xC2 || (opcode & 0xC7) == 0xC4 || opcode == 0x10
+        || opcode == 0x18 || (opcode & 0xE7) == 0x20) {
+        return OpcodeKind::Jump;
+    }
+    if (opcode == 0xC9 || (opcode & 0xC7) == 0xC0) {
+        return OpcodeKind::Return;
+    }
+    if ((opcode & 0xC7) == 0xC7) {
+        return OpcodeKind::Restart;
+    }
+    return opcode == 0xE9 ? OpcodeKind::Indirect : OpcodeKind::Plain;
+}
+
+// One copy of the instruction at 'address'; flow instructions land on the one after it
+std::vector<uint8_t> encode(Z80OpcodeTable table, uint8_t opcode, uint16_t address) {
+    static const std::array<std::vector<uint8_t>, Z80OpcodeHistogram::kTables> kPrefixes = {{
+        {},
+        {0xCB},
+        {0xED},
+        {0xDD},
+        {0xFD},
+        {0xDD, 0xCB, kOperand},
+        {0xFD, 0xCB, kOperand},
+    }};
+    std::vector<uint8_t> bytes = kPrefixes[static_cast<size_t>(table)];
+    bytes.push_back(opcode);
+    bool chained = table != Z80OpcodeTable::CB && table != Z80OpcodeTable::DDCB && table != Z80OpcodeTable::FDCB
+                   && (opcode == 0xDD || opcode == 0xED || opcode == 0xFD);
+    if (chained) {
+        bytes.push_back(0x00);
+    }
+
+    std::vector<uint8_t> padded = bytes;
+    padded.resize(bytes.size() + 4, kOperand);
+    uint32_t length = z80InstructionLength(0, [&padded](uint16_t offset) { return padded[offset]; });
+    bytes.resize(length, kOperand);
+
+    if (!chained && classify(table, opcode) == OpcodeKind::Jump) {
+        auto next = static_cast<uint16_t>(address + length);
+        if (opcode == 0x10 || opcode == 0x18 || (opcode & 0xE7) == 0x20) {
+            bytes[length - 1] = 0x00;
+        } else {
+            bytes[length - 2] = static_cast<uint8_t>(next);
+            bytes[length - 1] = static_cast<uint8_t>(next >> 8);
+        }
+    }
+    return bytes;
+}
+
+void pushWord(std::vector<uint8_t>& code, uint8_t opcode, uint16_t word) {
+    code.push_back(opcode);
+    code.push_back(static_cast<uint8_t>(word));
+    code.push_back(static_cast<uint8_t>(word >> 8));
+}
+
+std::vector<uint8_t> prologue(uint16_t hl, uint16_t ix, uint16_t iy) {
+    std::vector<uint8_t> code;
+    pushWord(code, 0x31, kStack);
+    pushWord(code, 0x21, hl);
+    pushWord(code, 0x11, 0x9000);
+    pushWord(code, 0x01, 0x2020);
+    code.push_back(0xDD);
+    pushWord(code, 0x21, ix);
+    code.push_back(0xFD);
+    pushWord(code, 0x21, iy);
+    code.insert(code.end(), {0x3E, 0x55, 0xB7});
+    return code;
+}
+
+// The loop for 'copies' copies of the opcode, or the bare loop with none
+std::unique_ptr<BenchmarkSim> makeLoop(Z80OpcodeTable table, uint8_t opcode, int copies) {
+    auto sim = std::make_unique<BenchmarkSim>();
+    auto& ram = sim->getRam();
+    for (uint16_t vector = 0x00; vector <= 0x38; vector += 8) {
+        ram[vector] = 0xC9;
+    }
+
+    auto length = static_cast<uint16_t>(copies == 0 ? 0 : encode(table, opcode, 0).size());
+    std::vector<uint8_t> code = prologue(kHL, kIX, kIY);
+
+    for (int copy = 0; copy < copies; copy++) {
+        auto address = static_cast<uint16_t>(kCodeStart + code.size());
+        std::vector<uint8_t> bytes = encode(table, opcode, address);
+        code.insert(code.end(), bytes.begin(), bytes.end());
+        auto next = static_cast<uint16_t>(address + length);
+        ram[kStack + 2 * copy] = static_cast<uint8_t>(next);
+        ram[kStack + 2 * copy + 1] = static_cast<uint8_t>(next >> 8);
+    }
+    pushWord(code, 0xC3, kCodeStart);
+    std::copy(code.begin(), code.end(), ram.begin() + kCodeStart);
+    sim->getCpu().setRegPC(kCodeStart);
+    return sim;
+}
+
+// Instructions of one pass back to the prologue, 0 if two passes differ or one never ends
+uint64_t countPass(BenchmarkSim& sim) {
+    uint64_t counts[3] = {};
+    for (uint64_t& count : counts) {
+        do {
+            sim.getCpu().execute();
+            count++;
+        } while (sim.getCpu().getRegPC() != kCodeStart && count < kMaxPass);
+    }
+    // The first pass starts from the reset state
+    return counts[1] == counts[2] && counts[1] < kMaxPass ? counts[1] : 0;
+}
+
+Timing timeExecutes(BenchmarkSim& sim, uint64_t executes) {
+    auto& cpu = sim.getCpu();
+    auto start = std::chrono::steady_clock::now();
+    uint64_t startCycles = readHostCycles();
+    for (uint64_t idx = 0; idx < executes; idx++) {
+        cpu.execute();
+    }
+    uint64_t endCycles = readHostCycles();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return {elapsed.count(), static_cast<double>(endCycles - startCycles)};
+}
+
+void keepBest(Timing& best, const Timing& timing) {
+    best.ns = std::min(best.ns, timing.ns);
+    best.cycles = std::min(best.cycles, timing.cycles);
+}
+
+void keepWorst(Timing& worst, const Timing& timing) {
+    worst.ns = std::max(worst.ns, timing.ns);
+    worst.cycles = std::max(worst.cycles, timing.cycles);
+}
+
+// Best and worst of the rounds
+void keep(Timing& best, Timing& worst, const Timing& timing) {
+    keepBest(best, timing);
+    keepWorst(worst, timing);
+}
+
+// Per pass of 'passes' passes of 'perPass' instructions
+Timing timePasses(BenchmarkSim& sim, uint64_t perPass, uint64_t passes) {
+    Timing timing = timeExecutes(sim, perPass * passes);
+    return {timing.ns / static_cast<double>(passes), timing.cycles / static_cast<double>(passes)};
+}
+
+/* Rounds over the whole table rather than repeats of each opcode on the
+ * spot, so that a slow spell of the host lands on different opcodes in
+ * different rounds; every entry and the empty loop keep their best time.
+ * Each entry also keeps its worst time, so that a comparison can tell a
+ * change from the noise of the host. */
+class OpcodeBenchmark {
+  public:
+    explicit OpcodeBenchmark(uint64_t executions) : m_executions(executions) {
+        for (size_t table = 0; table < Z80OpcodeHistogram::kTables; table++) {
+            for (uint32_t opcode = 0; opcode < 256; opcode++) {
+                auto tbl = static_cast<Z80OpcodeTable>(table);
+                auto op = static_cast<uint8_t>(opcode);
+                m_samples.push_back({{tbl, op, classify(tbl, op)}});
+            }
+        }
+    }
+
+    void round() {
+        auto loop = makeLoop(Z80OpcodeTable::Main, 0x00, 0);
+        uint64_t perPass = countPass(*loop);
+        keepBest(m_loop, timePasses(*loop, perPass, std::max<uint64_t>(1, m_executions / perPass)));
+        for (Sample& sample : m_samples) {
+            measure(sample);
+        }
+        m_rounds++;
+    }
+
+    // Loop overhead per pass
+    [[nodiscard]] const Timing& getLoop() const {
+        return m_loop;
+    }
+
+    // Every table entry, Main first, from the best times so far
+    [[nodiscard]] std::vector<OpcodeTiming> getTimings() const {
+        std::vector<OpcodeTiming> timings;
+        for (const Sample& sample : m_samples) {
+            OpcodeTiming timing = sample.timing;
+            timing.measured = m_rounds > 0 && timing.kind != OpcodeKind::Prefix && !sample.failed;
+            if (timing.measured) {
+                Timing loop = inPlace(timing.kind) ? Timing{0, 0} : m_loop;
+                timing.ns = (sample.best.ns - loop.ns) / static_cast<double>(timing.executions);
+                timing.cycles = (sample.best.cycles - loop.cycles) / static_cast<double>(timing.executions);
+                timing.spread = (sample.worst.ns - sample.best.ns) / static_cast<double>(timing.executions);
+            }
+            timings.push_back(timing);
+        }
+
+        // RST returns through a RET at its vector
+        const OpcodeTiming ret = timings[0xC9];
+        for (OpcodeTiming& timing : timings) {
+            if (timing.kind == OpcodeKind::Restart && timing.measured) {
+                timing.ns -= ret.ns;
+                timing.cycles -= ret.cycles;
+            }
+        }
+        return timings;
+    }
+
+  private:
+    struct Sample {
+        OpcodeTiming timing;
+        Timing best{1e300, 1e300};
+        Timing worst{0, 0};
+        bool failed{false};
+    };
+
+    uint64_t m_executions;
+    std::vector<Sample> m_samples;
+    Timing m_loop{1e300, 1e300};
+    int m_rounds{0};
+
+    void measure(Sample& sample) const {
+        OpcodeTiming& timing = sample.timing;
+        if (timing.kind == OpcodeKind::Prefix || sample.failed) {
+            return;
+        }
+        if (inPlace(timing.kind)) {
+            measureInPlace(sample);
+            return;
+        }
+
+        auto loop = makeLoop(timing.table, timing.opcode, timing.kind == OpcodeKind::Repeat ? 1 : kCopies);
+        uint64_t perPass = countPass(*loop);
+        if (perPass <= kPrologueInstructions + 1) {
+            sample.failed = true;
+            return;
+        }
+        // An RST and the RET at its vector count once
+        timing.executions = (perPass - kPrologueInstructions - 1) / (timing.kind == OpcodeKind::Restart ? 2 : 1);
+        uint64_t passes = (m_executions + timing.executions - 1) / timing.executions;
+        keep(sample.best, sample.worst, timePasses(*loop, perPass, passes));
+        sample.failed = loop->getCpu().getRegPC() != kCodeStart;
+    }
+
+    static bool inPlace(OpcodeKind kind) {
+        return kind == OpcodeKind::Halt || kind == OpcodeKind::Indirect;
+    }
+
+    // HALT halted, JP (HL) after the prologue with HL, IX and IY pointing at it
+    void measureInPlace(Sample& sample) const {
+        auto sim = std::make_unique<BenchmarkSim>();
+        bool halt = sample.timing.kind == OpcodeKind::Halt;
+        auto target = static_cast<uint16_t>(kCodeStart + (halt ? 0 : prologue(0, 0, 0).size()));
+        std::vector<uint8_t> code = halt ? std::vector<uint8_t>() : prologue(target, target, target);
+        std::vector<uint8_t> bytes = encode(sample.timing.table, sample.timing.opcode, target);
+        code.insert(code.end(), bytes.begin(), bytes.end());
+        std::copy(code.begin(), code.end(), sim->getRam().begin() + kCodeStart);
+        sim->getCpu().setRegPC(kCodeStart);
+        for (uint64_t idx = 0; idx < (halt ? 1 : kPrologueInstructions + 1); idx++) {
+            sim->getCpu().execute();
+        }
+        sample.timing.executions = 1;
+        keep(sample.best, sample.worst, timePasses(*sim, 1, m_executions));
+        sample.failed = halt ? !sim->getCpu().isHalted() : sim->getCpu().getRegPC() != target;
+    }
+};
+
+std::string hexByte(uint8_t value) {
+    static constexpr char kDigits[] = "0123456789abcdef";
+    return std::string("0x") + kDigits[value >> 4] + kDigits[value & 0x0F];
+}
+
+// "table,opcode,kind,executions,ns_per_instruction,cycles_per_instruction,spread_ns"; figures empty when not measured
+void writeCsv(std::ostream& out, const std::vector<OpcodeTiming>& timings) {
+    out << "table,opcode,kind,executions,ns_per_instruction,cycles_per_instruction,spread_ns\n";
+    for (const OpcodeTiming& timing : timings) {
+        out << Z80OpcodeHistogram::tableName(timing.table) << ',' << hexByte(timing.opcode) << ','
+            << kindName(timing.kind) << ',' << timing.executions << ',';
+        if (timing.measured) {
+            out << std::fixed << std::setprecision(3) << timing.ns << ',' << std::setprecision(2) << timing.cycles
+                << ',' << std::setprecision(3) << timing.spread;
+        } else {
+            out << ",,";
+        }
+        out << '\n';
+    }
+}
+
+struct BaselineTiming {
+    double ns;
+    double spread;
+};
+
+// "table,opcode" to ns per instruction and its spread from a CSV of an earlier run; no spread column reads as 0
+std::map<std::string, BaselineTiming> readCsv(std::istream& in) {
+    std::map<std::string, BaselineTiming> timings;
+    std::string line;
+    std::getline(in, line);
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields;
+        std::istringstream row(line);
+        std::string field;
+        while (std::getline(row, field, ',')) {
+            fields.push_back(field);
+        }
+        if (fields.size() >= 5 && !fields[4].empty()) {
+            double spread = fields.size() >= 7 && !fields[6].empty() ? std::stod(fields[6]) : 0.0;
+            timings[fields[0] + ',' + fields[1]] = {std::stod(fields[4]), spread};
+        }
+    }
+    return timings;
+}
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values.empty() ? 0.0 : values[values.size() / 2];
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        std::cout << "========================================" << '\n';
+        std::cout << "Z80 Opcode Benchmark" << '\n';
+        std::cout << "========================================" << '\n';
+        std::cout << '\n';
+
+        // Options: --executions N, --rounds N, --csv FILE, --baseline FILE, --tolerance FRACTION, --fail-on-regression
+        uint64_t executions = 20000;
+        int rounds = 3;
+        std::string csv_path = "opcode_benchmark.csv";
+        std::string baseline_path;
+        double tolerance = 0.25;
+        bool fail_on_regression = false;
+        for (int idx = 1; idx < argc; idx++) {
+            std::string option = argv[idx];
+            if (option == "--fail-on-regression") {
+                fail_on_regression = true;
+                continue;
+            }
+            if (idx + 1 == argc) {
+                std::cerr << "Missing value for option: " << option << '\n';
+                return 1;
+            }
+            std::string value = argv[++idx];
+            if (option == "--executions") {
+                executions = std::max<uint64_t>(1, std::stoull(value));
+            } else if (option == "--rounds") {
+                rounds = std::max(1, std::stoi(value));
+            } else if (option == "--csv") {
+                csv_path = value;
+            } else if (option == "--baseline") {
+                baseline_path = value;
+            } else if (option == "--tolerance") {
+                tolerance = std::stod(value);
+            } else {
+                std::cerr << "Unknown option: " << option << '\n';
+                return 1;
+            }
+        }
+
+        OpcodeBenchmark benchmark(executions);
+        for (int round = 0; round < rounds; round++) {
+            benchmark.round();
+        }
+        std::cout << std::fixed << std::setprecision(2) << "Loop overhead: " << benchmark.getLoop().ns
+                  << " ns, " << benchmark.getLoop().cycles << " host cycles per pass" << '\n';
+        std::vector<OpcodeTiming> timings = benchmark.getTimings();
+
+        size_t measured = 0;
+        size_t failed = 0;
+        for (const OpcodeTiming& timing : timings) {
+            if (timing.measured) {
+                measured++;
+            } else if (timing.kind != OpcodeKind::Prefix) {
+                std::cout << "✗ " << Z80OpcodeHistogram::tableName(timing.table) << ' ' << hexByte(timing.opcode)
+                          << " did not run the same instructions every pass" << '\n';
+                failed++;
+            }
+        }
+
+        std::vector<const OpcodeTiming*> slowest;
+        for (const OpcodeTiming& timing : timings) {
+            if (timing.measured) {
+                slowest.push_back(&timing);
+            }
+        }
+        std::sort(slowest.begin(), slowest.end(),
+                  [](const OpcodeTiming* lhs, const OpcodeTiming* rhs) { return lhs->ns > rhs->ns; });
+        std::cout << '\n' << "Slowest:" << '\n';
+        for (size_t idx = 0; idx < std::min<size_t>(10, slowest.size()); idx++) {
+            std::cout << "  " << std::left << std::setw(5) << Z80OpcodeHistogram::tableName(slowest[idx]->table)
+                      << hexByte(slowest[idx]->opcode) << std::right << std::setw(10) << slowest[idx]->ns << " ns"
+                      << std::setw(10) << slowest[idx]->cycles << " cycles" << '\n';
+        }
+
+        std::ofstream csv(csv_path);
+        writeCsv(csv, timings);
+        std::cout << '\n' << "Wrote " << timings.size() << " opcodes to " << csv_path << '\n';
+
+        /* Slower than the baseline by more than 'tolerance', by more than the
+         * spreads of the two runs added together, and by more than a
+         * nanosecond. Only --fail-on-regression makes a regression fail the
+         * run, since identical code can still exceed the spreads of a few
+         * rounds on a busy host. The baseline is first scaled by the
+         * ratio of the medians of the two runs: a host that is uniformly slower
+         * than it was flags nothing, and neither does a change to the cost of
+         * every instruction, which the aggregate benchmarks are there for. */
+        size_t regressions = 0;
+        if (!baseline_path.empty()) {
+            std::ifstream in(baseline_path);
+            if (!in) {
+                std::cerr << "Cannot read " << baseline_path << '\n';
+                return 1;
+            }
+            std::map<std::string, BaselineTiming> baseline = readCsv(in);
+            std::vector<std::pair<const OpcodeTiming*, BaselineTiming>> matched;
+            std::vector<double> current;
+            std::vector<double> previous;
+            for (const OpcodeTiming& timing : timings) {
+                auto found = baseline.find(std::string(Z80OpcodeHistogram::tableName(timing.table)) + ','
+                                           + hexByte(timing.opcode));
+                if (timing.measured && found != baseline.end()) {
+                    matched.emplace_back(&timing, found->second);
+                    current.push_back(timing.ns);
+                    previous.push_back(found->second.ns);
+                }
+            }
+            double scale = median(previous) > 0 ? median(current) / median(previous) : 1.0;
+            std::cout << '\n' << "Host speed against the baseline: " << scale << "x" << '\n';
+            for (const auto& [timing, before] : matched) {
+                double expected = before.ns * scale;
+                double slower = timing->ns - expected;
+                double noise = timing->spread + before.spread * scale;
+                if (slower > expected * tolerance && slower > noise && slower > 1.0) {
+                    std::cout << "Regression: " << Z80OpcodeHistogram::tableName(timing->table) << ' '
+                              << hexByte(timing->opcode) << ' ' << expected << " -> " << timing->ns << " ns (spread "
+                              << noise << " ns)" << '\n';
+                    regressions++;
+                }
+            }
+        }
+
+        std::cout << '\n';
+        std::cout << "Measured: " << measured << " of " << timings.size() << '\n';
+        std::cout << "Failed: " << failed << '\n';
+        if (!baseline_path.empty()) {
+            std::cout << "Regressions: " << regressions << '\n';
+        }
+
+        return (failed == 0 && (!fail_on_regression || regressions == 0)) ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,275 @@
+// Z80 Profiler Test Suite
+// Sampling profiler with a shadow call stack, built with WITH_FLOW_EVENTS
+
+#include "../include/z80.h"
+#include "../include/z80_bus_interface.h"
+#include "../include/z80_profiler.h"
+#include "../include/z80_symbols.h"
+#include "test_bus.h"
+#include "test_runner.h"
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef WITH_FLOW_EVENTS
+#    error "This test must be built with WITH_FLOW_EVENTS"
+#endif
+
+class ProfiledBus : public Z80BusInterface<ProfiledBus>, public TestBus<ProfiledBus> {
+  public:
+    Z80Profiler profiler;
+    // INT is held active for 32 T-states every 'intPeriod', 0 == never
+    uint64_t intPeriod{0};
+    std::vector<Z80FlowKind> events;
+
+    explicit ProfiledBus(uint32_t sampleInterval, size_t maxDepth = 256) : profiler(sampleInterval, maxDepth) {
+    }
+
+    void run(uint64_t limit) {
+        while (tstates < limit) {
+            cpu.execute();
+            profiler.sample(tstates, cpu.getRegPC());
+        }
+    }
+
+    [[nodiscard]] bool isActiveINTImpl() const {
+        return intPeriod != 0 && tstates % intPeriod < 32;
+    }
+
+    void flowEventImpl(Z80FlowKind kind, uint16_t from, uint16_t to, uint16_t sp) {
+        events.push_back(kind);
+        profiler.onFlow(kind, from, to, sp);
+    }
+};
+
+// main calls outer, outer calls inner twice and then loops on its own
+const std::vector<uint8_t> kStart = {
+    0x31, 0x00, 0x80, // 0x0050 start: LD SP,0x8000
+    0xED, 0x56,       // IM 1
+    0xFB,             // EI
+    0xCD, 0x00, 0x01, // 0x0056 main: CALL outer
+    0x18, 0xFB,       // JR main
+};
+
+const std::vector<uint8_t> kOuter = {
+    0xCD, 0x00, 0x02, // 0x0100 outer: CALL inner
+    0xCD, 0x00, 0x02, // CALL inner
+    0x06, 0x0A,       // LD B,10
+    0x10, 0xFE,       // DJNZ $
+    0xC9,             // RET
+};
+
+const std::vector<uint8_t> kInner = {
+    0x06, 0x28, // 0x0200 inner: LD B,40
+    0x10, 0xFE, // DJNZ $
+    0xC9,       // RET
+};
+
+const std::vector<uint8_t> kIsr = {
+    0xF5,       // 0x0038 isr: PUSH AF
+    0x3E, 0x14, // LD A,20
+    0x3D,       // DEC A
+    0x20, 0xFD, // JR NZ,$-1
+    0xF1,       // POP AF
+    0xFB,       // EI
+    0xED, 0x4D, // RETI
+};
+
+const char* const kSymbols = "; mixed formats\n"
+                             "isr EQU 0038H\n"
+                             "main: EQU 0x00000056\n"
+                             "outer = $0100 ; addr, local, , , , profiler.asm:12\n"
+                             "0200 inner\n"
+                             "WIDTH EQU 70000\n";
+
+std::unique_ptr<ProfiledBus> make_bus(uint32_t sampleInterval) {
+    auto bus = std::make_unique<ProfiledBus>(sampleInterval);
+    bus->ram[0x0000] = 0xC3; // JP start
+    bus->ram[0x0001] = 0x50;
+    bus->load(0x0038, kIsr);
+    bus->load(0x0050, kStart);
+    bus->load(0x0100, kOuter);
+    bus->load(0x0200, kInner);
+    return bus;
+}
+
+// Folded lines as a map from stack to count
+std::vector<std::pair<std::string, uint64_t>> folded_lines(const ProfiledBus& bus, const Z80SymbolMap* symbols) {
+    std::ostringstream out;
+    bus.profiler.writeFolded(out, symbols);
+    std::vector<std::pair<std::string, uint64_t>> lines;
+    std::istringstream in(out.str());
+    for (std::string line; std::getline(in, line);) {
+        size_t space = line.rfind(' ');
+        lines.emplace_back(line.substr(0, space), std::stoull(line.substr(space + 1)));
+    }
+    return lines;
+}
+
+uint64_t count_of(const std::vector<std::pair<std::string, uint64_t>>& lines, const std::string& stack) {
+    for (const auto& [line, count] : lines) {
+        if (line == stack) {
+            return count;
+        }
+    }
+    return 0;
+}
+
+bool test_symbol_formats() {
+    Z80SymbolMap symbols;
+    std::istringstream in(kSymbols);
+    size_t added = symbols.parse(in);
+    const std::string* isrBody = symbols.lookup(0x003A);
+    return added == 4 && symbols.size() == 4 && isrBody != nullptr && *isrBody == "isr"
+           && symbols.name(0x0056) == "main" && symbols.name(0x0104) == "outer" && symbols.name(0x0203) == "inner"
+           && symbols.name(0x0010) == "0x0010" && symbols.lookup(0x0037) == nullptr;
+}
+
+bool test_nested_calls() {
+    auto bus = make_bus(97);
+    bus->run(200000);
+
+    Z80SymbolMap symbols;
+    std::istringstream in(kSymbols);
+    symbols.parse(in);
+    auto lines = folded_lines(*bus, &symbols);
+    uint64_t inner = count_of(lines, "outer;inner");
+    uint64_t outer = count_of(lines, "outer");
+    uint64_t main = count_of(lines, "main");
+    uint64_t total = 0;
+    for (const auto& [line, count] : lines) {
+        total += count;
+    }
+    std::cout << "  " << total << " samples: outer;inner " << inner << ", outer " << outer << ", main " << main
+              << '\n';
+    // inner: 2 x 540 T-states per pass of outer, outer on its own 171
+    return total == bus->profiler.getSamples() && total >= 200000 / 97 - 1 && lines.size() == 3
+           && inner > 5 * outer && outer > main && main > 0;
+}
+
+bool test_interrupt_frames() {
+    auto bus = make_bus(89);
+    bus->intPeriod = 5000;
+    bus->run(300000);
+
+    Z80SymbolMap symbols;
+    std::istringstream in(kSymbols);
+    symbols.parse(in);
+    auto lines = folded_lines(*bus, &symbols);
+    uint64_t isr = 0;
+    uint64_t isrInInner = 0;
+    for (const auto& [line, count] : lines) {
+        if (line.size() >= 9 && line.compare(line.size() - 9, 9, "[int] isr") == 0) {
+            isr += count;
+        }
+        if (line == "outer;inner;[int] isr") {
+            isrInInner = count;
+        }
+    }
+    size_t interrupts = 0;
+    size_t retis = 0;
+    for (Z80FlowKind kind : bus->events) {
+        interrupts += kind == Z80FlowKind::Interrupt ? 1 : 0;
+        retis += kind == Z80FlowKind::Reti ? 1 : 0;
+    }
+    std::cout << "  " << interrupts << " interrupts, " << isr << " samples in the ISR" << '\n';
+    // One INT every 5000 T-states; the last one may still be in its ISR
+    return interrupts >= 59 && interrupts <= 61 && retis + 1 >= interrupts && retis <= interrupts && isr > 0
+           && isrInInner > 0;
+}
+
+bool test_discarded_return_addresses() {
+    ProfiledBus bus(50);
+    bus.load(0x0000, {
+                         0x31, 0x00, 0x80, // LD SP,0x8000
+                         0xCD, 0x00, 0x03, // loop: CALL 0x0300
+                         0x18, 0xFB,       // JR loop
+                     });
+    bus.load(0x0300, {
+                         0xCD, 0x00, 0x04, // CALL 0x0400
+                         0x00, 0x00, 0x00, //
+                         0xC9,             // 0x0306: RET
+                     });
+    bus.load(0x0400, {
+                         0xE1,             // POP HL
+                         0xC3, 0x06, 0x03, // JP 0x0306
+                     });
+    size_t deepest = 0;
+    while (bus.tstates < 100000) {
+        bus.cpu.execute();
+        bus.profiler.sample(bus.tstates, bus.cpu.getRegPC());
+        deepest = std::max(deepest, bus.profiler.getStack().size());
+    }
+    for (const auto& [line, count] : folded_lines(bus, nullptr)) {
+        if (std::count(line.begin(), line.end(), ';') > 2) {
+            return false;
+        }
+    }
+    return deepest == 2;
+}
+
+// The return address of the first CALL is at 0xFFFE, and its RET wraps SP to 0
+bool test_stack_at_top_of_memory() {
+    ProfiledBus bus(10);
+    bus.load(0x0000, {
+                         0x31, 0x00, 0x00, // LD SP,0
+                         0xCD, 0x00, 0x03, // CALL 0x0300
+                         0x06, 0x00,       // LD B,0
+                         0x10, 0xFE,       // DJNZ $
+                         0x76,             // HALT
+                     });
+    bus.load(0x0300, {
+                         0x06, 0x14, // LD B,20
+                         0x10, 0xFE, // DJNZ $
+                         0xC9,       // RET
+                     });
+    bool called = false;
+    while (!bus.cpu.isHalted()) {
+        bus.cpu.execute();
+        bus.profiler.sample(bus.tstates, bus.cpu.getRegPC());
+        const std::vector<Z80Profiler::Frame>& stack = bus.profiler.getStack();
+        called = called || (stack.size() == 1 && stack[0].sp == 0xFFFE);
+        if (bus.cpu.getRegPC() >= 0x0006 && bus.cpu.getRegPC() < 0x0300 && !stack.empty()) {
+            return false;
+        }
+    }
+    return called && bus.cpu.getRegSP() == 0x0000;
+}
+
+bool test_depth_limit() {
+    ProfiledBus bus(10, 4);
+    bus.load(0x0000, {
+                         0x31, 0x00, 0x80, // LD SP,0x8000
+                         0x06, 0x0A,       // LD B,10
+                         0xCD, 0x00, 0x01, // CALL recurse
+                         0x76,             // HALT
+                     });
+    bus.load(0x0100, {
+                         0x05,             // recurse: DEC B
+                         0xC4, 0x00, 0x01, // CALL NZ,recurse
+                         0xC9,             // RET
+                     });
+    while (!bus.cpu.isHalted()) {
+        bus.cpu.execute();
+        bus.profiler.sample(bus.tstates, bus.cpu.getRegPC());
+        if (bus.profiler.getStack().size() > 4) {
+            return false;
+        }
+    }
+    return bus.profiler.getDropped() == 6 && bus.profiler.getStack().empty();
+}
+
+int main() {
+    return runTests("Z80 Profiler Test Suite", {
+        {"Symbol file formats", test_symbol_formats},
+        {"Nested calls folded by symbol", test_nested_calls},
+        {"Interrupt frames", test_interrupt_frames},
+        {"Discarded return addresses", test_discarded_return_addresses},
+        {"Stack at the top of memory", test_stack_at_top_of_memory},
+        {"Depth limit", test_depth_limit},
+    });
+}
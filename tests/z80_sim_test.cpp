@@ -1,9 +1,15 @@
 #include "z80_sim_test.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <filesystem>
 #include <iomanip>
+#include <memory>
 #include <sstream>
+#include <string>
+#include <thread>
 
 Z80SimTest::Z80SimTest() : cpu(*this) {
 }
@@ -15,9 +21,9 @@ uint8_t Z80SimTest::fetchOpcodeImpl(uint16_t address) {
     tstates += 4;
 
 #ifdef WITH_BREAKPOINT_SUPPORT
-    return z80Ram.at(address);
+    return z80Ram.read(address);
 #else
-    uint8_t opcode = z80Ram.at(address);
+    uint8_t opcode = z80Ram.read(address);
     return (cpmMode && address == 0x0005 ? breakpoint(address, opcode) : opcode);
 #endif
 }
@@ -25,13 +31,13 @@ uint8_t Z80SimTest::fetchOpcodeImpl(uint16_t address) {
 uint8_t Z80SimTest::peek8Impl(uint16_t address) {
     // 3 clocks for read byte from RAM
     tstates += 3;
-    return z80Ram.at(address);
+    return z80Ram.read(address);
 }
 
 void Z80SimTest::poke8Impl(uint16_t address, uint8_t value) {
     // 3 clocks for write byte to RAM
     tstates += 3;
-    z80Ram.at(address) = value;
+    z80Ram.write(address, value);
 }
 
 uint16_t Z80SimTest::peek16Impl(uint16_t address) {
@@ -100,13 +106,13 @@ uint8_t Z80SimTest::breakpoint(uint16_t address, uint8_t opcode) {
     switch (cpu.getRegC()) {
         case 0: // BDOS 0 System Reset
         {
-            std::cout << '\n' << "Z80 reset after " << tstates << " t-states\n";
+            *out << '\n' << "Z80 reset after " << tstates << " t-states\n";
             finish = true;
             return opcode;
         }
         case 2: // BDOS 2 console char output
         {
-            std::cout << static_cast<char>(cpu.getRegE());
+            *out << static_cast<char>(cpu.getRegE());
             return opcode;
         }
         case 9: // BDOS 9 console string output (string terminated by "$")
@@ -115,9 +121,9 @@ uint8_t Z80SimTest::breakpoint(uint16_t address, uint8_t opcode) {
             return opcode;
         }
         default: {
-            std::cout << "BDOS Call " << static_cast<unsigned int>(cpu.getRegC()) << '\n';
+            *out << "BDOS Call " << static_cast<unsigned int>(cpu.getRegC()) << '\n';
             finish = true;
-            std::cout << finish << '\n';
+            *out << finish << '\n';
         }
     }
     // opcode would be modified before the decodeOpcode method
@@ -128,8 +134,8 @@ void Z80SimTest::handleStringOutput() {
     uint16_t strAddr = cpu.getRegDE();
     std::string output;
 
-    while (z80Ram.at(strAddr) != '$') {
-        output += static_cast<char>(z80Ram.at(strAddr++));
+    while (z80Ram.read(strAddr) != '$') {
+        output += static_cast<char>(z80Ram.read(strAddr++));
     }
 
     auto current_time = std::chrono::high_resolution_clock::now();
@@ -149,24 +155,22 @@ void Z80SimTest::handleStringOutput() {
         output.replace(output.find("ERROR"), 5, "Failed");
         ++failed;
     }
-    std::cout << output << std::flush;
+    *out << output << std::flush;
     opcode_start_time = current_time;
 }
 
-void Z80SimTest::runTest(std::ifstream* fileStream) {
-    if (!fileStream->is_open()) {
-        std::cout << "file NOT OPEN\n";
-        return;
+size_t Z80SimTest::countGroups(const Z80Image& image) {
+    const uint8_t* data = image.data();
+    size_t groups = 0;
+    size_t offset = kTestTable - kLoadAddress;
+    while (offset + 1 < image.size() && (data[offset] | data[offset + 1]) != 0) {
+        groups++;
+        offset += 2;
     }
+    return groups;
+}
 
-    std::cout << "file open\n";
-
-    const std::streampos size = fileStream->tellg();
-    std::cout << "Test size: " << size << '\n';
-    fileStream->seekg(0, std::ios::beg);
-    fileStream->read(reinterpret_cast<char*>(&z80Ram[0x100]), size);
-    fileStream->close();
-
+void Z80SimTest::run() {
 #ifdef WITH_BREAKPOINT_SUPPORT
     cpu.setBreakpoint(true);
 #endif
@@ -174,19 +178,49 @@ void Z80SimTest::runTest(std::ifstream* fileStream) {
     cpu.reset();
     finish = false;
 
-    z80Ram[0] = static_cast<uint8_t>(0xC3);
-    z80Ram[1] = 0x00;
-    z80Ram[2] = 0x01;                       // JP 0x100 CP/M TPA
-    z80Ram[5] = static_cast<uint8_t>(0xC9); // Return from BDOS call
+    z80Ram.write(0, 0xC3);
+    z80Ram.write(1, 0x00);
+    z80Ram.write(2, 0x01); // JP 0x100 CP/M TPA
+    z80Ram.write(5, 0xC9); // Return from BDOS call
 
-    std::cout << "Running zexall...\n";
-    std::cout.flush();
     start_time = opcode_start_time = std::chrono::high_resolution_clock::now();
     while (!finish) {
         cpu.execute();
     }
     auto end_time = std::chrono::high_resolution_clock::now();
     elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+}
+
+bool Z80SimTest::runGroup(const std::string& path, size_t group) {
+    // Copy-on-write: pages stay shared with the page cache until the program writes them
+    if (!z80Ram.mapCopyOnWrite(kLoadAddress, path)) {
+        return false;
+    }
+
+    // The table keeps the selected entry followed by the terminator
+    auto entry = static_cast<uint16_t>(kTestTable + (group * 2));
+    z80Ram.write(kTestTable, z80Ram.read(entry));
+    z80Ram.write(kTestTable + 1, z80Ram.read(entry + 1));
+    z80Ram.write(kTestTable + 2, 0x00);
+    z80Ram.write(kTestTable + 3, 0x00);
+
+    run();
+    return true;
+}
+
+void Z80SimTest::runTest(const std::string& path) {
+    if (!z80Ram.mapCopyOnWrite(kLoadAddress, path)) {
+        std::cout << "file NOT OPEN\n";
+        return;
+    }
+
+    std::cout << "file open\n";
+
+    std::cout << "Test size: " << std::filesystem::file_size(path) << '\n';
+
+    std::cout << "Running zexall...\n";
+    std::cout.flush();
+    run();
 
     std::cout << "\n";
     std::cout << "Elapsed T-state count:  " << tstates << "\n";
@@ -203,13 +237,109 @@ void Z80SimTest::runTest(std::ifstream* fileStream) {
     }
 }
 
-int main() {
+// Result of one ZEXALL group run on its own thread
+struct GroupResult {
+    std::string output;
+    bool passed{false};
+    int64_t elapsed_ms{0};
+    uint64_t tstates{0};
+};
+
+/* Run every ZEXALL group on its own Z80SimTest, spread over 'threads' worker
+ * threads. Every group maps the program on its own, since the groups write
+ * to it. */
+void run_parallel(const std::string& path, size_t threads) {
+    std::shared_ptr<const Z80Image> table = Z80Image::map(path, Z80Image::Access::ReadOnly);
+    if (!table) {
+        std::cout << "file NOT OPEN\n";
+        return;
+    }
+
+    size_t groups = Z80SimTest::countGroups(*table);
+    threads = std::max<size_t>(1, std::min(threads, groups));
+    std::cout << "Running " << groups << " zexall groups on " << threads << " threads...\n";
+    std::cout.flush();
+
+    std::vector<GroupResult> results(groups);
+    std::atomic<size_t> next{0};
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    auto worker = [&]() {
+        for (size_t group = next++; group < groups; group = next++) {
+            std::ostringstream output;
+            auto sim = std::make_unique<Z80SimTest>();
+            sim->setOutput(output);
+            auto group_start = std::chrono::high_resolution_clock::now();
+            bool mapped = sim->runGroup(path, group);
+            auto group_end = std::chrono::high_resolution_clock::now();
+
+            GroupResult& result = results[group];
+            result.output = mapped ? output.str() : "cannot map " + path + "\n";
+            result.passed = mapped && sim->getPassed() == 1 && sim->getFailed() == 0;
+            result.elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(group_end - group_start).count();
+            result.tstates = sim->getTstates();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t idx = 1; idx < threads; idx++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    int64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+
+    int64_t total_ms = 0;
+    uint64_t tstates = 0;
+    size_t passed = 0;
+    for (size_t group = 0; group < groups; group++) {
+        const GroupResult& result = results[group];
+        // Keep the group line only, the banner and the closing messages are printed by every group
+        size_t begin = result.output.find('\r');
+        begin = (begin == std::string::npos) ? 0 : begin + 1;
+        size_t end = result.output.find('\n', begin);
+        std::cout << std::setw(2) << group << " " << result.output.substr(begin, end - begin + 1) << std::flush;
+        if (!result.passed) {
+            std::cout << "   (group " << group << " failed)\n";
+        }
+        passed += result.passed ? 1 : 0;
+        total_ms += result.elapsed_ms;
+        tstates += result.tstates;
+    }
+
+    std::cout << "\n";
+    std::cout << "Elapsed T-state count:  " << tstates << "\n";
+    std::cout << "Cumulative test time:  " << static_cast<float>(total_ms) / 1000.0f << " sec\n";
+    std::cout << "✓ Tests passed: " << passed << "\n";
+    std::cout << "✗ Tests failed: " << groups - passed << "\n";
+    std::cout << "Total elapsed time:     " << static_cast<float>(elapsed_ms) / 1000.0f << " sec\n";
+    if (elapsed_ms > 0) {
+        std::cout << "Cumulative / elapsed:   " << std::fixed << std::setprecision(2)
+                  << static_cast<float>(total_ms) / static_cast<float>(elapsed_ms) << "x\n";
+    }
+    std::cout.flush();
+    if (passed != groups) {
+        throw std::runtime_error("Test failed");
+    }
+}
+
+int main(int argc, char* argv[]) {
     try {
-        Z80SimTest sim;
+        // --parallel [threads]: one thread per test group, up to the number of cores by default
+        if (argc > 1 && std::string(argv[1]) == "--parallel") {
+            size_t threads = std::max(1U, std::thread::hardware_concurrency());
+            if (argc > 2) {
+                threads = std::stoul(argv[2]);
+            }
+            run_parallel("zexall.bin", threads);
+            return 0;
+        }
 
-        std::ifstream f1("zexall.bin", std::ios::in | std::ios::binary | std::ios::ate);
-        sim.runTest(&f1);
-        f1.close();
+        Z80SimTest sim;
+        sim.runTest("zexall.bin");
         return 0;
     } catch (const std::exception& e) {
         std::cerr << "Exception: " << e.what() << '\n';
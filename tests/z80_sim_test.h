@@ -3,17 +3,20 @@
 
 #include <array>
 #include <chrono>
-#include <fstream>
 #include <iostream>
+#include <memory>
+#include <string>
 
 #include "../include/z80.h"
 #include "../include/z80_bus_interface.h"
+#include "../include/z80_image.h"
+#include "../include/z80_memory.h"
 
 class Z80SimTest : public Z80BusInterface<Z80SimTest> {
   private:
     uint64_t tstates{0};
     Z80<Z80SimTest> cpu;
-    std::array<uint8_t, 0x10000> z80Ram{};
+    Z80Memory z80Ram;
     std::array<uint8_t, 0x10000> z80Ports{};
     volatile bool finish{false};
     volatile uint16_t failed{0};
@@ -23,6 +26,7 @@ class Z80SimTest : public Z80BusInterface<Z80SimTest> {
     std::chrono::high_resolution_clock::time_point start_time;
     std::chrono::high_resolution_clock::time_point opcode_start_time;
     bool cpmMode{true};
+    std::ostream* out{&std::cout};
 
   public:
     Z80SimTest();
@@ -55,7 +59,36 @@ class Z80SimTest : public Z80BusInterface<Z80SimTest> {
     void execDoneImpl(void);
 #endif
 
-    void runTest(std::ifstream* fileStream);
+    void runTest(const std::string& path);
+
+    // ZEXALL keeps its list of test groups at 0x013C, a 0x0000 terminated table of pointers
+    static constexpr uint16_t kTestTable = 0x013C;
+    static constexpr uint16_t kLoadAddress = 0x0100;
+
+    static size_t countGroups(const Z80Image& image);
+
+    /* Run a single test group by patching the test table to hold only that
+     * group; false if the program cannot be mapped */
+    bool runGroup(const std::string& path, size_t group);
+
+    void setOutput(std::ostream& stream) {
+        out = &stream;
+    }
+
+    [[nodiscard]] int64_t getPassed() const {
+        return num_tests;
+    }
+
+    [[nodiscard]] uint16_t getFailed() const {
+        return failed;
+    }
+
+    [[nodiscard]] uint64_t getTstates() const {
+        return tstates;
+    }
+
+  private:
+    void run();
 };
 
 #endif // Z80_SIM_TEST_H
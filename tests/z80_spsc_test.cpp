@@ -0,0 +1,171 @@
+// Z80 SPSC Ring Test Suite
+// Lock-free channels between the emulation thread and its consumers
+
+#include "../include/z80.h"
+#include "../include/z80_bus_interface.h"
+#include "../include/z80_spsc.h"
+#include "test_bus.h"
+#include "test_runner.h"
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+bool test_push_pop_wraps_around() {
+    Z80SpscRing<uint32_t, 8> ring;
+    uint32_t next = 0;
+    uint32_t expected = 0;
+    for (int round = 0; round < 100; round++) {
+        std::array<uint32_t, 5> batch{};
+        for (auto& value : batch) {
+            value = next++;
+        }
+        if (ring.pushBatch(batch.data(), batch.size()) != batch.size()) {
+            return false;
+        }
+        std::array<uint32_t, 8> out{};
+        size_t count = ring.popBatch(out.data(), out.size());
+        for (size_t idx = 0; idx < count; idx++) {
+            if (out[idx] != expected++) {
+                return false;
+            }
+        }
+    }
+    return ring.empty() && ring.getDropped() == 0 && expected == next;
+}
+
+bool test_drop_newest() {
+    Z80SpscRing<uint8_t, 4> ring(Z80DropPolicy::DropNewest);
+    std::array<uint8_t, 6> batch = {1, 2, 3, 4, 5, 6};
+    size_t accepted = ring.pushBatch(batch.data(), batch.size());
+    uint8_t first = 0;
+    return accepted == 4 && ring.getDropped() == 2 && !ring.tryPush(7) && ring.getDropped() == 3
+           && ring.tryPop(first) && first == 1 && ring.tryPush(8) && ring.size() == 4;
+}
+
+bool test_drop_batch() {
+    Z80SpscRing<uint8_t, 4> ring(Z80DropPolicy::DropBatch);
+    std::array<uint8_t, 3> batch = {1, 2, 3};
+    return ring.pushBatch(batch.data(), batch.size()) == 3 && ring.pushBatch(batch.data(), batch.size()) == 0
+           && ring.getDropped() == 3 && ring.size() == 3 && ring.tryPush(4) && ring.size() == 4;
+}
+
+bool test_threaded_transfer_in_order() {
+    constexpr uint64_t kItems = 2000000;
+    auto ring = std::make_unique<Z80SpscRing<uint64_t, 1024>>();
+    std::atomic<bool> inOrder{true};
+
+    std::thread consumer([&] {
+        std::array<uint64_t, 64> out{};
+        uint64_t expected = 0;
+        while (expected < kItems) {
+            size_t count = ring->popBatch(out.data(), out.size());
+            for (size_t idx = 0; idx < count; idx++) {
+                if (out[idx] != expected++) {
+                    inOrder = false;
+                }
+            }
+            if (count == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Lossless for the test: retry what was dropped
+    uint64_t dropped = 0;
+    for (uint64_t value = 0; value < kItems;) {
+        if (ring->tryPush(value)) {
+            value++;
+        } else {
+            dropped++;
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+    return inOrder && ring->empty() && ring->getDropped() == dropped;
+}
+
+// Bus that publishes OUT writes and reads the last input state pushed by the frontend
+class ChannelBus : public Z80BusInterface<ChannelBus>, public TestBus<ChannelBus> {
+  public:
+    Z80PortChannels<256, 16> channels;
+
+    uint8_t inPortImpl(uint16_t port) {
+        tstates += 4;
+        return channels.inPort();
+    }
+
+    void outPortImpl(uint16_t port, uint8_t value) {
+        tstates += 4;
+        channels.outPort(tstates, port, value);
+    }
+};
+
+// Writes A to port 0xFE until a key read from port 0x1F returns 0x00, then HALT
+const std::vector<uint8_t> kPortProgram = {
+    0x3E, 0x00, // LD A,0
+    0xD3, 0xFE, // loop: OUT (0xFE),A
+    0x3C,       // INC A
+    0x47,       // LD B,A
+    0xDB, 0x1F, // IN A,(0x1F)
+    0xB7,       // OR A
+    0x78,       // LD A,B
+    0x20, 0xF6, // JR NZ,loop
+    0x76,       // HALT
+};
+
+bool test_bus_channels() {
+    auto bus = std::make_unique<ChannelBus>();
+    bus->load(0, kPortProgram);
+
+    std::atomic<bool> running{true};
+    std::atomic<bool> valid{true};
+    uint64_t received = 0;
+
+    std::thread frontend([&] {
+        std::array<Z80PortEvent, 32> events{};
+        uint64_t lastTstates = 0;
+        while (running || !bus->channels.events().empty()) {
+            size_t count = bus->channels.events().popBatch(events.data(), events.size());
+            for (size_t idx = 0; idx < count; idx++) {
+                if ((events[idx].port & 0xFF) != 0xFE) {
+                    valid = false;
+                }
+                if (events[idx].tstates <= lastTstates) {
+                    valid = false;
+                }
+                lastTstates = events[idx].tstates;
+            }
+            received += count;
+            // Release the key after enough events made it through
+            if (received >= 10000) {
+                bus->channels.pushInput(0x00);
+            }
+            if (count == 0) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    bus->runToHalt();
+    running = false;
+    frontend.join();
+
+    // Every OUT was either delivered or counted as dropped, the emulation never waited
+    uint64_t outs = bus->cpu.getRegB();
+    uint64_t total = received + bus->channels.events().getDropped();
+    return valid && received >= 10000 && total % 256 == outs % 256;
+}
+
+int main() {
+    return runTests("Z80 SPSC Ring Test Suite", {
+        {"Push and pop wrap around", test_push_pop_wraps_around},
+        {"Drop newest policy", test_drop_newest},
+        {"Drop batch policy", test_drop_batch},
+        {"Threaded transfer keeps order", test_threaded_transfer_in_order},
+        {"Bus callbacks feed the channels", test_bus_channels},
+    });
+}
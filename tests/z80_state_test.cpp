@@ -0,0 +1,226 @@
+// Z80 CPU State Test Suite
+// Movable, poolable and rebindable CPU instances, checkpoints
+
+#include "../include/z80.h"
+#include "../include/z80_bus_interface.h"
+#include "../include/z80_checkpoint.h"
+#include "../include/z80_hash.h"
+#include "../include/z80_machine.h"
+#include "test_bus.h"
+#include "test_runner.h"
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Minimal bus that does not own its CPU, so CPUs can live in a separate pool
+class PoolBus : public Z80BusInterface<PoolBus>, public FlatTestBus {};
+
+// Sums 1..B into HL, with B taken from (0x7000), stores HL at 0x7002 and halts
+const std::vector<uint8_t> kSumProgram = {
+    0x3A, 0x00, 0x70, // LD A,(0x7000)
+    0x47,             // LD B,A
+    0x21, 0x00, 0x00, // LD HL,0
+    0x16, 0x00,       // LD D,0
+    0x58,             // loop: LD E,B
+    0x19,             // ADD HL,DE
+    0x10, 0xFC,       // DJNZ loop
+    0x22, 0x02, 0x70, // LD (0x7002),HL
+    0x76,             // HALT
+};
+
+void load_sum_program(PoolBus& bus, uint8_t count) {
+    bus.load(0, kSumProgram);
+    bus.ram[0x7000] = count;
+}
+
+void run_to_halt(Z80<PoolBus>& cpu) {
+    while (!cpu.isHalted()) {
+        cpu.execute();
+    }
+}
+
+uint16_t stored_sum(const PoolBus& bus) {
+    return bus.ram[0x7002] | (bus.ram[0x7003] << 8);
+}
+
+bool test_cpu_is_movable() {
+    static_assert(std::is_nothrow_move_constructible_v<Z80<PoolBus>>);
+    static_assert(std::is_nothrow_move_assignable_v<Z80<PoolBus>>);
+    static_assert(!std::is_copy_constructible_v<Z80<PoolBus>>);
+
+    PoolBus bus;
+    load_sum_program(bus, 10);
+    Z80<PoolBus> cpu(bus);
+    for (int idx = 0; idx < 8; idx++) {
+        cpu.execute();
+    }
+    Z80State before = cpu.getState();
+
+    Z80<PoolBus> moved(std::move(cpu));
+    if (z80HashState(moved.getState()) != z80HashState(before) || moved.getBus() != &bus) {
+        return false;
+    }
+    run_to_halt(moved);
+    return stored_sum(bus) == 55;
+}
+
+bool test_contiguous_pool() {
+    constexpr size_t kBuses = 8;
+    constexpr size_t kCpus = 64;
+    std::vector<PoolBus> buses(kBuses);
+
+    // Unbound CPUs, constructed in place in one allocation
+    std::vector<Z80<PoolBus>> pool(kCpus / 2);
+    for (size_t idx = 0; idx < pool.size(); idx++) {
+        pool[idx].rebind(buses[idx % kBuses]);
+    }
+
+    // Half-way through, grow the pool so that the existing CPUs are moved
+    for (int step = 0; step < 20; step++) {
+        for (auto& cpu : pool) {
+            cpu.execute();
+        }
+    }
+    while (pool.size() < kCpus) {
+        pool.emplace_back(buses[pool.size() % kBuses]);
+    }
+
+    for (size_t idx = 0; idx < kBuses; idx++) {
+        load_sum_program(buses[idx], static_cast<uint8_t>(idx + 1));
+    }
+    // Every CPU of a bus computes the same result; run each group in turn
+    for (size_t idx = 0; idx < pool.size(); idx++) {
+        pool[idx].reset();
+        run_to_halt(pool[idx]);
+        size_t count = (idx % kBuses) + 1;
+        if (stored_sum(buses[idx % kBuses]) != count * (count + 1) / 2) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool test_recycle_with_rebind() {
+    PoolBus first;
+    PoolBus second;
+    load_sum_program(first, 100);
+    load_sum_program(second, 200);
+
+    Z80<PoolBus> cpu(first);
+    run_to_halt(cpu);
+
+    // Recycle the same instance for another machine without reconstructing it
+    cpu.rebind(second);
+    cpu.reset();
+    run_to_halt(cpu);
+
+    Z80<PoolBus> reference(second);
+    load_sum_program(second, 200);
+    run_to_halt(reference);
+
+    return stored_sum(first) == 5050 && stored_sum(second) == 20100 && cpu.getRegHL() == reference.getRegHL();
+}
+
+void load_sum_program(Z80Machine& machine, uint8_t count) {
+    machine.getMemory().load(0, kSumProgram.data(), kSumProgram.size());
+    machine.getMemory().write(0x7000, count);
+}
+
+bool test_checkpoint_round_trip() {
+    Z80Machine machine;
+    load_sum_program(machine, 200);
+    machine.getCpu().setRegIX(0xBEEF);
+    machine.getCpu().setIM(Z80<Z80Machine>::IntMode::IM2);
+    machine.runUntil(1000);
+
+    Z80Checkpoint checkpoint;
+    checkpoint.capture(machine.getCpu(), machine.getMemory(), machine.getTstates());
+    checkpoint.devices = {0x01, 0x02, 0x03};
+    std::vector<uint8_t> bytes = checkpoint.serialize();
+
+    Z80Checkpoint decoded;
+    if (!Z80Checkpoint::deserialize(bytes.data(), bytes.size(), decoded)) {
+        return false;
+    }
+    // Only pages 0x00 and 0x70 are non-zero and stored, the stack page is still empty
+    return bytes.size() < 1024 && z80HashState(decoded.cpu) == z80HashState(checkpoint.cpu)
+           && decoded.tstates == checkpoint.tstates && decoded.memory == checkpoint.memory
+           && decoded.devices == checkpoint.devices && decoded.cpu.ix == 0xBEEF && decoded.cpu.im == 2;
+}
+
+bool test_checkpoint_rejects_corruption() {
+    Z80Machine machine;
+    load_sum_program(machine, 10);
+    Z80Checkpoint checkpoint;
+    checkpoint.capture(machine.getCpu(), machine.getMemory(), machine.getTstates());
+    std::vector<uint8_t> bytes = checkpoint.serialize();
+
+    Z80Checkpoint decoded;
+    std::vector<uint8_t> flipped = bytes;
+    flipped[20] ^= 0x01;
+    std::vector<uint8_t> newer = bytes;
+    newer[8] = Z80Checkpoint::kVersion + 1;
+    // A device length past the end of the image, with a valid hash
+    std::vector<uint8_t> oversized = bytes;
+    size_t hashOffset = oversized.size() - 8;
+    std::fill(oversized.begin() + static_cast<std::ptrdiff_t>(hashOffset) - 4,
+              oversized.begin() + static_cast<std::ptrdiff_t>(hashOffset), 0xFF);
+    uint64_t hash = z80HashBytes(oversized.data(), hashOffset);
+    for (size_t idx = 0; idx < 8; idx++) {
+        oversized[hashOffset + idx] = static_cast<uint8_t>(hash >> (idx * 8));
+    }
+    return !Z80Checkpoint::deserialize(flipped.data(), flipped.size(), decoded)
+           && !Z80Checkpoint::deserialize(bytes.data(), bytes.size() - 1, decoded)
+           && !Z80Checkpoint::deserialize(newer.data(), newer.size(), decoded)
+           && !Z80Checkpoint::deserialize(oversized.data(), oversized.size(), decoded);
+}
+
+bool test_resume_from_streamed_checkpoint() {
+    std::string path = temp_path("z80_state_test.ckpt");
+
+    Z80Machine original;
+    load_sum_program(original, 250);
+    {
+        Z80CheckpointWriter writer;
+        original.runUntil(2000);
+        if (!writer.checkpoint(original.getCpu(), original.getMemory(), original.getTstates(), path)) {
+            return false;
+        }
+        // Emulation goes on while the writer thread serializes the snapshot
+        original.runUntil(1000000);
+        writer.flush();
+        if (writer.getWritten() != 1 || writer.getFailed() != 0) {
+            return false;
+        }
+    }
+
+    Z80Checkpoint checkpoint;
+    if (!Z80Checkpoint::load(path, checkpoint)) {
+        return false;
+    }
+    std::filesystem::remove(path);
+
+    Z80Machine resumed;
+    checkpoint.restore(resumed.getCpu(), resumed.getMemory());
+    resumed.setTstates(checkpoint.tstates);
+    resumed.runUntil(1000000);
+
+    return checkpoint.tstates >= 2000 && resumed.getTstates() == original.getTstates()
+           && resumed.hash() == original.hash() && resumed.getCpu().getRegHL() == 31375;
+}
+
+int main() {
+    return runTests("Z80 CPU State Test Suite", {
+        {"CPU can be moved", test_cpu_is_movable},
+        {"CPUs pooled in a contiguous vector", test_contiguous_pool},
+        {"CPU recycled with rebind", test_recycle_with_rebind},
+        {"Checkpoint round trip", test_checkpoint_round_trip},
+        {"Corrupt checkpoints are rejected", test_checkpoint_rejects_corruption},
+        {"Resume from a streamed checkpoint", test_resume_from_streamed_checkpoint},
+    });
+}
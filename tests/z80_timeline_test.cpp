@@ -0,0 +1,249 @@
+// Z80 Timeline Test Suite
+// Chrome trace event export of frames, interrupts, HALT periods and host stalls, built with WITH_FLOW_EVENTS
+
+#include "../include/z80.h"
+#include "../include/z80_bus_interface.h"
+#include "../include/z80_timeline.h"
+#include "test_bus.h"
+#include "test_runner.h"
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef WITH_FLOW_EVENTS
+#    error "This test must be built with WITH_FLOW_EVENTS"
+#endif
+
+constexpr uint64_t kFrameTstates = 69888;
+
+// A frame loop: INT at the start of every frame, memory accesses counted per frame
+class TimelineBus : public Z80BusInterface<TimelineBus>, public TestBus<TimelineBus> {
+  public:
+    uint64_t accesses{0};
+    Z80Timeline* timeline{nullptr};
+
+    void runFrame() {
+        uint64_t end = (tstates / kFrameTstates + 1) * kFrameTstates;
+        timeline->beginFrame(tstates);
+        accesses = 0;
+        while (tstates < end) {
+            cpu.execute();
+        }
+        timeline->counter("memory accesses", accesses);
+        timeline->endFrame(tstates);
+    }
+
+    uint8_t fetchOpcodeImpl(uint16_t address) {
+        accesses++;
+        return FlatTestBus::fetchOpcodeImpl(address);
+    }
+
+    uint8_t peek8Impl(uint16_t address) {
+        accesses++;
+        return FlatTestBus::peek8Impl(address);
+    }
+
+    void poke8Impl(uint16_t address, uint8_t value) {
+        accesses++;
+        FlatTestBus::poke8Impl(address, value);
+    }
+
+    uint16_t peek16Impl(uint16_t address) {
+        accesses += 2;
+        return FlatTestBus::peek16Impl(address);
+    }
+
+    void poke16Impl(uint16_t address, RegisterPair word) {
+        accesses += 2;
+        FlatTestBus::poke16Impl(address, word);
+    }
+
+    [[nodiscard]] bool isActiveINTImpl() const {
+        return tstates % kFrameTstates < 32;
+    }
+
+    void flowEventImpl(Z80FlowKind kind, uint16_t from, uint16_t to, uint16_t sp) {
+        timeline->onFlow(kind, to, tstates);
+    }
+};
+
+// The main loop waits for the frame interrupt; the ISR copies 'length' bytes
+const std::vector<uint8_t> kMain = {
+    0x31, 0x00, 0xF0, // 0x0000: LD SP,0xF000
+    0xED, 0x56,       // IM 1
+    0xFB,             // EI
+    0x76,             // 0x0006 loop: HALT
+    0x18, 0xFD,       // JR loop
+};
+
+const std::vector<uint8_t> kIsr = {
+    0xF5,             // 0x0038: PUSH AF
+    0x21, 0x00, 0x40, // LD HL,0x4000
+    0x11, 0x00, 0x80, // LD DE,0x8000
+    0xED, 0x4B, 0x00, 0x90, // LD BC,(0x9000)
+    0xED, 0xB0,       // LDIR
+    0xF1,             // POP AF
+    0xFB,             // EI
+    0xED, 0x4D,       // RETI
+};
+
+std::unique_ptr<TimelineBus> make_bus(Z80Timeline& timeline) {
+    auto bus = std::make_unique<TimelineBus>();
+    bus->load(0x0000, kMain);
+    bus->load(0x0038, kIsr);
+    bus->timeline = &timeline;
+    return bus;
+}
+
+std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+size_t count_of(const std::string& text, const std::string& pattern) {
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+        count++;
+    }
+    return count;
+}
+
+// Balanced braces and brackets outside strings, and nothing after the outer object
+bool well_formed(const std::string& text) {
+    std::vector<char> open;
+    bool inString = false;
+    for (size_t idx = 0; idx < text.size(); idx++) {
+        char chr = text[idx];
+        if (inString) {
+            if (chr == '\\') {
+                idx++;
+            } else if (chr == '"') {
+                inString = false;
+            }
+        } else if (chr == '"') {
+            inString = true;
+        } else if (chr == '{' || chr == '[') {
+            open.push_back(chr == '{' ? '}' : ']');
+        } else if (chr == '}' || chr == ']') {
+            if (open.empty() || open.back() != chr) {
+                return false;
+            }
+            open.pop_back();
+            if (open.empty()) {
+                return text.find_first_not_of(" \n", idx + 1) == std::string::npos;
+            }
+        } else if (chr == ',' && idx + 1 < text.size() && (text[idx + 1] == ']' || text[idx + 1] == '}')) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool test_frame_timeline() {
+    std::string path = temp_path("z80_timeline_test.json");
+    uint64_t frames = 0;
+    uint64_t events = 0;
+    {
+        Z80ChromeTraceWriter writer(path, 4096);
+        Z80Timeline timeline(writer);
+        auto bus = make_bus(timeline);
+        for (int frame = 0; frame < 50; frame++) {
+            // The ISR copies more every frame
+            bus->ram[0x9000] = static_cast<uint8_t>(frame * 50 + 1);
+            bus->ram[0x9001] = static_cast<uint8_t>((frame * 50 + 1) >> 8);
+            bus->runFrame();
+        }
+        frames = timeline.getFrames();
+        events = writer.getEvents();
+        if (!writer.close()) {
+            return false;
+        }
+    }
+
+    std::string json = read_file(path);
+    std::filesystem::remove(path);
+    // The first HALT is taken right after EI; every later INT is acknowledged by the HALT crossing into the next frame
+    size_t ints = count_of(json, "\"name\":\"INT\"");
+    size_t halts = count_of(json, "\"name\":\"HALT\"");
+    size_t counters = count_of(json, "\"ph\":\"C\",\"name\":\"memory accesses\"");
+    return well_formed(json) && frames == 50 && count_of(json, "\"name\":\"frame\"") == 50 && ints == 51
+           && halts == 51 && counters == 50 && count_of(json, "\"handler\":56") == 51
+           && count_of(json, "\"thread_name\"") == 2 && events == 2 + 50 + 51 + 51 + 50;
+}
+
+bool test_stalls_and_budget() {
+    std::string path = temp_path("z80_timeline_budget.json");
+    uint64_t overBudget = 0;
+    {
+        Z80ChromeTraceWriter writer(path);
+        Z80Timeline timeline(writer, 2000);
+        auto bus = make_bus(timeline);
+        for (int frame = 0; frame < 6; frame++) {
+            bus->runFrame();
+            // The host falls behind on frame 3
+            double start = writer.nowMicros();
+            auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(frame == 3 ? 3000 : 50);
+            while (std::chrono::steady_clock::now() < until) {
+            }
+            timeline.stall(frame == 3 ? "audio \"underrun\"" : "vsync", start);
+        }
+        // A frame that includes the stall
+        timeline.beginFrame(bus->tstates);
+        auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(2500);
+        while (std::chrono::steady_clock::now() < until) {
+        }
+        timeline.endFrame(bus->tstates);
+        overBudget = timeline.getOverBudget();
+    }
+
+    std::string json = read_file(path);
+    std::filesystem::remove(path);
+    return well_formed(json) && overBudget >= 1 && count_of(json, "\"name\":\"over budget\"") == overBudget
+           && count_of(json, "\"name\":\"vsync\",\"cat\":\"host\",\"pid\":1,\"tid\":2") == 5
+           && count_of(json, "\"name\":\"audio \\\"underrun\\\"\"") == 1;
+}
+
+bool test_unwritable_path() {
+    Z80ChromeTraceWriter writer(temp_path("no_such_dir/z80_timeline_test.json"), 64);
+    for (int idx = 0; idx < 100; idx++) {
+        writer.instant("event", "test", 1, writer.nowMicros());
+    }
+    return !writer.close() && !writer.good();
+}
+
+// Informational: cost of one event in the buffered writer
+bool test_writer_throughput() {
+    std::string path = temp_path("z80_timeline_throughput.json");
+    constexpr int kRuns = 3;
+    constexpr int kEvents = 200000;
+    double seconds = bestSeconds(kRuns, [&path]() {
+        Z80ChromeTraceWriter writer(path);
+        for (int idx = 0; idx < kEvents; idx++) {
+            writer.complete("frame", "emulation", 1, idx * 20.0, 15.0, {{"tstates", idx * kFrameTstates}});
+        }
+        writer.close();
+    });
+    auto bytes = std::filesystem::file_size(path);
+    std::filesystem::remove(path);
+    std::cout << std::fixed << std::setprecision(1) << "  " << seconds * 1e9 / kEvents << " ns/event, "
+              << static_cast<double>(bytes) / kEvents << " bytes/event" << '\n';
+    return bytes > 0;
+}
+
+int main() {
+    return runTests("Z80 Timeline Test Suite", {
+        {"Frames, interrupts and HALT periods", test_frame_timeline},
+        {"Host stalls and frame budget", test_stalls_and_budget},
+        {"Unwritable path is reported", test_unwritable_path},
+        {"Writer throughput", test_writer_throughput},
+    });
+}
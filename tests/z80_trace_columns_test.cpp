@@ -0,0 +1,294 @@
+// Z80 Columnar Trace Test Suite
+// Chunked, delta-encoded trace columns with a seek index, mmap reader and parallel analyzer
+
+#include "../include/z80.h"
+#include "../include/z80_machine.h"
+#include "../include/z80_trace.h"
+#include "../include/z80_trace_columns.h"
+#include "test_runner.h"
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef WITH_OPCODE_HISTOGRAM
+#    error "This test must be built with WITH_OPCODE_HISTOGRAM"
+#endif
+
+// 1024 passes over the main, CB, ED, DD and DDCB tables, three memory writes per pass
+const std::vector<uint8_t> kMixProgram = {
+    0x31, 0x00, 0xF0,       // LD SP,0xF000
+    0xDD, 0x21, 0x00, 0x80, // LD IX,0x8000
+    0x21, 0x00, 0x90,       // LD HL,0x9000
+    0x01, 0x00, 0x04,       // LD BC,0x0400
+    0x7D,                   // loop: LD A,L
+    0xED, 0x44,             // NEG
+    0xDD, 0x77, 0x00,       // LD (IX+0),A
+    0xDD, 0xCB, 0x00, 0x06, // RLC (IX+0)
+    0xDD, 0x23,             // INC IX
+    0x77,                   // LD (HL),A
+    0xCB, 0x3F,             // SRL A
+    0x23,                   // INC HL
+    0x0B,                   // DEC BC
+    0x78,                   // LD A,B
+    0xB1,                   // OR C
+    0x20, 0xEB,             // JR NZ,loop
+    0x76,                   // HALT
+};
+
+struct SyntheticTrace {
+    std::vector<Z80TraceRecord> records;
+    std::vector<std::vector<std::pair<uint16_t, uint8_t>>> writes;
+};
+
+SyntheticTrace make_synthetic(size_t count) {
+    std::mt19937 rng(0xC015);
+    SyntheticTrace trace;
+    uint64_t tstates = 1000;
+    for (size_t idx = 0; idx < count; idx++) {
+        tstates += 4 + rng() % 20;
+        Z80TraceRecord rec{};
+        rec.tstates = tstates;
+        rec.pc = static_cast<uint16_t>(idx % 13 == 0 ? rng() : 0x4000 + idx % 40);
+        rec.bytes = idx % 5 == 0 ? rng() : 0x00000000;
+        rec.af = static_cast<uint16_t>(rng());
+        rec.bc = static_cast<uint16_t>(idx / 100);
+        rec.hl = static_cast<uint16_t>(idx % 3 == 0 ? rng() : 0x5800);
+        rec.sp = static_cast<uint16_t>(0xFF00 - (idx % 4) * 2);
+        rec.r = static_cast<uint8_t>(idx * 2);
+        rec.status = static_cast<uint8_t>(idx % 50 == 0 ? 0x13 : 0x03);
+        trace.records.push_back(rec);
+        trace.writes.emplace_back();
+        for (uint32_t write = 0; write < (idx % 7 == 0 ? rng() % 4 : 0); write++) {
+            trace.writes.back().emplace_back(static_cast<uint16_t>(rng()), static_cast<uint8_t>(rng()));
+        }
+    }
+    return trace;
+}
+
+bool write_synthetic(const SyntheticTrace& trace, const std::string& path, uint32_t chunkRecords) {
+    Z80ColumnTraceWriter writer(path, chunkRecords);
+    for (size_t idx = 0; idx < trace.records.size(); idx++) {
+        for (const auto& [address, value] : trace.writes[idx]) {
+            writer.appendWrite(address, value);
+        }
+        writer.append(trace.records[idx]);
+    }
+    return writer.close();
+}
+
+bool test_round_trip() {
+    SyntheticTrace trace = make_synthetic(25000);
+    std::string path = temp_path("z80_trace_columns_test.z80c");
+    if (!write_synthetic(trace, path, 4096)) {
+        return false;
+    }
+
+    Z80ColumnTrace reader;
+    bool ok = reader.open(path) && reader.getRecords() == trace.records.size() && reader.getChunkCount() == 7;
+    Z80TraceChunk chunk;
+    for (size_t idx = 0; ok && idx < reader.getChunkCount(); idx++) {
+        ok = reader.decodeChunk(idx, chunk);
+        for (size_t rec = 0; ok && rec < chunk.size(); rec++) {
+            size_t instruction = chunk.firstInstruction + rec;
+            ok = chunk.record(rec) == trace.records[instruction]
+                 && chunk.writeStart[rec + 1] - chunk.writeStart[rec] == trace.writes[instruction].size();
+            for (size_t write = 0; ok && write < trace.writes[instruction].size(); write++) {
+                ok = chunk.writeAddress[chunk.writeStart[rec] + write] == trace.writes[instruction][write].first
+                     && chunk.writeValue[chunk.writeStart[rec] + write] == trace.writes[instruction][write].second;
+            }
+        }
+    }
+    std::filesystem::remove(path);
+    return ok;
+}
+
+bool test_random_access() {
+    SyntheticTrace trace = make_synthetic(50000);
+    std::string path = temp_path("z80_trace_columns_seek.z80c");
+    if (!write_synthetic(trace, path, 1000)) {
+        return false;
+    }
+
+    Z80ColumnTrace reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+    std::mt19937 rng(7);
+    bool ok = true;
+    for (int probe = 0; ok && probe < 200; probe++) {
+        uint64_t instruction = rng() % trace.records.size();
+        Z80TraceRecord record{};
+        ok = reader.read(instruction, record) && record == trace.records[instruction];
+
+        // The chunk found for a T-state holds the instruction running at that T-state
+        uint64_t tstates = trace.records[instruction].tstates + 2;
+        const auto& info = reader.getChunk(reader.findTstates(tstates));
+        ok = ok && instruction >= info.firstInstruction && instruction < info.firstInstruction + info.records;
+    }
+    ok = ok && reader.findInstruction(trace.records.size()) == reader.getChunkCount() && reader.findTstates(0) == 0;
+    std::filesystem::remove(path);
+    return ok;
+}
+
+bool test_rejects_unclosed_and_corrupt_files() {
+    std::string path = temp_path("z80_trace_columns_bad.z80c");
+    SyntheticTrace trace = make_synthetic(3000);
+    write_synthetic(trace, path, 1000);
+    Z80ColumnTrace reader;
+    bool closedOk = reader.open(path);
+
+    // Damage the first chunk: the index still opens, the chunk no longer decodes
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(Z80ColumnTraceWriter::kHeaderSize + 1);
+        file.put(static_cast<char>(0xFF));
+    }
+    Z80ColumnTrace damaged;
+    Z80TraceChunk chunk;
+    bool damagedRejected = damaged.open(path) && !damaged.decodeChunk(0, chunk) && damaged.decodeChunk(1, chunk);
+
+    // A trace without its index, as left by a crash
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(16);
+        for (int idx = 0; idx < 8; idx++) {
+            file.put(0);
+        }
+    }
+    Z80ColumnTrace unclosed;
+    bool unclosedRejected = !unclosed.open(path);
+    std::filesystem::remove(path);
+    return closedOk && damagedRejected && unclosedRejected;
+}
+
+bool test_analyzer_matches_core_histogram() {
+    std::string path = temp_path("z80_trace_columns_mix.z80c");
+    Z80OpcodeHistogram coreHistogram;
+    uint64_t records = 0;
+    {
+        auto machine = std::make_unique<Z80Machine>();
+        machine->getMemory().load(0, kMixProgram.data(), kMixProgram.size());
+        machine->getCpu().setOpcodeHistogram(&coreHistogram);
+        Z80ColumnTraceWriter writer(path, 2048);
+        machine->runTraced(UINT64_MAX, writer);
+        records = writer.getRecords();
+        if (!writer.close()) {
+            return false;
+        }
+    }
+
+    Z80ColumnTrace trace;
+    if (!trace.open(path)) {
+        return false;
+    }
+    Z80TraceStats serial = Z80TraceAnalyzer::analyze(trace, 1);
+    Z80TraceStats parallel = Z80TraceAnalyzer::analyze(trace, 4);
+    std::filesystem::remove(path);
+
+    bool sameOpcodes = true;
+    for (size_t table = 0; table < Z80OpcodeHistogram::kTables; table++) {
+        for (uint32_t opcode = 0; opcode < 256; opcode++) {
+            auto id = static_cast<Z80OpcodeTable>(table);
+            auto byte = static_cast<uint8_t>(opcode);
+            sameOpcodes = sameOpcodes && parallel.opcodes.get(id, byte) == coreHistogram.get(id, byte)
+                          && serial.opcodes.get(id, byte) == coreHistogram.get(id, byte);
+        }
+    }
+    auto hot = parallel.getHotPCs(3);
+    bool writesPerAddress = true;
+    for (uint32_t address = 0x8000; address < 0x8400; address++) {
+        writesPerAddress = writesPerAddress && parallel.writeCounts[address] == 2;
+    }
+    return sameOpcodes && parallel.records == records && parallel.chunks == trace.getChunkCount()
+           && parallel.writes == 3 * 1024 && serial.writes == parallel.writes && writesPerAddress
+           && parallel.corruptChunks == 0 && hot.size() == 3 && hot[0].second == 1024;
+}
+
+// The same machine run through both trace formats
+bool test_machine_trace_formats_agree() {
+    std::string streamPath = temp_path("z80_trace_columns_stream.z80t");
+    std::string columnPath = temp_path("z80_trace_columns_machine.z80c");
+    {
+        Z80Machine machine;
+        machine.getMemory().load(0, kMixProgram.data(), kMixProgram.size());
+        Z80TraceWriter writer(streamPath);
+        machine.runTraced(UINT64_MAX, writer);
+    }
+    {
+        Z80Machine machine;
+        machine.getMemory().load(0, kMixProgram.data(), kMixProgram.size());
+        Z80ColumnTraceWriter writer(columnPath, 4096);
+        machine.runTraced(UINT64_MAX, writer);
+    }
+
+    Z80TraceReader stream;
+    Z80ColumnTrace columns;
+    bool ok = stream.open(streamPath) && columns.open(columnPath);
+    Z80TraceChunk chunk;
+    Z80TraceRecord record{};
+    uint64_t compared = 0;
+    uint64_t writes = 0;
+    for (size_t idx = 0; ok && idx < columns.getChunkCount(); idx++) {
+        ok = columns.decodeChunk(idx, chunk);
+        for (size_t rec = 0; ok && rec < chunk.size(); rec++, compared++) {
+            ok = stream.next(record) && record == chunk.record(rec);
+        }
+        writes += chunk.writeAddress.size();
+    }
+    ok = ok && !stream.next(record) && compared == columns.getRecords();
+
+    // The columnar file also holds the memory writes, which the stream format has no room for
+    auto columnBytes = std::filesystem::file_size(columnPath);
+    auto streamBytes = std::filesystem::file_size(streamPath);
+    std::cout << std::fixed << std::setprecision(2) << "  " << compared << " records: columnar "
+              << static_cast<double>(columnBytes) / compared << " bytes/record with " << writes << " writes, stream "
+              << static_cast<double>(streamBytes) / compared << " bytes/record" << '\n';
+    std::filesystem::remove(streamPath);
+    std::filesystem::remove(columnPath);
+    return ok && writes == 3 * 1024 && columnBytes < compared * sizeof(Z80TraceRecord) / 3;
+}
+
+// Informational: analysis throughput on one and several threads
+bool test_parallel_analysis_throughput() {
+    SyntheticTrace trace = make_synthetic(400000);
+    std::string path = temp_path("z80_trace_columns_big.z80c");
+    if (!write_synthetic(trace, path, 1 << 14)) {
+        return false;
+    }
+    Z80ColumnTrace reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+
+    size_t threads = std::max<unsigned>(2, std::thread::hardware_concurrency());
+    auto start = std::chrono::steady_clock::now();
+    Z80TraceStats serial = Z80TraceAnalyzer::analyze(reader, 1);
+    double serialSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    Z80TraceStats parallel = Z80TraceAnalyzer::analyze(reader, threads);
+    double parallelSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::filesystem::remove(path);
+
+    std::cout << std::fixed << std::setprecision(1) << "  " << reader.getChunkCount() << " chunks: 1 thread "
+              << serial.records / serialSeconds / 1e6 << " M records/s, " << threads << " threads "
+              << parallel.records / parallelSeconds / 1e6 << " M records/s" << '\n';
+    return serial.records == trace.records.size() && parallel.records == serial.records
+           && parallel.writes == serial.writes && parallel.getHotPCs(10) == serial.getHotPCs(10);
+}
+
+int main() {
+    return runTests("Z80 Columnar Trace Test Suite", {
+        {"Round trip with memory writes", test_round_trip},
+        {"Random access by instruction and T-state", test_random_access},
+        {"Unclosed and corrupt files", test_rejects_unclosed_and_corrupt_files},
+        {"Analyzer matches the core histogram", test_analyzer_matches_core_histogram},
+        {"Machine trace formats agree", test_machine_trace_formats_agree},
+        {"Parallel analysis throughput", test_parallel_analysis_throughput},
+    });
+}
@@ -0,0 +1,256 @@
+// Z80 Trace Test Suite
+// Fixed-size execution records compressed and streamed to disk from a background thread
+
+#include "../include/z80_machine.h"
+#include "../include/z80_trace.h"
+#include "test_runner.h"
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Fills two buffers in a 4096 pass loop; the subroutine rewrites its own LD D,n operand on every call
+const std::vector<uint8_t> kTracedProgram = {
+    0x31, 0x00, 0xF0,       // 0x0000: LD SP,0xF000
+    0xDD, 0x21, 0x00, 0x80, // LD IX,0x8000
+    0x21, 0x00, 0x90,       // LD HL,0x9000
+    0x01, 0x00, 0x10,       // LD BC,0x1000
+    0x7D,                   // 0x000D loop: LD A,L
+    0x87,                   // ADD A,A
+    0xDD, 0x77, 0x00,       // LD (IX+0),A
+    0xDD, 0x23,             // INC IX
+    0x77,                   // LD (HL),A
+    0x23,                   // INC HL
+    0xC5,                   // PUSH BC
+    0xCD, 0x30, 0x00,       // CALL sub
+    0xC1,                   // POP BC
+    0x0B,                   // DEC BC
+    0x78,                   // LD A,B
+    0xB1,                   // OR C
+    0x20, 0xED,             // JR NZ,loop
+    0x76,                   // HALT
+};
+
+const std::vector<uint8_t> kSubroutine = {
+    0x3A, 0x38, 0x00, // 0x0030 sub: LD A,(0x0038)
+    0x3C,             // INC A
+    0x32, 0x38, 0x00, // LD (0x0038),A
+    0x16, 0x00,       // LD D,n
+    0xC9,             // RET
+};
+
+void load_program(Z80Machine& machine) {
+    machine.getMemory().load(0x0000, kTracedProgram.data(), kTracedProgram.size());
+    machine.getMemory().load(0x0030, kSubroutine.data(), kSubroutine.size());
+}
+
+std::vector<Z80TraceRecord> read_trace(const std::string& path, bool& corrupt) {
+    std::vector<Z80TraceRecord> records;
+    Z80TraceReader reader;
+    corrupt = !reader.open(path);
+    Z80TraceRecord record{};
+    while (!corrupt && reader.next(record)) {
+        records.push_back(record);
+    }
+    corrupt = corrupt || reader.isCorrupt();
+    return records;
+}
+
+bool test_codec_round_trip() {
+    std::mt19937 rng(0x7ACE);
+    std::vector<Z80TraceRecord> records(5000);
+    uint64_t tstates = 0;
+    for (size_t idx = 0; idx < records.size(); idx++) {
+        Z80TraceRecord& rec = records[idx];
+        tstates += 4 + rng() % (idx % 100 == 0 ? 100000 : 20);
+        rec.tstates = tstates;
+        rec.pc = static_cast<uint16_t>(idx % 7 == 0 ? rng() : 0x100 + idx % 50);
+        rec.bytes = idx % 3 == 0 ? rng() : 0x000000C9;
+        rec.af = static_cast<uint16_t>(rng());
+        rec.bc = static_cast<uint16_t>(idx % 2 == 0 ? rng() : 0);
+        rec.de = 0xFFFF;
+        rec.hl = static_cast<uint16_t>(idx);
+        rec.ix = static_cast<uint16_t>(0x8000 - idx);
+        rec.iy = 0x5C3A;
+        rec.sp = static_cast<uint16_t>(0xF000 - (idx % 5) * 2);
+        rec.r = static_cast<uint8_t>(idx * 3);
+        rec.status = static_cast<uint8_t>(idx % 11 == 0 ? 0x0B : 0x03);
+        rec.reserved = 0;
+    }
+
+    Z80TraceCodec codec;
+    std::vector<uint8_t> encoded;
+    codec.encode(records.data(), records.size(), encoded);
+    std::vector<Z80TraceRecord> decoded;
+    bool ok = codec.decode(encoded.data(), encoded.size(), records.size(), decoded);
+
+    std::vector<Z80TraceRecord> truncated;
+    bool truncatedOk = codec.decode(encoded.data(), encoded.size() - 1, records.size(), truncated);
+    return ok && decoded == records && !truncatedOk;
+}
+
+bool test_trace_matches_execution() {
+    std::string path = temp_path("z80_trace_test.z80t");
+    uint64_t appended = 0;
+    {
+        Z80Machine machine;
+        load_program(machine);
+        Z80TraceWriter writer(path, 1000, 3);
+        machine.runTraced(UINT64_MAX, writer);
+        appended = writer.getRecords();
+        writer.close();
+        if (!writer.good()) {
+            return false;
+        }
+    }
+
+    bool corrupt = false;
+    std::vector<Z80TraceRecord> records = read_trace(path, corrupt);
+    std::filesystem::remove(path);
+    if (corrupt || records.size() != appended) {
+        return false;
+    }
+
+    // Replay step by step through the getters
+    Z80Machine machine;
+    load_program(machine);
+    auto& cpu = machine.getCpu();
+    for (const Z80TraceRecord& record : records) {
+        uint16_t pc = cpu.getRegPC();
+        uint32_t bytes = machine.getMemory().read16(pc) | (machine.getMemory().read16(pc + 2) << 16);
+        if (record.pc != pc || record.tstates != machine.getTstates() || record.bytes != bytes) {
+            return false;
+        }
+        cpu.execute();
+        if (record.af != cpu.getRegAF() || record.bc != cpu.getRegBC() || record.de != cpu.getRegDE()
+            || record.hl != cpu.getRegHL() || record.ix != cpu.getRegIX() || record.sp != cpu.getRegSP()
+            || record.r != cpu.getRegR()) {
+            return false;
+        }
+    }
+    // The operand of LD D,n at 0x0037 is traced as rewritten by every call
+    uint32_t calls = 0;
+    for (const Z80TraceRecord& record : records) {
+        if (record.pc == 0x0037 && record.bytes != (0xC90016U | (++calls & 0xFF) << 8)) {
+            return false;
+        }
+    }
+    return cpu.isHalted() && calls == 4096 && (records.back().status & 0x04) != 0;
+}
+
+bool test_slow_writer_loses_nothing() {
+    std::string path = temp_path("z80_trace_test_small.z80t");
+    uint64_t stalls = 0;
+    uint64_t appended = 0;
+    {
+        Z80Machine machine;
+        load_program(machine);
+        // Two blocks of 64 records: the emulation thread keeps catching up with the writer
+        Z80TraceWriter writer(path, 64, 2);
+        machine.runTraced(UINT64_MAX, writer);
+        appended = writer.getRecords();
+        writer.close();
+        stalls = writer.getStalls();
+    }
+
+    bool corrupt = false;
+    std::vector<Z80TraceRecord> records = read_trace(path, corrupt);
+    std::filesystem::remove(path);
+    bool ordered = true;
+    for (size_t idx = 1; idx < records.size(); idx++) {
+        ordered = ordered && records[idx].tstates > records[idx - 1].tstates;
+    }
+    std::cout << "  " << appended << " records in blocks of 64, " << stalls << " stalls" << '\n';
+    return !corrupt && records.size() == appended && ordered;
+}
+
+bool test_unwritable_path() {
+    Z80TraceWriter writer(temp_path("no_such_dir/z80_trace_test.z80t"));
+    Z80Machine machine;
+    load_program(machine);
+    machine.runTraced(10000, writer);
+    writer.close();
+    return !writer.good();
+}
+
+// CPU time of the calling thread, which leaves out the writer thread; 0 where not available
+double thread_cpu_seconds() {
+#ifdef __linux__
+    timespec now{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_nsec) * 1e-9;
+#else
+    return 0;
+#endif
+}
+
+/* Informational: cost of tracing against a plain run, and the size of the
+ * trace. The emulation thread figure is what the target is about: with a
+ * spare core the writer encodes in parallel. Wall time adds the encoding
+ * when the writer has to share a core with the emulation. */
+bool test_tracing_overhead() {
+    constexpr int kRuns = 20;
+    constexpr double kSlowdownTarget = 2.0;
+    // Best of the runs, in wall time and in CPU time of this thread
+    double plainCpuSeconds = 1e9;
+    uint64_t instructions = 0;
+    double plainSeconds = bestSeconds(kRuns, [&]() {
+        Z80Machine machine;
+        load_program(machine);
+        double cpuStart = thread_cpu_seconds();
+        instructions = 0;
+        while (!machine.isFinished()) {
+            machine.getCpu().execute();
+            instructions++;
+        }
+        plainCpuSeconds = std::min(plainCpuSeconds, thread_cpu_seconds() - cpuStart);
+    });
+
+    std::string path = temp_path("z80_trace_test_overhead.z80t");
+    double tracedSeconds = 0;
+    double tracedCpuSeconds = 1e9;
+    uint64_t bytes = 0;
+    uint64_t records = 0;
+    {
+        Z80TraceWriter writer(path);
+        tracedSeconds = bestSeconds(kRuns, [&]() {
+            Z80Machine machine;
+            load_program(machine);
+            double cpuStart = thread_cpu_seconds();
+            machine.runTraced(UINT64_MAX, writer);
+            tracedCpuSeconds = std::min(tracedCpuSeconds, thread_cpu_seconds() - cpuStart);
+        });
+        records = writer.getRecords();
+        writer.close();
+        bytes = writer.getBytesWritten();
+    }
+    std::filesystem::remove(path);
+
+    // Reported, not enforced: timing on a shared host is too noisy to fail on
+    std::cout << std::fixed << std::setprecision(2) << "  plain " << plainSeconds * 1e9 / instructions
+              << " ns/instr, traced " << tracedSeconds * 1e9 / instructions << " ns/instr, "
+              << static_cast<double>(bytes) / records << " bytes/record on disk" << '\n';
+    auto report = [kSlowdownTarget](const char* label, double slowdown) {
+        std::cout << "  " << label << " slowdown " << slowdown << "x, target < " << kSlowdownTarget << "x "
+                  << (slowdown < kSlowdownTarget ? "met" : "NOT met") << '\n';
+    };
+    if (plainCpuSeconds > 0) {
+        report("emulation thread", tracedCpuSeconds / plainCpuSeconds);
+    }
+    report("wall clock", tracedSeconds / plainSeconds);
+    return records == kRuns * instructions && bytes < records * sizeof(Z80TraceRecord) / 3;
+}
+
+int main() {
+    return runTests("Z80 Trace Test Suite", {
+        {"Codec round trip", test_codec_round_trip},
+        {"Trace matches step by step execution", test_trace_matches_execution},
+        {"Slow writer loses nothing", test_slow_writer_loses_nothing},
+        {"Unwritable path is reported", test_unwritable_path},
+        {"Tracing overhead", test_tracing_overhead},
+    });
+}